@@ -403,7 +403,7 @@ auto getScopeAtPoint(std::string source, PythonLocation location) -> std::vector
     auto l = lcc::Location{
         (lcc::u32) location.byte_offset,
         (lcc::u16) location.length,
-        (lcc::u16) context.files().at(0)->file_id()
+        (lcc::u16) context.file(0)->file_id()
     };
     auto s = m->enclosing_scope(l);
     std::vector<std::vector<std::string>> out{};
@@ -418,9 +418,10 @@ auto getDiagnostics(std::string source) -> std::vector<PythonDiagnostic> {
     auto context = default_context();
     auto maybe_m = get_analysed_module(context, source);
 
+    auto diagnostics = context.diagnostics();
     std::vector<PythonDiagnostic> out{};
-    out.reserve(context.diagnostics().size());
-    for (auto d : context.diagnostics()) {
+    out.reserve(diagnostics.size());
+    for (const auto& d : diagnostics) {
         auto kind = PythonDiagnostic::Severity::None;
         switch (d.kind) {
             case lcc::Diag::Kind::None: break;
@@ -510,7 +511,7 @@ PythonType getTypeAtPoint(std::string source, PythonLocation location) {
     auto l = lcc::Location{
         (lcc::u32) location.byte_offset,
         (lcc::u16) location.length,
-        (lcc::u16) context.files().at(0)->file_id()
+        (lcc::u16) context.file(0)->file_id()
     };
 
     auto found = getNodeAtPoint(*m, l);
@@ -428,6 +428,11 @@ public:
 struct GlintToken : public syntax::Token<TokenKind> {
     Expr* expression{};
 
+    /// For an identifier, the id its text was interned as in the
+    /// context (see Context::intern()), or 0 if it wasn't, e.g. for
+    /// a gensym.
+    u32 identifier{};
+
     /// Whether the expression bound by this token should
     /// only be evaluated once.
     bool eval_once = true;
@@ -1796,6 +1801,17 @@ public:
         Scope* scope
     ) -> Expr*;
 
+    /// Deep-copy an expression that may belong to another module, treating
+    /// references to `from_scope` as references to `to_scope`.
+    [[nodiscard]]
+    static auto CloneInto(
+        Module& mod,
+        Context* context,
+        Expr* expr,
+        Scope* from_scope,
+        Scope* to_scope
+    ) -> Expr*;
+
     /// Deep copy a vector of expressions.
     [[nodiscard]]
     static auto CloneInto(
@@ -26,6 +26,7 @@ class IRGen {
     usz total_for = 0;
     usz total_if = 0;
     usz total_string = 0;
+    usz total_sum_access = 0;
 
     void update_block(std::unique_ptr<lcc::Block> new_block) {
         block = new_block.get();
@@ -12,6 +12,7 @@
 #include <deque>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
 
 namespace lcc::glint {
@@ -51,6 +52,10 @@ class Lexer : public syntax::Lexer<GlintToken> {
 
     std::deque<Token> lookahead_tokens{};
     std::deque<Macro> macros{};
+    /// Lookup table from the interned name of a macro to its definition
+    /// in `macros`; the deque never moves its elements, so these pointers
+    /// stay valid.
+    std::unordered_map<u32, Macro*> macro_index{};
     std::vector<MacroExpansion> macro_expansion_stack{};
     bool raw_mode = false;
     bool looking_ahead = false;
@@ -64,6 +69,11 @@ class Lexer : public syntax::Lexer<GlintToken> {
     static constexpr u32 DigitSeparator = '\'';
     void NextNumber();
 
+    /// Return the macro whose name was interned as \p name, or nullptr
+    /// if there is none.
+    [[nodiscard]]
+    auto FindMacro(u32 name) -> Macro*;
+
     void ExpandMacro(Macro& m);
     void HandleMacroDefinition();
 
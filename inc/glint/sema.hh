@@ -6,7 +6,9 @@
 
 #include <glint/ast.hh>
 
+#include <span>
 #include <string>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -56,6 +58,11 @@ class Sema {
     /// Whether to use colours in diagnostics.
     bool _use_colours;
 
+    // Dynamic array appends (`+=`) whose capacity has already been reserved
+    // by a preceding, fused capacity check.
+    // \see ReserveDynamicArrayAppendRun()
+    std::unordered_set<const BinaryExpr*> _reserved_dynarray_appends{};
+
     Sema(Context* ctx, Module& module, bool use_colours)
         : context(ctx)
         , mod(module)
@@ -165,6 +172,41 @@ private:
         bool no_return = false
     );
 
+    // Given the first of a run of consecutive `+=` appends to the same
+    // dynamic array within a block (i.e. `s += `a`; s += "bc";`), replace it
+    // with a group that first reserves capacity for every element the run
+    // appends, and mark each append in the run so that it skips its own
+    // capacity check.
+    void ReserveDynamicArrayAppendRun(Expr** expr_ptr, std::span<Expr*> following);
+
+    // Whether `container` is a fixed array, array view, or dynamic array
+    // whose element type is `element_type`.
+    auto IsArrayOf(Expr* container, Type* element_type) -> bool;
+
+    // If `container` is a fixed array, array view, or dynamic array whose
+    // element type is `element_type`, return an expression pointing to its
+    // first element and an expression evaluating to its element count.
+    // Otherwise, return a pair of nullptr.
+    auto ArrayDataAndCount(Expr* container, Type* element_type) -> std::pair<Expr*, Expr*>;
+
+    // Unless the expression at `expr_ptr` may be evaluated more than once
+    // without side effects (i.e. a name or a literal), declare a local
+    // temporary initialised with it in the current scope, replace it with a
+    // reference to that temporary, and return the (analysed) declaration,
+    // which must be evaluated before any use of the reference.
+    // Otherwise, return nullptr.
+    auto BindToTemporary(Expr** expr_ptr) -> Expr*;
+
+    // Declare an external variable (imported) at the global scope with the
+    // given name.
+    void DeclareImportedGlobalVariable(std::string name, Type* type);
+
+    // Create an expression that evaluates to the C runtime's `FILE*` for
+    // standard output on the current target. Used by `print` to write
+    // entire byte containers at once via `fwrite`.
+    [[nodiscard]]
+    auto StandardOutputStream(Location location) -> Expr*;
+
     /// Analyse an expression and discard it.
     /// \see Discard.
     [[nodiscard]]
@@ -12,6 +12,7 @@ class Value;
 class Inst;
 class Block;
 class Function;
+class DomTree;
 class MInst;
 class MBlock;
 class MFunction;
@@ -3,19 +3,28 @@
 #include <lcc/ir/module.hh>
 #include <lcc/target.hh>
 #include <lcc/utils/colours.hh>
+#include <lcc/utils/thread_pool.hh>
 
 #include <lccbase/context.hh>
 
 #include <fmt/format.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <charconv>
+#include <chrono>
 #include <concepts>
 #include <filesystem>
+#include <iterator>
+#include <ranges>
 #include <span>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <tuple>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 // TODO: Would be cool to have >= syntax to start a "continuation" test
@@ -28,6 +37,66 @@
 
 namespace langtest {
 
+/// Number of tests to run at the same time (`-j`). This is capped by
+/// the size of the shared thread pool, which has one thread per
+/// hardware thread.
+inline unsigned job_count = unsigned(lcc::utils::ThreadPool::hardware_threads());
+
+/// Output of the test running on this thread, if any.
+inline thread_local std::string* test_output{};
+
+/// Print test output. While a test is running, this goes to a buffer
+/// that is printed once all tests have run, so that tests running at
+/// the same time don't mix their output and it is always printed in
+/// the same order.
+template <typename... Args>
+void print(fmt::format_string<Args...> fmt, Args&&... args) {
+    if (test_output) fmt::format_to(std::back_inserter(*test_output), fmt, std::forward<Args>(args)...);
+    else fmt::print(fmt, std::forward<Args>(args)...);
+}
+
+struct TestResult {
+    bool passed{};
+    std::chrono::steady_clock::duration time{};
+    std::string output{};
+};
+
+/// Run `count` tests on up to `job_count` threads of the shared thread
+/// pool. `run(i)` runs the test with index `i` and returns whether it
+/// passed. What a test prints, diagnostics included, ends up in the
+/// output of its result.
+///
+/// \return The results, in the same order as the tests.
+template <typename Run>
+auto run_tests(size_t count, Run run) -> std::vector<TestResult> {
+    std::vector<TestResult> results(count);
+    lcc::utils::ThreadPool::shared().for_each_index(
+        count,
+        [&](size_t i) {
+            auto& result = results[i];
+            test_output = &result.output;
+            lcc::Diag::output = &result.output;
+            auto start = std::chrono::steady_clock::now();
+            result.passed = run(i);
+            result.time = std::chrono::steady_clock::now() - start;
+            lcc::Diag::output = nullptr;
+            test_output = nullptr;
+        },
+        job_count
+    );
+    return results;
+}
+
+/// Parse the argument of `-j`.
+inline bool parse_job_count(std::string_view arg) {
+    unsigned jobs{};
+    auto [end, ec] = std::from_chars(arg.data(), arg.data() + arg.size(), jobs);
+    if (ec != std::errc{} or end != arg.data() + arg.size() or jobs == 0)
+        return false;
+    job_count = jobs;
+    return true;
+}
+
 struct MatchTree {
     std::string_view name{};
     std::vector<MatchTree> children{};
@@ -104,14 +173,14 @@ struct Test {
         switch (warning_point) {
             case langtest::Test::WarningPoint::Syntax:
                 if (not warned_parse) {
-                    fmt::print("Expected warning from parser, but one was not emitted.\n");
+                    langtest::print("Expected warning from parser, but one was not emitted.\n");
                     return false;
                 }
                 break;
 
             case langtest::Test::WarningPoint::Sema:
                 if (not warned_check) {
-                    fmt::print("Expected warning from sema, but one was not emitted.\n");
+                    langtest::print("Expected warning from sema, but one was not emitted.\n");
                     return false;
                 }
                 break;
@@ -119,7 +188,7 @@ struct Test {
             // No warning point means no warnings are expected.
             case langtest::Test::WarningPoint::None:
                 if (warned_parse or warned_check) {
-                    fmt::print("Expected no warnings, but warnings were emitted.\n");
+                    langtest::print("Expected no warnings, but warnings were emitted.\n");
                     return false;
                 }
                 break;
@@ -128,7 +197,7 @@ struct Test {
         switch (failure_point) {
             case langtest::Test::FailurePoint::Syntax:
                 if (not failed_parse) {
-                    fmt::print("Expected parse failure, but parsing succeeded.\n");
+                    langtest::print("Expected parse failure, but parsing succeeded.\n");
                     return false;
                 }
                 break;
@@ -136,11 +205,11 @@ struct Test {
             // Failure Point at sema means parsing is expected to succeed.
             case langtest::Test::FailurePoint::Sema:
                 if (failed_parse) {
-                    fmt::print("Expected sema failure, which implies parsing success, but parsing failed.\n");
+                    langtest::print("Expected sema failure, which implies parsing success, but parsing failed.\n");
                     return false;
                 }
                 if (not failed_check) {
-                    fmt::print("Expected sema failure, but sema succeeded.\n");
+                    langtest::print("Expected sema failure, but sema succeeded.\n");
                     return false;
                 }
                 break;
@@ -148,21 +217,21 @@ struct Test {
             case langtest::Test::FailurePoint::None:
                 // No failure point means parsing and checking is expected to succeed.
                 if (failed_parse) {
-                    fmt::print("Expected no failures, but parsing failed.\n");
+                    langtest::print("Expected no failures, but parsing failed.\n");
                     return false;
                 }
                 if (failed_check) {
-                    fmt::print("Expected no failures, but sema failed.\n");
+                    langtest::print("Expected no failures, but sema failed.\n");
                     return false;
                 }
                 // No failure point means matching is performed, and expected to
                 // succeed.
                 if (not matched_ast) {
-                    fmt::print("Expected AST to match, but AST did not match.\n");
+                    langtest::print("Expected AST to match, but AST did not match.\n");
                     return false;
                 }
                 if (not matched_ir) {
-                    fmt::print("Expected IR to match, but IR did not match.\n");
+                    langtest::print("Expected IR to match, but IR did not match.\n");
                     return false;
                 }
                 break;
@@ -185,6 +254,8 @@ class TestContext {
     // but, for now, we duplicate them.
     std::vector<std::string> _completed_tests{};
     std::vector<std::string> _passing_tests{};
+    // How long each completed test took, in the same order.
+    std::vector<std::chrono::steady_clock::duration> _times{};
 
 public:
     [[nodiscard]]
@@ -219,12 +290,44 @@ public:
     void merge(const TestContext& other) {
         _completed_tests.append_range(other._completed_tests);
         _passing_tests.append_range(other._passing_tests);
+        _times.append_range(other._times);
     }
 
-    void record_test(const Test& test, bool passed) {
-        _completed_tests.emplace_back(test.name);
+    void record_test(
+        std::string_view name,
+        bool passed,
+        std::chrono::steady_clock::duration time = {}
+    ) {
+        _completed_tests.emplace_back(name);
+        _times.push_back(time);
         if (passed)
-            _passing_tests.emplace_back(test.name);
+            _passing_tests.emplace_back(name);
+    }
+
+    void record_test(const Test& test, bool passed) {
+        record_test(test.name, passed);
+    }
+
+    /// Print the tests that took the longest.
+    void print_slowest(size_t count = 10) const {
+        std::vector<size_t> indices(_completed_tests.size());
+        for (size_t i = 0; i < indices.size(); ++i) indices[i] = i;
+        count = std::min(count, indices.size());
+        std::ranges::partial_sort(
+            indices,
+            indices.begin() + std::ptrdiff_t(count),
+            std::ranges::greater{},
+            [&](size_t i) { return _times[i]; }
+        );
+
+        if (count) fmt::print("SLOWEST:\n");
+        for (auto i : indices | std::views::take(count)) {
+            fmt::print(
+                "  {:>9.3f}ms  {}\n",
+                std::chrono::duration<double, std::milli>(_times[i]).count(),
+                _completed_tests[i]
+            );
+        }
     }
 };
 
@@ -268,14 +371,14 @@ auto perform_match(TNode* e, MatchTree& t) -> bool {
     auto name = e->langtest_name();
     if (name != t.name) {
         // TODO: Record test failure, somewhere/somehow
-        fmt::print("\nMISMATCH: node name\n");
-        fmt::print("Expected {} but got {}\n", t.name, name);
+        langtest::print("\nMISMATCH: node name\n");
+        langtest::print("Expected {} but got {}\n", t.name, name);
         return false;
     }
 
     auto children = e->langtest_children();
     if (children.size() != t.children.size()) {
-        fmt::print("\nMISMATCH: child count\n");
+        langtest::print("\nMISMATCH: child count\n");
         return false;
     }
 
@@ -313,7 +416,7 @@ bool perform_ir_match_block(
     // Two blocks without the same number of instructions within them are
     // never equivalent.
     if (expected_block->instructions().size() != got_block->instructions().size()) {
-        fmt::print(
+        langtest::print(
             "IR MISMATCH: Instruction count in block {} in function {}\n",
             expected_block->name(),
             expected_block->function()->names().at(0).name
@@ -338,7 +441,7 @@ bool perform_ir_match_block(
             // fmt::print("Got IR:\n");
             // got_func->print();
 
-            fmt::print(
+            langtest::print(
                 "IR MISMATCH: Expected instruction (1) but got instruction (2) in block {} in function {}\n"
                 "(1): {}"
                 "(2): {}",
@@ -358,14 +461,16 @@ bool perform_ir_match_block(
         // comparison properly).
         auto expected_children = expected_inst->children();
         auto got_children = got_inst->children();
+        auto expected_it = expected_children.begin();
+        auto got_it = got_children.begin();
 
         size_t child_i = 0;
         while (
-            expected_children.begin() != expected_children.end()
-            and got_children.begin() != got_children.end()
+            expected_it != expected_children.end()
+            and got_it != got_children.end()
         ) {
-            auto* expected_child = *expected_children.begin();
-            auto* got_child = *got_children.begin();
+            auto* expected_child = *expected_it;
+            auto* got_child = *got_it;
 
             // If the expected child is an instruction, that means we can look it up
             // in our "expected instruction to got instruction" cache.
@@ -382,7 +487,7 @@ bool perform_ir_match_block(
                 // If the expected child instruction does not "map" to the actual child
                 // instruction we got, then these IRs do not match.
                 if (expected_to_got[expected_child_inst] != got_child) {
-                    fmt::print(
+                    langtest::print(
                         "IR MISMATCH: Expected operand {} (zero-based) of instruction (1) to reference (2), but it instead references (3)\n"
                         "(1): {}"
                         "(2): {}"
@@ -397,8 +502,8 @@ bool perform_ir_match_block(
                 }
             }
             // Advance iterators
-            ++expected_children.begin();
-            ++got_children.begin();
+            ++expected_it;
+            ++got_it;
             ++child_i;
         }
     }
@@ -426,7 +531,7 @@ bool perform_ir_match_function(
     auto got_func_in_ir
         = got.function_by_one_of_names(expected_function->names());
     if (not got_func_in_ir) {
-        fmt::print(
+        langtest::print(
             "IR MISMATCH: Expected function {} to be in IR, but didn't find it\n"
             "{}",
             expected_function->names().at(0).name,
@@ -438,7 +543,7 @@ bool perform_ir_match_function(
     auto* got_func = *got_func_in_ir;
 
     if (expected_function->blocks().size() != got_func->blocks().size()) {
-        fmt::print(
+        langtest::print(
             "IR MISMATCH: Block count in function {}\n",
             expected_function->names().at(0).name
         );
@@ -522,7 +627,7 @@ bool perform_ir_match(lcc::Module& got, langtest::Test& test) {
     auto& ir_f = got.context()->create_file("ir_source.lcc", std::move(ir_v));
     auto expected = lcc::Module::Parse(got.context(), ir_f);
     if (not expected) {
-        fmt::print("Error parsing expected IR for test {}\n", test.name);
+        langtest::print("Error parsing expected IR for test {}\n", test.name);
         return false;
     }
 
@@ -541,7 +646,7 @@ void parse_matchtree(
 
     if (i >= fsize or contents[i] == '=') {
         // TODO: file location
-        fmt::print("ERROR parse_matchtree was called but the test expects nothing (no matcher)\n");
+        langtest::print("ERROR parse_matchtree was called but the test expects nothing (no matcher)\n");
         return;
     }
 
@@ -553,7 +658,7 @@ void parse_matchtree(
 
     if (i >= fsize or contents[i] == '=') {
         // TODO: file location near list opening symbol
-        fmt::print("ERROR expected list closing symbol but got end of input\n");
+        langtest::print("ERROR expected list closing symbol but got end of input\n");
         return;
     }
 
@@ -573,7 +678,7 @@ void parse_matchtree(
     // Eat whitespace
     while (i < fsize and isspace(contents[i])) ++i;
     if (i >= fsize or contents[i] == '=') {
-        fmt::print("ERROR expected list closing symbol but got end of input\n");
+        langtest::print("ERROR expected list closing symbol but got end of input\n");
         return;
     }
 
@@ -585,7 +690,7 @@ void parse_matchtree(
         // Skip whitespace
         while (i < fsize and isspace(contents[i])) ++i;
         if (i >= fsize or contents[i] == '=') {
-            fmt::print("ERROR expected list closing symbol but got end of input\n");
+            langtest::print("ERROR expected list closing symbol but got end of input\n");
             return;
         }
     }
@@ -638,7 +743,7 @@ auto parse_test(
     { // Parse test name
         ToBeginningOfNextLine();
         if (i >= fsize) {
-            fmt::print("ERROR parsing first line of test\n");
+            langtest::print("ERROR parsing first line of test\n");
             return false;
         }
 
@@ -646,7 +751,7 @@ auto parse_test(
         size_t begin{i};
         ToNewline();
         if (i >= fsize) {
-            fmt::print("ERROR parsing name of test\n");
+            langtest::print("ERROR parsing name of test\n");
             return false;
         }
 
@@ -701,19 +806,19 @@ auto parse_test(
             ) {
                 test.failure_point = Test::FailurePoint::Sema;
             } else {
-                fmt::print("ERROR parsing test specifiers for test {}\n", test.name);
+                langtest::print("ERROR parsing test specifiers for test {}\n", test.name);
                 return false;
             }
         }
 
         if (contents[i] != '=') {
-            fmt::print("ERROR parsing closing name line of test {}. It should be all `=` characters\n", test.name);
+            langtest::print("ERROR parsing closing name line of test {}. It should be all `=` characters\n", test.name);
             return false;
         }
 
         ToBeginningOfNextLine();
         if (i >= fsize) {
-            fmt::print("ERROR parsing closing line of name of test {}\n", test.name);
+            langtest::print("ERROR parsing closing line of name of test {}\n", test.name);
             return false;
         }
     }
@@ -732,7 +837,7 @@ auto parse_test(
             // Error if the test is not expected to fail (nothing to match if it
             // is specified to fail)
             if (test.failure_point == Test::FailurePoint::None) {
-                fmt::print(
+                langtest::print(
                     "ERROR test has no matcher declared but it is not specified to fail... {}\n",
                     test.name
                 );
@@ -748,7 +853,7 @@ auto parse_test(
             ++i;
         if (i >= fsize) {
             // Got EOF when expected `(` (beginning of expected test output after `---`)
-            fmt::print("ERROR parsing expected of test {}\n", test.name);
+            langtest::print("ERROR parsing expected of test {}\n", test.name);
             return false;
         }
 
@@ -776,7 +881,7 @@ auto parse_test(
         // Skip `---` line
         ToBeginningOfNextLine();
         if (i >= fsize) {
-            fmt::print("ERROR parsing expected IR of test {}\n", test.name);
+            langtest::print("ERROR parsing expected IR of test {}\n", test.name);
             return false;
         }
 
@@ -816,12 +921,11 @@ template <typename TTest>
 concept langtest_test_requirements
     = langtest_test_has_run<TTest> and langtest_test_derived_from_test<TTest>;
 
+/// Parse all tests in the contents of a test file.
 template <typename TTest>
 requires langtest_test_requirements<TTest>
-auto parse_and_run_tests(
-    std::span<char> contents
-) -> TestContext {
-    TestContext context{};
+auto parse_tests(std::span<char> contents) -> std::vector<TTest> {
+    std::vector<TTest> tests{};
 
     auto fsize = contents.size();
     bool bol = true;
@@ -832,24 +936,42 @@ auto parse_and_run_tests(
         if (bol and c == '=') {
             TTest test{};
             if (parse_test(contents, fsize, i, test))
-                context.record_test(test, test.run());
+                tests.push_back(std::move(test));
             bol = true;
         } else bol = c == '\n';
     }
 
-    return context;
+    return tests;
 }
 
 template <typename TTest>
 requires langtest_test_requirements<TTest>
-auto process_ast_test_file(
-    const std::filesystem::path& path
+auto parse_and_run_tests(
+    std::span<char> contents
 ) -> TestContext {
+    TestContext context{};
+    auto tests = parse_tests<TTest>(contents);
+
+    // Run them, then report them in order.
+    auto results = run_tests(tests.size(), [&](size_t i) -> bool {
+        return tests[i].run();
+    });
+    for (size_t i = 0; i < tests.size(); ++i) {
+        fmt::print("{}", results[i].output);
+        context.record_test(tests[i].name, results[i].passed, results[i].time);
+    }
+
+    return context;
+}
+
+inline auto read_test_file(
+    const std::filesystem::path& path
+) -> std::vector<char> {
     // Read file
     auto path_str = path.string();
     auto* f = fopen(path_str.data(), "rb");
     if (not f) {
-        fmt::print("ERROR opening file {}\n", path_str);
+        langtest::print("ERROR opening file {}\n", path_str);
         return {};
     }
     fseek(f, 0, SEEK_END);
@@ -859,7 +981,7 @@ auto process_ast_test_file(
     contents.resize(fsize);
     auto nread = fread(contents.data(), 1, fsize, f);
     if (nread != fsize) {
-        fmt::print(
+        langtest::print(
             "ERROR reading file {}\n"
             "    Got {} bytes, expected {}\n",
             path_str,
@@ -871,7 +993,158 @@ auto process_ast_test_file(
     }
     fclose(f);
 
+    return contents;
+}
+
+template <typename TTest>
+requires langtest_test_requirements<TTest>
+auto process_ast_test_file(
+    const std::filesystem::path& path
+) -> TestContext {
+    auto contents = read_test_file(path);
     return parse_and_run_tests<TTest>(contents);
 }
 
+struct TestFileResults {
+    TestContext results{};
+    // Everything the tests in this file printed, in order.
+    std::string output{};
+};
+
+/// Run the tests in all of the given files together, so that tests
+/// from different files may run at the same time.
+///
+/// \return The results of each file, in the same order as the files.
+template <typename TTest>
+requires langtest_test_requirements<TTest>
+auto process_ast_test_files(
+    std::span<const std::filesystem::path> paths
+) -> std::vector<TestFileResults> {
+    // The tests refer to the contents of their file, so those have to
+    // stay around until all tests have run.
+    std::vector<std::vector<char>> contents{};
+    std::vector<std::pair<size_t, TTest>> tests{};
+    for (size_t file_index = 0; file_index < paths.size(); ++file_index) {
+        contents.push_back(read_test_file(paths[file_index]));
+        for (auto& test : parse_tests<TTest>(contents.back()))
+            tests.emplace_back(file_index, std::move(test));
+    }
+
+    auto results = run_tests(tests.size(), [&](size_t i) -> bool {
+        return tests[i].second.run();
+    });
+
+    std::vector<TestFileResults> out(paths.size());
+    for (size_t i = 0; i < tests.size(); ++i) {
+        auto& [file_index, test] = tests[i];
+        out[file_index].output += results[i].output;
+        out[file_index].results.record_test(test.name, results[i].passed, results[i].time);
+    }
+
+    return out;
+}
+
+/// Compile all tests in the given files on several threads at once,
+/// all in one context, and check that every test compiles to the same
+/// thing, and reports the same diagnostics, as it does in a context of
+/// its own.
+///
+/// Only tests that are expected to compile are used, since one error
+/// sets the error flag of the whole context, and the frontends stop
+/// at the next phase when that is set.
+///
+/// `compile(context, file, test)` compiles the test whose source is in
+/// `file` and returns what should be compared, e.g. the generated IR.
+template <typename TTest, typename Compile>
+requires langtest_test_requirements<TTest>
+auto compile_concurrently(
+    std::span<const std::filesystem::path> paths,
+    const lcc::Target* target,
+    const lcc::Format* format,
+    Compile compile
+) -> bool {
+    std::vector<std::vector<char>> contents{};
+    std::vector<TTest> tests{};
+    for (const auto& path : paths) {
+        contents.push_back(read_test_file(path));
+        for (auto& test : parse_tests<TTest>(contents.back()))
+            if (test.failure_point == Test::FailurePoint::None)
+                tests.push_back(std::move(test));
+    }
+    if (tests.empty()) return true;
+
+    // File ids depend on which thread gets to create its file first, so
+    // compare the diagnostics in each file without them. The order they
+    // are reported in depends on the threads, too, so sort them.
+    using Report = std::tuple<lcc::Diag::Kind, lcc::u32, lcc::u16, std::string>;
+    auto ReportsIn = [](const std::vector<lcc::Context::DiagnosticReport>& reports, lcc::u32 file_id) {
+        std::vector<Report> out{};
+        for (const auto& r : reports)
+            if (r.where.file_id == file_id)
+                out.emplace_back(r.kind, r.where.pos, r.where.len, r.message);
+        std::ranges::sort(out);
+        return out;
+    };
+
+    auto CompileInto = [&](lcc::Context& context, std::string name, const TTest& test) {
+        auto& file = context.create_file(
+            std::move(name),
+            std::vector<char>{test.source.begin(), test.source.end()}
+        );
+        return std::pair{compile(context, file, test), file.file_id()};
+    };
+
+    // A test that is expected to compile but doesn't (it fails on its
+    // own, too) would stop every other test in the shared context, so
+    // leave those out.
+    std::vector<TTest> compiling{};
+    std::vector<std::string> reference{};
+    std::vector<std::vector<Report>> reference_reports{};
+    for (auto& test : tests) {
+        lcc::Context context{target, format, {}};
+        context.suppress_diagnostics();
+        auto [output, file_id] = CompileInto(context, std::string{test.name}, test);
+        if (context.has_error()) continue;
+        reference.push_back(std::move(output));
+        reference_reports.push_back(ReportsIn(context.diagnostics(), file_id));
+        compiling.push_back(std::move(test));
+    }
+    tests = std::move(compiling);
+    if (tests.empty()) return true;
+
+    lcc::Context context{target, format, {}};
+    context.suppress_diagnostics();
+
+    static constexpr size_t thread_count = 8;
+    std::atomic<bool> passed{true};
+    std::vector<std::vector<lcc::u32>> file_ids(thread_count);
+    std::vector<std::thread> threads{};
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads.emplace_back([&, i] {
+            // Start each thread at a different test so they don't all
+            // compile the same thing at the same time.
+            file_ids[i].resize(tests.size());
+            for (size_t n = 0; n < tests.size(); ++n) {
+                auto index = (i + n) % tests.size();
+                auto [output, file_id] = CompileInto(
+                    context,
+                    fmt::format("concurrent.{}.{}", i, tests[index].name),
+                    tests[index]
+                );
+                file_ids[i][index] = file_id;
+                if (output != reference[index]) passed = false;
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    auto reports = context.diagnostics();
+    for (size_t i = 0; i < thread_count; ++i)
+        for (size_t index = 0; index < tests.size(); ++index)
+            if (ReportsIn(reports, file_ids[i][index]) != reference_reports[index])
+                passed = false;
+
+    return passed;
+}
+
 } // namespace langtest
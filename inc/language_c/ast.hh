@@ -38,7 +38,7 @@ struct Scope {
     void* operator new(size_t) = delete;
     [[nodiscard]]
     void* operator new(size_t size, TranslationUnit& tu) {
-        auto ptr = ::operator new(size);
+        auto ptr = tu.allocate(size);
         tu.allocated_scopes.push_back(static_cast<Scope*>(ptr));
         return ptr;
     };
@@ -63,6 +63,9 @@ struct Node {
     NodeKind _kind{NodeKind::Invalid};
     Location _location{};
 
+    // Filled in by semantic analysis, which only ever has a const Node*.
+    mutable Type* _analysed_type{nullptr};
+
 public:
     Node(NodeKind kind, Location location)
         : _kind(kind)
@@ -83,7 +86,7 @@ public:
     void* operator new(size_t) = delete;
     [[nodiscard]]
     void* operator new(size_t size, TranslationUnit& tu) {
-        auto ptr = ::operator new(size);
+        auto ptr = tu.allocate(size);
         tu.allocated_nodes.push_back(static_cast<const Node*>(ptr));
         return ptr;
     };
@@ -92,6 +95,10 @@ public:
     auto location() const { return _location; }
     auto location() -> Location& { return _location; }
 
+    // @return type given by semantic analysis, or nullptr if not yet known.
+    auto analysed_type() const { return _analysed_type; }
+    void analysed_type(Type* t) const { _analysed_type = t; }
+
     // Given "  _return 69_  ", where the underscores delineate the node's
     // location, return a location like "  return 69_ _ ".
     auto get_past_location() -> Location;
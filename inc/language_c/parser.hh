@@ -12,8 +12,12 @@
 #include <fmt/base.h>
 
 #include <list>
+#include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace lcc::language_c {
@@ -103,6 +107,11 @@ enum class TokenKind : unsigned int {
     RightCurlyBrace,
 
     Semicolon,
+
+    // Preprocessor operators; only produced within macro definitions.
+    Hash,
+    HashHash,
+
     Eof,
     Count,
 };
@@ -110,29 +119,159 @@ enum class TokenKind : unsigned int {
 using Token = syntax::Token<TokenKind>;
 
 class Lexer : public syntax::Lexer<Token> {
-    std::list<Token> _next_tokens{};
-    std::list<std::vector<char>> _including{};
-    usz _including_offset{};
+    /// Text of an included file that is still being read. The text
+    /// is owned by the context, which caches each file it loads.
+    struct IncludedFile {
+        const File* file;
+        std::string_view text;
+        usz offset{};
+        /// Whether anything but whitespace and comments has been read
+        /// from it yet.
+        bool started{false};
+        /// Set once the `#endif` of its include guard has been read.
+        bool guard_closed{false};
+    };
+
+    const File* _file;
 
-    StringMap<std::vector<Token>> _simple_defines{};
+    std::list<Token> _next_tokens{};
+    /// Innermost include first.
+    std::list<IncludedFile> _including{};
+
+    /// Resolved path of each `#include` spelling we've already seen;
+    /// quoted spellings are keyed by the directory they're relative to.
+    StringMap<fs::path> _resolved_includes{};
+    /// Files that have been marked with `#pragma once`.
+    std::unordered_set<const File*> _pragma_once_files{};
+    /// Files that are wholly enclosed in `#ifndef X`...`#endif`, and
+    /// their X; including one of them while X is defined does nothing.
+    std::unordered_map<const File*, std::string> _include_guards{};
+    /// The file the current token started in.
+    const File* _token_file{};
+
+    /// An `#ifdef` or `#ifndef` whose `#endif` we haven't seen yet.
+    struct Conditional {
+        Location location;
+        bool seen_else{false};
+        /// If this is an `#ifndef` that starts its file, the file and
+        /// the macro it tests; see `_include_guards`.
+        const File* guarded_file{};
+        std::string guard{};
+    };
+
+    /// Innermost last.
+    std::vector<Conditional> _conditionals{};
+
+    struct Macro {
+        std::vector<Token> replacement{};
+        std::vector<std::string> parameters{};
+        bool function_like{false};
+        /// The last parameter is `__VA_ARGS__`.
+        bool variadic{false};
+
+        /// Get the index of the parameter \p t names, if it names one.
+        [[nodiscard]]
+        auto parameter_index(const Token& t) const -> std::optional<usz> {
+            if (t.kind != TokenKind::Identifier) return std::nullopt;
+            auto found = rgs::find(parameters, t.text);
+            if (found == parameters.end()) return std::nullopt;
+            return usz(std::distance(parameters.begin(), found));
+        }
+    };
+
+    /// Tokens of a macro expansion that is still being read. Object-
+    /// like macros are read straight out of their definition; only
+    /// function-like macros build a new token list, once per call.
+    struct Expansion {
+        std::shared_ptr<const std::vector<Token>> tokens;
+        usz index{};
+        /// Macro that is disabled while this is being read, so that
+        /// self-referential macros don't expand forever. Empty for a
+        /// macro argument being expanded on its own.
+        std::string macro{};
+    };
+
+    /// Definitions are shared with the expansions reading from them, so
+    /// `#undef`ing a macro in the middle of its expansion is fine.
+    StringMap<std::shared_ptr<const Macro>> _macros{};
+    /// Innermost expansion last.
+    std::vector<Expansion> _expansions{};
+    /// Expansions at or below this depth are off-limits; see ExpandArgument().
+    usz _expansion_floor{};
 
     bool preprocessing{false};
 
     static constexpr std::string_view preprocessor_whitespace{" \t\f"};
-    Result<void> preprocessor_define(std::string_view name, std::vector<Token> contents);
+    Result<void> preprocessor_define(std::string_view name, std::shared_ptr<const Macro> macro);
     void preprocessor_undefine(std::string_view name);
 
+    /// Lex a token from the source, handling any directives before it.
+    void LexToken();
+
+    /// Get the next token without expanding it if it's a macro.
+    void NextUnexpandedToken();
+
+    /// If the identifier in `tok` names a macro that may be expanded
+    /// here, start reading its expansion and return true.
+    auto ExpandMacro() -> bool;
+
+    /// Read the arguments of a call to function-like macro \p name, up
+    /// to and including the closing parenthesis.
+    auto CollectArguments(std::string_view name, const Macro& macro)
+        -> std::optional<std::vector<std::vector<Token>>>;
+
+    /// Fully macro-expand a macro argument on its own.
+    auto ExpandArgument(const std::vector<Token>& argument) -> std::vector<Token>;
+
+    /// Replace the parameters of \p macro with \p arguments.
+    auto Substitute(const Macro& macro, const std::vector<std::vector<Token>>& arguments)
+        -> std::vector<Token>;
+
+    /// Apply the `#` operator.
+    auto Stringify(const std::vector<Token>& tokens, Location where) -> Token;
+
+    /// Apply the `##` operator.
+    auto Paste(const Token& lhs, const Token& rhs) -> Token;
+
+    /// Skip source up to the `#else` or `#endif` that ends the group
+    /// we're in, and handle that.
+    void SkipGroup();
+
+    /// Handle the rest of the `#else` or `#endif` directive whose name
+    /// is in `tok`. Returns false if there is no group for it to end.
+    auto EndGroup() -> bool;
+
+    /// Record that \p file has content besides whitespace, comments and
+    /// the directives seen so far.
+    void NoteContent(const File* file);
+
+    /// The file the lexer is currently reading from.
+    [[nodiscard]]
+    auto current_file() const -> const File* {
+        return _including.empty() ? _file : _including.front().file;
+    }
+
+    /// Find the file an `#include` directive refers to, or return
+    /// an empty path if there is none. Quoted includes are first
+    /// looked up relative to the file that contains them.
+    auto resolve_include(
+        std::string_view path,
+        bool quoted,
+        const File* includer,
+        std::vector<fs::path>& checked
+    ) -> fs::path;
+
     void NextNumber();
     void NextIdentifier();
 
 public:
     Lexer(Context* c, File* f)
-        : syntax::Lexer<Token>(c, f) {}
+        : syntax::Lexer<Token>(c, f), _file(f) {}
 
     void NextToken();
     void NextChar();
 
-    auto& defines() const { return _simple_defines; }
+    auto& defines() const { return _macros; }
 };
 
 class Parser : Lexer {
@@ -177,7 +316,7 @@ public:
 };
 
 std::string_view ToString(TokenKind k);
-Result<std::string> ToSource(Token&);
+Result<std::string> ToSource(const Token&);
 
 } // namespace lcc::language_c
 
@@ -15,8 +15,6 @@ class Sema {
     std::unordered_set<Node*> analysed{};
     Declaration* defining{};
 
-    std::unordered_map<const Node*, Type*> _type_cache{};
-
     [[nodiscard]]
     Result<Type*> type_of(const Node* n);
     void update_type(const Node*, Type*);
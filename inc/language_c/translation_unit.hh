@@ -3,6 +3,10 @@
 
 #include <hdronly/language_c/forward.hh>
 
+#include <lcc/stringmap.hh>
+
+#include <cstddef>
+#include <memory>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -14,11 +18,21 @@ struct TranslationUnit {
     Node* tree{};
     std::vector<std::string> string_literals{};
 
-    // Book-keeping of memory owned by this translation unit.
+    // Book-keeping of memory owned by this translation unit. Nodes, scopes
+    // and types live in arena blocks that are freed all at once; these lists
+    // are only kept so we can run their destructors.
     std::vector<const Node*> allocated_nodes{};
     std::vector<Scope*> allocated_scopes{};
     std::vector<const Type*> allocated_types{};
 
+    static constexpr size_t arena_block_size{64 * 1024};
+    std::vector<std::unique_ptr<std::byte[]>> arena_blocks{};
+    std::byte* arena_cursor{};
+    size_t arena_remaining{};
+
+    // Index of each interned string in `string_literals`.
+    StringMap<size_t> interned_strings{};
+
     // Filled in by semantic analysis.
     std::vector<const Declaration*> functions{};
     std::vector<const Declaration*> globals{};
@@ -36,6 +50,11 @@ struct TranslationUnit {
 
     // @return index of given string after interning.
     size_t intern(std::string_view);
+
+    // @return memory for a node, scope or type, suitably aligned for any
+    // of them. Owned by the translation unit.
+    [[nodiscard]]
+    void* allocate(size_t size);
 };
 
 } // namespace lcc::language_c
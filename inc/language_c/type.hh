@@ -68,7 +68,7 @@ public:
     void* operator new(size_t) = delete;
     [[nodiscard]]
     void* operator new(size_t size, TranslationUnit& tu) {
-        auto ptr = ::operator new(size);
+        auto ptr = tu.allocate(size);
         tu.allocated_types.push_back(static_cast<const Type*>(ptr));
         return ptr;
     };
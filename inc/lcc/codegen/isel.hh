@@ -761,7 +761,7 @@ struct PatternList {
 
                                 auto& operand = instruction->all_operands().at(op_i);
                                 static_assert(
-                                    std::variant_size_v<MOperand> == 6,
+                                    std::variant_size_v<MOperand> == 7,
                                     "Exhaustive handling of MOperand alternatives in instruction selection"
                                 );
                                 if (std::holds_alternative<MOperandImmediate>(operand)) {
@@ -779,6 +779,10 @@ struct PatternList {
                                     operands_match = op::kind == OperandKind::Function;
                                 } else if (std::holds_alternative<MOperandBlock>(operand)) {
                                     operands_match = op::kind == OperandKind::Block;
+                                } else if (std::holds_alternative<MOperandMemory>(operand)) {
+                                    // Memory operands are only created by in-code selection, after
+                                    // which no pattern should touch the instruction.
+                                    operands_match = false;
                                 } else LCC_ASSERT(false, "Unhandled MIR Operand Kind in ISel...");
                                 ++op_i;
                             });
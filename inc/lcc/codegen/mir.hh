@@ -64,6 +64,16 @@ struct LocalOp {
     i32 offset{0};
 };
 
+// A memory operand: base + index * scale + displacement.
+struct Memory {
+    Register base{};
+    // Not present if the register value is zero.
+    Register index{};
+    // One of 1, 2, 4, or 8.
+    u8 scale{1};
+    i32 displacement{0};
+};
+
 // Machine Operand
 using MOperandRegister = Register;
 using MOperandImmediate = Immediate;
@@ -71,13 +81,15 @@ using MOperandLocal = LocalOp;
 using MOperandGlobal = GlobalVariable*;
 using MOperandFunction = Function*;
 using MOperandBlock = Block*;
+using MOperandMemory = Memory;
 using MOperand = std::variant<
     MOperandRegister,
     MOperandImmediate,
     MOperandLocal,
     MOperandGlobal,
     MOperandFunction,
-    MOperandBlock>;
+    MOperandBlock,
+    MOperandMemory>;
 
 class MInst {
 public:
@@ -91,6 +103,7 @@ public:
         Intrinsic,
         Load,
         Phi,
+        Select,
         Store,
 
         /// Terminators
@@ -491,6 +504,7 @@ inline std::string ToString(MInst::Kind k) {
         case MInst::Kind::Intrinsic: return "M.Intrinsic";
         case MInst::Kind::Load: return "M.Load";
         case MInst::Kind::Phi: return "M.Phi";
+        case MInst::Kind::Select: return "M.Select";
         case MInst::Kind::Store: return "M.Store";
         case MInst::Kind::Branch: return "M.Branch";
         case MInst::Kind::CondBranch: return "M.CondBranch";
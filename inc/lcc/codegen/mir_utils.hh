@@ -98,6 +98,13 @@ inline auto extract_reg_global(MInst& inst) {
     return extract_two_operand<MOperandRegister, MOperandGlobal>(inst);
 }
 
+inline bool is_reg_mem(MInst& inst) {
+    return is_two_operand<MOperandRegister, MOperandMemory>(inst);
+}
+inline auto extract_reg_mem(MInst& inst) {
+    return extract_two_operand<MOperandRegister, MOperandMemory>(inst);
+}
+
 inline bool is_imm_reg(MInst& inst) {
     return is_two_operand<MOperandImmediate, MOperandRegister>(inst);
 }
@@ -130,6 +137,13 @@ inline auto extract_local_reg(MInst& inst) {
     return extract_two_operand<MOperandLocal, MOperandRegister>(inst);
 }
 
+inline bool is_mem_reg(MInst& inst) {
+    return is_two_operand<MOperandMemory, MOperandRegister>(inst);
+}
+inline auto extract_mem_reg(MInst& inst) {
+    return extract_two_operand<MOperandMemory, MOperandRegister>(inst);
+}
+
 inline bool is_global_reg(MInst& inst) {
     return is_two_operand<MOperandGlobal, MOperandRegister>(inst);
 }
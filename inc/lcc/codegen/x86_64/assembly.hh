@@ -10,6 +10,11 @@
 
 namespace lcc::x86_64 {
 
+/// Size of the stack frame of a function, in bytes: its locals,
+/// followed by a slot for each spilled register, aligned to 16 bytes.
+/// This is exactly what the function subtracts from %rsp on entry.
+auto frame_size(const MFunction&) -> usz;
+
 void emit_gnu_att_assembly(
     const fs::path&,
     lcc::Module*,
@@ -130,8 +130,8 @@ using s_ext_imm = Pattern<
 using not_reg = Pattern<
     InstList<Inst<Clobbers<>, usz(MKind::Compl), Register<>>>,
     InstList<
-        Inst<Clobbers<>, usz(Opcode::Not), o<0>>,
-        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>>>;
+        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>,
+        Inst<Clobbers<c<0>>, usz(Opcode::Not), i<0>>>>;
 
 using sar_imm_imm = Pattern<
     InstList<Inst<Clobbers<>, usz(MKind::Sar), Immediate<>, Immediate<>>>,
@@ -182,62 +182,65 @@ using shl_imm_reg = Pattern<
 using sar_reg_imm = Pattern<
     InstList<Inst<Clobbers<>, usz(MKind::Sar), Register<>, Immediate<>>>,
     InstList<
-        Inst<Clobbers<c<1>>, usz(Opcode::ShiftRightArithmetic), o<1>, o<0>>,
-        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>>>;
+        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>,
+        Inst<Clobbers<c<1>>, usz(Opcode::ShiftRightArithmetic), o<1>, i<0>>>>;
 
 using shr_reg_imm = Pattern<
     InstList<Inst<Clobbers<>, usz(MKind::Shr), Register<>, Immediate<>>>,
     InstList<
-        Inst<Clobbers<c<1>>, usz(Opcode::ShiftRightLogical), o<1>, o<0>>,
-        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>>>;
+        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>,
+        Inst<Clobbers<c<1>>, usz(Opcode::ShiftRightLogical), o<1>, i<0>>>>;
 
 using shl_reg_imm = Pattern<
     InstList<Inst<Clobbers<>, usz(MKind::Shl), Register<>, Immediate<>>>,
     InstList<
-        Inst<Clobbers<>, usz(Opcode::ShiftLeft), o<1>, o<0>>,
-        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>>>;
+        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>,
+        Inst<Clobbers<c<1>>, usz(Opcode::ShiftLeft), o<1>, i<0>>>>;
 
 using sar_reg_reg = Pattern<
     InstList<Inst<Clobbers<>, usz(MKind::Sar), Register<>, Register<>>>,
     InstList<
+        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>,
         Inst<Clobbers<c<1>>, usz(Opcode::Move), o<1>, Register<usz(RegId::RCX), Immediate<32>>>, // 32 bits to clear dependencies
-        Inst<Clobbers<c<1>>, usz(Opcode::ShiftRightArithmetic), Register<usz(RegId::RCX), Immediate<8>>, o<0>>,
-        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>>>;
+        Inst<Clobbers<c<1>>, usz(Opcode::ShiftRightArithmetic), Register<usz(RegId::RCX), Immediate<8>>, i<0>>>>;
 
 using shr_reg_reg = Pattern<
     InstList<Inst<Clobbers<>, usz(MKind::Shr), Register<>, Register<>>>,
     InstList<
+        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>,
         Inst<Clobbers<c<1>>, usz(Opcode::Move), o<1>, Register<usz(RegId::RCX), Immediate<32>>>, // 32 bits to clear dependencies
-        Inst<Clobbers<c<1>>, usz(Opcode::ShiftRightLogical), Register<usz(RegId::RCX), Immediate<8>>, o<0>>,
-        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>>>;
+        Inst<Clobbers<c<1>>, usz(Opcode::ShiftRightLogical), Register<usz(RegId::RCX), Immediate<8>>, i<0>>>>;
 
 using shl_reg_reg = Pattern<
     InstList<Inst<Clobbers<>, usz(MKind::Shl), Register<>, Register<>>>,
     InstList<
+        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>,
         Inst<Clobbers<c<1>>, usz(Opcode::Move), o<1>, Register<usz(RegId::RCX), Immediate<32>>>, // 32 bits to clear dependencies
-        Inst<Clobbers<c<1>>, usz(Opcode::ShiftLeft), Register<usz(RegId::RCX), Immediate<8>>, o<0>>,
-        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>>>;
+        Inst<Clobbers<c<1>>, usz(Opcode::ShiftLeft), Register<usz(RegId::RCX), Immediate<8>>, i<0>>>>;
 
+// Two-operand instructions overwrite their last operand, so copy the
+// input into the output register first and operate on that: the input
+// may still be used after this instruction.
 template <usz inst_kind, usz out_opcode>
 using binary_commutative_reg_reg = Pattern<
     InstList<Inst<Clobbers<>, inst_kind, Register<>, Register<>>>,
     InstList<
-        Inst<Clobbers<c<1>>, out_opcode, o<0>, o<1>>,
-        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<1>, i<0>>>>;
+        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<1>, i<0>>,
+        Inst<Clobbers<c<1>>, out_opcode, o<0>, i<0>>>>;
 
 using and_reg_reg = binary_commutative_reg_reg<usz(MKind::And), usz(Opcode::And)>;
 using and_reg_imm = Pattern<
     InstList<Inst<Clobbers<>, usz(MKind::And), Register<>, Immediate<>>>,
     InstList<
-        Inst<Clobbers<c<1>>, usz(Opcode::And), o<1>, o<0>>,
-        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>>>;
+        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>,
+        Inst<Clobbers<c<1>>, usz(Opcode::And), o<1>, i<0>>>>;
 
 using or_reg_reg = binary_commutative_reg_reg<usz(MKind::Or), usz(Opcode::Or)>;
 using or_reg_imm = Pattern<
     InstList<Inst<Clobbers<>, usz(MKind::Or), Register<>, Immediate<>>>,
     InstList<
-        Inst<Clobbers<c<1>>, usz(Opcode::Or), o<1>, o<0>>,
-        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>>>;
+        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>,
+        Inst<Clobbers<c<1>>, usz(Opcode::Or), o<1>, i<0>>>>;
 
 // A global is actually an lvalue (ptr to global). When adding to a
 // global, we are actually trying to do ptr arithmetic; we use `lea` for
@@ -297,14 +300,14 @@ using mul_reg_reg = binary_commutative_reg_reg<usz(MKind::Mul), usz(Opcode::Mult
 using mul_reg_imm = Pattern<
     InstList<Inst<Clobbers<>, usz(MKind::Mul), Register<>, Immediate<>>>,
     InstList<
-        Inst<Clobbers<c<1>>, usz(Opcode::Multiply), o<1>, o<0>>,
-        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>>>;
+        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>,
+        Inst<Clobbers<c<1>>, usz(Opcode::Multiply), o<1>, i<0>>>>;
 
 using mul_imm_reg = Pattern<
     InstList<Inst<Clobbers<>, usz(MKind::Mul), Immediate<>, Register<>>>,
     InstList<
-        Inst<Clobbers<c<1>>, usz(Opcode::Multiply), o<0>, o<1>>,
-        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<1>, i<0>>>>;
+        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<1>, i<0>>,
+        Inst<Clobbers<c<1>>, usz(Opcode::Multiply), o<0>, i<0>>>>;
 
 using mul_imm_imm = Pattern<
     InstList<Inst<Clobbers<>, usz(MKind::Mul), Immediate<>, Immediate<>>>,
@@ -316,14 +319,21 @@ using sub_reg_reg = Pattern<
     InstList<Inst<Clobbers<>, usz(MKind::Sub), Register<>, Register<>>>,
     InstList<
         // NOTE: GNU ordering of operands
-        Inst<Clobbers<c<1>>, usz(Opcode::Sub), o<1>, o<0>>,
-        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>>>;
+        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>,
+        Inst<Clobbers<c<1>>, usz(Opcode::Sub), o<1>, i<0>>>>;
 
 using sub_reg_imm = Pattern<
     InstList<Inst<Clobbers<>, usz(MKind::Sub), Register<>, Immediate<>>>,
     InstList<
-        Inst<Clobbers<c<1>>, usz(Opcode::Sub), o<1>, o<0>>,
-        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>>>;
+        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>,
+        Inst<Clobbers<c<1>>, usz(Opcode::Sub), o<1>, i<0>>>>;
+
+/// The high half of the dividend of an unsigned divide is zero.
+using zero_rdx = Inst<Clobbers<c<1>>, usz(Opcode::Xor), Register<usz(RegId::RDX), Immediate<32>>, Register<usz(RegId::RDX), Immediate<32>>>;
+
+/// The high half of the dividend of a signed divide is the sign of the
+/// low half.
+using sign_extend_rax = Inst<Clobbers<c<1>>, usz(Opcode::SignExtendAccumulator), Register<usz(RegId::RAX), Sizeof<0>>, Register<usz(RegId::RDX), Sizeof<0>>>;
 
 using sdiv_imm_imm = Pattern<
     InstList<
@@ -331,7 +341,7 @@ using sdiv_imm_imm = Pattern<
     InstList<
         Inst<Clobbers<c<1>>, usz(Opcode::Move), o<1>, v<0, 1>>,
         Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, Register<usz(RegId::RAX), Sizeof<0>>>,
-        Inst<Clobbers<c<1>>, usz(Opcode::Xor), Register<usz(RegId::RDX), Immediate<32>>, Register<usz(RegId::RDX), Immediate<32>>>,
+        sign_extend_rax,
         Inst<Clobbers<r<usz(RegId::RAX)>, r<usz(RegId::RDX)>>, usz(Opcode::SignedDivide), v<0, 1>>,
         Inst<Clobbers<c<1>>, usz(Opcode::Move), Register<usz(RegId::RAX), Sizeof<0>>, i<0>>>>;
 
@@ -345,7 +355,7 @@ using sdiv_reg_reg = Pattern<
     InstList<
         Inst<Clobbers<c<1>>, usz(Opcode::Move), o<1>, v<0, 1>>,
         Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, Register<usz(RegId::RAX), Sizeof<0>>>,
-        Inst<Clobbers<c<1>>, usz(Opcode::Xor), Register<usz(RegId::RDX), Immediate<32>>, Register<usz(RegId::RDX), Immediate<32>>>,
+        sign_extend_rax,
         Inst<Clobbers<r<usz(RegId::RAX)>, r<usz(RegId::RDX)>>, usz(Opcode::SignedDivide), v<0, 1>>,
         Inst<Clobbers<c<1>>, usz(Opcode::Move), Register<usz(RegId::RAX), Sizeof<0>>, i<0>>>>;
 
@@ -359,7 +369,7 @@ using sdiv_reg_imm = Pattern<
     InstList<
         Inst<Clobbers<c<1>>, usz(Opcode::Move), o<1>, v<0, 1>>,
         Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, Register<usz(RegId::RAX), Sizeof<0>>>,
-        Inst<Clobbers<c<1>>, usz(Opcode::Xor), Register<usz(RegId::RDX), Immediate<32>>, Register<usz(RegId::RDX), Immediate<32>>>,
+        sign_extend_rax,
         Inst<Clobbers<r<usz(RegId::RAX)>, r<usz(RegId::RDX)>>, usz(Opcode::SignedDivide), v<0, 1>>,
         Inst<Clobbers<c<1>>, usz(Opcode::Move), Register<usz(RegId::RAX), Sizeof<0>>, i<0>>>>;
 
@@ -369,7 +379,7 @@ using udiv_imm_imm = Pattern<
     InstList<
         Inst<Clobbers<c<1>>, usz(Opcode::Move), o<1>, v<0, 1>>,
         Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, Register<usz(RegId::RAX), Sizeof<0>>>,
-        Inst<Clobbers<c<1>>, usz(Opcode::Xor), Register<usz(RegId::RDX), Immediate<32>>, Register<usz(RegId::RDX), Immediate<32>>>,
+        zero_rdx,
         Inst<Clobbers<r<usz(RegId::RAX)>, r<usz(RegId::RDX)>>, usz(Opcode::UnsignedDivide), v<0, 1>>,
         Inst<Clobbers<c<1>>, usz(Opcode::Move), Register<usz(RegId::RAX), Sizeof<0>>, i<0>>>>;
 
@@ -383,7 +393,7 @@ using udiv_reg_reg = Pattern<
     InstList<
         Inst<Clobbers<c<1>>, usz(Opcode::Move), o<1>, v<0, 1>>,
         Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, Register<usz(RegId::RAX), Sizeof<0>>>,
-        Inst<Clobbers<c<1>>, usz(Opcode::Xor), Register<usz(RegId::RDX), Immediate<32>>, Register<usz(RegId::RDX), Immediate<32>>>,
+        zero_rdx,
         Inst<Clobbers<r<usz(RegId::RAX)>, r<usz(RegId::RDX)>>, usz(Opcode::UnsignedDivide), v<0, 1>>,
         Inst<Clobbers<c<1>>, usz(Opcode::Move), Register<usz(RegId::RAX), Sizeof<0>>, i<0>>>>;
 
@@ -397,7 +407,7 @@ using udiv_reg_imm = Pattern<
     InstList<
         Inst<Clobbers<c<1>>, usz(Opcode::Move), o<1>, v<0, 1>>,
         Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, Register<usz(RegId::RAX), Sizeof<0>>>,
-        Inst<Clobbers<c<1>>, usz(Opcode::Xor), Register<usz(RegId::RDX), Immediate<32>>, Register<usz(RegId::RDX), Immediate<32>>>,
+        zero_rdx,
         Inst<Clobbers<r<usz(RegId::RAX)>, r<usz(RegId::RDX)>>, usz(Opcode::UnsignedDivide), v<0, 1>>,
         Inst<Clobbers<c<1>>, usz(Opcode::Move), Register<usz(RegId::RAX), Sizeof<0>>, i<0>>>>;
 
@@ -411,8 +421,8 @@ using float_reg_reg = Pattern<
             RegisterOfCategory<+::lcc::Register::Category::FLOAT>,
             RegisterOfCategory<+::lcc::Register::Category::FLOAT>>>,
     InstList<
-        Inst<Clobbers<c<1>>, op, o<0>, o<1>>,
-        Inst<Clobbers<c<1>>, usz(Opcode::ScalarFloatMove), o<1>, i<0>>>>;
+        Inst<Clobbers<c<1>>, usz(Opcode::ScalarFloatMove), o<1>, i<0>>,
+        Inst<Clobbers<c<1>>, op, o<0>, i<0>>>>;
 
 using float_div_reg_reg = Pattern<
     InstList<
@@ -423,8 +433,8 @@ using float_div_reg_reg = Pattern<
             RegisterOfCategory<+::lcc::Register::Category::FLOAT>,
             RegisterOfCategory<+::lcc::Register::Category::FLOAT>>>,
     InstList<
-        Inst<Clobbers<c<1>>, usz(Opcode::ScalarFloatDiv), o<1>, o<0>>,
-        Inst<Clobbers<c<1>>, usz(Opcode::ScalarFloatMove), o<0>, i<0>>>>;
+        Inst<Clobbers<c<1>>, usz(Opcode::ScalarFloatMove), o<0>, i<0>>,
+        Inst<Clobbers<c<1>>, usz(Opcode::ScalarFloatDiv), o<1>, i<0>>>>;
 
 using float_add_reg_reg = float_reg_reg<usz(MKind::Add), usz(Opcode::ScalarFloatAdd)>;
 using float_sub_reg_reg = float_reg_reg<usz(MKind::Sub), usz(Opcode::ScalarFloatSub)>;
@@ -491,7 +501,7 @@ using float_ret_reg = Pattern<
                 Sizeof<0>>>,
         Inst<Clobbers<>, usz(Opcode::Return)>>>;
 
-template <usz in, usz op>
+template <usz in, usz op, typename extend>
 using rem_reg_reg = Pattern<
     InstList<
         Inst<
@@ -502,14 +512,14 @@ using rem_reg_reg = Pattern<
     InstList<
         Inst<Clobbers<c<1>>, usz(Opcode::Move), o<1>, v<0, 1>>,
         Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, Register<usz(RegId::RAX), Sizeof<0>>>,
-        Inst<Clobbers<c<1>>, usz(Opcode::Xor), Register<usz(RegId::RDX), Immediate<32>>, Register<usz(RegId::RDX), Immediate<32>>>,
+        extend,
         Inst<Clobbers<r<usz(RegId::RAX)>, r<usz(RegId::RDX)>>, op, v<0, 1>>,
         Inst<Clobbers<c<1>>, usz(Opcode::Move), Register<usz(RegId::RDX), Sizeof<0>>, i<0>>>>;
 
-using srem_reg_reg = rem_reg_reg<usz(MKind::SRem), usz(x86_64::Opcode::SignedDivide)>;
-using urem_reg_reg = rem_reg_reg<usz(MKind::URem), usz(x86_64::Opcode::UnsignedDivide)>;
+using srem_reg_reg = rem_reg_reg<usz(MKind::SRem), usz(x86_64::Opcode::SignedDivide), sign_extend_rax>;
+using urem_reg_reg = rem_reg_reg<usz(MKind::URem), usz(x86_64::Opcode::UnsignedDivide), zero_rdx>;
 
-template <usz in, usz op>
+template <usz in, usz op, typename extend>
 using rem_reg_imm = Pattern<
     InstList<
         Inst<
@@ -520,12 +530,12 @@ using rem_reg_imm = Pattern<
     InstList<
         Inst<Clobbers<c<1>>, usz(Opcode::Move), o<1>, v<0, 1>>,
         Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, Register<usz(RegId::RAX), Sizeof<0>>>,
-        Inst<Clobbers<c<1>>, usz(Opcode::Xor), Register<usz(RegId::RDX), Immediate<32>>, Register<usz(RegId::RDX), Immediate<32>>>,
+        extend,
         Inst<Clobbers<r<usz(RegId::RAX)>, r<usz(RegId::RDX)>>, op, v<0, 1>>,
         Inst<Clobbers<c<1>>, usz(Opcode::Move), Register<usz(RegId::RDX), Sizeof<0>>, i<0>>>>;
 
-using srem_reg_imm = rem_reg_imm<usz(MKind::SRem), usz(x86_64::Opcode::SignedDivide)>;
-using urem_reg_imm = rem_reg_imm<usz(MKind::URem), usz(x86_64::Opcode::UnsignedDivide)>;
+using srem_reg_imm = rem_reg_imm<usz(MKind::SRem), usz(x86_64::Opcode::SignedDivide), sign_extend_rax>;
+using urem_reg_imm = rem_reg_imm<usz(MKind::URem), usz(x86_64::Opcode::UnsignedDivide), zero_rdx>;
 
 using cond_branch_reg = Pattern<
     InstList<Inst<Clobbers<>, usz(MKind::CondBranch), Register<>, Block<>, Block<>>>,
@@ -639,13 +649,15 @@ using neg_reg = Pattern<
     InstList<
         Inst<Clobbers<>, usz(MKind::Neg), Register<>>>,
     InstList<
-        Inst<Clobbers<>, usz(Opcode::Negate), o<0>>>>;
+        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>,
+        Inst<Clobbers<c<0>>, usz(Opcode::Negate), i<0>>>>;
 
 using neg_imm = Pattern<
     InstList<
         Inst<Clobbers<>, usz(MKind::Neg), Immediate<>>>,
     InstList<
-        Inst<Clobbers<>, usz(Opcode::Negate), o<0>>>>;
+        Inst<Clobbers<c<1>>, usz(Opcode::Move), o<0>, i<0>>,
+        Inst<Clobbers<c<0>>, usz(Opcode::Negate), i<0>>>>;
 
 // clang-format off
 // This doesn't really work, as far as I can tell. Not exactly sure yet,
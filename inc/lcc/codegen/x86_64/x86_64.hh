@@ -11,6 +11,10 @@ namespace lcc::x86_64 {
 constexpr usz GeneralPurposeBitwidth = 64;
 constexpr usz GeneralPurposeBytewidth = 8;
 
+/// Memory intrinsics with a constant size of at most this many bytes
+/// are expanded into moves instead of calling memcpy() or memset().
+constexpr usz MaxInlineMemoryIntrinsicBytes = 64;
+
 enum struct Opcode : u32 {
     Poison = u32(lcc::MInst::Kind::ArchStart),
     Return,           // ret
@@ -42,6 +46,14 @@ enum struct Opcode : u32 {
 
     Multiply, // mul
 
+    // One operand; %rdx:%rax = %rax * operand.
+    UnsignedMultiplyWide, // mul
+    SignedMultiplyWide,   // imul
+
+    // Sign-extend the accumulator into %rdx (cwd/cdq/cqo), or %al into
+    // %ax (cbw), to make the dividend of a signed divide.
+    SignExtendAccumulator,
+
     SignedDivide,   // idiv
     UnsignedDivide, // div
 
@@ -51,6 +63,17 @@ enum struct Opcode : u32 {
     Test,           // test
     JumpIfZeroFlag, // jz
 
+    JumpIfEqual,                  // je
+    JumpIfNotEqual,               // jne
+    JumpIfEqualOrLessUnsigned,    // jbe
+    JumpIfEqualOrLessSigned,      // jle
+    JumpIfEqualOrGreaterUnsigned, // jae
+    JumpIfEqualOrGreaterSigned,   // jge
+    JumpIfLessUnsigned,           // jb
+    JumpIfLessSigned,             // jl
+    JumpIfGreaterUnsigned,        // ja
+    JumpIfGreaterSigned,          // jg
+
     SetByteIfEqual,                  // sete (set if equal)
     SetByteIfNotEqual,               // setne (set if not equal)
     SetByteIfEqualOrLessUnsigned,    // setbe (set if below or equal, "below" being Intel's way of meaning unsigned less than)
@@ -62,6 +85,17 @@ enum struct Opcode : u32 {
     SetByteIfGreaterUnsigned,        // seta (set if above)
     SetByteIfGreaterSigned,          // setg (set if greater)
 
+    MoveIfEqual,                  // cmove
+    MoveIfNotEqual,               // cmovne
+    MoveIfEqualOrLessUnsigned,    // cmovbe
+    MoveIfEqualOrLessSigned,      // cmovle
+    MoveIfEqualOrGreaterUnsigned, // cmovae
+    MoveIfEqualOrGreaterSigned,   // cmovge
+    MoveIfLessUnsigned,           // cmovb
+    MoveIfLessSigned,             // cmovl
+    MoveIfGreaterUnsigned,        // cmova
+    MoveIfGreaterSigned,          // cmovg
+
     // You can re-order these, just not past the fences.
     ScalarFloatFENCEBegin,
     ScalarFloatMove,               // movss/movsd
@@ -180,13 +214,26 @@ static constexpr auto ToString(Opcode op) -> std::string {
         case Opcode::ShiftRightArithmetic: return "sar";
         case Opcode::Add: return "add";
         case Opcode::Multiply: return "imul";
+        case Opcode::UnsignedMultiplyWide: return "mul";
+        case Opcode::SignedMultiplyWide: return "imul";
         case Opcode::Sub: return "sub";
+        case Opcode::SignExtendAccumulator: return "cqo";
         case Opcode::SignedDivide: return "idiv";
         case Opcode::UnsignedDivide: return "div";
         case Opcode::Push: return "push";
         case Opcode::Pop: return "pop";
         case Opcode::Test: return "test";
         case Opcode::JumpIfZeroFlag: return "jz";
+        case Opcode::JumpIfEqual: return "je";
+        case Opcode::JumpIfNotEqual: return "jne";
+        case Opcode::JumpIfLessUnsigned: return "jb";
+        case Opcode::JumpIfLessSigned: return "jl";
+        case Opcode::JumpIfGreaterUnsigned: return "ja";
+        case Opcode::JumpIfGreaterSigned: return "jg";
+        case Opcode::JumpIfEqualOrLessUnsigned: return "jbe";
+        case Opcode::JumpIfEqualOrLessSigned: return "jle";
+        case Opcode::JumpIfEqualOrGreaterUnsigned: return "jae";
+        case Opcode::JumpIfEqualOrGreaterSigned: return "jge";
         case Opcode::Compare: return "cmp";
         case Opcode::SetByteIfEqual: return "sete";
         case Opcode::SetByteIfNotEqual: return "setne";
@@ -198,6 +245,16 @@ static constexpr auto ToString(Opcode op) -> std::string {
         case Opcode::SetByteIfEqualOrLessSigned: return "setle";
         case Opcode::SetByteIfEqualOrGreaterUnsigned: return "setae";
         case Opcode::SetByteIfEqualOrGreaterSigned: return "setge";
+        case Opcode::MoveIfEqual: return "cmove";
+        case Opcode::MoveIfNotEqual: return "cmovne";
+        case Opcode::MoveIfLessUnsigned: return "cmovb";
+        case Opcode::MoveIfLessSigned: return "cmovl";
+        case Opcode::MoveIfGreaterUnsigned: return "cmova";
+        case Opcode::MoveIfGreaterSigned: return "cmovg";
+        case Opcode::MoveIfEqualOrLessUnsigned: return "cmovbe";
+        case Opcode::MoveIfEqualOrLessSigned: return "cmovle";
+        case Opcode::MoveIfEqualOrGreaterUnsigned: return "cmovae";
+        case Opcode::MoveIfEqualOrGreaterSigned: return "cmovge";
         case Opcode::ScalarFloatMoveDereferenceLHS:
         case Opcode::ScalarFloatMoveDereferenceRHS:
         case Opcode::ScalarFloatMove: return "movs";
@@ -25,6 +25,11 @@ public:
         // Emits `.lcc` files.
         LCC_SSA_IR,
 
+        // Lensor Compiler Collection Intermediate Representation in SSA form,
+        // in a compact binary encoding (see lib/lcc/ir/module_bin.cc).
+        // Emits `.lccb` files.
+        LCC_BINARY_IR,
+
         // LLVM's Textual IR
         // Emits `.ll` files.
         LLVM_TEXTUAL_IR,
@@ -55,6 +60,7 @@ public:
 
     static const Format* const lcc_ir;
     static const Format* const lcc_ssa_ir;
+    static const Format* const lcc_binary_ir;
     static const Format* const llvm_textual_ir;
     static const Format* const wasm_textual;
     static const Format* const gnu_as_att_assembly;
@@ -76,6 +82,12 @@ struct Formats {
         return f;
     }();
 
+    static constexpr Format lcc_binary_ir = [] {
+        auto f = Format();
+        f._format = Format::LCC_BINARY_IR;
+        return f;
+    }();
+
     static constexpr Format llvm_textual_ir = [] {
         auto f = Format();
         f._format = Format::LLVM_TEXTUAL_IR;
@@ -110,6 +122,7 @@ struct Formats {
 
 constexpr inline const Format* const Format::lcc_ir = &detail::Formats::lcc_ir;
 constexpr inline const Format* const Format::lcc_ssa_ir = &detail::Formats::lcc_ssa_ir;
+constexpr inline const Format* const Format::lcc_binary_ir = &detail::Formats::lcc_binary_ir;
 constexpr inline const Format* const Format::llvm_textual_ir = &detail::Formats::llvm_textual_ir;
 constexpr inline const Format* const Format::wasm_textual = &detail::Formats::wasm_textual;
 constinit inline const Format* const Format::gnu_as_att_assembly = &detail::Formats::gnu_as_att_assembly;
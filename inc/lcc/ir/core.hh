@@ -15,9 +15,13 @@
 #include <lccbase/location.hh>
 
 #include <algorithm>
+#include <array>
 #include <concepts>
+#include <cstddef>
 #include <functional>
+#include <iterator>
 #include <memory>
+#include <ranges>
 #include <span>
 #include <string>
 #include <string_view>
@@ -60,6 +64,7 @@ public:
         Intrinsic,
         Load,
         Phi,
+        Select,
         Store,
 
         /// Terminators
@@ -141,7 +146,8 @@ public:
     Type*& type_reference() { return value_type; }
 
     /// Print this value for debugging.
-    auto string() const -> std::string;
+    auto string() const -> std::string { return string(true); }
+    auto string(bool use_colour) const -> std::string;
     /// Print this value for debugging.
     void print() const;
 
@@ -168,6 +174,7 @@ public:
             case VK::Intrinsic: return "Intrinsic";
             case VK::Load: return "Load";
             case VK::Phi: return "Phi";
+            case VK::Select: return "Select";
             case VK::Store: return "Store";
 
             /// Terminators
@@ -275,6 +282,161 @@ public:
     ) -> GlobalVariable*;
 };
 
+/// The operand slots of an instruction.
+///
+/// This is a view into the instruction itself, so iterating over
+/// it does not allocate. A few fixed slots are followed by a run of
+/// evenly spaced slots in out-of-line storage (call arguments,
+/// intrinsic operands, the incoming values of a phi).
+class OperandSlots : public std::ranges::view_interface<OperandSlots> {
+public:
+    static constexpr usz max_fixed = 3;
+
+private:
+    /// Where the slots are. Iterators carry a copy of this rather than
+    /// a pointer to the view, so they stay valid when the view is
+    /// copied or moved (e.g. returned from a function).
+    struct Storage {
+        std::array<Value**, max_fixed> fixed{};
+        usz fixed_count{};
+        std::byte* run{};
+        usz run_count{};
+        usz run_stride{sizeof(Value*)};
+
+        [[nodiscard]]
+        auto at(usz i) const -> Value** {
+            if (i < fixed_count) return fixed[i];
+            return reinterpret_cast<Value**>(run + (i - fixed_count) * run_stride);
+        }
+    };
+
+    Storage storage{};
+
+public:
+    class Iterator {
+        Storage storage{};
+        usz index{};
+
+    public:
+        using iterator_concept = std::forward_iterator_tag;
+        using value_type = Value**;
+        using difference_type = std::ptrdiff_t;
+
+        Iterator() = default;
+        Iterator(const Storage& s, usz i) : storage(s), index(i) {}
+
+        auto operator*() const -> Value** { return storage.at(index); }
+        auto operator++() -> Iterator& {
+            ++index;
+            return *this;
+        }
+        auto operator++(int) -> Iterator {
+            auto it = *this;
+            ++index;
+            return it;
+        }
+        auto operator==(const Iterator& other) const -> bool { return index == other.index; }
+    };
+
+    /// Add a single slot.
+    void add(Value** slot) {
+        LCC_ASSERT(storage.fixed_count < max_fixed, "Too many fixed operand slots");
+        storage.fixed[storage.fixed_count++] = slot;
+    }
+
+    /// Add \p count slots, starting at \p first, \p stride bytes apart.
+    void add_run(Value** first, usz count, usz stride = sizeof(Value*)) {
+        LCC_ASSERT(not storage.run, "Only one run of operand slots is supported");
+        storage.run = reinterpret_cast<std::byte*>(first);
+        storage.run_count = count;
+        storage.run_stride = stride;
+    }
+
+    /// Get a slot by index.
+    [[nodiscard]]
+    auto at(usz i) const -> Value** { return storage.at(i); }
+
+    [[nodiscard]]
+    auto size() const -> usz { return storage.fixed_count + storage.run_count; }
+
+    [[nodiscard]]
+    auto begin() const -> Iterator { return {storage, 0}; }
+
+    [[nodiscard]]
+    auto end() const -> Iterator { return {storage, size()}; }
+};
+
+/// The children of an instruction: the values in its operand slots,
+/// followed by any blocks it references.
+class InstChildren : public std::ranges::view_interface<InstChildren> {
+public:
+    static constexpr usz max_blocks = 2;
+
+private:
+    /// \see OperandSlots::Storage
+    struct Storage {
+        OperandSlots slots{};
+        std::array<Value*, max_blocks> blocks{};
+        usz block_count{};
+
+        [[nodiscard]]
+        auto at(usz i) const -> Value* {
+            if (i < slots.size()) return *slots.at(i);
+            return blocks[i - slots.size()];
+        }
+    };
+
+    Storage storage{};
+
+public:
+    class Iterator {
+        Storage storage{};
+        usz index{};
+
+    public:
+        using iterator_concept = std::forward_iterator_tag;
+        using value_type = Value*;
+        using difference_type = std::ptrdiff_t;
+
+        Iterator() = default;
+        Iterator(const Storage& s, usz i) : storage(s), index(i) {}
+
+        auto operator*() const -> Value* { return storage.at(index); }
+        auto operator++() -> Iterator& {
+            ++index;
+            return *this;
+        }
+        auto operator++(int) -> Iterator {
+            auto it = *this;
+            ++index;
+            return it;
+        }
+        auto operator==(const Iterator& other) const -> bool { return index == other.index; }
+    };
+
+    InstChildren() = default;
+    explicit InstChildren(OperandSlots s) : storage{s} {}
+
+    /// Add a referenced block.
+    void add_block(Value* block) {
+        LCC_ASSERT(storage.block_count < max_blocks, "Too many block children");
+        storage.blocks[storage.block_count++] = block;
+    }
+
+    /// Get a child by index.
+    [[nodiscard]]
+    auto at(usz i) const -> Value* { return storage.at(i); }
+
+    [[nodiscard]]
+    auto size() const -> usz { return storage.slots.size() + storage.block_count; }
+
+    [[nodiscard]]
+    auto begin() const -> Iterator { return {storage, 0}; }
+
+    [[nodiscard]]
+    auto end() const -> Iterator { return {storage, size()}; }
+};
+
 /// IR instruction.
 class Inst : public UseTrackingValue {
     /// So that parent can be set upon insertion.
@@ -286,6 +448,10 @@ class Inst : public UseTrackingValue {
     /// Associated machine instruction during early codegen.
     MInst* minst{};
 
+    /// Virtual register holding the result of this instruction
+    /// during early codegen, or 0 if it has none.
+    usz vreg{};
+
     /// The parent block that this instruction is inserted in.
     Block* parent{};
 
@@ -317,7 +483,7 @@ protected:
     /// This is a low-level API. Prefer to use `children()`
     /// instead.
     [[nodiscard]]
-    auto Children() -> Generator<Value**>;
+    auto Children() -> OperandSlots;
 
     /// Prepare for actual erasure/deletion by removing all tracked uses of
     /// this instruction. Does NOT remove from block, delete memory, etc.
@@ -325,6 +491,10 @@ protected:
     /// Actually remove this instruction from the parent block.
     void PerformErasure();
 
+    /// Remove this instruction from the parent block without
+    /// checking for users.
+    void RemoveFromParent();
+
     /// Remove a use by an instruction.
     static void RemoveUse(Value* of_value, Inst* by) {
         LCC_ASSERT(of_value, "Expected non-null ptr");
@@ -362,6 +532,10 @@ protected:
         op = newval;
     }
 
+    /// Replace a successor of a terminator and update uses and
+    /// the dominator tree of the parent function.
+    void UpdateSuccessor(Block*& op, Block* newval);
+
 public:
     virtual ~Inst() override = default;
 
@@ -371,15 +545,15 @@ public:
 
     /// Iterate over the children of this instruction.
     [[nodiscard]]
-    auto children() const -> Generator<Value*>;
+    auto children() const -> InstChildren;
 
     /// Iterate over all children of a certain instruction type.
     template <std::derived_from<Value> Inst>
     [[nodiscard]]
-    auto children_of_kind() const -> Generator<Inst*> {
-        for (auto* v : children())
-            if (auto* c = cast<Inst>(v))
-                co_yield c;
+    auto children_of_kind() const {
+        return children()
+             | vws::filter([](Value* v) { return is<Inst>(v); })
+             | vws::transform([](Value* v) { return as<Inst>(v); });
     }
 
     /// Remove this instruction from its parent block.
@@ -394,6 +568,11 @@ public:
 
     void insert_before(std::unique_ptr<Inst> to_insert);
 
+    /// Move this instruction so that it is right before another
+    /// instruction, which may be in a different block. This does
+    /// not check that the instruction still dominates its users.
+    void move_before(Inst* before);
+
     /// Iterate over all instructions before (and not including) this one.
     auto instructions_before_this() -> std::vector<Inst*>;
 
@@ -412,6 +591,13 @@ public:
     /// Set the associated machine instruction.
     void machine_inst(MInst* m) { minst = m; }
 
+    /// Get the virtual register assigned to this instruction.
+    [[nodiscard]]
+    auto virtual_register() const -> usz { return vreg; }
+
+    /// Set the virtual register assigned to this instruction.
+    void virtual_register(usz r) { vreg = r; }
+
     /// Replace children of this instruction.
     ///
     /// PLEASE DO NOT INSERT OR REMOVE INSTRUCTIONS IN THE CALLBACK.
@@ -478,6 +664,10 @@ class Block : public UseTrackingValue {
     /// The name of this block.
     std::string block_name;
 
+    /// Update the dominator tree if an instruction that was just
+    /// inserted is the terminator of this block.
+    void TerminatorInserted(Inst* i);
+
 public:
     explicit Block(std::string n = "")
         : UseTrackingValue(Kind::Block)
@@ -664,6 +854,10 @@ private:
     /// The calling convention of this function.
     CallConv cc;
 
+    /// The dominator tree of this function, if it has been computed
+    /// and the CFG hasn’t changed in a way it couldn’t be updated for.
+    std::unique_ptr<DomTree> dom_tree;
+
 public:
     // TODO: Re-do to take an IRName
     Function(
@@ -675,11 +869,14 @@ public:
         Location location = {}
     );
 
+    ~Function() override;
+
     /// Get an iterator to the first block in this function.
     [[nodiscard]]
     auto begin() const { return block_list.begin(); }
 
     void append_block(std::unique_ptr<Block> b) {
+        invalidate_dominator_tree();
         b->function(this);
         block_list.emplace_back(std::move(b));
     }
@@ -706,6 +903,23 @@ public:
         return block_list.front().get();
     }
 
+    /// Get the dominator tree of this function.
+    ///
+    /// The tree is computed on first use and kept up to date as
+    /// edges are added to or removed from the CFG, or discarded if
+    /// that isn’t possible. Don’t hold on to it across CFG changes.
+    [[nodiscard]]
+    auto dominator_tree() -> DomTree&;
+
+    /// Discard the cached dominator tree.
+    void invalidate_dominator_tree();
+
+    /// Update the cached dominator tree, if any, for an edge that
+    /// was added to or removed from the CFG. Changes made through
+    /// Block and Inst do this automatically.
+    void cfg_edge_erased(Block* from, Block* to);
+    void cfg_edge_inserted(Block* from, Block* to);
+
     /// Get the source location of this function.
     [[nodiscard]]
     auto location() const -> Location { return _location; }
@@ -1244,6 +1458,80 @@ public:
     static auto classof(const Value* v) -> bool { return v->kind() == Kind::Phi; }
 };
 
+/// Select instruction.
+///
+/// Yields one of two values depending on a condition, without
+/// branching. Both values are always evaluated.
+class SelectInst : public Inst {
+    friend Inst;
+    friend parser::Parser;
+
+    /// The condition.
+    Value* condition{};
+
+    /// The value if the condition is true.
+    Value* if_true{};
+
+    /// The value if the condition is false.
+    Value* if_false{};
+
+    /// Used by the IR parser.
+    explicit SelectInst(Type* ty, Location location = {})
+        : Inst(Kind::Select, ty, location) {}
+
+public:
+    explicit SelectInst(
+        Value* cond,
+        Value* then_value,
+        Value* else_value,
+        Location location = {}
+    )
+        : Inst(Kind::Select, then_value->type(), location)
+        , condition(cond)
+        , if_true(then_value)
+        , if_false(else_value) {
+        LCC_ASSERT(
+            cond->type() == Type::I1Ty,
+            "IR: SelectInst condition must be of type i1, but was {}",
+            *cond->type()
+        );
+        LCC_ASSERT(
+            then_value->type() == else_value->type(),
+            "IR: SelectInst values must have the same type, but were {} and {}",
+            *then_value->type(),
+            *else_value->type()
+        );
+        AddUse(condition, this);
+        AddUse(if_true, this);
+        AddUse(if_false, this);
+    }
+
+    /// Get the condition.
+    [[nodiscard]]
+    auto cond() const -> Value* { return condition; }
+
+    /// Replace the condition.
+    void cond(Value* v) { UpdateOperand(condition, v); }
+
+    /// Get the value yielded if the condition is true.
+    [[nodiscard]]
+    auto then_value() const -> Value* { return if_true; }
+
+    /// Replace the value yielded if the condition is true.
+    void then_value(Value* v) { UpdateOperand(if_true, v); }
+
+    /// Get the value yielded if the condition is false.
+    [[nodiscard]]
+    auto else_value() const -> Value* { return if_false; }
+
+    /// Replace the value yielded if the condition is false.
+    void else_value(Value* v) { UpdateOperand(if_false, v); }
+
+    /// RTTI.
+    [[nodiscard]]
+    static auto classof(const Value* v) -> bool { return v->kind() == Kind::Select; }
+};
+
 /// ============================================================================
 ///  Terminators
 /// ============================================================================
@@ -1273,7 +1561,7 @@ public:
     auto target() const -> Block* { return target_block; }
 
     /// Replace the target with another block.
-    void target(Block* b) { UpdateOperand(target_block, b); }
+    void target(Block* b) { UpdateSuccessor(target_block, b); }
 
     /// RTTI.
     [[nodiscard]]
@@ -1326,14 +1614,14 @@ public:
     auto else_block() const -> Block* { return otherwise; }
 
     /// Replace the else block.
-    void else_block(Block* b) { UpdateOperand(otherwise, b); }
+    void else_block(Block* b) { UpdateSuccessor(otherwise, b); }
 
     /// Get the block to branch to if the condition is true.
     [[nodiscard]]
     auto then_block() const -> Block* { return then; }
 
     /// Replace the then block.
-    void then_block(Block* b) { UpdateOperand(then, b); }
+    void then_block(Block* b) { UpdateSuccessor(then, b); }
 
     /// RTTI.
     [[nodiscard]]
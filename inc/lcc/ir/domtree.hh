@@ -3,6 +3,9 @@
 
 #include <lcc/ir/core.hh>
 
+#include <span>
+#include <vector>
+
 namespace lcc {
 class DomTree {
     static constexpr usz RootId = 0;
@@ -14,16 +17,44 @@ class DomTree {
     /// Immediate Dominators.
     Buffer<usz> idoms{f->blocks().size(), InvalidId};
 
-    /// Dominance frontier of each node.
-    Buffer<std::vector<Block*>> df{f->blocks().size()};
+    /// Children of each node, stored in one flat list: the children
+    /// of node i are child_list[child_offsets[i] .. child_offsets[i + 1]).
+    std::vector<usz> child_offsets;
+    std::vector<usz> child_list;
+
+    /// Dominance frontier of each node, stored in the same way.
+    std::vector<usz> df_offsets;
+    std::vector<Block*> df_list;
 
-    /// Children of each node.
-    Buffer<std::vector<usz>> children{f->blocks().size()};
+    /// Whether the dominance frontiers have been computed.
+    bool has_frontiers;
 
 public:
     /// Compute the dominator tree for a function.
     DomTree(Function* f, bool compute_dominance_frontiers = true);
 
+    /// Update the tree after an edge was added to the CFG.
+    ///
+    /// This only handles edges that leave the dominators unchanged,
+    /// e.g. an edge out of an unreachable block, or an edge to a
+    /// block whose immediate dominator dominates the source.
+    ///
+    /// \return false if the tree could not be updated and must be
+    ///     rebuilt.
+    [[nodiscard]]
+    auto insert_edge(Block* from, Block* to) -> bool;
+
+    /// Update the tree after an edge was removed from the CFG.
+    ///
+    /// This only handles edges that leave the dominators unchanged,
+    /// e.g. an edge out of an unreachable block, or a back edge to
+    /// a block that dominates the source.
+    ///
+    /// \return false if the tree could not be updated and must be
+    ///     rebuilt.
+    [[nodiscard]]
+    auto erase_edge(Block* from, Block* to) -> bool;
+
     /// Get a representation of this dominator tree in the DOT format.
     auto debug() const -> std::string;
 
@@ -37,7 +68,7 @@ public:
             auto b = stack.back();
             stack.pop_back();
             co_yield b;
-            for (auto c : children[b->id()]) {
+            for (auto c : children(b->id())) {
                 if (not visited[c]) {
                     stack.push_back(f->blocks()[c].get());
                     visited[c] = true;
@@ -47,7 +78,11 @@ public:
     }
 
     /// Get the dominance frontier of a block.
-    auto dom_frontier(Block* b) const -> const std::vector<Block*>& { return df[b->id()]; }
+    auto dom_frontier(Block* b) const -> std::span<Block* const> {
+        LCC_ASSERT(has_frontiers, "Dominance frontiers were not computed");
+        auto i = b->id();
+        return std::span{df_list}.subspan(df_offsets[i], df_offsets[i + 1] - df_offsets[i]);
+    }
 
     /// Check if a block dominates another.
     auto dominates(Block* dominator, Block* b) const -> bool {
@@ -129,6 +164,36 @@ public:
 
         return false;
     }
+
+private:
+    /// Get the children of a node.
+    auto children(usz i) const -> std::span<const usz> {
+        return std::span{child_list}.subspan(child_offsets[i], child_offsets[i + 1] - child_offsets[i]);
+    }
+
+    /// Add a block to the dominance frontiers of the given nodes.
+    void AddToFrontiers(std::span<const usz> nodes, Block* b);
+
+    /// Compute the children of each node from the immediate dominators.
+    void ComputeChildren();
+
+    /// Compute the dominance frontiers of all nodes.
+    void ComputeFrontiers();
+
+    /// Call a function for every node whose dominance frontier
+    /// contains `to` because of the edge from block `from_id` to it.
+    template <typename Callable>
+    void ForEachFrontierOf(usz from_id, Block* to, Callable cb) const {
+        /// An unreachable block contributes nothing to any frontier.
+        if (idoms[from_id] == InvalidId) return;
+        for (usz x = from_id;;) {
+            auto b = f->blocks()[x].get();
+            if (strictly_dominates(b, to)) return;
+            cb(x);
+            if (x == RootId) return;
+            x = idoms[x];
+        }
+    }
 };
 } // namespace lcc
 
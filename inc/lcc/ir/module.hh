@@ -12,7 +12,9 @@
 #include <lccbase/diags.hh>
 
 #include <algorithm>
+#include <cstdio>
 #include <memory>
+#include <span>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -94,14 +96,35 @@ public:
     [[nodiscard]]
     auto as_llvm_ir() -> std::string;
 
+    /// Write the module as Textual LLVM IR to a file, as it is
+    /// generated. See `as_llvm_ir()`.
+    void emit_llvm_ir(std::FILE* file);
+
     /// Get the textual LCC IR of this module.
     [[nodiscard]]
     auto as_lcc_ir(bool use_colour) -> std::string;
 
+    /// Write the textual LCC IR of this module to a file, as it is
+    /// generated.
+    void emit_lcc_ir(std::FILE* file, bool use_colour);
+
     /// Get the textual WebAssembly of this module.
     [[nodiscard]]
     auto as_wat() -> std::string;
 
+    /// Write the textual WebAssembly of this module to a file, as it
+    /// is generated.
+    void emit_wat(std::FILE* file);
+
+    /// Get the binary LCC IR of this module. See module_bin.cc for
+    /// the format.
+    [[nodiscard]]
+    auto as_binary_ir() -> std::string;
+
+    /// Write the binary LCC IR of this module to a file, as it is
+    /// generated.
+    void emit_binary_ir(std::FILE* file);
+
     [[nodiscard]]
     auto code() -> std::vector<std::unique_ptr<Function>>& { return _code; }
     [[nodiscard]]
@@ -188,6 +211,14 @@ public:
     /// Parse a module from a file.
     [[nodiscard]]
     static auto Parse(Context* ctx, File& file) -> std::unique_ptr<Module>;
+
+    /// Read a module from binary LCC IR. The data is only read, not
+    /// copied, so it may be a mapped file.
+    [[nodiscard]]
+    static auto ParseBinary(Context* ctx, std::span<const char> data) -> std::unique_ptr<Module>;
+    /// Read a module from a file containing binary LCC IR.
+    [[nodiscard]]
+    static auto ParseBinary(Context* ctx, File& file) -> std::unique_ptr<Module>;
 };
 
 } // namespace lcc
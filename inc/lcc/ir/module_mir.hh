@@ -15,15 +15,48 @@ namespace lcc {
 struct MIRBuildContext {
     Module& mod;
 
-    // THOUGHTS: It may be beneficial cache-wise to use a union between a
-    // vector and a map and switch between them at a certain size (like >4096
-    // values, off the top of my head).
-    // You are going to want to populate this first :).
-    std::unordered_map<Value*, usz> virts{};
-
     std::vector<MFunction> funcs{};
 
     Function* func_memcpy{};
+    // Only declared if some MemSet intrinsic has to be lowered to a call.
+    Function* func_memset{};
+
+    // SysV register parameters are copied into these virtual registers on
+    // entry to their function, so that the argument registers are free to be
+    // clobbered (by calls, divisions, shifts, ...) afterwards.
+    std::unordered_map<Parameter*, usz> parameter_registers{};
+
+    // Where the machine instruction defining a virtual register lives. The
+    // index is only a hint, as instructions may be removed from a block.
+    struct MInstLocation {
+        MBlock* block{};
+        usz index{};
+    };
+
+    // Dense map from virtual registers assigned to IR values (offset by
+    // Module::first_virtual_register) to their defining machine instruction.
+    std::vector<MInstLocation> minsts{};
+
+    // The block currently being generated, and how many of its instructions
+    // have been recorded in `minsts`.
+    MBlock* indexed_block{};
+    usz indexed_count{};
+
+    // Get the virtual register assigned to an IR value, or 0 if it has none.
+    // You are going to want to populate these first :).
+    [[nodiscard]]
+    static auto virt(Value* v) -> usz {
+        if (auto* inst = cast<Inst>(v)) return inst->virtual_register();
+        return 0;
+    }
+
+    // Record machine instructions added to a block since the last call.
+    void index_minsts(MBlock& block);
+
+    // Remove the machine instructions defining a virtual register from a
+    // block. Use this instead of MBlock::remove_inst_by_reg() while
+    // generating MIR.
+    void remove_minst(MBlock& block, usz virtual_register);
 
     // Find machine instruction based on virtual register.
     [[nodiscard]]
@@ -39,6 +39,7 @@ typedef enum LccValueKind {
     LCC_INST_LOAD,
     LCC_INST_PARAMETER,
     LCC_INST_PHI,
+    LCC_INST_SELECT,
     LCC_INST_STORE,
 
     /// TERMINATORS.
@@ -156,6 +157,24 @@ typedef struct LccModule* LccModuleRef;
 typedef struct LccValue* LccValueRef;
 typedef struct LccType* LccTypeRef;
 
+// Keep this in sync with the cursor constructors below.
+typedef enum LccCursorKind {
+    LCC_CURSOR_MODULE_FUNCTIONS,
+    LCC_CURSOR_MODULE_VARIABLES,
+    LCC_CURSOR_FUNCTION_BLOCKS,
+    LCC_CURSOR_BLOCK_INSTRUCTIONS,
+    LCC_CURSOR_VALUE_USERS,
+} LccCursorKind;
+
+/// Iterates over the functions of a module, the instructions of a
+/// block, etc. A cursor is a plain value and owns nothing; it must
+/// not outlive what it iterates over.
+typedef struct LccCursor {
+    const void* container;
+    int64_t index;
+    LccCursorKind kind;
+} LccCursor;
+
 // ==== Modules
 
 /// Gets the target info for 64 bit Linux.
@@ -373,6 +392,41 @@ LccValueRef lcc_get_unary_operand(LccValueRef instruction);
 /// Set this unary instruction's operand.
 void lcc_set_unary_operand(LccValueRef instruction, LccValueRef block);
 
+// ==== Bulk Access
+//
+// These copy up to `capacity` values, starting at index `first`,
+// into the caller-provided array `out`, and return how many values
+// were copied. Use them instead of the `..._at_index()` accessors
+// to avoid a call per value.
+
+/// Copy the functions declared/defined in this LCC module.
+int64_t lcc_module_get_functions(LccModuleRef module, LccValueRef* out, int64_t first, int64_t capacity);
+/// Copy the (global) variables declared/defined in this LCC module.
+int64_t lcc_module_get_variables(LccModuleRef module, LccValueRef* out, int64_t first, int64_t capacity);
+/// Copy the blocks in this function.
+int64_t lcc_get_function_blocks(LccValueRef function, LccValueRef* out, int64_t first, int64_t capacity);
+/// Copy the instructions in this block.
+int64_t lcc_get_block_instructions(LccValueRef block, LccValueRef* out, int64_t first, int64_t capacity);
+/// Copy the users of this value.
+int64_t lcc_get_value_users(LccValueRef value, LccValueRef* out, int64_t first, int64_t capacity);
+
+// ==== Cursors
+
+/// Get a cursor over the functions in this LCC module.
+LccCursor lcc_module_function_cursor(LccModuleRef module);
+/// Get a cursor over the (global) variables in this LCC module.
+LccCursor lcc_module_variable_cursor(LccModuleRef module);
+/// Get a cursor over the blocks in this function.
+LccCursor lcc_function_block_cursor(LccValueRef function);
+/// Get a cursor over the instructions in this block.
+LccCursor lcc_block_instruction_cursor(LccValueRef block);
+/// Get a cursor over the users of this value.
+LccCursor lcc_value_user_cursor(LccValueRef value);
+
+/// Get the next value and advance the cursor, or NULL if there are
+/// no more values.
+LccValueRef lcc_cursor_next(LccCursor* cursor);
+
 // ==== Instruction Constructors
 
 LccValueRef lcc_build_alloca(LccTypeRef type, LccLocation location);
@@ -381,6 +435,7 @@ LccValueRef lcc_build_intrinsic(LccIntrinsicKind intrinsic, LccValueRef* operand
 LccValueRef lcc_build_load(LccTypeRef type, LccValueRef address, LccLocation location);
 LccValueRef lcc_build_store(LccValueRef value, LccValueRef address, LccLocation location);
 LccValueRef lcc_build_phi(LccTypeRef type, LccLocation location);
+LccValueRef lcc_build_select(LccValueRef condition, LccValueRef then_value, LccValueRef else_value, LccLocation location);
 LccValueRef lcc_build_param(LccTypeRef type, uint32_t index, LccLocation location);
 LccValueRef lcc_build_branch(LccValueRef target_block, LccLocation location);
 LccValueRef lcc_build_cond_branch(LccValueRef condition, LccValueRef then_block, LccValueRef else_block, LccLocation location);
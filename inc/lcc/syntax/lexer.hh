@@ -5,11 +5,86 @@
 #include <lccbase/file.hh>
 #include <lcc/utils.hh>
 
+#include <bit>
+#include <string>
 #include <string_view>
 #include <utility>
 
+#if defined(__SSE2__)
+#    include <emmintrin.h>
+#endif
+
 namespace lcc::syntax {
 namespace detail {
+/// Byte scanners used by CharacterRange to skip over long runs of
+/// input (whitespace, comments, string bodies) without decoding
+/// every character individually. Each one looks at 16 bytes at a
+/// time where SSE2 is available and finishes with a scalar loop.
+///
+/// None of these ever stop in the middle of a UTF-8 sequence: the
+/// bytes they look for are all ASCII, and no byte of a multi-byte
+/// sequence is.
+
+/// Return the first byte in [p, end) that is NOT in \p set. Sets
+/// must only contain ASCII characters other than NUL.
+[[nodiscard]]
+inline auto scan_past_ascii(const char* p, const char* end, std::string_view set) -> const char* {
+#if defined(__SSE2__)
+    while (end - p >= 16) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        auto in_set = _mm_setzero_si128();
+        for (char c : set) in_set = _mm_or_si128(in_set, _mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+        auto mask = ~unsigned(_mm_movemask_epi8(in_set)) & 0xffffU;
+        if (mask) return p + std::countr_zero(mask);
+        p += 16;
+    }
+#endif
+    while (p < end and set.contains(*p)) ++p;
+    return p;
+}
+
+/// Return the first byte in [p, end) that is NUL or in \p stops;
+/// if \p stop_at_non_ascii is set, also stop at any byte that is
+/// not ASCII.
+[[nodiscard]]
+inline auto scan_until_ascii(
+    const char* p,
+    const char* end,
+    std::string_view stops,
+    bool stop_at_non_ascii
+) -> const char* {
+#if defined(__SSE2__)
+    while (end - p >= 16) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        auto hit = _mm_cmpeq_epi8(v, _mm_setzero_si128());
+        for (char c : stops) hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+        auto mask = unsigned(_mm_movemask_epi8(hit));
+        if (stop_at_non_ascii) mask |= unsigned(_mm_movemask_epi8(v));
+        if (mask) return p + std::countr_zero(mask);
+        p += 16;
+    }
+#endif
+    while (
+        p < end and *p != 0 and not stops.contains(*p)
+        and not (stop_at_non_ascii and u8(*p) >= 0x80)
+    ) ++p;
+    return p;
+}
+
+/// Check whether [p, end) only contains ASCII bytes.
+[[nodiscard]]
+inline auto is_ascii(const char* p, const char* end) -> bool {
+#if defined(__SSE2__)
+    auto any = _mm_setzero_si128();
+    for (; end - p >= 16; p += 16)
+        any = _mm_or_si128(any, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    if (_mm_movemask_epi8(any)) return false;
+#endif
+    for (; p < end; ++p)
+        if (u8(*p) >= 0x80) return false;
+    return true;
+}
+
 /// API for the lexer to make sure the lexer code doesn’t
 /// try to do funny stuff with `curr` since extracting the
 /// next character is NOT trivial and should ONLY ever be
@@ -34,21 +109,26 @@ class CharacterRange {
         COUNT
     } encoding{Encoding::UTF8};
 
+    /// Most sources are plain ASCII; don’t bother decoding those.
+    void detect_encoding() {
+        if (is_ascii(curr, end)) encoding = Encoding::ASCII;
+    }
+
 public:
     explicit CharacterRange(File* f)
         : curr(f->data()),
           end(f->data() + f->size()),
-          begin(f->data()) {}
+          begin(f->data()) { detect_encoding(); }
 
     explicit CharacterRange(File* f, usz pos, usz len)
         : curr(f->data() + std::min(pos, f->size() - 1)),
           end(f->data() + std::min(pos + len, f->size())),
-          begin(f->data()) {}
+          begin(f->data()) { detect_encoding(); }
 
     explicit CharacterRange(std::string_view s)
         : curr(s.data()),
           end(s.data() + s.size()),
-          begin(s.data()) {}
+          begin(s.data()) { detect_encoding(); }
 
     /// Get the current offset in the file.
     [[nodiscard]]
@@ -144,6 +224,46 @@ public:
         return b0;
     }
 
+    /// Append bytes to \p out for as long as they are ASCII and
+    /// satisfy \p pred, advancing past them.
+    ///
+    /// Within ASCII, one byte is one character, and neither NUL
+    /// nor line endings can get through a sensible predicate, so
+    /// this is equivalent to calling `next()` repeatedly; the
+    /// first byte that doesn’t match is left for `next()`.
+    template <typename Predicate>
+    void append_ascii_while(std::string& out, Predicate pred) {
+        const char* run = curr;
+        while (run < end and u8(*run) < 0x80 and *run != 0 and pred(u32(u8(*run))))
+            ++run;
+        out.append(curr, usz(run - curr));
+        curr = run;
+    }
+
+    /// Skip bytes for as long as they are in \p set, which must only
+    /// contain ASCII characters other than NUL. Meant for whitespace;
+    /// line endings need no normalisation if they’re skipped anyway.
+    void skip_ascii_in(std::string_view set) {
+        curr = scan_past_ascii(curr, end, set);
+    }
+
+    /// Skip bytes up to, but not including, the next one in \p stops
+    /// (ASCII only), or a NUL byte. Any non-ASCII characters are
+    /// skipped without being decoded. If a line ending is to be found,
+    /// \p stops must contain both '\r' and '\n'.
+    void skip_until(std::string_view stops) {
+        curr = scan_until_ascii(curr, end, stops, false);
+    }
+
+    /// Append bytes to \p out up to, but not including, the next one
+    /// that is in \p stops, NUL, or not ASCII. Stops must include
+    /// '\r' if the caller cares about line ending normalisation.
+    void append_ascii_until(std::string& out, std::string_view stops) {
+        const char* run = scan_until_ascii(curr, end, stops, true);
+        out.append(curr, usz(run - curr));
+        curr = run;
+    }
+
     /// Get the next character.
     [[nodiscard]]
     auto next() -> u32 {
@@ -27,7 +27,10 @@ private:
 
     static constexpr Word Bits = sizeof(Word) * CHAR_BIT;
 
-    constexpr auto SExt() const -> SWord { return SWord(sign_bit() ? ~Word(0) & w : w); }
+    constexpr auto SExt() const -> SWord {
+        /// Fill in everything above the sign bit if it is set.
+        return SWord(w & sign_bit() ? w | ~(sign_bit() | (sign_bit() - 1)) : w);
+    }
 
 public:
     constexpr aint() = default;
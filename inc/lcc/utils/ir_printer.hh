@@ -6,9 +6,11 @@
 #include <lcc/ir/core.hh>
 #include <lcc/ir/module.hh>
 #include <lcc/utils/colours.hh>
+#include <lcc/utils/output_buffer.hh>
 
 #include <lccbase/context.hh>
 
+#include <cstdio>
 #include <iterator>
 #include <string>
 #include <unordered_map>
@@ -36,10 +38,22 @@ struct IRColourPalette {
     static constexpr auto Literal = BoldMagenta;
 };
 
+/// Text that is formatted straight into the output when it is
+/// passed to IRPrinter::Print(), instead of into a string of its
+/// own first. `write` is called with the output iterator and must
+/// return it, advanced.
+template <typename Write>
+struct DeferredText {
+    Write write;
+};
+
+template <typename Write>
+DeferredText(Write) -> DeferredText<Write>;
+
 template <typename Derived, usz block_indent>
 class IRPrinter {
 private:
-    std::string s{};
+    OutputBuffer _out;
     isz tmp = 0;
 
     /// Map from blocks and instructions to their indices.
@@ -50,12 +64,21 @@ public:
     /// Entry point.
     [[nodiscard]]
     static auto Print(Module* mod, bool use_colour) -> std::string {
-        return IRPrinter{use_colour}.PrintModule(mod);
+        IRPrinter p{use_colour};
+        p.PrintModule(mod);
+        return p._out.take();
+    }
+
+    /// Entry point. Write the module to a file as it is printed.
+    static void Emit(Module* mod, bool use_colour, std::FILE* file) {
+        IRPrinter p{use_colour, file};
+        p.PrintModule(mod);
+        p._out.flush();
     }
 
 protected:
-    explicit IRPrinter(bool use_colour)
-        : _use_colour(use_colour) {}
+    explicit IRPrinter(bool use_colour, std::FILE* file = nullptr)
+        : _out(file), _use_colour(use_colour) {}
 
     using P = IRColourPalette;
 
@@ -77,25 +100,39 @@ protected:
     /// Check if an instruction has an index.
     auto HasIndex(Inst* inst) const -> bool { return inst_indices.contains(inst); }
 
-    /// Get an insert iterator to a string.
-    static auto It(std::string& str) { return std::back_inserter(str); }
+    /// Get the inline representation of a value, for Print().
+    ///
+    /// The derived printer writes it with WriteVal(), straight into
+    /// the output, so printing an operand allocates nothing.
+    [[nodiscard]]
+    auto Val(Value* v, bool include_type = true) {
+        return DeferredText{[this, v, include_type](auto out) {
+            return This()->WriteVal(out, v, include_type);
+        }};
+    }
+
+    /// Get the inline representation of a type, for Print(); see Val().
+    [[nodiscard]]
+    auto Ty(Type* ty) {
+        return DeferredText{[this, ty](auto out) { return This()->WriteTy(out, ty); }};
+    }
 
     /// Get the content to be printed.
-    auto Output() -> std::string_view { return s; }
+    auto Output() -> std::string_view { return _out.text(); }
 
     /// Append text to the output.
     template <typename... Args>
     void Print(fmt::format_string<Args...> fmt, Args&&... args) {
-        fmt::format_to(It(s), fmt, std::forward<Args>(args)...);
+        _out.print(fmt, std::forward<Args>(args)...);
     }
 
     /// Emit a block and its containing instructions.
     void PrintBlock(Block* b) {
-        for (usz i = 0; i < block_indent; i++) s += ' ';
+        for (usz i = 0; i < block_indent; i++) _out.write(' ');
         Print("{}bb{}{}:\n", C(P::Block), block_indices[b], C(P::Filler));
         for (auto& inst : b->instructions()) {
             This()->PrintInst(inst.get());
-            s += '\n';
+            _out.write('\n');
         }
     }
 
@@ -105,7 +142,7 @@ protected:
         tmp = isz(f->param_count());
         This()->PrintFunctionHeader(f);
         if (f->blocks().empty()) {
-            s += '\n';
+            _out.write('\n');
             return;
         }
 
@@ -117,21 +154,25 @@ protected:
         This()->ExitFunctionBody(f);
     }
 
-    [[nodiscard]]
-    auto PrintModule(Module* mod) -> std::string {
+    /// Print a module. Output is flushed between globals and
+    /// functions if we're writing to a file.
+    void PrintModule(Module* mod) {
         This()->PrintHeader(mod);
         for (auto struct_type : mod->context()->struct_types)
             This()->PrintStructType(struct_type);
         if (not mod->context()->struct_types.empty())
-            s += '\n';
-        for (auto& var : mod->vars())
+            _out.write('\n');
+        for (auto& var : mod->vars()) {
             This()->PrintGlobal(var.get());
+            _out.maybe_flush();
+        }
         if (not mod->vars().empty())
-            s += '\n';
-        for (auto& f : mod->code())
+            _out.write('\n');
+        for (auto& f : mod->code()) {
             PrintFunction(f.get());
-        s += C(P::Reset);
-        return std::move(s);
+            _out.maybe_flush();
+        }
+        _out.write(C(P::Reset));
     }
 
     void SetFunctionIndices(Function* f) {
@@ -149,4 +190,12 @@ protected:
 };
 } // namespace lcc
 
+template <typename Write>
+struct fmt::formatter<lcc::DeferredText<Write>> : fmt::formatter<fmt::string_view> {
+    template <typename FormatContext>
+    auto format(const lcc::DeferredText<Write>& text, FormatContext& ctx) const {
+        return text.write(ctx.out());
+    }
+};
+
 #endif // LCC_UTILS_IR_PRINTER_HH
@@ -0,0 +1,88 @@
+#ifndef LCC_UTILS_OUTPUT_BUFFER_HH
+#define LCC_UTILS_OUTPUT_BUFFER_HH
+
+#include <hdronly/lcc/typedefs.hh>
+
+#include <lccbase/assert.hh>
+#include <lccbase/diags.hh>
+
+#include <fmt/format.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace lcc {
+/// Text output that is written to a file in chunks as it is
+/// produced, rather than built up into one big string first.
+///
+/// Without a file, all output is kept and may be taken as a
+/// string at the end.
+class OutputBuffer {
+    fmt::memory_buffer _buffer{};
+    std::FILE* _file{};
+
+public:
+    /// Buffered output is written out once there is at least
+    /// this much of it.
+    static constexpr usz flush_threshold = 64 * 1024;
+
+    OutputBuffer() = default;
+    explicit OutputBuffer(std::FILE* file) : _file(file) {}
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer(OutputBuffer&&) = delete;
+    auto operator=(const OutputBuffer&) -> OutputBuffer& = delete;
+    auto operator=(OutputBuffer&&) -> OutputBuffer& = delete;
+
+    ~OutputBuffer() { flush(); }
+
+    /// Append formatted text.
+    template <typename... Args>
+    void print(fmt::format_string<Args...> fmt, Args&&... args) {
+        fmt::format_to(std::back_inserter(_buffer), fmt, std::forward<Args>(args)...);
+    }
+
+    /// Append text as-is.
+    void write(std::string_view text) {
+        _buffer.append(text.data(), text.data() + text.size());
+    }
+    void write(char c) { _buffer.push_back(c); }
+
+    /// Get the text that hasn't been written out yet.
+    [[nodiscard]]
+    auto text() const -> std::string_view {
+        return {_buffer.data(), _buffer.size()};
+    }
+
+    /// Write out the buffered text if there is enough of it. Call
+    /// this wherever the output may be split, e.g. after every
+    /// function.
+    void maybe_flush() {
+        if (_buffer.size() >= flush_threshold) flush();
+    }
+
+    /// Write out the buffered text, if there is a file.
+    void flush() {
+        if (not _file or _buffer.size() == 0) return;
+        if (std::fwrite(_buffer.data(), 1, _buffer.size(), _file) != _buffer.size())
+            Diag::Fatal("Failed to write output: {}", std::strerror(errno));
+        _buffer.clear();
+    }
+
+    /// Take all output as a string. Only valid without a file.
+    [[nodiscard]]
+    auto take() -> std::string {
+        LCC_ASSERT(not _file, "Cannot take output that is written to a file");
+        auto out = fmt::to_string(_buffer);
+        _buffer.clear();
+        return out;
+    }
+};
+} // namespace lcc
+
+#endif // LCC_UTILS_OUTPUT_BUFFER_HH
@@ -0,0 +1,133 @@
+#ifndef LCC_UTILS_THREAD_POOL_HH
+#define LCC_UTILS_THREAD_POOL_HH
+
+#include <hdronly/lcc/typedefs.hh>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace lcc::utils {
+/// A fixed number of worker threads that run tasks from a queue.
+///
+/// Work is handed to the pool with `for_each_index()`, which the
+/// calling thread takes part in as well, so it is safe to use from
+/// within a task running on the pool, and never waits on a worker
+/// that is busy with something else.
+class ThreadPool {
+    std::vector<std::thread> _workers{};
+    std::deque<std::function<void()>> _tasks{};
+    std::mutex _mutex{};
+    std::condition_variable _task_available{};
+    bool _stopping{false};
+
+    void work() {
+        for (;;) {
+            std::function<void()> task{};
+            {
+                std::unique_lock lock{_mutex};
+                _task_available.wait(lock, [&] { return _stopping or not _tasks.empty(); });
+                if (_tasks.empty()) return;
+                task = std::move(_tasks.front());
+                _tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+public:
+    /// One thread per hardware thread.
+    static auto hardware_threads() -> usz {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    explicit ThreadPool(usz threads = hardware_threads()) {
+        _workers.reserve(threads);
+        for (usz i = 0; i < threads; ++i)
+            _workers.emplace_back([this] { work(); });
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    auto operator=(const ThreadPool&) -> ThreadPool& = delete;
+    auto operator=(ThreadPool&&) -> ThreadPool& = delete;
+
+    /// Finishes the tasks that are already queued.
+    ~ThreadPool() {
+        {
+            std::scoped_lock lock{_mutex};
+            _stopping = true;
+        }
+        _task_available.notify_all();
+        for (auto& worker : _workers) worker.join();
+    }
+
+    /// The pool shared by everything in the process that wants to do
+    /// work in parallel, so that it never runs more threads than there
+    /// are hardware threads, however many parts of LCC use it at once.
+    static auto shared() -> ThreadPool& {
+        static ThreadPool pool{};
+        return pool;
+    }
+
+    /// Number of worker threads.
+    [[nodiscard]]
+    auto size() const -> usz { return _workers.size(); }
+
+    /// Call `f(i)` for every `i` in `[0, count)`, on at most `jobs`
+    /// threads at a time (the calling thread included), and return
+    /// once all calls have returned. Indices are handed out in order.
+    template <typename Callable>
+    void for_each_index(usz count, Callable f, usz jobs = hardware_threads()) {
+        // Helpers that haven't started by the time the calling thread
+        // runs out of indices have nothing left to do; they must not
+        // be waited for, as every worker may be busy, so they may
+        // outlive this call and only ever look at this state.
+        struct Batch {
+            std::atomic<usz> next{0};
+            std::mutex mutex{};
+            std::condition_variable idle{};
+            usz active{0};
+            bool closed{false};
+        };
+        auto batch = std::make_shared<Batch>();
+        auto run = [batch = batch.get(), count, &f] {
+            for (auto i = batch->next++; i < count; i = batch->next++) f(i);
+        };
+
+        const usz helpers = std::min({count, jobs, size() + 1}) - std::min<usz>(count, 1);
+        if (helpers) {
+            {
+                std::scoped_lock lock{_mutex};
+                for (usz i = 0; i < helpers; ++i) {
+                    _tasks.emplace_back([batch, run] {
+                        {
+                            std::scoped_lock batch_lock{batch->mutex};
+                            if (batch->closed) return;
+                            ++batch->active;
+                        }
+                        run();
+                        std::scoped_lock batch_lock{batch->mutex};
+                        if (--batch->active == 0) batch->idle.notify_all();
+                    });
+                }
+            }
+            _task_available.notify_all();
+        }
+
+        run();
+        std::unique_lock lock{batch->mutex};
+        batch->closed = true;
+        batch->idle.wait(lock, [&] { return batch->active == 0; });
+    }
+};
+} // namespace lcc::utils
+
+#endif /* LCC_UTILS_THREAD_POOL_HH */
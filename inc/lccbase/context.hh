@@ -8,10 +8,15 @@
 #include <hdronly/lcc/forward.hh>
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
 #include <filesystem>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -22,6 +27,14 @@
 
 namespace lcc {
 
+/// State shared by everything that is compiled together.
+///
+/// A context may be shared by several threads, e.g. frontends
+/// compiling different modules at the same time. The target, format,
+/// options, include directories and CRT directory are configuration:
+/// set them up before any other thread uses the context, and do not
+/// change them afterwards. Everything else (files, diagnostics, the
+/// error flag, and the IR type caches) may be used concurrently.
 class Context {
 public:
     enum OptionColour : bool {
@@ -88,11 +101,43 @@ private:
     /// The files owned by the context.
     std::vector<std::unique_ptr<File>> owned_files{};
 
-    std::vector<DiagnosticReport> _diagnostics{};
-    bool _suppress_diagnostics{false};
+    /// Owned files by path, so loading a file that is already
+    /// loaded (e.g. a header included from many places) is cheap.
+    std::unordered_map<std::string, File*> files_by_path{};
+
+    /// Guards `owned_files` and `files_by_path`.
+    mutable std::mutex files_mutex;
+
+    /// Interned identifiers, by id; see intern(). A deque, so the
+    /// views in `identifier_ids` stay valid as it grows.
+    std::deque<std::string> identifiers{""};
+
+    /// The id of each interned identifier.
+    std::unordered_map<std::string_view, u32> identifier_ids{{"", 0}};
+
+    /// Guards `identifiers` and `identifier_ids`.
+    mutable std::shared_mutex identifiers_mutex;
+
+    /// Diagnostics reported by one thread. Only that thread adds to
+    /// it, so its lock is only ever contended while merging.
+    struct DiagnosticBuffer {
+        std::mutex mutex;
+        std::vector<DiagnosticReport> reports{};
+    };
+
+    /// One buffer per thread that has reported a diagnostic.
+    std::unordered_map<std::thread::id, std::unique_ptr<DiagnosticBuffer>> diagnostic_buffers{};
+
+    /// Guards `diagnostic_buffers` (but not the buffers themselves).
+    mutable std::mutex diagnostics_mutex;
+
+    /// Distinguishes this context from every other one ever created in
+    /// this process, including any that lived at the same address.
+    const u64 serial;
+    std::atomic<bool> _suppress_diagnostics{false};
 
     /// Error flag. This is set-only.
-    mutable bool error_flag = false;
+    mutable std::atomic<bool> error_flag = false;
 
     Options _options;
 
@@ -108,6 +153,7 @@ private:
     // Options checked via has_option(). If a user option is provided and
     // never checked for, we can warn the user.
     std::vector<std::string> _checked_options{};
+    std::mutex checked_options_mutex;
 
     /// Called once the first time a context is created.
     static void InitialiseLCCData();
@@ -121,6 +167,10 @@ public:
     std::vector<Type*> function_types;
     std::vector<Type*> struct_types;
 
+    /// Guards the IR type caches. Lookups take it shared and only
+    /// creating a new type takes it exclusively.
+    std::shared_mutex type_cache_mutex;
+
     /// Create a new context.
     explicit Context(
         const Target* target,
@@ -147,12 +197,40 @@ public:
         );
     }
 
-    /// Get a list of all files owned by the context.
+    /// Get all files owned by the context, ordered by id.
+    ///
+    /// This is a snapshot: files loaded by other threads afterwards
+    /// are not included, but the files themselves stay valid for as
+    /// long as the context does.
+    [[nodiscard]]
+    auto files() const -> std::vector<const File*> {
+        std::scoped_lock lock{files_mutex};
+        std::vector<const File*> out{};
+        out.reserve(owned_files.size());
+        for (const auto& f : owned_files) out.push_back(f.get());
+        return out;
+    }
+
+    /// Get the number of files owned by the context.
+    [[nodiscard]]
+    auto file_count() const -> usz {
+        std::scoped_lock lock{files_mutex};
+        return owned_files.size();
+    }
+
+    /// Get a file by id, or nullptr if there is no such file.
     [[nodiscard]]
-    auto files() const -> const decltype(owned_files)& {
-        return owned_files;
+    auto file(usz id) const -> const File* {
+        std::scoped_lock lock{files_mutex};
+        return id < owned_files.size() ? owned_files[id].get() : nullptr;
     }
 
+    /// Get the number that distinguishes this context from every other
+    /// one ever created in this process, including any that lived at
+    /// the same address.
+    [[nodiscard]]
+    auto serial_number() const -> u64 { return serial; }
+
     /// Get a file from disk.
     ///
     /// This loads a file from disk or returns a reference to it if
@@ -163,6 +241,24 @@ public:
     [[nodiscard]]
     auto get_or_load_file(fs::path path) -> File&;
 
+    /// Get the id of an identifier, interning it if this is the
+    /// first time it is seen.
+    ///
+    /// Ids are small and dense, and stay the same for as long as the
+    /// context lives, so two identifiers interned in the same context
+    /// are equal if and only if their ids are. The empty identifier
+    /// is always 0.
+    [[nodiscard]]
+    auto intern(std::string_view name) -> u32;
+
+    /// Get the id of an identifier, or 0 if it was never interned.
+    [[nodiscard]]
+    auto interned(std::string_view name) const -> u32;
+
+    /// Get the identifier an id was interned from.
+    [[nodiscard]]
+    auto identifier(u32 id) const -> std::string_view;
+
     /// Check if the error flag is set.
     [[nodiscard]]
     auto has_error() const -> bool { return error_flag; }
@@ -171,9 +267,7 @@ public:
     ///
     /// \return The previous value of the error flag.
     auto set_error() const -> bool {
-        auto old = error_flag;
-        error_flag = true;
-        return old;
+        return error_flag.exchange(true);
     }
 
     /// Check if all diagnostics are suppressed.
@@ -187,17 +281,23 @@ public:
         _suppress_diagnostics = true;
     }
 
-    auto report_diagnostic(Diag& d) {
-        _diagnostics.emplace_back(d.kind, d.where, d.message);
-    }
+    /// Record a diagnostic in the calling thread's buffer.
+    void report_diagnostic(Diag& d);
 
-    auto diagnostics() const {
-        return _diagnostics;
-    }
+    /// Get all diagnostics reported so far.
+    ///
+    /// If they were all reported by one thread, they are in the order in
+    /// which they were reported. Otherwise, each diagnostic is kept
+    /// together with the notes reported right after it by the same
+    /// thread, and these groups are ordered by the location, kind and
+    /// message of the diagnostic, and then those of its notes, so that
+    /// the result does not depend on which thread reported what, or
+    /// when. Diagnostics without a location come last.
+    [[nodiscard]]
+    auto diagnostics() const -> std::vector<DiagnosticReport>;
 
-    auto diagnostics() -> std::vector<DiagnosticReport>& {
-        return _diagnostics;
-    }
+    /// Forget all diagnostics reported so far.
+    void clear_diagnostics();
 
     /// Get the target.
     [[nodiscard]]
@@ -270,6 +370,8 @@ public:
     }
 
     // Collect provided options that were never checked for.
+    ///
+    /// Only call this once nothing is using the context anymore.
     auto unchecked_options() const -> std::vector<std::string> {
         std::vector<std::string> out{};
         for (auto provided_option : __options) {
@@ -292,6 +394,7 @@ public:
     }
 
     bool has_option(std::string_view option) {
+        std::scoped_lock lock{checked_options_mutex};
         if (not rgs::contains(_checked_options, without_dashes(option)))
             _checked_options.emplace_back(without_dashes(option));
         return rgs::contains(
@@ -303,6 +406,10 @@ public:
 private:
     /// Register a file in the context.
     auto make_file(fs::path name, std::vector<char>&& contents) -> File&;
+
+    /// Give a file its id and take ownership of it. The caller must
+    /// hold `files_mutex`.
+    auto register_file(std::unique_ptr<File> f) -> File&;
 };
 
 } // namespace lcc
@@ -79,6 +79,11 @@ public:
     static constexpr u8 ICE_EXIT_CODE = 17;
     static constexpr u8 FATAL_EXIT_CODE = 18;
 
+    /// If set, diagnostics printed on this thread are appended to this
+    /// string instead of being written to stderr, e.g. so that a test
+    /// runner can show them along with the test that caused them.
+    static inline thread_local std::string* output{};
+
     // Move constructor
     Diag(Diag&& other) noexcept
         : kind(other.kind)
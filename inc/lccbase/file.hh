@@ -3,6 +3,7 @@
 
 #include <hdronly/lcc/typedefs.hh>
 
+#include <cstdio>
 #include <filesystem>
 #include <string_view>
 #include <vector>
@@ -38,6 +39,9 @@ public:
     /// Write to a file on disk and terminate on error.
     static void WriteOrTerminate(const void* data, usz size, const fs::path& file);
 
+    /// Open a file on disk for writing and terminate on error.
+    static auto OpenForWritingOrTerminate(const fs::path& file) -> std::FILE*;
+
     /// Get a file's contents from disk.
     static auto Read(const fs::path& path) -> std::vector<char>;
 
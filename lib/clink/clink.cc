@@ -384,6 +384,7 @@ bool link(
         case lcc::Format::INVALID:
         case lcc::Format::LCC_IR:
         case lcc::Format::LCC_SSA_IR:
+        case lcc::Format::LCC_BINARY_IR:
         case lcc::Format::LLVM_TEXTUAL_IR:
         case lcc::Format::WASM_TEXTUAL:
         case lcc::Format::GNU_AS_ATT_ASSEMBLY:
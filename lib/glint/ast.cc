@@ -584,6 +584,99 @@ auto lcc::glint::CallExpr::callee_type() const -> FuncType* {
     return as<FuncType>(ty);
 }
 
+// Types within an expression that has not been analysed yet may still
+// be rewritten in place (e.g. when a template is expanded, or by sema
+// resolving named types), so a clone gets its own copy of them. Types
+// that are already analysed never change, and declared types are
+// nominal, so those are shared.
+namespace lcc::glint {
+template <typename CloneExpr>
+static auto clone_unanalysed_type(
+    Module& mod,
+    Type* type,
+    std::unordered_map<Scope*, Scope*>& scope_fixups,
+    CloneExpr&& clone_expr
+) -> Type* {
+    if (not type or type->sema() != SemaNode::State::NotAnalysed)
+        return type;
+
+    const auto CloneType = [&](Type* t) {
+        return clone_unanalysed_type(mod, t, scope_fixups, clone_expr);
+    };
+
+    switch (type->kind()) {
+        case Type::Kind::Pointer:
+            return new (mod) PointerType(CloneType(type->elem()), type->location());
+
+        case Type::Kind::Reference:
+            return new (mod) ReferenceType(CloneType(type->elem()), type->location());
+
+        case Type::Kind::Array: {
+            auto a = as<ArrayType>(type);
+            return new (mod) ArrayType(CloneType(a->elem()), clone_expr(a->size()), a->location());
+        }
+
+        case Type::Kind::ArrayView:
+            return new (mod) ArrayViewType(CloneType(type->elem()), type->location());
+
+        case Type::Kind::DynamicArray: {
+            auto d = as<DynamicArrayType>(type);
+            return new (mod) DynamicArrayType(
+                CloneType(d->elem()),
+                clone_expr(d->initial_size()),
+                d->location()
+            );
+        }
+
+        case Type::Kind::Function: {
+            auto f = as<FuncType>(type);
+            std::vector<FuncType::Param> params{};
+            params.reserve(f->params().size());
+            for (const auto& p : f->params())
+                params.emplace_back(p.name, CloneType(p.type), p.location);
+
+            return new (mod) FuncType(
+                std::move(params),
+                CloneType(f->return_type()),
+                f->attributes(),
+                f->location()
+            );
+        }
+
+        case Type::Kind::Typeof: {
+            auto t = as<TypeofType>(type);
+            return new (mod) TypeofType(clone_expr(t->expression()), t->location());
+        }
+
+        case Type::Kind::Named: {
+            auto n = as<NamedType>(type);
+            auto scope = n->scope();
+            if (scope_fixups.contains(scope))
+                scope = scope_fixups.at(scope);
+            return new (mod) NamedType(n->name(), scope, n->location());
+        }
+
+        case Type::Kind::Integer: {
+            auto i = as<IntegerType>(type);
+            return new (mod) IntegerType(i->bit_width(), i->is_signed(), i->location());
+        }
+
+        case Type::Kind::FFIType:
+            return FFIType::Make(mod, as<FFIType>(type)->ffi_kind(), type->location());
+
+        case Type::Kind::Builtin:
+        case Type::Kind::Type:
+        case Type::Kind::Struct:
+        case Type::Kind::TemplatedStruct:
+        case Type::Kind::Union:
+        case Type::Kind::Sum:
+        case Type::Kind::Enum:
+            return type;
+    }
+    LCC_UNREACHABLE();
+}
+} // namespace lcc::glint
+
 auto lcc::glint::Expr::CloneIntoImpl(
     Module& mod,
     Context* context,
@@ -600,6 +693,10 @@ auto lcc::glint::Expr::CloneIntoImpl(
         return Expr::CloneIntoImpl(mod, context, e, scope_fixups, current_scope);
     };
 
+    const auto CloneType = [&](Type* t) {
+        return clone_unanalysed_type(mod, t, scope_fixups, Clone);
+    };
+
     const auto CloneAll = [&](std::vector<Expr*> exprs) -> std::vector<Expr*> {
         std::vector<Expr*> out{};
         out.reserve(exprs.size());
@@ -831,7 +928,7 @@ auto lcc::glint::Expr::CloneIntoImpl(
             auto c = as<CastExpr>(expr);
             return new (mod) CastExpr(
                 Clone(c->operand()),
-                c->type(),
+                CloneType(c->type()),
                 c->cast_kind(),
                 c->location()
             );
@@ -917,11 +1014,13 @@ auto lcc::glint::Expr::CloneIntoImpl(
 
             LCC_ASSERT(fixed_scope);
 
+            // NOTE: The clone belongs to the module it is cloned into, which may not
+            // be the module of the original declaration.
             auto clone = new (mod) VarDecl(
                 v->name(),
-                v->type(),
+                CloneType(v->type()),
                 Clone(v->init()),
-                v->module(),
+                &mod,
                 v->linkage(),
                 v->location()
             );
@@ -989,44 +1088,12 @@ auto lcc::glint::Expr::CloneIntoImpl(
 
         case Kind::Type: {
             auto e_type = as<TypeExpr>(expr);
-            auto contained_type = e_type->contained_type();
-
             // TODO: Handle structs with initialized members...
-
-            if (auto t_fixedarray = cast<ArrayType>(contained_type); t_fixedarray) {
-                return new (mod) TypeExpr(
-                    mod,
-                    new (mod) ArrayType(
-                        t_fixedarray->elem(),
-                        Clone(t_fixedarray->size()),
-                        {}
-                    ),
-                    {}
-                );
-            }
-            if (auto t_dynarray = cast<DynamicArrayType>(contained_type); t_dynarray) {
-                return new (mod) TypeExpr(
-                    mod,
-                    new (mod) DynamicArrayType(
-                        t_dynarray->elem(),
-                        Clone(t_dynarray->initial_size()),
-                        {}
-                    ),
-                    {}
-                );
-            }
-            if (auto t_typeof = cast<TypeofType>(contained_type); t_typeof) {
-                return new (mod) TypeExpr(
-                    mod,
-                    new (mod) TypeofType(Clone(t_typeof->expression()), {}),
-                    {}
-                );
-            }
-            LCC_ASSERT(
-                expr->children().size() == 0,
-                "If a type has expressions within it, they need to be cloned properly"
+            return new (mod) TypeExpr(
+                mod,
+                CloneType(e_type->contained_type()),
+                expr->location()
             );
-            return new (mod) TypeExpr(mod, contained_type, expr->location());
         }
 
         case Kind::Module: {
@@ -1098,6 +1165,21 @@ auto lcc::glint::Expr::CloneInto(
     return CloneIntoImpl(mod, context, expr, scope_fixups, current_scope);
 }
 
+auto lcc::glint::Expr::CloneInto(
+    Module& mod,
+    Context* context,
+    Expr* expr,
+    Scope* from_scope,
+    Scope* to_scope
+) -> Expr* {
+    LCC_ASSERT(context);
+    // Don't pass me nullptr, I won't return it.
+    if (not expr) return {};
+
+    std::unordered_map<Scope*, Scope*> scope_fixups{{from_scope, to_scope}};
+    return CloneIntoImpl(mod, context, expr, scope_fixups, to_scope);
+}
+
 auto lcc::glint::Expr::FullClone(
     Module& mod,
     Context* context,
@@ -2518,8 +2600,8 @@ auto lcc::glint::GetPastLocation(lcc::glint::Expr* expr) -> lcc::Location {
 /// Only call this for valid `file_id`s, this function does assert
 /// validity.
 auto lcc::glint::GetLastLocation(const Context& context, u16 file_id) -> lcc::Location {
-    LCC_ASSERT(file_id < context.files().size());
-    auto& file = context.files().at(file_id);
+    const auto* file = context.file(file_id);
+    LCC_ASSERT(file);
     decltype(Location::pos) pos = 0;
     if (file->size() >= 1)
         pos = (u32) file->size() - 1;
@@ -1822,7 +1822,6 @@ void glint::IRGen::generate_expression(glint::Expr* expr) {
                 // Otherwise, crash.
 
                 // Create Basic Blocks
-                static usz total_sum_access{0};
                 auto* then = new (*ir_module) lcc::Block(
                     fmt::format("sum.access.good.{}", total_sum_access)
                 );
@@ -135,6 +135,7 @@ void lcc::glint::Lexer::NextToken() {
     /// Reset the token.
     tok.artificial = false;
     tok.kind = TokenKind::Invalid;
+    tok.identifier = 0;
 
     /// Keep returning EOF if we’re at EOF.
     if (not lastc) {
@@ -142,8 +143,11 @@ void lcc::glint::Lexer::NextToken() {
         return;
     }
 
-    /// Skip whitespace.
-    while (IsSpace(lastc)) NextChar();
+    /// Skip whitespace; runs of ASCII whitespace are skipped in bulk.
+    while (IsSpace(lastc)) {
+        chars.skip_ascii_in(" \t\n\r\f\v");
+        NextChar();
+    }
     tok.location.pos = CurrentOffset();
     tok.location.len = 1;
 
@@ -303,6 +307,7 @@ void lcc::glint::Lexer::NextToken() {
                         tok.text = fmt::format("{}{}", tok.text[0], tok.integer_value);
                     } break;
                 }
+                tok.identifier = context->intern(tok.text);
             }
 
             /// Mark it as artificial.
@@ -454,7 +459,10 @@ void lcc::glint::Lexer::NextToken() {
             NextChar();
             // Line comments begin with `;;`
             if (lastc == ';') {
-                while (lastc and lastc != '\n') NextChar();
+                while (lastc and lastc != '\n') {
+                    chars.skip_until("\r\n");
+                    NextChar();
+                }
                 return NextToken();
             }
 
@@ -659,14 +667,15 @@ void lcc::glint::Lexer::NextToken() {
 
     // Roundabout way to shoe-horn regular tokens into existing identifier-
     // only macro system.
-    if (not raw_mode and tok.kind != TokenKind::Invalid and tok.kind != TokenKind::Eof) {
+    // No need to stringify every token if there are no macros to match.
+    if (
+        not raw_mode and not macros.empty()
+        and tok.kind != TokenKind::Invalid and tok.kind != TokenKind::Eof
+    ) {
         auto stringified_token = ToSource(tok);
         if (stringified_token) {
-            auto macro = rgs::find_if(
-                macros,
-                [&](const auto& m) { return m.name == *stringified_token; }
-            );
-            if (macro != macros.end()) {
+            // A name that was never interned can't be the name of a macro.
+            if (auto* macro = FindMacro(context->interned(*stringified_token))) {
                 ExpandMacro(*macro);
                 return;
             }
@@ -695,13 +704,19 @@ void lcc::glint::Lexer::NextIdentifier() {
     // Note: Istg if anyone gets the genius idea of extracting a substring
     // instead of appending character by character, DON’T. There is a REASON
     // why NextChar() exists. Character != byte in the source file.
+    //
+    // The one exception is a run of plain ASCII identifier characters: there,
+    // one byte *is* one character, so we let the character range copy the
+    // whole run at once and only go through NextChar() for whatever ends it.
     do {
         if (lastc > 0xff)
             LCC_TODO("Handle unicode codepoint in identifier");
         tok.text += char(lastc);
+        chars.append_ascii_while(tok.text, IsIdentContinue);
         NextChar();
     } while (IsIdentContinue(lastc));
     tok.kind = TokenKind::Ident;
+    tok.identifier = context->intern(tok.text);
 }
 
 void lcc::glint::Lexer::HandleIdentifier() {
@@ -710,14 +725,7 @@ void lcc::glint::Lexer::HandleIdentifier() {
         return;
     }
 
-    auto macro = rgs::find_if(
-        macros,
-        [&](const auto& m) {
-            return m.name == tok.text;
-        }
-    );
-
-    if (macro != macros.end()) {
+    if (auto* macro = FindMacro(tok.identifier)) {
         ExpandMacro(*macro);
         return;
     }
@@ -776,6 +784,7 @@ void lcc::glint::Lexer::NextString() {
             }
             if (lastc > 0xff) LCC_TODO("Handle unicode codepoint in string literal");
             tok.text += char(lastc);
+            chars.append_ascii_until(tok.text, "'\r\n");
             NextChar();
         }
     } else {
@@ -814,6 +823,7 @@ void lcc::glint::Lexer::NextString() {
             } else {
                 if (lastc > 0xff) LCC_TODO("Handle unicode codepoint in string literal");
                 tok.text += char(lastc);
+                chars.append_ascii_until(tok.text, "\"\\\r\n");
             }
             NextChar();
         }
@@ -996,6 +1006,13 @@ void lcc::glint::Lexer::NextNumber() {
     }
 }
 
+auto lcc::glint::Lexer::FindMacro(u32 name) -> Macro* {
+    if (not name) return nullptr;
+    auto found = macro_index.find(name);
+    if (found == macro_index.end()) return nullptr;
+    return found->second;
+}
+
 void lcc::glint::Lexer::ExpandMacro(Macro& m) {
     bool error_reported = false;
     auto start_location = tok.location;
@@ -1113,7 +1130,8 @@ void lcc::glint::Lexer::HandleMacroDefinition() {
     auto name = *name_result;
 
     /// Check that the macro isn’t already defined.
-    if (rgs::find_if(macros, [&](auto&& m) { return m.name == name; }) != macros.end()) {
+    auto id = context->intern(name);
+    if (FindMacro(id)) {
         Error(
             ErrorId::Redefinition,
             "Macro '{}' is already defined",
@@ -1122,6 +1140,8 @@ void lcc::glint::Lexer::HandleMacroDefinition() {
     }
 
     auto& macro = macros.emplace_back(name);
+    // On redefinition, the first definition keeps winning, as it always has.
+    macro_index.try_emplace(id, &macro);
 
     /// Lex parameter token list.
     for (;;) {
@@ -1270,6 +1290,7 @@ auto lcc::glint::Lexer::MacroExpansion::operator++() -> Token {
     if (ret.kind == Tk::Gensym) {
         ret.kind = Tk::Ident;
         ret.text = gensyms[(usz) ret.integer_value];
+        ret.identifier = 0;
     }
 
     // Mark the token as non-artificial, because, for example, if we are
@@ -1286,6 +1307,10 @@ auto lcc::glint::GlintToken::operator==(const GlintToken& rhs) const -> bool {
     if (kind != rhs.kind) return false;
     switch (kind) {
         case TokenKind::Ident:
+            // Gensyms aren't interned.
+            if (identifier and rhs.identifier) return identifier == rhs.identifier;
+            return text == rhs.text;
+
         case TokenKind::String:
         case TokenKind::Gensym:
         case TokenKind::MacroArg:
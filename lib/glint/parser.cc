@@ -2786,7 +2786,7 @@ void lcc::glint::Parser::ParseTopLevel() {
                 auto l_past = GetPastLocation(*expr);
                 Note(l_past, "GetPastLocation(*expr)");
                 Note(l_past, "GetPastLocation(*expr).pos: {}", l_past.pos);
-                Note(l_past, "GetPastLocation(*expr).file_id size: {}", context->files().at(l_past.file_id)->size());
+                Note(l_past, "GetPastLocation(*expr).file_id size: {}", context->file(l_past.file_id)->size());
                 Note(l_past, "GetPastLocation(*expr).is_valid(): {}", l_past.is_valid());
                 Note(l_past, "GetPastLocation(*expr).seekable(): {}", l_past.seekable(context));
                 Note(GetRightmostLocation(*expr), "GetRightmostLocation(*expr)");
@@ -2799,7 +2799,7 @@ void lcc::glint::Parser::ParseTopLevel() {
                     l = GetPastLocation(*expr);
                 // Without a valid parsed expression, since we are at EOF, just point to
                 // the very end of the file (iff the file_id we have is valid).
-                else if (context and tok.location.file_id < context->files().size())
+                else if (context and tok.location.file_id < context->file_count())
                     l = GetLastLocation(*context, tok.location.file_id);
 
                 auto w = Warning(
@@ -2903,7 +2903,7 @@ auto lcc::glint::Parser::ParseFreestanding(
                     l = GetPastLocation(*expr);
                 // Without a valid parsed expression, since we are at EOF, just point to
                 // the very end of the file (iff the file_id we have is valid).
-                else if (context and parser.tok.location.file_id < context->files().size())
+                else if (context and parser.tok.location.file_id < context->file_count())
                     l = GetLastLocation(*context, parser.tok.location.file_id);
 
                 auto w = parser.Warning(
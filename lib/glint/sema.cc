@@ -11,6 +11,7 @@
 #include <lcc/core.hh>
 #include <lcc/string_distance.hh>
 #include <lcc/stringmap.hh>
+#include <lcc/target.hh>
 #include <lcc/utils/macros.hh>
 
 #include <lccbase/assert.hh>
@@ -23,9 +24,12 @@
 #include <filesystem>
 #include <functional>
 #include <iterator>
+#include <memory>
+#include <mutex>
 #include <ranges>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
@@ -591,6 +595,206 @@ void lcc::glint::Sema::DeclareImportedGlobalFunction(
     );
 }
 
+void lcc::glint::Sema::DeclareImportedGlobalVariable(
+    std::string name,
+    Type* type
+) {
+    LCC_ASSERT(type);
+
+    auto var = new (mod) VarDecl(
+        name,
+        type,
+        nullptr,
+        &mod,
+        Linkage::Imported,
+        {}
+    );
+    (void) mod.global_scope()->declare(context, std::move(name), var);
+
+    // Nothing else analyses declarations made up by sema, and references to
+    // an unanalysed variable are diagnosed as uses before its declaration.
+    Expr* decl = var;
+    LCC_ASSERT(Analyse(&decl), "Failed to analyse imported global variable {}", var->name());
+}
+
+auto lcc::glint::Sema::StandardOutputStream(Location location) -> Expr* {
+    // The UCRT has no `stdout` object; the macro expands to a call.
+    if (context->target()->is_platform_windows()) {
+        return new (mod) CallExpr(
+            new (mod) NameRefExpr(
+                "__acrt_iob_func",
+                mod.global_scope(),
+                location
+            ),
+            {new (mod) IntegerLiteral(1, location)},
+            location
+        );
+    }
+
+    return new (mod) NameRefExpr(
+        "stdout",
+        mod.global_scope(),
+        location
+    );
+}
+
+auto lcc::glint::Sema::IsArrayOf(Expr* container, Type* element_type) -> bool {
+    auto container_t = container->type()->strip_references();
+    return is<ArrayType, ArrayViewType, DynamicArrayType>(container_t)
+       and Type::Equal(container_t->elem(), element_type);
+}
+
+auto lcc::glint::Sema::ArrayDataAndCount(
+    Expr* container,
+    Type* element_type
+) -> std::pair<Expr*, Expr*> {
+    if (not IsArrayOf(container, element_type))
+        return {nullptr, nullptr};
+    auto container_t = container->type()->strip_references();
+
+    // container[0], with a count known at compile time.
+    if (auto fixarray_t = cast<ArrayType>(container_t)) {
+        auto dimension = fixarray_t->dimension();
+        // Don't do null terminator stuff
+        if (is<StringLiteral>(container))
+            dimension -= 1;
+
+        return {
+            new (mod) BinaryExpr(
+                TokenKind::Subscript,
+                container,
+                new (mod) IntegerLiteral(0, {}),
+                container->location()
+            ),
+            new (mod) IntegerLiteral(dimension, container->location())
+        };
+    }
+
+    // container.data, container.size
+    return {
+        new (mod) MemberAccessExpr(container, "data", container->location()),
+        new (mod) MemberAccessExpr(container, "size", container->location())
+    };
+}
+
+auto lcc::glint::Sema::BindToTemporary(Expr** expr_ptr) -> Expr* {
+    auto expr = *expr_ptr;
+
+    // Names (and members thereof) and literals may be evaluated any number
+    // of times without side effects.
+    auto object = expr;
+    while (auto member = cast<MemberAccessExpr>(object))
+        object = member->object();
+    if (is<NameRefExpr, StringLiteral, IntegerLiteral, ConstantExpr>(object))
+        return nullptr;
+
+    auto name = mod.unique_name("arraytmp_");
+    auto decl = _decl_scope->declare(
+        context,
+        std::string{name},
+        new (mod) VarDecl(
+            name,
+            expr->type()->strip_references(),
+            expr,
+            &mod,
+            Linkage::LocalVar,
+            expr->location()
+        )
+    );
+    LCC_ASSERT(decl, "Failed to declare temporary {}", name);
+
+    Expr* decl_expr = *decl;
+    LCC_ASSERT(Analyse(&decl_expr));
+
+    *expr_ptr = new (mod) NameRefExpr(name, _decl_scope, expr->location());
+    LCC_ASSERT(Analyse(expr_ptr));
+
+    return decl_expr;
+}
+
+void lcc::glint::Sema::ReserveDynamicArrayAppendRun(
+    Expr** expr_ptr,
+    std::span<Expr*> following
+) {
+    // Only appends to a plain name may be part of a run.
+    auto append_to_name = [](Expr* e) -> BinaryExpr* {
+        auto b = cast<BinaryExpr>(e);
+        if (b and b->op() == TokenKind::PlusEq and is<NameRefExpr>(b->lhs()))
+            return b;
+        return nullptr;
+    };
+
+    auto first = append_to_name(*expr_ptr);
+    if (
+        not first or _reserved_dynarray_appends.contains(first)
+        or following.empty() or not append_to_name(following.front())
+    ) return;
+
+    if (not Analyse(&first->lhs()) or not first->lhs()->type()->is_dynamic_array())
+        return;
+
+    auto first_name = cast<NameRefExpr>(first->lhs());
+    if (not first_name) return;
+    auto element_type = first->lhs()->type()->elem();
+
+    std::vector<BinaryExpr*> run{};
+    usz count{0};
+    auto add_to_run = [&](BinaryExpr* b) {
+        // Only operands that can't possibly modify the dynamic array while
+        // being evaluated (i.e. no calls) may be covered by the reservation.
+        // Check everything we can before analysing anything, since the run
+        // usually ends at the first statement that isn't part of it.
+        if (not is<IntegerLiteral, StringLiteral, ConstantExpr, NameRefExpr>(b->rhs()))
+            return false;
+        if (as<NameRefExpr>(b->lhs())->name() != first_name->name())
+            return false;
+
+        if (not Analyse(&b->lhs()))
+            return false;
+        auto name = cast<NameRefExpr>(b->lhs());
+        if (not name or name->target() != first_name->target())
+            return false;
+
+        if (
+            not Analyse(&b->rhs())
+            or not is<IntegerLiteral, StringLiteral, ConstantExpr, NameRefExpr>(b->rhs())
+        ) return false;
+        auto rhs_t = b->rhs()->type()->strip_references();
+        if (is<ArrayViewType, DynamicArrayType>(rhs_t))
+            return false;
+
+        // Same count as ArrayDataAndCount(), without building the expressions.
+        if (auto fixarray_t = cast<ArrayType>(rhs_t)) {
+            if (not IsArrayOf(b->rhs(), element_type)) return false;
+            auto dimension = fixarray_t->dimension();
+            if (is<StringLiteral>(b->rhs()))
+                dimension -= 1;
+            count += dimension;
+        } else count += 1;
+
+        run.emplace_back(b);
+        return true;
+    };
+
+    if (not add_to_run(first)) return;
+    for (auto e : following) {
+        auto b = append_to_name(e);
+        if (not b or not add_to_run(b)) break;
+    }
+    if (run.size() < 2) return;
+
+    for (auto b : run)
+        _reserved_dynarray_appends.emplace(b);
+
+    auto reserve = new (mod) CallExpr(
+        named_template("dynarray_reserve"),
+        {first->lhs(),
+         new (mod) IntegerLiteral(count, first->location())},
+        first->location()
+    );
+    *expr_ptr = new (mod) GroupExpr({reserve, first}, first->location());
+}
+
 auto lcc::glint::Sema::apply_template(
     std::string template_source,
     std::vector<Expr*> template_arguments
@@ -637,6 +841,243 @@ auto lcc::glint::Sema::apply_template(
     return new (mod) CallExpr(template_, template_arguments, {});
 };
 
+namespace lcc::glint::detail {
+// Templates that sema will use to expand and/or rewrite things (that way
+// we don't have to create large, branching AST structures in code).
+// TODO: Once we use C++26, just use #embed
+// TODO: It'd be really convenient to have a way to tell the Glint parser
+// to "obfuscate" all identifiers encountered in a source file (such that
+// you can write a standard library without having to riddle everything
+// with double underscores).
+// NOTE: Template parameters must be `expr` or `type`, as the parsed
+// templates are shared by every module (see parsed_sema_templates()), and
+// any other parameter type would be a type node owned by another module.
+constexpr std::string_view sema_templates_source =
+    "__zero :: template(x : expr) {\n"
+    "  memset &x, 0, (typeof x).bytes;\n"
+    "  x;\n"
+    "};\n"
+    "\n"
+    ";; Initialise a dynamic array with a given capacity.\n"
+    "__dynarray_init :: template(dynarray : expr, capacity : expr) {\n"
+    "  dynarray.capacity := capacity;\n"
+    "  dynarray.size := 0;\n"
+    "  dynarray.data := (typeof dynarray.data)\n"
+    "    (malloc (capacity ((sizeof @dynarray.data) / 8)));\n"
+    "};\n"
+    "\n"
+    "__dynarray_initvalue :: template(capacity : expr, element_type : type) {\n"
+    "  [element_type] !{\n"
+    "    .data element_type.ptr (malloc (capacity ((sizeof element_type) / 8))),\n"
+    "    .size 0,\n"
+    "    .capacity capacity\n"
+    "  };\n"
+    "};\n"
+    "\n"
+    ";; Ensure the given dynamic array is able to store `COUNT` elements\n"
+    ";; *in addition to* it's current elements.\n"
+    ";; Capacity is (at least) doubled whenever it must grow, such that a\n"
+    ";; sequence of appends is amortised constant time, and `realloc` is used\n"
+    ";; so that the allocator may extend the allocation in place.\n"
+    ";; Like every template below, each `expr` argument other than the dynamic\n"
+    ";; array itself is evaluated exactly once.\n"
+    "__dynarray_reserve :: template(dynarray : expr, count : expr) {\n"
+    "  __reserve_count :: (typeof dynarray.size) count;\n"
+    "  if __reserve_count > dynarray.capacity - dynarray.size, {\n"
+    "    __newcap :: dynarray.capacity * 2;\n"
+    "    if __newcap < dynarray.size + __reserve_count,\n"
+    "      __newcap := dynarray.size + __reserve_count;\n"
+    "    dynarray.data := (typeof dynarray.data)\n"
+    "      (realloc dynarray.data, (__newcap * ((sizeof @dynarray.data) / 8)));\n"
+    "    dynarray.capacity := __newcap;\n"
+    "  };\n"
+    "};\n"
+    "\n"
+    ";; Append a single element to the end of the given dynamic array.\n"
+    "__dynarray_append :: template(dynarray : expr, value : expr) {\n"
+    "  __dynarray_reserve dynarray, 1;\n"
+    "  @dynarray.data[dynarray.size] := value;\n"
+    "  dynarray.size += 1;\n"
+    "};\n"
+    ";; Like `__dynarray_append`, but the caller has already reserved space.\n"
+    "__dynarray_append_reserved :: template(dynarray : expr, value : expr) {\n"
+    "  @dynarray.data[dynarray.size] := value;\n"
+    "  dynarray.size += 1;\n"
+    "};\n"
+    "\n"
+    ";; Append `COUNT` elements starting at pointer `SOURCE` to the end of the\n"
+    ";; given dynamic array, with a single capacity check and copy.\n"
+    ";; `SOURCE` may point into the dynamic array itself (i.e. a view of it),\n"
+    ";; so when it must grow, the elements are copied into new storage before\n"
+    ";; the old storage is freed, rather than using `realloc`.\n"
+    "__dynarray_append_n :: template(dynarray : expr, source : expr, count : expr) {\n"
+    "  __append_count :: (typeof dynarray.size) count;\n"
+    "  if __append_count > dynarray.capacity - dynarray.size, {\n"
+    "    __newcap :: dynarray.capacity * 2;\n"
+    "    if __newcap < dynarray.size + __append_count,\n"
+    "      __newcap := dynarray.size + __append_count;\n"
+    "    __newdata :: (typeof dynarray.data)\n"
+    "      (malloc (__newcap * ((sizeof @dynarray.data) / 8)));\n"
+    "    memcpy __newdata[0], dynarray.data[0], (dynarray.size * ((sizeof @dynarray.data) / 8));\n"
+    "    memcpy __newdata[dynarray.size], source, (__append_count * ((sizeof @dynarray.data) / 8));\n"
+    "    free dynarray.data;\n"
+    "    dynarray.data := __newdata;\n"
+    "    dynarray.capacity := __newcap;\n"
+    "  } else memcpy dynarray.data[dynarray.size], source, (__append_count * ((sizeof @dynarray.data) / 8));\n"
+    "  dynarray.size += __append_count;\n"
+    "};\n"
+    ";; Like `__dynarray_append_n`, but the caller has already reserved space.\n"
+    "__dynarray_append_n_reserved :: template(dynarray : expr, source : expr, count : expr) {\n"
+    "  __reserved_count :: (typeof dynarray.size) count;\n"
+    "  memcpy dynarray.data[dynarray.size], source, (__reserved_count * ((sizeof @dynarray.data) / 8));\n"
+    "  dynarray.size += __reserved_count;\n"
+    "};\n"
+    "\n"
+    "__dynarray_insert :: template(dynarray : expr, index : expr, value : expr) {\n"
+    "  __index :: index;\n"
+    "  if __index < 0 or __index > dynarray.size, {\n"
+    "    print \"Glint Runtime Error: oob dynarray insertion\\n\";\n"
+    "    exit 1;\n"
+    "  };\n"
+    "\n"
+    "  ;; If we need to grow, do that\n"
+    "  __dynarray_reserve dynarray, 1;\n"
+    "  ;; Copy size - index elements forward one element starting at given index\n"
+    "  memmove dynarray.data[__index + 1], dynarray.data[__index],\n"
+    "    ((dynarray.size - __index) * ((sizeof @dynarray.data) / 8));\n"
+    "  ;; Insert given element at index, now that everything is moved out of the\n"
+    "  ;; way.\n"
+    "  @dynarray.data[__index] := value;\n"
+    "  dynarray.size += 1;\n"
+    "};\n"
+    ";; Insert `COUNT` elements starting at pointer `SOURCE` at the given index,\n"
+    ";; moving the tail of the dynamic array only once.\n"
+    ";; Like `__dynarray_append_n`, `SOURCE` may point into the dynamic array\n"
+    ";; itself, so growing copies into new storage before freeing the old one;\n"
+    ";; otherwise, moving the tail leaves the elements before the old size in\n"
+    ";; place, and the final copy may overlap them.\n"
+    "__dynarray_insert_n :: template(dynarray : expr, index : expr, source : expr, count : expr) {\n"
+    "  __index :: index;\n"
+    "  __insert_count :: (typeof dynarray.size) count;\n"
+    "  if __index < 0 or __index > dynarray.size, {\n"
+    "    print \"Glint Runtime Error: oob dynarray insertion\\n\";\n"
+    "    exit 1;\n"
+    "  };\n"
+    "\n"
+    "  if __insert_count > dynarray.capacity - dynarray.size, {\n"
+    "    __newcap :: dynarray.capacity * 2;\n"
+    "    if __newcap < dynarray.size + __insert_count,\n"
+    "      __newcap := dynarray.size + __insert_count;\n"
+    "    __newdata :: (typeof dynarray.data)\n"
+    "      (malloc (__newcap * ((sizeof @dynarray.data) / 8)));\n"
+    "    memcpy __newdata[0], dynarray.data[0], (__index * ((sizeof @dynarray.data) / 8));\n"
+    "    memcpy __newdata[__index], source, (__insert_count * ((sizeof @dynarray.data) / 8));\n"
+    "    memcpy __newdata[__index + __insert_count], dynarray.data[__index],\n"
+    "      ((dynarray.size - __index) * ((sizeof @dynarray.data) / 8));\n"
+    "    free dynarray.data;\n"
+    "    dynarray.data := __newdata;\n"
+    "    dynarray.capacity := __newcap;\n"
+    "  } else {\n"
+    "    memmove dynarray.data[__index + __insert_count], dynarray.data[__index],\n"
+    "      ((dynarray.size - __index) * ((sizeof @dynarray.data) / 8));\n"
+    "    memmove dynarray.data[__index], source, (__insert_count * ((sizeof @dynarray.data) / 8));\n"
+    "  };\n"
+    "  dynarray.size += __insert_count;\n"
+    "};\n"
+    "\n"
+    ";; Write the first `SIZE` bytes of a fixed array to `STREAM` in a single\n"
+    ";; call.\n"
+    "__fwrite_each :: template(container : expr, size : expr, stream : expr)\n"
+    "  fwrite container[0], 1, size, stream;\n"
+    ";; Write every byte of a dynamic array or view to `STREAM` in a single\n"
+    ";; call.\n"
+    "__print__fwrite_each :: template(container : expr, stream : expr)\n"
+    "  fwrite container.data, 1, container.size, stream;\n";
+
+struct ParsedSemaTemplates {
+    Module mod{nullptr, "__sema_templates", Module::IsAModule};
+    std::vector<VarDecl*> templates{};
+
+    /// The id of "sema_templates.g" within each context that has used
+    /// the templates, by context serial number. Locations within the
+    /// parsed templates refer to it in the context that parsed them.
+    std::unordered_map<u64, u16> file_ids{};
+    u16 parsed_file_id{};
+    std::mutex file_ids_mutex;
+
+    /// Get the id of "sema_templates.g" within the given context,
+    /// registering the source with it the first time.
+    auto file_id(Context* context) -> u16 {
+        std::scoped_lock lock{file_ids_mutex};
+        auto [it, inserted] = file_ids.try_emplace(context->serial_number());
+        if (inserted) it->second = u16(create_file(context).file_id());
+        return it->second;
+    }
+
+    static auto create_file(Context* context) -> File& {
+        return context->create_file(
+            "sema_templates.g",
+            std::vector<char>{sema_templates_source.begin(), sema_templates_source.end()}
+        );
+    }
+};
+
+// Parse the sema templates exactly once per process; every module being
+// analysed clones the (small) parsed templates instead of lexing and
+// parsing the source again.
+auto parsed_sema_templates(Context* context) -> ParsedSemaTemplates& {
+    static const std::unique_ptr<ParsedSemaTemplates> parsed = [&] {
+        auto out = std::make_unique<ParsedSemaTemplates>();
+
+        auto& f = ParsedSemaTemplates::create_file(context);
+        out->parsed_file_id = u16(f.file_id());
+        out->file_ids.emplace(context->serial_number(), out->parsed_file_id);
+
+        // A module only gets a global scope when it is parsed as a whole,
+        // so give the templates one to be declared in.
+        auto* global = new (out->mod) Scope(nullptr);
+        auto templates_m = glint::Parser::ParseFreestanding(
+            out->mod,
+            context,
+            f,
+            global
+        );
+        if (not templates_m) {
+            if (templates_m.is_diag())
+                templates_m.diag().print();
+            Diag::ICE("GlintSema failed to parse semantic templates");
+        }
+
+        for (auto c : *templates_m) {
+            LCC_ASSERT(
+                is<VarDecl>(c),
+                "Malformed sema_templates.g: expected named template as top level expression"
+            );
+            auto v = as<VarDecl>(c);
+            LCC_ASSERT(is<TemplateExpr>(v->init()), "Malformed sema_templates.g: expected named template...");
+            out->templates.emplace_back(v);
+        }
+
+        return out;
+    }();
+    return *parsed;
+}
+
+// Point locations within a clone of the parsed sema templates, i.e. the
+// nodes and types the module gained since it had the given counts, at the
+// copy of "sema_templates.g" owned by the context it is cloned into.
+void relocate(Module& mod, usz first_node, usz first_type, u16 from_file_id, u16 to_file_id) {
+    auto relocate_one = [&](auto node) {
+        auto l = node->location();
+        if (l.file_id != from_file_id) return;
+        l.file_id = to_file_id;
+        node->location(l);
+    };
+    for (auto node : mod.nodes | vws::drop(first_node)) relocate_one(node);
+    for (auto type : mod.types | vws::drop(first_type)) relocate_one(type);
+}
+} // namespace lcc::glint::detail
+
 void lcc::glint::Sema::AnalyseModule() {
     // Load imported modules.
     // Don't load imported modules twice.
@@ -723,107 +1164,23 @@ void lcc::glint::Sema::AnalyseModule() {
         }
     }
 
-    // Parse templates that sema will use to expand and/or rewrite things
-    // (that way we don't have to create large, branching AST structures in
-    // code).
+    // Instantiate the templates that sema will use to expand and/or rewrite
+    // things into this module.
     {
-        // TODO: Once we use C++26, just use #embed
-        // TODO: It'd be really convenient to have a way to tell the Glint parser
-        // to "obfuscate" all identifiers encountered in a source file (such that
-        // you can write a standard library without having to riddle everything
-        // with double underscores).
-        std::string_view templates_source =
-            "__zero :: template(x : expr) {\n"
-            "  memset &x, 0, (typeof x).bytes;\n"
-            "  x;\n"
-            "};\n"
-            "\n"
-            ";; Initialise a dynamic array with a given capacity.\n"
-            "__dynarray_init :: template(dynarray : expr, capacity : expr) {\n"
-            "  dynarray.capacity := capacity;\n"
-            "  dynarray.size := 0;\n"
-            "  dynarray.data := (typeof dynarray.data)\n"
-            "    (malloc (capacity ((sizeof @dynarray.data) / 8)));\n"
-            "};\n"
-            "\n"
-            "__dynarray_initvalue :: template(capacity : expr, element_type : type) {\n"
-            "  [element_type] !{\n"
-            "    .data element_type.ptr (malloc (capacity ((sizeof element_type) / 8))),\n"
-            "    .size 0,\n"
-            "    .capacity capacity\n"
-            "  };\n"
-            "};\n"
-            "\n"
-            ";; Grow the given dynamic array, multiplying it's capacity by `FACTOR`.\n"
-            "__dynarray_grow :: template(dynarray : expr, factor : u32) {\n"
-            "  newmem :: malloc (factor dynarray.capacity);\n"
-            "  memcpy newmem, dynarray.data, dynarray.size;\n"
-            "  free dynarray.data;\n"
-            "  dynarray.data := (typeof dynarray.data) newmem;\n"
-            "  dynarray.capacity *= factor;\n"
-            "};\n"
-            "\n"
-            ";; Grow the given dynamic array iff it is not able to store `COUNT`\n"
-            ";; elements *in addition to* it's current elements.\n"
-            ";; The `COUNT` is a count of how many elements are being added to the\n"
-            ";; dynamic array, and this operation ensures there is space.\n"
-            "__dynarray_grow_if :: template(dynarray : expr, count : uint) {\n"
-            "  if count > dynarray.capacity - dynarray.size,\n"
-            "    __dynarray_grow dynarray, 2;\n"
-            "};\n"
-            "__dynarray_insert :: template(dynarray : expr, index : expr, value : expr) {\n"
-            "  if index < 0 or index > dynarray.size, {\n"
-            "    print \"Glint Runtime Error: oob dynarray insertion\\n\";\n"
-            "    exit 1;\n"
-            "  };\n"
-            "\n"
-            "  ;; If we need to grow, do that\n"
-            "  __dynarray_grow_if dynarray, 1;\n"
-            "  ;; Copy size - index elements forward one element starting at given index\n"
-            "  memmove dynarray.data[index + 1], dynarray.data[index], dynarray.size - index;\n"
-            "  ;; Insert given element at index, now that everything is moved out of the\n"
-            "  ;; way.\n"
-            "  @dynarray.data[index] := value;\n"
-            "  dynarray.size += 1;\n"
-            "};\n"
-            "\n"
-            "__putchar_each :: template(container : expr, size : uint)\n"
-            "  cfor\n"
-            "      __i_ii :: 0;\n"
-            "      __i_ii < size;\n"
-            "      __i_ii += 1;\n"
-            "    putchar @container[__i_ii];\n"
-            "__print__putchar_each :: template(container : expr)\n"
-            "  cfor\n"
-            "      __i_ii :: 0;\n"
-            "      __i_ii < container.size;\n"
-            "      __i_ii += 1;\n"
-            "    putchar @container[__i_ii];\n";
-
-        auto& f = context->create_file(
-            "sema_templates.g",
-            std::vector<char>{templates_source.begin(), templates_source.end()}
-        );
-
-        auto templates_m = glint::Parser::ParseFreestanding(
-            mod,
-            context,
-            f,
-            mod.global_scope()
-        );
-        if (not templates_m) {
-            if (templates_m.is_diag())
-                templates_m.diag().print();
-            Diag::ICE("GlintSema failed to parse semantic templates");
-        }
-
-        for (auto c : *templates_m) {
-            LCC_ASSERT(
-                is<VarDecl>(c),
-                "Malformed sema_templates.g: expected named template as top level expression"
-            );
-            auto v = as<VarDecl>(c);
-            LCC_ASSERT(is<TemplateExpr>(v->init()), "Malformed sema_templates.g: expected named template...");
+        auto& parsed = detail::parsed_sema_templates(context);
+        auto file_id = parsed.file_id(context);
+        for (auto t : parsed.templates) {
+            auto first_node = mod.nodes.size();
+            auto first_type = mod.types.size();
+            auto v = as<VarDecl>(Expr::CloneInto(
+                mod,
+                context,
+                t,
+                parsed.mod.global_scope(),
+                mod.global_scope()
+            ));
+            if (file_id != parsed.parsed_file_id)
+                detail::relocate(mod, first_node, first_type, parsed.parsed_file_id, file_id);
 
             LCC_ASSERT(
                 Analyse(&v->init()),
@@ -850,12 +1207,33 @@ void lcc::glint::Sema::AnalyseModule() {
         Type::Void,
         {{"c", FFIType::CInt(mod), {}}}
     );
+    DeclareImportedGlobalFunction(
+        "fwrite",
+        Type::Void,
+        {{"ptr", Type::VoidPtr, {}},
+         {"size", FFIType::CULongLong(mod), {}},
+         {"count", FFIType::CULongLong(mod), {}},
+         {"stream", Type::VoidPtr, {}}}
+    );
+    if (context->target()->is_platform_windows()) {
+        DeclareImportedGlobalFunction(
+            "__acrt_iob_func",
+            Type::VoidPtr,
+            {{"index", FFIType::CUInt(mod), {}}}
+        );
+    } else DeclareImportedGlobalVariable("stdout", Type::VoidPtr);
 
     // Dynamic array operations require these...
     DeclareImportedGlobalFunction(
         "malloc",
         Type::VoidPtr,
-        {{"size", FFIType::CInt(mod), {}}}
+        {{"size", FFIType::CULongLong(mod), {}}}
+    );
+    DeclareImportedGlobalFunction(
+        "realloc",
+        Type::VoidPtr,
+        {{"ptr", Type::VoidPtr, {}},
+         {"size", FFIType::CULongLong(mod), {}}}
     );
     DeclareImportedGlobalFunction(
         "free",
@@ -874,7 +1252,7 @@ void lcc::glint::Sema::AnalyseModule() {
         Type::Void,
         {{"dest", Type::VoidPtr, {}},
          {"src", Type::VoidPtr, {}},
-         {"size", FFIType::CInt(mod), {}}}
+         {"size", FFIType::CULongLong(mod), {}}}
     );
     DeclareImportedGlobalFunction(
         "memset",
@@ -888,7 +1266,7 @@ void lcc::glint::Sema::AnalyseModule() {
         Type::Void,
         {{"dest", Type::VoidPtr, {}},
          {"src", Type::VoidPtr, {}},
-         {"size", FFIType::CInt(mod), {}}}
+         {"size", FFIType::CULongLong(mod), {}}}
     );
 
     {
@@ -2233,6 +2611,12 @@ auto lcc::glint::Sema::Analyse(Expr** expr_ptr, Type* expected_type) -> bool {
 
             for (auto*& child : block->children()) {
                 const bool last = &child == block->last_expr();
+                if (not last) {
+                    ReserveDynamicArrayAppendRun(
+                        &child,
+                        {&child + 1, block->children().data() + block->children().size()}
+                    );
+                }
                 if (not Analyse(&child, last ? expected_type : nullptr)) {
                     block->set_sema_errored();
                     // NOTE: If, for some ungodly reason, we want to continue semantic
@@ -3308,10 +3692,30 @@ void lcc::glint::Sema::AnalyseBinary(Expr** expr_ptr, BinaryExpr* b) {
                 // Relevant dynamic array type
                 auto dyn_t = as<DynamicArrayType>(subscript->lhs()->type());
 
-                // TODO: Check that RHS is an array type (fixed, dynamic, or a view).
-                // If it is, check that it's element type is convertible to our element
-                // type.
-                // If it is, insert entire array.
+                // If RHS is an array (fixed, dynamic, or a view) of our element type,
+                // insert the entire array at once.
+                // TODO: Array of element type that is convertible to our element type.
+                if (not Analyse(&b->rhs())) {
+                    b->set_sema_errored();
+                    return;
+                }
+                if (IsArrayOf(b->rhs(), dyn_t->elem())) {
+                    auto temporary = BindToTemporary(&b->rhs());
+                    auto [data, count] = ArrayDataAndCount(b->rhs(), dyn_t->elem());
+                    *expr_ptr = new (mod) CallExpr(
+                        named_template("dynarray_insert_n"),
+                        {dynarray_expr,
+                         index_expr,
+                         data,
+                         count},
+                        b->location()
+                    );
+                    if (temporary)
+                        *expr_ptr = new (mod) GroupExpr({temporary, *expr_ptr}, b->location());
+                    LCC_ASSERT(Analyse(expr_ptr));
+
+                    return;
+                }
 
                 // Ensure rhs is convertible to dynamic array element type
                 if (not Convert(&b->rhs(), dyn_t->elem())) {
@@ -3357,18 +3761,27 @@ void lcc::glint::Sema::AnalyseBinary(Expr** expr_ptr, BinaryExpr* b) {
             // NOTE: Dynamic array insert handled above
             // Handle dynamic array append.
             if (lhs_t->is_dynamic_array()) {
+                // Whether a preceding, fused capacity check already covers this append.
+                // \see ReserveDynamicArrayAppendRun()
+                auto reserved = _reserved_dynarray_appends.contains(b);
+
                 // RHS is array with convertible element type
                 // TODO: What if LHS element type *is* an array type?
                 if (
                     is<ArrayType, ArrayViewType, DynamicArrayType>(rhs_t->strip_references())
                 ) {
-                    if (auto fixarray_t = cast<ArrayType>(rhs_t->strip_references())) {
-                        auto dimension = fixarray_t->dimension();
-                        // Don't do null terminator stuff
-                        if (is<StringLiteral>(b->rhs()))
-                            dimension -= 1;
-
-                        if (not dimension) {
+                    // If element types differ, load one element from rhs at a time, and store
+                    // it into lhs as a converted value.
+                    if (not IsArrayOf(b->rhs(), lhs_t->elem()))
+                        LCC_TODO("Append to {} from array type {}", *lhs_t, *rhs_t);
+
+                    // The data and count expressions both refer to the rhs; make sure
+                    // it is only evaluated once.
+                    auto temporary = BindToTemporary(&b->rhs());
+                    auto [data, count] = ArrayDataAndCount(b->rhs(), lhs_t->elem());
+
+                    if (auto count_literal = cast<IntegerLiteral>(count)) {
+                        if (not count_literal->value().value()) {
                             Error(
                                 b->rhs()->location(),
                                 "Cannot append fixed array of zero elements to dynamic array"
@@ -3376,77 +3789,22 @@ void lcc::glint::Sema::AnalyseBinary(Expr** expr_ptr, BinaryExpr* b) {
                             b->set_sema_errored();
                             break;
                         }
-
-                        // If element types are EQUAL, increase lhs size and then do a memcpy.
-                        if (Type::Equal(lhs_t->elem(), fixarray_t->element_type())) {
-                            // TODO: Once we can get the length of a fixed array and a dynamic array
-                            // with the same syntax, we could write this as a sema template.
-
-                            // Ensure lhs.size + rhs.size < lhs.capacity. Otherwise, grow.
-                            auto grow_if = new (mod) CallExpr(
-                                named_template("dynarray_grow_if"),
-                                {b->lhs(),
-                                 new (mod) IntegerLiteral(
-                                     dimension,
-                                     b->rhs()->location()
-                                 )},
-                                b->location()
-                            );
-
-                            // memcpy lhs.data[lhs.size], rhs.data[0], rhs.size;
-                            auto memcpy_dst = new (mod) BinaryExpr(
-                                TokenKind::Subscript,
-                                new (mod) MemberAccessExpr(b->lhs(), "data", b->lhs()->location()),
-                                new (mod) MemberAccessExpr(b->lhs(), "size", b->lhs()->location()),
-                                b->lhs()->location()
-                            );
-                            auto memcpy_src = new (mod) BinaryExpr(
-                                TokenKind::Subscript,
-                                b->rhs(),
-                                new (mod) IntegerLiteral(0, {}),
-                                b->rhs()->location()
-                            );
-                            auto memcpy_len = new (mod) IntegerLiteral(
-                                dimension,
-                                b->rhs()->location()
-                            );
-                            auto memcpy_call
-                                = new (mod) CallExpr(
-                                    new (mod) NameRefExpr(
-                                        "memcpy",
-                                        mod.global_scope(),
-                                        b->location()
-                                    ),
-                                    {memcpy_dst, memcpy_src, memcpy_len},
-                                    b->location()
-                                );
-
-                            // lhs.size += rhs.size;
-                            auto size_update = new (mod) BinaryExpr(
-                                TokenKind::PlusEq,
-                                new (mod) MemberAccessExpr(b->lhs(), "size", b->lhs()->location()),
-                                memcpy_len,
-                                b->location()
-                            );
-
-                            auto append_operation = new (mod) GroupExpr(
-                                {grow_if, memcpy_call, size_update},
-                                b->location()
-                            );
-
-                            *expr_ptr = append_operation;
-                            LCC_ASSERT(
-                                Analyse(expr_ptr),
-                                "Dynamic array append from fixed array failed sema (oops)"
-                            );
-                            break;
-                        }
-
-                        // If element types differ, load one element from rhs at a time, and store
-                        // it into lhs as a converted value.
                     }
 
-                    LCC_TODO("Append to {} from array type {}", *lhs_t, *rhs_t);
+                    // Ensure lhs.size + count <= lhs.capacity (growing if not), then
+                    // memcpy lhs.data[lhs.size], data, count * element size;
+                    *expr_ptr = new (mod) CallExpr(
+                        named_template(reserved ? "dynarray_append_n_reserved" : "dynarray_append_n"),
+                        {b->lhs(), data, count},
+                        b->location()
+                    );
+                    if (temporary)
+                        *expr_ptr = new (mod) GroupExpr({temporary, *expr_ptr}, b->location());
+                    LCC_ASSERT(
+                        Analyse(expr_ptr),
+                        "Dynamic array append from array failed sema (oops)"
+                    );
+                    break;
                 }
 
                 // RHS is a single element.
@@ -3458,9 +3816,8 @@ void lcc::glint::Sema::AnalyseBinary(Expr** expr_ptr, BinaryExpr* b) {
                 }
 
                 *expr_ptr = new (mod) CallExpr(
-                    named_template("dynarray_insert"),
+                    named_template(reserved ? "dynarray_append_reserved" : "dynarray_append"),
                     {b->lhs(),
-                     new (mod) MemberAccessExpr(b->lhs(), "size", b->location()),
                      b->rhs()},
                     b->location()
                 );
@@ -3515,6 +3872,25 @@ void lcc::glint::Sema::AnalyseBinary(Expr** expr_ptr, BinaryExpr* b) {
                 break;
             }
 
+            // Prepend an entire array at once, moving the existing elements only
+            // once.
+            if (IsArrayOf(b->rhs(), lhs_t->elem())) {
+                auto temporary = BindToTemporary(&b->rhs());
+                auto [data, count] = ArrayDataAndCount(b->rhs(), lhs_t->elem());
+                *expr_ptr = new (mod) CallExpr(
+                    named_template("dynarray_insert_n"),
+                    {b->lhs(),
+                     new (mod) IntegerLiteral(0, {}),
+                     data,
+                     count},
+                    b->location()
+                );
+                if (temporary)
+                    *expr_ptr = new (mod) GroupExpr({temporary, *expr_ptr}, b->location());
+                LCC_ASSERT(Analyse(expr_ptr));
+                break;
+            }
+
             // Ensure rhs is convertible to lhs element type
             if (not Convert(&b->rhs(), lhs_t->elem())) {
                 Error(b->location(), "Cannot prepend to {} with value of type {}", lhs_t, rhs_t);
@@ -4527,10 +4903,86 @@ void lcc::glint::Sema::AnalyseCall(Expr** expr_ptr, CallExpr* expr) {
             return;
         }
 
+        // __builtin_reserve dynarray, count
+        // Ensure `dynarray` is able to store `count` more elements without
+        // growing.
+        if (n == "__builtin_reserve") {
+            if (expr->args().size() != 2) {
+                Error(
+                    expr->location(),
+                    "{} expects a dynamic array and an element count, but was given {} arguments",
+                    n,
+                    expr->args().size()
+                );
+                expr->set_sema_errored();
+                return;
+            }
+            for (auto& arg : expr->args()) {
+                if (not Analyse(&arg)) {
+                    expr->set_sema_errored();
+                    return;
+                }
+            }
+            if (not expr->args().at(0)->type()->is_dynamic_array()) {
+                Error(
+                    expr->args().at(0)->location(),
+                    "{} expects a dynamic array, but was given {}",
+                    n,
+                    expr->args().at(0)->type()
+                );
+                expr->set_sema_errored();
+                return;
+            }
+            if (not Convert(&expr->args().at(1), Type::UInt)) {
+                Error(
+                    expr->args().at(1)->location(),
+                    "{} expects an element count convertible to {}, but was given {}",
+                    n,
+                    Type::UInt,
+                    expr->args().at(1)->type()
+                );
+                expr->set_sema_errored();
+                return;
+            }
+
+            *expr_ptr = new (mod) CallExpr(
+                named_template("dynarray_reserve"),
+                {expr->args().at(0),
+                 expr->args().at(1)},
+                expr->location()
+            );
+            (void) Analyse(expr_ptr);
+            return;
+        }
+
         if (n == "__glintprint") {
             // This is the group of expressions we will be replacing the print call
             // expression with.
             std::vector<Expr*> exprs{};
+
+            // Bytes of adjacent arguments whose value is known at compile time
+            // (string, byte, and type literals, constant enumerators) are
+            // accumulated here and written out with a single `fwrite`, rather than
+            // one call per argument (or per byte).
+            std::string constant_bytes{};
+            auto flush_constant_bytes = [&] {
+                if (constant_bytes.empty()) return;
+                auto str_literal = new (mod) StringLiteral(
+                    mod,
+                    constant_bytes,
+                    expr->location()
+                );
+                auto print_call = new (mod) CallExpr(
+                    named_template("fwrite_each"),
+                    {str_literal,
+                     new (mod) IntegerLiteral(constant_bytes.size(), {}),
+                     StandardOutputStream(expr->location())},
+                    expr->location()
+                );
+                exprs.emplace_back(print_call);
+                constant_bytes.clear();
+            };
+
             for (auto& arg : expr->args()) {
                 if (not Analyse(&arg)) {
                     expr->set_sema_errored();
@@ -4548,9 +5000,32 @@ void lcc::glint::Sema::AnalyseCall(Expr** expr_ptr, CallExpr* expr) {
                     continue;
                 }
 
+                // Fuse string literals into the pending constant bytes.
+                // print "foo" -> fwrite "foo"[0], 1, 3, stdout
+                if (auto str_literal = cast<StringLiteral>(arg)) {
+                    constant_bytes += str_literal->origin_module()->strings.at(
+                        str_literal->string_index()
+                    );
+                    continue;
+                }
+
                 // print x:byte -> putchar x
                 bool arg_is_byte = arg->type()->is_byte();
                 if (arg_is_byte) {
+                    // Fuse byte literals into the pending constant bytes.
+                    if (auto byte_literal = cast<IntegerLiteral>(arg)) {
+                        constant_bytes += char(byte_literal->value().value());
+                        continue;
+                    }
+                    if (
+                        auto byte_constant = cast<ConstantExpr>(arg);
+                        byte_constant and byte_constant->value().is_int()
+                    ) {
+                        constant_bytes += char(byte_constant->value().as_int().value());
+                        continue;
+                    }
+
+                    flush_constant_bytes();
                     auto print_call = new (mod) CallExpr(
                         new (mod) NameRefExpr(
                             "putchar",
@@ -4564,6 +5039,41 @@ void lcc::glint::Sema::AnalyseCall(Expr** expr_ptr, CallExpr* expr) {
                     continue;
                 }
 
+                // Handle type (print representation of type).
+                bool arg_is_type
+                    = is<TypeExpr>(arg);
+                if (arg_is_type) {
+                    auto relevant_type = as<TypeExpr>(arg)->contained_type();
+                    constant_bytes += relevant_type->string(false);
+                    continue;
+                }
+
+                // If the value of an enum is known at compile time, just print the name
+                // of the enumerator that we know it is.
+                bool arg_is_enum
+                    = is<EnumType>(arg->type()->strip_references());
+                if (arg_is_enum) {
+                    if (
+                        auto enum_expression = cast<ConstantExpr>(arg);
+                        enum_expression
+                    ) {
+                        auto enum_type = as<EnumType>(arg->type()->strip_references());
+                        LCC_ASSERT(enum_type->enumerators().size());
+
+                        auto enum_value = enum_expression->value().as_int();
+
+                        auto e_decl = enum_type->enumerator_by_value(enum_value);
+                        LCC_ASSERT(e_decl and e_decl->name().size());
+
+                        constant_bytes += e_decl->name();
+                        continue;
+                    }
+                }
+
+                // Everything past this point does work at runtime, so anything known
+                // at compile time must be written first to preserve ordering.
+                flush_constant_bytes();
+
                 // Just call puts on byte pointers
                 // print x:byte.ptr -> puts x
                 bool arg_is_pointer_to_byte = arg->type()->is_pointer()
@@ -4583,34 +5093,32 @@ void lcc::glint::Sema::AnalyseCall(Expr** expr_ptr, CallExpr* expr) {
                 }
 
                 // Don't format dynamic byte arrays...
-                // print x:[byte] -> puts x.data
+                // print x:[byte] -> fwrite x.data, 1, x.size, stdout
                 bool arg_is_dynamic_array_of_byte
                     = arg->type()->strip_references()->is_dynamic_array()
                   and Type::Equal(arg->type()->strip_references()->elem(), Type::Byte);
                 if (arg_is_dynamic_array_of_byte) {
                     auto print_call = new (mod) CallExpr(
-                        named_template("print__putchar_each"),
-                        {arg},
+                        named_template("print__fwrite_each"),
+                        {arg, StandardOutputStream(expr->location())},
                         {}
                     );
                     exprs.emplace_back(print_call);
                     continue;
                 }
 
-                // Don't format fixed byte arrays (like string literals)
-                // print x:[byte 4] -> puts x[0]
+                // Don't format fixed byte arrays
+                // print x:[byte 4] -> fwrite x[0], 1, 4, stdout
                 bool arg_is_fixed_array_of_byte
                     = arg->type()->strip_references()->is_array()
                   and Type::Equal(arg->type()->strip_references()->elem(), Type::Byte);
                 if (arg_is_fixed_array_of_byte) {
                     auto size = as<ArrayType>(arg->type()->strip_references())->dimension();
-                    // Don't print (implicit) trailing NULL byte for string literals...
-                    if (is<StringLiteral>(arg))
-                        size -= 1;
                     auto print_call = new (mod) CallExpr(
-                        named_template("putchar_each"),
+                        named_template("fwrite_each"),
                         {arg,
-                         new (mod) IntegerLiteral(size, {})},
+                         new (mod) IntegerLiteral(size, {}),
+                         StandardOutputStream(expr->location())},
                         expr->location()
                     );
                     exprs.emplace_back(print_call);
@@ -4618,76 +5126,25 @@ void lcc::glint::Sema::AnalyseCall(Expr** expr_ptr, CallExpr* expr) {
                 }
 
                 // Handle array view of byte.
-                // print x:[byte view] -> puts x.data
+                // print x:[byte view] -> fwrite x.data, 1, x.size, stdout
                 bool arg_is_view_of_byte
                     = arg->type()->strip_references()->is_view()
                   and Type::Equal(arg->type()->strip_references()->elem(), Type::Byte);
                 if (arg_is_view_of_byte) {
                     auto print_call = new (mod) CallExpr(
-                        named_template("print__putchar_each"),
-                        {arg},
+                        named_template("print__fwrite_each"),
+                        {arg, StandardOutputStream(expr->location())},
                         {}
                     );
                     exprs.emplace_back(print_call);
                     continue;
                 }
 
-                // Handle type (print representation of type).
-                bool arg_is_type
-                    = is<TypeExpr>(arg);
-                if (arg_is_type) {
-                    auto relevant_type = as<TypeExpr>(arg)->contained_type();
-                    auto relevant_type_string = relevant_type->string(false);
-                    auto str_literal = new (mod) StringLiteral(
-                        mod,
-                        relevant_type_string,
-                        {}
-                    );
-                    auto print_call = new (mod) CallExpr(
-                        named_template("putchar_each"),
-                        {str_literal,
-                         new (mod) IntegerLiteral(relevant_type_string.size(), {})},
-                        expr->location()
-                    );
-                    exprs.emplace_back(print_call);
-                    continue;
-                }
-
                 // Handle enum value (print name of value).
-                bool arg_is_enum
-                    = is<EnumType>(arg->type()->strip_references());
                 if (arg_is_enum) {
                     auto enum_type = as<EnumType>(arg->type()->strip_references());
                     LCC_ASSERT(enum_type->enumerators().size());
 
-                    // If the value is known at compile time, just print the name of the enum
-                    // that we know it is.
-                    if (
-                        auto enum_expression = cast<ConstantExpr>(arg);
-                        enum_expression
-                    ) {
-                        auto enum_value = enum_expression->value().as_int();
-
-                        auto e_decl = enum_type->enumerator_by_value(enum_value);
-                        LCC_ASSERT(e_decl and e_decl->name().size());
-
-                        auto string_literal = new (mod) StringLiteral(
-                            mod,
-                            e_decl->name(),
-                            e_decl->location()
-                        );
-
-                        auto print_call = new (mod) CallExpr(
-                            named_template("putchar_each"),
-                            {string_literal,
-                             new (mod) IntegerLiteral(e_decl->name().size(), {})},
-                            arg->location()
-                        );
-
-                        exprs.emplace_back(print_call);
-                        continue;
-                    }
-
                     // Map dynamic enum value to it's corresponding string literal.
                     // TODO: Use `switch` once we have it. Binary search?
                     //
@@ -4703,8 +5160,7 @@ void lcc::glint::Sema::AnalyseCall(Expr** expr_ptr, CallExpr* expr) {
                             locinfo.line,
                             locinfo.col,
                             context
-                                ->files()
-                                .at(arg->location().file_id)
+                                ->file(arg->location().file_id)
                                 ->path()
                                 .lexically_normal()
                                 .string(),
@@ -4761,9 +5217,10 @@ void lcc::glint::Sema::AnalyseCall(Expr** expr_ptr, CallExpr* expr) {
                         );
 
                         auto print_call = new (mod) CallExpr(
-                            named_template("putchar_each"),
+                            named_template("fwrite_each"),
                             {string_literal,
-                             new (mod) IntegerLiteral(e->name().size(), {})},
+                             new (mod) IntegerLiteral(e->name().size(), {}),
+                             StandardOutputStream(arg->location())},
                             arg->location()
                         );
 
@@ -4786,7 +5243,7 @@ void lcc::glint::Sema::AnalyseCall(Expr** expr_ptr, CallExpr* expr) {
                 }
 
                 // Otherwise, format argument
-                // print x -> { tmp :: format x; puts tmp.data; -tmp; }
+                // print x -> { tmp :: format x; fwrite tmp.data, 1, tmp.size, stdout; -tmp; }
                 auto format_call = new (mod) CallExpr(
                     new (mod) NameRefExpr(
                         "format",
@@ -4813,15 +5270,11 @@ void lcc::glint::Sema::AnalyseCall(Expr** expr_ptr, CallExpr* expr) {
                 // formattmp :[byte] = format arg;
                 exprs.emplace_back(*format_decl);
 
-                // template(dynarray : expr)
-                //   cfor
-                //       i :: 0;
-                //       i < dynarray.size;
-                //       i += 1;
-                //     putchar @dynarray[i];
+                // template(dynarray : expr, stream : expr)
+                //   fwrite dynarray.data, 1, dynarray.size, stream;
                 auto print_call = new (mod) CallExpr(
-                    named_template("print__putchar_each"),
-                    {*format_decl},
+                    named_template("print__fwrite_each"),
+                    {*format_decl, StandardOutputStream(expr->location())},
                     {}
                 );
                 exprs.emplace_back(print_call);
@@ -4840,7 +5293,7 @@ void lcc::glint::Sema::AnalyseCall(Expr** expr_ptr, CallExpr* expr) {
 
                 exprs.emplace_back(unary);
             }
-
+            flush_constant_bytes();
             *expr_ptr = new (mod) BlockExpr(exprs, name->scope(), expr->location());
             (void) Analyse(expr_ptr);
             return;
@@ -5238,7 +5691,7 @@ void lcc::glint::Sema::AnalyseIntrinsicCall(Expr** expr_ptr, IntrinsicCallExpr*
             /// Get the name of the file containing this call.
             std::string filename = "<unknown>";
             if (expr->location().seekable(context))
-                filename = context->files()[expr->location().file_id]->path().filename().string();
+                filename = context->file(expr->location().file_id)->path().filename().string();
 
             /// Create a string literal containing the filename.
             auto* str = new (mod) StringLiteral(mod, filename, expr->location());
@@ -128,6 +128,10 @@ int main(int argc, char** argv) {
                 replacement = ".lcc";
                 break;
 
+            case lcc::Format::LCC_BINARY_IR:
+                replacement = ".lccb";
+                break;
+
             case lcc::Format::LLVM_TEXTUAL_IR:
                 replacement = ".ll";
                 break;
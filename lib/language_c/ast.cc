@@ -318,6 +318,8 @@ auto Node::name() const -> std::string_view {
                 case TokenKind::LeftCurlyBrace:
                 case TokenKind::RightCurlyBrace:
                 case TokenKind::Semicolon:
+                case TokenKind::Hash:
+                case TokenKind::HashHash:
                 case TokenKind::Eof:
                 case TokenKind::Count:
                     Diag::ICE("Invalid unary operator `{}`", u->unary_operator());
@@ -396,6 +398,8 @@ auto Node::name() const -> std::string_view {
                 case TokenKind::LeftCurlyBrace:
                 case TokenKind::RightCurlyBrace:
                 case TokenKind::Semicolon:
+                case TokenKind::Hash:
+                case TokenKind::HashHash:
                 case TokenKind::Eof:
                 case TokenKind::Count:
                     Diag::ICE("Invalid binary operator `{}`", b->binary_operator());
@@ -417,6 +417,8 @@ void IRGen::generate_expression(const Node* n) {
                 case TokenKind::LeftCurlyBrace:
                 case TokenKind::RightCurlyBrace:
                 case TokenKind::Semicolon:
+                case TokenKind::Hash:
+                case TokenKind::HashHash:
                 case TokenKind::Eof:
                 case TokenKind::Count:
                     Diag::ICE("unreachable");
@@ -519,6 +521,8 @@ void IRGen::generate_expression(const Node* n) {
                 case TokenKind::LeftCurlyBrace:
                 case TokenKind::RightCurlyBrace:
                 case TokenKind::Semicolon:
+                case TokenKind::Hash:
+                case TokenKind::HashHash:
                 case TokenKind::Eof:
                 case TokenKind::Count:
                 case TokenKind::KwSizeof:
@@ -13,12 +13,17 @@
 #include <fmt/format.h>
 #include <fmt/std.h>
 
+#include <algorithm>
 #include <cstdlib>
 #include <filesystem>
+#include <memory>
+#include <optional>
 #include <ranges>
+#include <span>
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace lcc::language_c {
@@ -104,6 +109,8 @@ Type::flag_t flag_from_keyword(TokenKind k) {
         case TokenKind::LeftCurlyBrace:
         case TokenKind::RightCurlyBrace:
         case TokenKind::Semicolon:
+        case TokenKind::Hash:
+        case TokenKind::HashHash:
         case TokenKind::Eof:
         case TokenKind::Count:
             break;
@@ -181,13 +188,15 @@ std::string_view ToString(TokenKind k) {
         case TokenKind::LeftCurlyBrace: return "{";
         case TokenKind::RightCurlyBrace: return "}";
         case TokenKind::Semicolon: return ";";
+        case TokenKind::Hash: return "#";
+        case TokenKind::HashHash: return "##";
         case TokenKind::Eof: return "EOF";
         case TokenKind::Count: break;
     }
     Diag::ICE("unreachable");
 }
 
-Result<std::string> ToSource(Token& t) {
+Result<std::string> ToSource(const Token& t) {
     switch (t.kind) {
         case TokenKind::Eof:
         case TokenKind::Count:
@@ -267,24 +276,49 @@ Result<std::string> ToSource(Token& t) {
         case TokenKind::LeftCurlyBrace:
         case TokenKind::RightCurlyBrace:
         case TokenKind::Semicolon:
+        case TokenKind::Hash:
+        case TokenKind::HashHash:
             return std::string{ToString(t.kind)};
     }
     Diag::ICE("unreachable");
 }
 
-Result<void> Lexer::preprocessor_define(std::string_view name, std::vector<Token> contents) {
-    if (_simple_defines.contains(name))
+Result<void> Lexer::preprocessor_define(std::string_view name, std::shared_ptr<const Macro> macro) {
+    if (_macros.contains(name))
         return Error("c/preprocessor", "Redefinition of `{}`", name);
-    _simple_defines.emplace(name, contents);
+
+    // `##` needs an operand on either side, and `#` needs a parameter to
+    // stringify.
+    const auto& replacement = macro->replacement;
+    if (
+        not replacement.empty()
+        and (replacement.front().kind == TokenKind::HashHash or replacement.back().kind == TokenKind::HashHash)
+    ) return Error("c/preprocessor", "`##` cannot appear at either end of the replacement of macro `{}`", name);
+
+    if (macro->function_like) {
+        for (usz i = 0; i < replacement.size(); ++i) {
+            if (replacement[i].kind != TokenKind::Hash) continue;
+            if (i + 1 >= replacement.size() or not macro->parameter_index(replacement[i + 1])) {
+                return Error(
+                    replacement[i].location,
+                    "c/preprocessor",
+                    "`#` must be followed by a parameter of macro `{}`",
+                    name
+                );
+            }
+        }
+    }
+
+    _macros.emplace(name, std::move(macro));
     return {};
 }
 void Lexer::preprocessor_undefine(std::string_view name) {
     // FIXME: Remove this shit once libc++ actually supports any semblance of
     // the modern language.
 #ifdef __cpp_lib_associative_heterogeneous_erasure
-    _simple_defines.erase(name);
+    _macros.erase(name);
 #else
-    _simple_defines.erase(std::string{name});
+    _macros.erase(std::string{name});
 #endif
 }
 
@@ -323,6 +357,268 @@ bool IsIdentifierContinueCharacter(uint32_t c) {
         or (c >= '0' and c <= '9');
 }
 
+auto Lexer::ExpandMacro() -> bool {
+    auto found = _macros.find(tok.text);
+    if (found == _macros.end()) return false;
+
+    // A macro is not expanded again within its own expansion.
+    if (rgs::any_of(_expansions, [&](const auto& e) { return e.macro == tok.text; }))
+        return false;
+
+    auto macro = found->second;
+    if (not macro->function_like) {
+        _expansions.push_back({
+            std::shared_ptr<const std::vector<Token>>(macro, &macro->replacement),
+            0,
+            tok.text,
+        });
+        return true;
+    }
+
+    // The name of a function-like macro that isn't followed by a
+    // parenthesis is just an identifier.
+    auto name = std::move(tok);
+    NextUnexpandedToken();
+    if (tok.kind != TokenKind::LeftParenthesis) {
+        _next_tokens.push_front(std::move(tok));
+        tok = std::move(name);
+        return false;
+    }
+
+    auto arguments = CollectArguments(name.text, *macro);
+    if (not arguments) {
+        tok.kind = TokenKind::Eof;
+        return false;
+    }
+
+    _expansions.push_back({
+        std::make_shared<const std::vector<Token>>(Substitute(*macro, *arguments)),
+        0,
+        std::move(name.text),
+    });
+    return true;
+}
+
+auto Lexer::CollectArguments(std::string_view name, const Macro& macro)
+    -> std::optional<std::vector<std::vector<Token>>> {
+    std::vector<std::vector<Token>> arguments(1);
+    usz depth = 0;
+    for (;;) {
+        NextUnexpandedToken();
+        if (tok.kind == TokenKind::Eof) {
+            Error("c/preprocessor", "Unterminated call to macro `{}`", name);
+            return std::nullopt;
+        }
+
+        if (tok.kind == TokenKind::LeftParenthesis) ++depth;
+        else if (tok.kind == TokenKind::RightParenthesis) {
+            if (depth == 0) break;
+            --depth;
+        } else if (
+            tok.kind == TokenKind::OpComma and depth == 0
+            // Commas are part of the variable arguments.
+            and not (macro.variadic and arguments.size() == macro.parameters.size())
+        ) {
+            arguments.emplace_back();
+            continue;
+        }
+
+        arguments.back().push_back(std::move(tok));
+    }
+
+    // `foo()` passes no arguments to a macro without parameters, and the
+    // variable arguments may be left out entirely.
+    if (macro.parameters.empty() and arguments.size() == 1 and arguments.front().empty())
+        arguments.clear();
+    if (macro.variadic and arguments.size() + 1 == macro.parameters.size())
+        arguments.emplace_back();
+
+    if (arguments.size() != macro.parameters.size()) {
+        Error(
+            "c/preprocessor",
+            "Macro `{}` expects {} argument{}, but got {}",
+            name,
+            macro.parameters.size(),
+            macro.parameters.size() == 1 ? "" : "s",
+            arguments.size()
+        );
+        return std::nullopt;
+    }
+
+    return arguments;
+}
+
+auto Lexer::ExpandArgument(const std::vector<Token>& argument) -> std::vector<Token> {
+    if (argument.empty()) return {};
+
+    // The argument is expanded as if it were all that's left of the input:
+    // the expansion reading from it can't be popped, and reading past its
+    // end yields EOF instead of the tokens after the macro call. The
+    // argument outlives this, so the expansion needn't own it.
+    auto saved_lookahead = std::exchange(_next_tokens, {});
+    auto saved_floor = std::exchange(_expansion_floor, _expansions.size() + 1);
+    _expansions.push_back({
+        std::shared_ptr<const std::vector<Token>>(std::shared_ptr<void>{}, &argument),
+        0,
+        {},
+    });
+
+    std::vector<Token> expanded{};
+    for (;;) {
+        NextToken();
+        if (tok.kind == TokenKind::Eof) break;
+        expanded.push_back(std::move(tok));
+    }
+
+    _expansions.erase(
+        _expansions.begin() + isz(_expansion_floor - 1),
+        _expansions.end()
+    );
+    _expansion_floor = saved_floor;
+    _next_tokens = std::move(saved_lookahead);
+    return expanded;
+}
+
+auto Lexer::Substitute(const Macro& macro, const std::vector<std::vector<Token>>& arguments)
+    -> std::vector<Token> {
+    const auto& replacement = macro.replacement;
+
+    // Arguments are expanded at most once, and only if they're used other
+    // than as an operand of `#` or `##`.
+    std::vector<std::optional<std::vector<Token>>> expanded(arguments.size());
+
+    std::vector<Token> result{};
+    // Set if the last thing substituted was an argument without tokens;
+    // pasting onto that just yields the right-hand side.
+    bool placemarker = false;
+    for (usz i = 0; i < replacement.size(); ++i) {
+        const auto& t = replacement[i];
+
+        // Definitions make sure `#` is followed by a parameter, and that
+        // `##` isn't at either end.
+        if (macro.function_like and t.kind == TokenKind::Hash) {
+            auto parameter = *macro.parameter_index(replacement[++i]);
+            result.push_back(Stringify(arguments[parameter], t.location));
+            placemarker = false;
+            continue;
+        }
+
+        if (t.kind == TokenKind::HashHash) {
+            const auto& operand = replacement[++i];
+            Token single{};
+            std::span<const Token> rhs{};
+            if (macro.function_like and operand.kind == TokenKind::Hash) {
+                auto parameter = *macro.parameter_index(replacement[++i]);
+                single = Stringify(arguments[parameter], operand.location);
+                rhs = {&single, 1};
+            } else if (auto parameter = macro.parameter_index(operand)) {
+                rhs = arguments[*parameter];
+            } else rhs = {&operand, 1};
+
+            if (rhs.empty()) continue;
+            if (placemarker or result.empty()) result.insert(result.end(), rhs.begin(), rhs.end());
+            else {
+                result.back() = Paste(result.back(), rhs.front());
+                result.insert(result.end(), rhs.begin() + 1, rhs.end());
+            }
+            placemarker = false;
+            continue;
+        }
+
+        if (auto parameter = macro.parameter_index(t)) {
+            const auto& argument = arguments[*parameter];
+            if (i + 1 < replacement.size() and replacement[i + 1].kind == TokenKind::HashHash) {
+                result.insert(result.end(), argument.begin(), argument.end());
+                placemarker = argument.empty();
+                continue;
+            }
+
+            if (not expanded[*parameter]) expanded[*parameter] = ExpandArgument(argument);
+            result.insert(result.end(), expanded[*parameter]->begin(), expanded[*parameter]->end());
+            placemarker = false;
+            continue;
+        }
+
+        result.push_back(t);
+        placemarker = false;
+    }
+
+    return result;
+}
+
+auto Lexer::Stringify(const std::vector<Token>& tokens, Location where) -> Token {
+    Token string{};
+    string.kind = TokenKind::String;
+    string.location = where;
+
+    for (usz i = 0; i < tokens.size(); ++i) {
+        const auto& t = tokens[i];
+
+        // Any whitespace between two tokens becomes a single space.
+        if (i and tokens[i - 1].location.pos + tokens[i - 1].location.len < t.location.pos)
+            string.text += ' ';
+
+        if (t.kind == TokenKind::String) {
+            string.text += '"';
+            for (char c : t.text) {
+                if (c == '\n') {
+                    string.text += "\\n";
+                    continue;
+                }
+                if (c == '"' or c == '\\') string.text += '\\';
+                string.text += c;
+            }
+            string.text += '"';
+        } else if (auto spelling = ToSource(t)) {
+            string.text += *spelling;
+        }
+    }
+
+    return string;
+}
+
+auto Lexer::Paste(const Token& lhs, const Token& rhs) -> Token {
+    auto lhs_spelling = ToSource(lhs);
+    auto rhs_spelling = ToSource(rhs);
+    if (not lhs_spelling or not rhs_spelling) return lhs;
+    auto spelling = *lhs_spelling + *rhs_spelling;
+
+    Token pasted{};
+    pasted.location = lhs.location;
+
+    if (
+        IsIdentifierStartCharacter(u8(spelling.front()))
+        and rgs::all_of(spelling, [](char c) { return IsIdentifierContinueCharacter(u8(c)); })
+    ) {
+        pasted.kind = keywords.contains(spelling) ? keywords.at(spelling) : TokenKind::Identifier;
+        pasted.text = std::move(spelling);
+        return pasted;
+    }
+
+    if (rgs::all_of(spelling, [](char c) { return c >= '0' and c <= '9'; })) {
+        pasted.kind = TokenKind::Integer;
+        pasted.integer_value = std::strtoull(spelling.c_str(), nullptr, 10);
+        return pasted;
+    }
+
+    // Anything else has to spell out a punctuator.
+    for (auto k = unsigned(TokenKind::Invalid) + 1; k < unsigned(TokenKind::Count); ++k) {
+        if (ToString(TokenKind(k)) == spelling) {
+            pasted.kind = TokenKind(k);
+            return pasted;
+        }
+    }
+
+    Error(
+        lhs.location,
+        "c/preprocessor",
+        "Pasting `{}` and `{}` does not give a valid token",
+        *lhs_spelling,
+        *rhs_spelling
+    );
+    return lhs;
+}
+
 void Lexer::NextNumber() {
     auto start_location = tok.location;
 
@@ -555,23 +851,167 @@ void Lexer::NextChar() {
         return;
     }
     auto& in = _including.front();
-    lastc = u32(in.at(_including_offset++));
-    if (_including_offset >= in.size()) {
+    lastc = u32(in.text.at(in.offset++));
+    if (in.offset >= in.text.size())
         _including.pop_front();
-        _including_offset = 0;
+}
+
+auto Lexer::resolve_include(
+    std::string_view path,
+    bool quoted,
+    const File* includer,
+    std::vector<fs::path>& checked
+) -> fs::path {
+    std::string key{};
+    if (quoted) key = includer->path().parent_path().string();
+    key += quoted ? '"' : '<';
+    key += path;
+
+    if (
+        auto cached = _resolved_includes.find(key);
+        cached != _resolved_includes.end()
+    ) return cached->second;
+
+    if (quoted) checked.push_back(includer->path().parent_path() / path);
+    checked.emplace_back(path);
+    for (const auto& dir : context->include_directories())
+        checked.push_back(fs::path(dir) / path);
+
+    for (const auto& candidate : checked) {
+        std::error_code ec{};
+        if (not fs::is_regular_file(candidate, ec)) continue;
+        // Canonical, so that `#pragma once` and the context's file
+        // cache see a header as the same file however it was reached.
+        auto resolved = fs::canonical(candidate, ec);
+        if (ec) resolved = fs::absolute(candidate);
+        _resolved_includes.emplace(std::move(key), resolved);
+        return resolved;
+    }
+
+    return {};
+}
+
+void Lexer::NoteContent(const File* file) {
+    for (auto& in : _including) {
+        if (in.file != file) continue;
+        in.started = true;
+        // Anything after the `#endif` of an include guard means it isn't one.
+        if (in.guard_closed) _include_guards.erase(in.file);
+        return;
+    }
+}
+
+auto Lexer::EndGroup() -> bool {
+    bool is_else = tok.text == "else";
+    auto location = tok.location;
+
+    NextToken();
+    while (not (tok.kind == TokenKind::Eof or tok.kind == TokenKind::Invalid)) {
+        Warning("c/preprocessor", "Junk following #{} directive", is_else ? "else" : "endif");
+        NextToken();
+    }
+
+    if (_conditionals.empty()) {
+        Error(location, "c/preprocessor", "#{} without #ifdef or #ifndef", is_else ? "else" : "endif");
+        return false;
+    }
+
+    auto& conditional = _conditionals.back();
+    if (is_else) {
+        if (conditional.seen_else)
+            Error(location, "c/preprocessor", "Duplicate #else");
+        conditional.seen_else = true;
+        // `#ifndef X ... #else ... #endif` has content whether X is defined or not.
+        conditional.guard.clear();
+        return true;
+    }
+
+    if (not conditional.guard.empty()) {
+        for (auto& in : _including) {
+            if (in.file == conditional.guarded_file) {
+                in.guard_closed = true;
+                break;
+            }
+        }
+        _include_guards[conditional.guarded_file] = std::move(conditional.guard);
+    }
+    _conditionals.pop_back();
+    return true;
+}
+
+void Lexer::SkipGroup() {
+    // Groups nested in the one we're skipping are skipped whole.
+    usz depth{};
+    for (;;) {
+        while (lastc and lastc != '\n') NextChar();
+        if (not lastc) return;
+        NextChar();
+
+        while (preprocessor_whitespace.contains((char) lastc)) NextChar();
+        if (lastc != '#') continue;
+        NextChar();
+        while (preprocessor_whitespace.contains((char) lastc)) NextChar();
+        if (not IsIdentifierStartCharacter(lastc)) continue;
+        NextIdentifier();
+
+        if (tok.text == "if" or tok.text == "ifdef" or tok.text == "ifndef") ++depth;
+        else if (tok.text == "endif" and depth) --depth;
+        else if (not depth and (tok.text == "else" or tok.text == "endif")) {
+            (void) EndGroup();
+            return;
+        }
     }
 }
 
 void Lexer::NextToken() {
-    // If the preprocessor asks for a token, don't replace it.
-    if (_next_tokens.size()) {
-        tok = _next_tokens.front();
+    // Directives see the source as-is.
+    if (preprocessing) {
+        LexToken();
+        return;
+    }
+
+    do NextUnexpandedToken();
+    while (tok.kind == TokenKind::Identifier and ExpandMacro());
+}
+
+void Lexer::NextUnexpandedToken() {
+    // Tokens we've looked at and put back come first.
+    if (not _next_tokens.empty()) {
+        tok = std::move(_next_tokens.front());
         _next_tokens.pop_front();
         return;
     }
 
+    // Then whatever macro expansions are still being read, innermost first.
+    // An expansion is only popped once we try to read past its end; until
+    // then, its macro stays disabled.
+    while (not _expansions.empty()) {
+        auto& expansion = _expansions.back();
+        if (expansion.index < expansion.tokens->size()) {
+            tok = (*expansion.tokens)[expansion.index++];
+            return;
+        }
+
+        // The end of a macro argument being expanded on its own.
+        if (_expansions.size() == _expansion_floor) {
+            tok = {};
+            tok.kind = TokenKind::Eof;
+            return;
+        }
+
+        _expansions.pop_back();
+    }
+
+    LexToken();
+}
+
+void Lexer::LexToken() {
     // Return EOF if we’re at EOF.
     if (not lastc) {
+        if (not _conditionals.empty()) {
+            Error(_conditionals.back().location, "c/preprocessor", "Missing #endif");
+            _conditionals.clear();
+        }
         tok.kind = TokenKind::Eof;
         return;
     }
@@ -584,19 +1024,33 @@ void Lexer::NextToken() {
     // Skip different kinds of whitespace depending on if we are preprocessing
     // or not.
     // TODO: Handle escaped newlines
-    if (preprocessing)
-        while (preprocessor_whitespace.contains((char) lastc)) NextChar();
-    else
-        while (IsSpace(lastc)) NextChar();
+    // Runs of whitespace in the main source are skipped in bulk; included
+    // text is fed through NextChar() one byte at a time.
+    if (preprocessing) {
+        while (preprocessor_whitespace.contains((char) lastc)) {
+            if (_including.empty()) chars.skip_ascii_in(preprocessor_whitespace);
+            NextChar();
+        }
+    } else {
+        while (IsSpace(lastc)) {
+            if (_including.empty()) chars.skip_ascii_in(" \n\r\t");
+            NextChar();
+        }
+    }
 
     // Record start of token.
     tok.location.pos = CurrentOffset();
     auto start_location = tok.location;
 
+    // Comments and directives are looked at once we know they are ones.
+    _token_file = current_file();
+    if (lastc != '/' and lastc != '#') NoteContent(_token_file);
+
     // Determine token starting at current offset.
     switch (lastc) {
         case 0:
         case ',':
+        case '.':
         case ';':
         case '(':
         case ')':
@@ -643,10 +1097,13 @@ void Lexer::NextToken() {
                 if (lastc == '/') {
                     NextChar();
 
-                    while (lastc and lastc != '\n') NextChar();
+                    while (lastc and lastc != '\n') {
+                        if (_including.empty()) chars.skip_until("\r\n");
+                        NextChar();
+                    }
 
                     // The actual token beyond the comment.
-                    NextToken();
+                    LexToken();
                     return;
                 }
                 // Block comment
@@ -654,6 +1111,7 @@ void Lexer::NextToken() {
                     NextChar();
 
                     while (lastc) {
+                        if (_including.empty()) chars.skip_until("*");
                         NextChar();
                         if (lastc == '*') {
                             NextChar();
@@ -665,9 +1123,11 @@ void Lexer::NextToken() {
                     }
 
                     // The actual token beyond the comment.
-                    NextToken();
+                    LexToken();
                     return;
                 }
+
+                NoteContent(_token_file);
             }
 
             if (lastc == '=' and from_trailing_equal.contains(tok.kind)) {
@@ -677,8 +1137,21 @@ void Lexer::NextToken() {
         } break;
 
         case '#': {
+            const auto* directive_file = current_file();
+            bool starts_file = not _including.empty() and not _including.front().started;
+            NoteContent(directive_file);
             NextChar();
 
+            // Within a directive, `#` and `##` are operators.
+            if (preprocessing) {
+                tok.kind = TokenKind::Hash;
+                if (lastc == '#') {
+                    tok.kind = TokenKind::HashHash;
+                    NextChar();
+                }
+                break;
+            }
+
             if (lastc == '#')
                 Diag::ICE("TODO: pp Concatenation");
 
@@ -696,15 +1169,60 @@ void Lexer::NextToken() {
                     }
 
                     std::string name = tok.text;
+                    auto macro = std::make_shared<Macro>();
+
+                    // The parameter list of a function-like macro must follow its name
+                    // immediately; `#define foo (x)` is object-like.
+                    if (lastc == '(') {
+                        macro->function_like = true;
+                        NextToken(); // yeet name
+                        NextToken(); // yeet '('
+                        while (tok.kind != TokenKind::RightParenthesis) {
+                            if (tok.kind == TokenKind::OpDot) {
+                                NextToken();
+                                if (tok.kind == TokenKind::OpDot) NextToken();
+                                if (tok.kind != TokenKind::OpDot) {
+                                    Error("c/preprocessor", "Expected `...` in parameter list of macro `{}`", name);
+                                    tok.kind = TokenKind::Eof;
+                                    return;
+                                }
+                                NextToken();
+                                macro->variadic = true;
+                                macro->parameters.emplace_back("__VA_ARGS__");
+                                if (tok.kind != TokenKind::RightParenthesis) {
+                                    Error("c/preprocessor", "Expected `)` after `...` in parameter list of macro `{}`", name);
+                                    tok.kind = TokenKind::Eof;
+                                    return;
+                                }
+                                break;
+                            }
+
+                            if (tok.kind != TokenKind::Identifier) {
+                                Error("c/preprocessor", "Expected parameter name in parameter list of macro `{}`", name);
+                                tok.kind = TokenKind::Eof;
+                                return;
+                            }
+                            if (rgs::find(macro->parameters, tok.text) != macro->parameters.end())
+                                Error("c/preprocessor", "Duplicate parameter `{}` of macro `{}`", tok.text, name);
+                            macro->parameters.emplace_back(tok.text);
+
+                            NextToken();
+                            if (tok.kind == TokenKind::OpComma) NextToken();
+                            else if (tok.kind != TokenKind::RightParenthesis) {
+                                Error("c/preprocessor", "Expected `,` or `)` in parameter list of macro `{}`", name);
+                                tok.kind = TokenKind::Eof;
+                                return;
+                            }
+                        }
+                    }
                     NextToken();
 
-                    std::vector<Token> contents{};
                     while (not (tok.kind == TokenKind::Eof or tok.kind == TokenKind::Invalid)) {
-                        contents.emplace_back(tok);
+                        macro->replacement.emplace_back(tok);
                         NextToken();
                     }
 
-                    (void) preprocessor_define(name, contents);
+                    (void) preprocessor_define(name, std::move(macro));
                 } else if (tok.text == "undef") {
                     NextToken();
                     if (tok.kind != TokenKind::Identifier) {
@@ -725,6 +1243,7 @@ void Lexer::NextToken() {
                 } else if (tok.text == "include") {
                     NextToken();
                     std::string path{};
+                    bool quoted{false};
                     if (tok.kind == TokenKind::OpLessThan) {
                         auto open_location = tok.location;
                         while (lastc and lastc != '\n' and lastc != '>') {
@@ -740,12 +1259,11 @@ void Lexer::NextToken() {
                             auto e = Error(open_location, "c/preprocessor", "Expected `>` to close this `<`...");
                             e.fix_by_inserting_at(tok.location, ">");
                         }
-                    }
-                    // TODO: include string syntax
-                    // else if (tok.kind == TokenKind::String) {
-                    //     path = tok.text;
-                    // }
-                    else {
+                    } else if (tok.kind == TokenKind::String) {
+                        path = tok.text;
+                        quoted = true;
+                        NextToken();
+                    } else {
                         Error(
                             "c/preprocessor",
                             "Expected `<` or `\"` to begin included path, but got {} instead",
@@ -756,32 +1274,14 @@ void Lexer::NextToken() {
                         return;
                     }
 
-                    fs::path fullpath{};
-                    if (fs::exists(path))
-                        fullpath = fs::absolute(path);
-                    else {
-                        for (auto dir : context->include_directories()) {
-                            auto dirpath = fs::path(dir);
-                            if (fs::exists(dirpath / path)) {
-                                fullpath = fs::absolute(dirpath / path);
-                                break;
-                            }
-                        }
-                    }
+                    std::vector<fs::path> checked{};
+                    auto fullpath = resolve_include(path, quoted, directive_file, checked);
                     if (fullpath.empty()) {
                         Error(
                             "c/preprocessor",
                             "Included file \"{}\" does not exist\nChecked:\n  {}",
                             path,
-                            fmt::join(
-                                lcc::rgs::transform_view(
-                                    context->include_directories(),
-                                    [&](const auto& d) {
-                                        return fs::path(d) / path;
-                                    }
-                                ),
-                                "\n  "
-                            )
+                            fmt::join(checked, "\n  ")
                         );
                         tok.kind = TokenKind::Eof;
                         return;
@@ -792,10 +1292,64 @@ void Lexer::NextToken() {
                         NextToken();
                     }
 
+                    // The context only ever loads a file once, no matter how many times
+                    // (or from where) it is included.
+                    const auto& included = context->get_or_load_file(fullpath);
+
                     // After this, the next characters we fetch via the lexer API will be from
                     // the included file. This means we can't do our normal handling of "go
                     // until EOF or newline", since, er, this file's tokens are in the way.
-                    _including.push_front(File::Read(path));
+                    auto guard = _include_guards.find(&included);
+                    bool guarded = guard != _include_guards.end() and _macros.contains(guard->second);
+                    if (included.size() and not guarded and not _pragma_once_files.contains(&included)) {
+                        _including.push_front({
+                            &included,
+                            std::string_view{included.data(), included.size()},
+                        });
+                    }
+                } else if (tok.text == "ifdef" or tok.text == "ifndef") {
+                    bool negated = tok.text == "ifndef";
+                    auto location = tok.location;
+                    NextToken();
+                    if (tok.kind != TokenKind::Identifier) {
+                        Error("c/preprocessor", "Macro name missing");
+                        tok.kind = TokenKind::Eof;
+                        return;
+                    }
+
+                    std::string name = tok.text;
+
+                    NextToken();
+                    while (not (tok.kind == TokenKind::Eof or tok.kind == TokenKind::Invalid)) {
+                        Warning("c/preprocessor", "Junk following macro name of #{} directive", negated ? "ifndef" : "ifdef");
+                        NextToken();
+                    }
+
+                    // An `#ifndef` before anything else in an included file may be
+                    // the start of an include guard; see EndGroup().
+                    auto& conditional = _conditionals.emplace_back(location);
+                    if (negated and starts_file) {
+                        conditional.guarded_file = directive_file;
+                        conditional.guard = name;
+                    }
+
+                    if (_macros.contains(name) == negated) SkipGroup();
+                } else if (tok.text == "else") {
+                    // We were reading the group before this, so this one is skipped.
+                    if (EndGroup()) SkipGroup();
+                } else if (tok.text == "endif") {
+                    (void) EndGroup();
+                } else if (tok.text == "pragma") {
+                    NextToken();
+                    if (tok.kind == TokenKind::Identifier and tok.text == "once") {
+                        _pragma_once_files.insert(directive_file);
+                        NextToken();
+                    }
+
+                    // Other pragmas are implementation-defined; we don't know any, so we
+                    // ignore them.
+                    while (not (tok.kind == TokenKind::Eof or tok.kind == TokenKind::Invalid))
+                        NextToken();
                 } else {
                     Error(
                         "c/preprocessor",
@@ -807,8 +1361,9 @@ void Lexer::NextToken() {
 
                 preprocessing = false;
 
-                // This fetches the *actual* token, not preprocessor stuff.
-                NextToken();
+                // This fetches the *actual* token, not preprocessor stuff; NextToken()
+                // takes care of expanding it.
+                LexToken();
 
                 break;
             } else Diag::ICE("TODO: pp Stringization");
@@ -906,26 +1461,8 @@ void Lexer::NextToken() {
             if (IsIdentifierStartCharacter(lastc)) {
                 NextIdentifier();
 
-                // Detect simple macros.
-                if (not preprocessing and _simple_defines.contains(tok.text)) {
-#ifdef __cpp_lib_containers_ranges
-                    _next_tokens.append_range(
-                        _simple_defines.at(tok.text)
-                    );
-#else
-                    const auto& replacement_tokens = _simple_defines.at(tok.text);
-                    _next_tokens.insert(
-                        _next_tokens.end(),
-                        replacement_tokens.cbegin(),
-                        replacement_tokens.cend()
-
-                    );
-#endif
-                    NextToken();
-                }
-
-                // Detect keywords.
-                else if (keywords.contains(tok.text))
+                // Detect keywords. Macros are expanded by NextToken().
+                if (keywords.contains(tok.text))
                     tok.kind = keywords.at(tok.text);
 
                 break;
@@ -1012,6 +1549,8 @@ constexpr size_t unary_precedence(TokenKind kind) {
         case TokenKind::LeftCurlyBrace:
         case TokenKind::RightCurlyBrace:
         case TokenKind::Semicolon:
+        case TokenKind::Hash:
+        case TokenKind::HashHash:
         case TokenKind::Eof:
         case TokenKind::Count:
         case TokenKind::OpDot:
@@ -1116,6 +1655,8 @@ constexpr size_t binary_precedence(TokenKind kind) {
         case TokenKind::LeftCurlyBrace:
         case TokenKind::RightCurlyBrace:
         case TokenKind::Semicolon:
+        case TokenKind::Hash:
+        case TokenKind::HashHash:
         case TokenKind::Eof:
         case TokenKind::OpExclamation:
         case TokenKind::Count:
@@ -1530,6 +2071,8 @@ auto Parser::ParseBaseType(Type::flag_t flags) -> Result<Type*> {
             case TokenKind::LeftCurlyBrace:
             case TokenKind::RightCurlyBrace:
             case TokenKind::Semicolon:
+            case TokenKind::Hash:
+            case TokenKind::HashHash:
             case TokenKind::Eof:
             case TokenKind::Count:
                 break;
@@ -1598,6 +2141,8 @@ auto Parser::ParseExpression(size_t current_precedence) -> Result<Node*> {
         case TokenKind::OpCaret:
         case TokenKind::OpPipe:
         case TokenKind::OpAmpersand:
+        case TokenKind::Hash:
+        case TokenKind::HashHash:
             return Error("expected-qualified-id", "Unexpected `{}`", tok.kind);
 
         case TokenKind::KwReturn: {
@@ -1903,6 +2448,8 @@ auto Parser::ParseExpression(size_t current_precedence) -> Result<Node*> {
             case TokenKind::LeftCurlyBrace:
             case TokenKind::RightCurlyBrace:
             case TokenKind::Semicolon:
+            case TokenKind::Hash:
+            case TokenKind::HashHash:
             case TokenKind::Eof:
             case TokenKind::Count:
             case TokenKind::KwSizeof:
@@ -1931,12 +2478,15 @@ void Parser::ParseTopLevel(std::string of_file) {
                 fmt::print("- {} <- {} ({})\n", *d->type(), d->name(), fmt::ptr(d));
             }
         }
-        for (auto [name, contents] : defines()) {
+        for (const auto& [name, macro] : defines()) {
             fmt::print(
-                "-D{}=\"{}\"\n",
+                "-D{}{}=\"{}\"\n",
                 name,
+                macro->function_like
+                    ? fmt::format("({})", fmt::join(macro->parameters, ","))
+                    : std::string{},
                 fmt::join(
-                    std::ranges::views::transform(contents, [](auto token) {
+                    std::ranges::views::transform(macro->replacement, [](auto token) {
                         auto token_source = ToSource(token);
                         if (not token_source)
                             Diag::ICE("Invalid token recorded in preprocessor definition");
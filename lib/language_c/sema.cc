@@ -12,15 +12,15 @@
 namespace lcc::language_c {
 
 void Sema::update_type(const Node* n, Type* t) {
-    _type_cache[n] = t;
+    n->analysed_type(t);
 }
 
 auto Sema::type_of(const Node* n) -> Result<Type*> {
     if (not n) Diag::ICE("nullptr argument");
 
     // Only get the type of a node once.
-    if (_type_cache.contains(n))
-        return _type_cache.at(n);
+    if (auto* t = n->analysed_type())
+        return t;
 
     /** (!) -- Assign Before Use! **/
     auto out = Result<Type*>::Null();
@@ -140,6 +140,8 @@ auto Sema::type_of(const Node* n) -> Result<Type*> {
                 case TokenKind::LeftCurlyBrace:
                 case TokenKind::RightCurlyBrace:
                 case TokenKind::Semicolon:
+                case TokenKind::Hash:
+                case TokenKind::HashHash:
                 case TokenKind::Eof:
                 case TokenKind::Count:
                     Diag::ICE("Not a binary operator");
@@ -262,6 +264,8 @@ auto Sema::type_of(const Node* n) -> Result<Type*> {
                 case TokenKind::LeftCurlyBrace:
                 case TokenKind::RightCurlyBrace:
                 case TokenKind::Semicolon:
+                case TokenKind::Hash:
+                case TokenKind::HashHash:
                 case TokenKind::Eof:
                 case TokenKind::Count:
                     Diag::ICE("Not a unary operator");
@@ -514,6 +518,8 @@ Result<void> Sema::analyse_binary(BinaryOperation*& b) {
         case TokenKind::LeftCurlyBrace:
         case TokenKind::RightCurlyBrace:
         case TokenKind::Semicolon:
+        case TokenKind::Hash:
+        case TokenKind::HashHash:
         case TokenKind::Eof:
         case TokenKind::Count:
             Diag::ICE("Invalid binary operator `{}`", b->binary_operator());
@@ -652,6 +658,8 @@ Result<void> Sema::analyse_unary(UnaryOperation*& u) {
         case TokenKind::LeftCurlyBrace:
         case TokenKind::RightCurlyBrace:
         case TokenKind::Semicolon:
+        case TokenKind::Hash:
+        case TokenKind::HashHash:
         case TokenKind::Eof:
         case TokenKind::Count:
             Diag::ICE("unreachable");
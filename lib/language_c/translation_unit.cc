@@ -1,28 +1,51 @@
 #include <language_c/translation_unit.hh>
 
 #include <language_c/ast.hh>
+#include <language_c/type.hh>
 
-#include <iterator>
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
 #include <string_view>
 
 namespace lcc::language_c {
 
 auto TranslationUnit::intern(std::string_view str) -> size_t {
-    auto begin = string_literals.begin();
-    auto found = rgs::find(string_literals, str);
-    if (found == string_literals.end())
-        string_literals.emplace_back(str);
+    auto [found, inserted] = interned_strings.try_emplace(
+        std::string{str},
+        string_literals.size()
+    );
+    if (inserted) string_literals.emplace_back(str);
+    return found->second;
+}
+
+auto TranslationUnit::allocate(size_t size) -> void* {
+    constexpr size_t align = alignof(std::max_align_t);
+    size = (size + align - 1) & ~(align - 1);
+
+    if (size > arena_remaining) {
+        // Anything too large for a block gets a block of its own.
+        auto block_size = std::max(size, arena_block_size);
+        arena_blocks.push_back(std::make_unique_for_overwrite<std::byte[]>(block_size));
+        arena_cursor = arena_blocks.back().get();
+        arena_remaining = block_size;
+    }
 
-    return (size_t) std::distance(begin, found);
+    auto* ptr = arena_cursor;
+    arena_cursor += size;
+    arena_remaining -= size;
+    return ptr;
 }
 
 TranslationUnit::~TranslationUnit() {
+    // The memory itself is released along with the arena blocks.
     for (const auto* const n : allocated_nodes)
-        delete n;
-    for (const auto* const s : allocated_scopes)
-        delete s;
+        n->~Node();
+    for (auto* const s : allocated_scopes)
+        s->~Scope();
     for (const auto* const t : allocated_types)
-        delete t;
+        t->~Type();
 }
 
 } // namespace lcc::language_c
@@ -7,7 +7,14 @@
 #include <lcc/ir/module.hh>
 #include <lcc/target.hh>
 #include <lcc/utils.hh>
+
+#include <bit>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <utility>
 #include <variant>
+#include <vector>
 
 namespace lcc {
 
@@ -105,11 +112,913 @@ static void calculate_defining_uses(MFunction& function) {
     );
 }
 
+static auto x86_64_is_compare(MInst::Kind kind) -> bool {
+    switch (kind) {
+        case MInst::Kind::Eq:
+        case MInst::Kind::Ne:
+        case MInst::Kind::SLt:
+        case MInst::Kind::SLe:
+        case MInst::Kind::SGt:
+        case MInst::Kind::SGe:
+        case MInst::Kind::ULt:
+        case MInst::Kind::ULe:
+        case MInst::Kind::UGt:
+        case MInst::Kind::UGe:
+            return true;
+        default: return false;
+    }
+}
+
+/// Map a comparison to the one that is true exactly when it is false.
+static auto x86_64_invert_compare(MInst::Kind kind) -> MInst::Kind {
+    switch (kind) {
+        case MInst::Kind::Eq: return MInst::Kind::Ne;
+        case MInst::Kind::Ne: return MInst::Kind::Eq;
+        case MInst::Kind::SLt: return MInst::Kind::SGe;
+        case MInst::Kind::SLe: return MInst::Kind::SGt;
+        case MInst::Kind::SGt: return MInst::Kind::SLe;
+        case MInst::Kind::SGe: return MInst::Kind::SLt;
+        case MInst::Kind::ULt: return MInst::Kind::UGe;
+        case MInst::Kind::ULe: return MInst::Kind::UGt;
+        case MInst::Kind::UGt: return MInst::Kind::ULe;
+        case MInst::Kind::UGe: return MInst::Kind::ULt;
+        default: LCC_UNREACHABLE();
+    }
+}
+
+/// Map a comparison to the conditional jump taken when it is true.
+static auto x86_64_jcc_for_compare(MInst::Kind kind) -> x86_64::Opcode {
+    using x86_64::Opcode;
+    switch (kind) {
+        case MInst::Kind::Eq: return Opcode::JumpIfEqual;
+        case MInst::Kind::Ne: return Opcode::JumpIfNotEqual;
+        case MInst::Kind::SLt: return Opcode::JumpIfLessSigned;
+        case MInst::Kind::SLe: return Opcode::JumpIfEqualOrLessSigned;
+        case MInst::Kind::SGt: return Opcode::JumpIfGreaterSigned;
+        case MInst::Kind::SGe: return Opcode::JumpIfEqualOrGreaterSigned;
+        case MInst::Kind::ULt: return Opcode::JumpIfLessUnsigned;
+        case MInst::Kind::ULe: return Opcode::JumpIfEqualOrLessUnsigned;
+        case MInst::Kind::UGt: return Opcode::JumpIfGreaterUnsigned;
+        case MInst::Kind::UGe: return Opcode::JumpIfEqualOrGreaterUnsigned;
+        default: LCC_UNREACHABLE();
+    }
+}
+
+/// Map a comparison to the conditional move performed when it is true.
+static auto x86_64_cmov_for_compare(MInst::Kind kind) -> x86_64::Opcode {
+    using x86_64::Opcode;
+    switch (kind) {
+        case MInst::Kind::Eq: return Opcode::MoveIfEqual;
+        case MInst::Kind::Ne: return Opcode::MoveIfNotEqual;
+        case MInst::Kind::SLt: return Opcode::MoveIfLessSigned;
+        case MInst::Kind::SLe: return Opcode::MoveIfEqualOrLessSigned;
+        case MInst::Kind::SGt: return Opcode::MoveIfGreaterSigned;
+        case MInst::Kind::SGe: return Opcode::MoveIfEqualOrGreaterSigned;
+        case MInst::Kind::ULt: return Opcode::MoveIfLessUnsigned;
+        case MInst::Kind::ULe: return Opcode::MoveIfEqualOrLessUnsigned;
+        case MInst::Kind::UGt: return Opcode::MoveIfGreaterUnsigned;
+        case MInst::Kind::UGe: return Opcode::MoveIfEqualOrGreaterUnsigned;
+        default: LCC_UNREACHABLE();
+    }
+}
+
+/// If `compare` is a comparison whose result is used only as `condition`,
+/// append a cmp that sets the flags accordingly to `out` and return true.
+/// The result of the comparison is then never materialised.
+static auto x86_64_compare_to_flags(
+    Module* mod,
+    const MInst& compare,
+    const MOperand& condition,
+    std::vector<MInst>& out
+) -> bool {
+    if (not x86_64_is_compare(compare.kind())) return false;
+
+    // The comparison result must not be needed anywhere but here.
+    if (compare.use_count() != 1) return false;
+    if (
+        not std::holds_alternative<MOperandRegister>(condition)
+        or std::get<MOperandRegister>(condition).value != compare.reg()
+    ) return false;
+
+    auto lhs = compare.get_operand(0);
+    auto rhs = compare.get_operand(1);
+    if (
+        not (std::holds_alternative<MOperandRegister>(lhs) or std::holds_alternative<MOperandImmediate>(lhs))
+        or not (std::holds_alternative<MOperandRegister>(rhs) or std::holds_alternative<MOperandImmediate>(rhs))
+    ) return false;
+
+    // Floating point comparisons set flags differently; leave them be.
+    auto is_float = [](const MOperand& op) {
+        return std::holds_alternative<MOperandRegister>(op)
+           and std::get<MOperandRegister>(op).category == Register::Category::FLOAT;
+    };
+    if (is_float(lhs) or is_float(rhs)) return false;
+
+    // The destination of a compare must be a register, so an immediate
+    // left-hand side is moved into a fresh one first.
+    if (std::holds_alternative<MOperandImmediate>(lhs)) {
+        auto imm = std::get<MOperandImmediate>(lhs);
+        uint size = std::holds_alternative<MOperandRegister>(rhs)
+                      ? std::get<MOperandRegister>(rhs).size
+                      : uint(imm.size ? imm.size : 64);
+        auto temp = MOperandRegister{mod->next_vreg(), size};
+        auto mov_imm = MInst(usz(x86_64::Opcode::Move), {0, 0});
+        mov_imm.add_operand(imm);
+        mov_imm.add_operand(temp);
+        mov_imm.add_operand_clobber(1);
+        out.push_back(mov_imm);
+        lhs = temp;
+    }
+
+    // NOTE: GNU ordering of operands
+    auto cmp = MInst(usz(x86_64::Opcode::Compare), {0, 0});
+    cmp.add_operand(rhs);
+    cmp.add_operand(lhs);
+    out.push_back(cmp);
+    return true;
+}
+
+/// Fuse a comparison whose only use is the conditional branch right
+/// after it into a compare and a conditional jump, instead of
+/// materialising the result with setcc and testing it again.
+///
+/// r2.1 | M.SLt r0.64, r1.64
+///        M.CondBranch r2.1, bb_then, bb_else
+/// becomes the following machine code, GNU syntax
+///     cmp %r1.64, %r0.64
+///     jl bb_then
+///     jmp bb_else
+///
+/// If the then block comes right after this one, the condition is
+/// inverted and the jump goes to the else block; the unconditional
+/// jump then falls through and is elided when emitting assembly.
+static void x86_64_fuse_compare_and_branch(Module* mod, MFunction& function) {
+    auto& blocks = function.blocks();
+    for (usz block_index = 0; block_index < blocks.size(); ++block_index) {
+        auto& instructions = blocks.at(block_index).instructions();
+        if (instructions.size() < 2) continue;
+
+        auto& branch = instructions.back();
+        auto& compare = instructions.at(instructions.size() - 2);
+        if (branch.kind() != MInst::Kind::CondBranch) continue;
+
+        std::vector<MInst> lowered{};
+        if (not x86_64_compare_to_flags(mod, compare, branch.get_operand(0), lowered))
+            continue;
+
+        auto then_block = std::get<MOperandBlock>(branch.get_operand(1));
+        auto else_block = std::get<MOperandBlock>(branch.get_operand(2));
+
+        bool then_is_next = block_index + 1 < blocks.size()
+                        and then_block->name() == blocks.at(block_index + 1).name();
+        auto kind = then_is_next ? x86_64_invert_compare(compare.kind()) : compare.kind();
+        auto jcc = MInst(usz(x86_64_jcc_for_compare(kind)), {0, 0});
+        jcc.add_operand(then_is_next ? else_block : then_block);
+        lowered.push_back(jcc);
+
+        auto jmp = MInst(usz(x86_64::Opcode::Jump), {0, 0});
+        jmp.add_operand(then_is_next ? then_block : else_block);
+        lowered.push_back(jmp);
+
+        instructions.erase(instructions.end() - 2, instructions.end());
+        instructions.insert(instructions.end(), lowered.begin(), lowered.end());
+    }
+}
+
+/// Lower selects to conditional moves.
+///
+/// r3.32 | M.Select r2.1, r0.32, r1.32
+/// becomes the following machine code, GNU syntax
+///     mov %r1.32, %r3.32
+///     test %r2.1, %r2.1
+///     cmovne %r0.32, %r3.32
+///
+/// If the condition is a comparison right before the select whose
+/// only use is the select, the comparison is fused into it the same
+/// way as for conditional branches, and the cmov tests the flags
+/// set by the cmp directly.
+///
+/// There is no 8-bit cmov, so everything is done in at least 32 bits;
+/// only the low bits of the result are ever looked at. The address of
+/// a local or global is computed with lea, as cmov can't take it.
+static void x86_64_lower_select(Module* mod, MFunction& function) {
+    for (auto& block : function.blocks()) {
+        auto& instructions = block.instructions();
+        if (rgs::none_of(instructions, [](auto& i) { return i.kind() == MInst::Kind::Select; }))
+            continue;
+
+        std::vector<MInst> lowered{};
+        for (auto& inst : instructions) {
+            if (inst.kind() != MInst::Kind::Select) {
+                lowered.push_back(inst);
+                continue;
+            }
+
+            LCC_ASSERT(
+                inst.regcategory() != +Register::Category::FLOAT,
+                "TODO: x86_64 lowering of select between floating point values"
+            );
+
+            auto size = std::max(uint(inst.regsize()), 32u);
+            auto resize = [&](MOperand op) -> MOperand {
+                if (std::holds_alternative<MOperandRegister>(op))
+                    std::get<MOperandRegister>(op).size = size;
+                return op;
+            };
+
+            // A local or global stands for its address, but as an operand
+            // of mov or cmov, it would be emitted as a load from memory, so
+            // the address is computed into a register first. lea does not
+            // affect the flags, so this doesn't get in the way of fusing the
+            // comparison before the select.
+            std::vector<MInst> addresses{};
+            auto address = [&](MOperand op) -> MOperand {
+                LCC_ASSERT(
+                    not std::holds_alternative<MOperandFunction>(op),
+                    "TODO: x86_64 lowering of select between function addresses"
+                );
+                if (
+                    not std::holds_alternative<MOperandLocal>(op)
+                    and not std::holds_alternative<MOperandGlobal>(op)
+                ) return op;
+
+                auto temp = MOperandRegister{mod->next_vreg(), 64};
+                auto lea = MInst(usz(x86_64::Opcode::LoadEffectiveAddress), {0, 0});
+                lea.add_operand(op);
+                lea.add_operand(temp);
+                lea.add_operand_clobber(1);
+                addresses.push_back(lea);
+                return temp;
+            };
+
+            auto condition = inst.get_operand(0);
+            auto then_value = resize(address(inst.get_operand(1)));
+            auto else_value = resize(address(inst.get_operand(2)));
+            auto result = MOperandRegister{inst.reg(), size};
+
+            auto mov = [&](MOperand from) {
+                auto m = MInst(usz(x86_64::Opcode::Move), {0, 0});
+                m.add_operand(from);
+                m.add_operand(result);
+                m.add_operand_clobber(1);
+                lowered.push_back(m);
+            };
+
+            // A constant condition just picks one of the values.
+            if (std::holds_alternative<MOperandImmediate>(condition)) {
+                lowered.insert(lowered.end(), addresses.begin(), addresses.end());
+                mov(std::get<MOperandImmediate>(condition).value ? then_value : else_value);
+                continue;
+            }
+
+            // Try to use the flags of the comparison right before this.
+            std::vector<MInst> flags{};
+            auto compare_kind = MInst::Kind::Ne;
+            if (
+                not lowered.empty()
+                and x86_64_compare_to_flags(mod, lowered.back(), condition, flags)
+            ) {
+                compare_kind = lowered.back().kind();
+                lowered.pop_back();
+            } else {
+                auto test = MInst(usz(x86_64::Opcode::Test), {0, 0});
+                test.add_operand(condition);
+                test.add_operand(condition);
+                flags.push_back(test);
+            }
+            lowered.insert(lowered.end(), addresses.begin(), addresses.end());
+
+            // cmov only takes a register source.
+            if (std::holds_alternative<MOperandImmediate>(then_value)) {
+                auto temp = MOperandRegister{mod->next_vreg(), size};
+                auto mov_imm = MInst(usz(x86_64::Opcode::Move), {0, 0});
+                mov_imm.add_operand(then_value);
+                mov_imm.add_operand(temp);
+                mov_imm.add_operand_clobber(1);
+                lowered.push_back(mov_imm);
+                then_value = temp;
+            }
+
+            // NOTE: mov does not affect the flags, so the result may be
+            // initialised either side of the compare.
+            lowered.insert(lowered.end(), flags.begin(), flags.end());
+            mov(else_value);
+
+            auto cmov = MInst(usz(x86_64_cmov_for_compare(compare_kind)), {0, 0});
+            cmov.add_operand(then_value);
+            cmov.add_operand(result);
+            cmov.add_operand_clobber(1);
+            lowered.push_back(cmov);
+        }
+
+        instructions = std::move(lowered);
+    }
+}
+
+/// Fold address arithmetic into the memory operand of the load or store
+/// that uses it, or into a single lea.
+///
+/// r2.64 | M.Mul 8.32, r1.64
+/// r2.64 | M.Add r0.64, r2.64
+/// r3.32 | M.Load r2.64
+/// becomes the following machine code, GNU syntax
+///     mov (%r0,%r1,8), %r3.32
+///
+/// The same goes for a store, and for a base plus a constant offset.
+/// A constant offset added to the scaled address right after it, as
+/// generated for a member of an array element, becomes the
+/// displacement. The base may also be a local, which is addressed
+/// relative to %rbp.
+///
+/// If the scaled address has any other use, or isn't used by the
+/// instruction right after it, it is computed with one lea instead of
+/// an imul and an add. A base plus a constant offset that can't be
+/// folded is left alone, as lea is no better than add for it.
+static void x86_64_fold_addressing_modes(MFunction& function) {
+    // How often each register is referenced by an operand in the whole
+    // function; the result of an address computation may only be folded
+    // away if the load or store is the only thing that looks at it.
+    std::unordered_map<usz, usz> references{};
+    for (auto& block : function.blocks()) {
+        for (auto& inst : block.instructions()) {
+            for (auto& op : inst.all_operands()) {
+                if (std::holds_alternative<MOperandRegister>(op))
+                    ++references[std::get<MOperandRegister>(op).value];
+            }
+        }
+    }
+
+    auto is_address_register = [](const MOperand& op) {
+        return std::holds_alternative<MOperandRegister>(op)
+           and std::get<MOperandRegister>(op).size == 64
+           and std::get<MOperandRegister>(op).category != Register::Category::FLOAT;
+    };
+    auto is_register = [](const MOperand& op, usz value) {
+        return std::holds_alternative<MOperandRegister>(op)
+           and std::get<MOperandRegister>(op).value == value;
+    };
+    // Sizes a plain mov can load or store.
+    auto is_movable = [](usz size) {
+        return size == 1 or size == 8 or size == 16 or size == 32 or size == 64;
+    };
+    auto fits_displacement = [](i64 offset) {
+        return offset >= std::numeric_limits<i32>::min() and offset <= std::numeric_limits<i32>::max();
+    };
+    // The base register and displacement that address `op`, if it is an
+    // address register or a local.
+    auto base_of = [&](const MOperand& op) -> std::optional<std::pair<Register, i64>> {
+        if (is_address_register(op))
+            return std::pair{std::get<MOperandRegister>(op), i64(0)};
+        if (std::holds_alternative<MOperandLocal>(op)) {
+            auto frame_pointer = Register{+x86_64::RegisterId::RBP, 64};
+            return std::pair{frame_pointer, i64(function.local_offset(std::get<MOperandLocal>(op)))};
+        }
+        return std::nullopt;
+    };
+
+    for (auto& block : function.blocks()) {
+        auto& instructions = block.instructions();
+
+        std::vector<MInst> lowered{};
+        lowered.reserve(instructions.size());
+        for (usz index = 0; index < instructions.size(); ++index) {
+            auto& inst = instructions.at(index);
+
+            Memory memory{};
+            usz length = 0;
+
+            // The register holding the address, and how often it must be
+            // referenced in the whole function for the instructions that
+            // compute it to be folded away: once by each of them but the
+            // first, and once by the load or store.
+            auto address = inst.reg();
+            usz address_references = 0;
+
+            // base + index * scale, as generated for a getelementptr.
+            if (
+                inst.kind() == MInst::Kind::Mul
+                and inst.regsize() == 64
+                and index + 1 < instructions.size()
+                and instructions.at(index + 1).kind() == MInst::Kind::Add
+                and instructions.at(index + 1).reg() == inst.reg()
+            ) {
+                auto& add = instructions.at(index + 1);
+                auto scale = inst.get_operand(0);
+                auto base = base_of(add.get_operand(0));
+                if (
+                    std::holds_alternative<MOperandImmediate>(scale)
+                    and is_address_register(inst.get_operand(1))
+                    and base and fits_displacement(base->second)
+                    and is_register(add.get_operand(1), inst.reg())
+                ) {
+                    auto factor = std::get<MOperandImmediate>(scale).value;
+                    if (factor == 1 or factor == 2 or factor == 4 or factor == 8) {
+                        memory.base = base->first;
+                        memory.index = std::get<MOperandRegister>(inst.get_operand(1));
+                        memory.scale = u8(factor);
+                        memory.displacement = i32(base->second);
+                        length = 2;
+                        address_references = 2;
+                    }
+                }
+
+                // + displacement, as generated for a getmemberptr or a
+                // getelementptr with a constant index into the result.
+                if (
+                    length
+                    and index + 2 < instructions.size()
+                    and instructions.at(index + 2).kind() == MInst::Kind::Add
+                    and instructions.at(index + 2).regsize() == 64
+                    and is_register(instructions.at(index + 2).get_operand(0), inst.reg())
+                    and std::holds_alternative<MOperandImmediate>(instructions.at(index + 2).get_operand(1))
+                ) {
+                    auto& displace = instructions.at(index + 2);
+                    auto offset = i64(memory.displacement) + i64(std::get<MOperandImmediate>(displace.get_operand(1)).value);
+
+                    // If the sum goes to a new register, the scaled address
+                    // itself must not be needed anywhere else.
+                    bool same_register = displace.reg() == inst.reg();
+                    if (fits_displacement(offset) and (same_register or references[inst.reg()] == 2)) {
+                        memory.displacement = i32(offset);
+                        length = 3;
+                        address = displace.reg();
+                        address_references = same_register ? 3 : 1;
+                    }
+                }
+            }
+
+            // base + displacement
+            else if (
+                inst.kind() == MInst::Kind::Add
+                and inst.regsize() == 64
+                and std::holds_alternative<MOperandImmediate>(inst.get_operand(1))
+            ) {
+                if (auto base = base_of(inst.get_operand(0))) {
+                    auto offset = base->second + i64(std::get<MOperandImmediate>(inst.get_operand(1)).value);
+                    if (fits_displacement(offset)) {
+                        memory.base = base->first;
+                        memory.displacement = i32(offset);
+                        length = 1;
+                        address_references = 1;
+                    }
+                }
+            }
+
+            if (not length) {
+                lowered.push_back(inst);
+                continue;
+            }
+
+            // The memory operand only ever reads its registers.
+            memory.base.defining_use = false;
+            memory.index.defining_use = false;
+
+            bool folds = references[address] == address_references
+                     and index + length < instructions.size();
+
+            if (folds) {
+                auto& user = instructions.at(index + length);
+
+                // r3 | M.Load rAddress
+                if (
+                    user.kind() == MInst::Kind::Load
+                    and user.regcategory() != +Register::Category::FLOAT
+                    and is_movable(user.regsize())
+                    and is_register(user.get_operand(0), address)
+                ) {
+                    auto mov = MInst(usz(x86_64::Opcode::MoveDereferenceLHS), {0, 0});
+                    mov.add_operand(memory);
+                    mov.add_operand(MOperandRegister{user.reg(), uint(user.regsize())});
+                    mov.add_operand_clobber(1);
+                    lowered.push_back(mov);
+                    index += length;
+                    continue;
+                }
+
+                // M.Store rValue, rAddress
+                if (
+                    user.kind() == MInst::Kind::Store
+                    and std::holds_alternative<MOperandRegister>(user.get_operand(0))
+                    and is_register(user.get_operand(1), address)
+                ) {
+                    auto value = std::get<MOperandRegister>(user.get_operand(0));
+                    if (
+                        value.category != Register::Category::FLOAT
+                        and value.value != address
+                        and value.value != inst.reg()
+                        and is_movable(value.size)
+                    ) {
+                        auto mov = MInst(usz(x86_64::Opcode::MoveDereferenceRHS), {0, 0});
+                        mov.add_operand(value);
+                        mov.add_operand(memory);
+                        lowered.push_back(mov);
+                        index += length;
+                        continue;
+                    }
+                }
+            }
+
+            if (length == 1) {
+                lowered.push_back(inst);
+                continue;
+            }
+
+            auto lea = MInst(usz(x86_64::Opcode::LoadEffectiveAddress), {0, 0});
+            lea.add_operand(memory);
+            lea.add_operand(MOperandRegister{address, 64});
+            lea.add_operand_clobber(1);
+            lowered.push_back(lea);
+            index += length - 1;
+        }
+
+        instructions = std::move(lowered);
+    }
+}
+
+/// Strength-reduce multiplications by a constant.
+///
+/// r1.64 | M.Mul 10.64, r0.64
+/// becomes the following machine code, GNU syntax
+///     lea (%r0,%r0,4), %r1
+///     shl $1, %r1
+///
+/// A factor of 3, 5, or 9 times a power of two is an lea and a shift,
+/// and a power of two is just a shift; any other factor is left to
+/// imul. imul only takes a sign-extended 32-bit immediate, so a factor
+/// that doesn't fit is moved into a register first.
+static void x86_64_lower_multiply_by_constant(Module* mod, MFunction& function) {
+    for (auto& block : function.blocks()) {
+        auto& instructions = block.instructions();
+        if (rgs::none_of(instructions, [](auto& i) { return i.kind() == MInst::Kind::Mul; }))
+            continue;
+
+        std::vector<MInst> lowered{};
+        lowered.reserve(instructions.size());
+        for (auto& inst : instructions) {
+            auto size = uint(inst.regsize());
+            if (
+                inst.kind() != MInst::Kind::Mul
+                or inst.regcategory() == +Register::Category::FLOAT
+                or (size != 32 and size != 64)
+            ) {
+                lowered.push_back(inst);
+                continue;
+            }
+
+            // The constant may be on either side.
+            auto constant = inst.get_operand(0);
+            auto other = inst.get_operand(1);
+            if (std::holds_alternative<MOperandImmediate>(other)) std::swap(constant, other);
+            if (
+                not std::holds_alternative<MOperandImmediate>(constant)
+                or not std::holds_alternative<MOperandRegister>(other)
+            ) {
+                lowered.push_back(inst);
+                continue;
+            }
+
+            auto factor = std::get<MOperandImmediate>(constant).value;
+            if (size == 32) factor &= 0xffff'ffff;
+            auto source = std::get<MOperandRegister>(other);
+            auto result = MOperandRegister{inst.reg(), size};
+
+            // factor = odd * 2^shift
+            auto shift = factor ? usz(std::countr_zero(factor)) : 0;
+            auto odd = factor >> shift;
+            if (factor > 1 and (odd == 1 or odd == 3 or odd == 5 or odd == 9)) {
+                if (odd == 1) {
+                    auto mov = MInst(usz(x86_64::Opcode::Move), {0, 0});
+                    source.size = size;
+                    mov.add_operand(source);
+                    mov.add_operand(result);
+                    mov.add_operand_clobber(1);
+                    lowered.push_back(mov);
+                } else {
+                    // Only the low bits of the address are kept for a
+                    // 32-bit result, so the source is read in full.
+                    source.size = 64;
+                    source.defining_use = false;
+                    auto lea = MInst(usz(x86_64::Opcode::LoadEffectiveAddress), {0, 0});
+                    lea.add_operand(Memory{source, source, u8(odd - 1), 0});
+                    lea.add_operand(result);
+                    lea.add_operand_clobber(1);
+                    lowered.push_back(lea);
+                }
+
+                if (shift) {
+                    auto shl = MInst(usz(x86_64::Opcode::ShiftLeft), {0, 0});
+                    shl.add_operand(MOperandImmediate{shift, 8});
+                    shl.add_operand(result);
+                    shl.add_operand_clobber(1);
+                    lowered.push_back(shl);
+                }
+                continue;
+            }
+
+            if (
+                size == 64
+                and (i64(factor) < std::numeric_limits<i32>::min() or i64(factor) > std::numeric_limits<i32>::max())
+            ) {
+                auto temp = MOperandRegister{mod->next_vreg(), size};
+                auto mov_imm = MInst(usz(x86_64::Opcode::Move), {0, 0});
+                mov_imm.add_operand(constant);
+                mov_imm.add_operand(temp);
+                mov_imm.add_operand_clobber(1);
+                lowered.push_back(mov_imm);
+
+                auto mul = inst;
+                mul.all_operands() = {temp, other};
+                lowered.push_back(mul);
+                continue;
+            }
+
+            lowered.push_back(inst);
+        }
+
+        instructions = std::move(lowered);
+    }
+}
+
+/// The multiplier and shift that divide an unsigned 64-bit integer by
+/// `d` (Hacker's Delight, 10-10). If `add` is set, the multiplier is
+/// one bit too wide, and the dividend has to be added back in.
+struct UnsignedDivisionMagic {
+    u64 multiplier;
+    u64 shift;
+    bool add;
+};
+
+static auto x86_64_unsigned_division_magic(u64 d) -> UnsignedDivisionMagic {
+    LCC_ASSERT(d > 1 and not std::has_single_bit(d));
+    constexpr u64 top = u64(1) << 63;
+    u64 nc = ~u64(0) - (-d) % d;
+    u64 q1 = top / nc, r1 = top - q1 * nc;
+    u64 q2 = (top - 1) / d, r2 = (top - 1) - q2 * d;
+    u64 p = 63;
+    bool add = false;
+    u64 delta{};
+    do {
+        ++p;
+        if (r1 >= nc - r1) {
+            q1 = 2 * q1 + 1;
+            r1 = 2 * r1 - nc;
+        } else {
+            q1 = 2 * q1;
+            r1 = 2 * r1;
+        }
+        if (r2 + 1 >= d - r2) {
+            if (q2 >= top - 1) add = true;
+            q2 = 2 * q2 + 1;
+            r2 = 2 * r2 + 1 - d;
+        } else {
+            if (q2 >= top) add = true;
+            q2 = 2 * q2;
+            r2 = 2 * r2 + 1;
+        }
+        delta = d - 1 - r2;
+    } while (p < 128 and (q1 < delta or (q1 == delta and r1 == 0)));
+    return {q2 + 1, p - 64, add};
+}
+
+/// The multiplier and shift that divide a signed 64-bit integer by
+/// `d` (Hacker's Delight, 10-6). The multiplier is to be read as signed.
+struct SignedDivisionMagic {
+    u64 multiplier;
+    u64 shift;
+};
+
+static auto x86_64_signed_division_magic(i64 d) -> SignedDivisionMagic {
+    constexpr u64 top = u64(1) << 63;
+    u64 ad = d < 0 ? -u64(d) : u64(d);
+    LCC_ASSERT(ad > 1 and not std::has_single_bit(ad));
+    u64 t = top + (u64(d) >> 63);
+    u64 anc = t - 1 - t % ad;
+    u64 q1 = top / anc, r1 = top - q1 * anc;
+    u64 q2 = top / ad, r2 = top - q2 * ad;
+    u64 p = 63;
+    u64 delta{};
+    do {
+        ++p;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= anc) {
+            ++q1;
+            r1 -= anc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= ad) {
+            ++q2;
+            r2 -= ad;
+        }
+        delta = ad - r2;
+    } while (q1 < delta or (q1 == delta and r1 == 0));
+    u64 m = q2 + 1;
+    if (d < 0) m = -m;
+    return {m, p - 64};
+}
+
+/// Strength-reduce 64-bit divisions and remainders by a constant.
+///
+/// The optimiser already does this for integers of up to 32 bits, as
+/// the high half of the product can be taken from a 64-bit multiply
+/// there. For 64 bits, the high half comes from the one-operand mul or
+/// imul, which leaves it in %rdx:
+///
+/// r1.64 | M.UDiv r0.64, 10.64
+/// becomes the following machine code, GNU syntax
+///     mov $0xcccccccccccccccd, %r2
+///     mov %r0, %rax
+///     mul %r2
+///     mov %rdx, %r1
+///     shr $3, %r1
+///
+/// A remainder is x - (x / d) * d, with the product left to the
+/// multiplication lowering. Powers of two are left alone; the
+/// optimiser turns those into shifts.
+static void x86_64_lower_division_by_constant(Module* mod, MFunction& function) {
+    using x86_64::Opcode;
+    using x86_64::RegisterId;
+
+    for (auto& block : function.blocks()) {
+        auto& instructions = block.instructions();
+        std::vector<MInst> lowered{};
+        lowered.reserve(instructions.size());
+        for (auto& inst : instructions) {
+            const bool is_signed = inst.kind() == MInst::Kind::SDiv or inst.kind() == MInst::Kind::SRem;
+            const bool is_remainder = inst.kind() == MInst::Kind::URem or inst.kind() == MInst::Kind::SRem;
+            if (
+                not (is_signed or is_remainder or inst.kind() == MInst::Kind::UDiv)
+                or inst.regsize() != 64
+                or inst.regcategory() == +Register::Category::FLOAT
+                or not std::holds_alternative<MOperandRegister>(inst.get_operand(0))
+                or not std::holds_alternative<MOperandImmediate>(inst.get_operand(1))
+            ) {
+                lowered.push_back(inst);
+                continue;
+            }
+
+            auto d = std::get<MOperandImmediate>(inst.get_operand(1)).value;
+            auto magnitude = is_signed and i64(d) < 0 ? -d : d;
+            if (magnitude < 2 or std::has_single_bit(magnitude)) {
+                lowered.push_back(inst);
+                continue;
+            }
+
+            auto x = std::get<MOperandRegister>(inst.get_operand(0));
+            x.defining_use = false;
+            auto rax = MOperandRegister{+RegisterId::RAX, 64};
+            auto rdx = MOperandRegister{+RegisterId::RDX, 64};
+            auto q = MOperandRegister{is_remainder ? mod->next_vreg() : inst.reg(), 64};
+
+            auto emit = [&](Opcode opcode, MOperand source, MOperand destination) {
+                auto i = MInst(usz(opcode), {0, 0});
+                i.add_operand(source);
+                i.add_operand(destination);
+                i.add_operand_clobber(1);
+                lowered.push_back(i);
+            };
+            auto imm = [](u64 value) { return MOperandImmediate{value, 64}; };
+
+            // q = high half of x * m
+            //
+            // The multiplier has to be live when x is moved into %rax:
+            // nothing says that the mul reads %rax, so the register
+            // allocator would otherwise be free to put it there.
+            auto multiply_high = [&](u64 m) {
+                auto multiplier = MOperandRegister{mod->next_vreg(), 64};
+                emit(Opcode::Move, imm(m), multiplier);
+                emit(Opcode::Move, x, rax);
+                auto mul = MInst(usz(is_signed ? Opcode::SignedMultiplyWide : Opcode::UnsignedMultiplyWide), {0, 0});
+                mul.add_operand(multiplier);
+                mul.add_register_clobber(+RegisterId::RAX);
+                mul.add_register_clobber(+RegisterId::RDX);
+                lowered.push_back(mul);
+                emit(Opcode::Move, rdx, q);
+            };
+
+            if (is_signed) {
+                // q = (mulhs(x, m) [+/- x]) sar s; q += q < 0
+                auto [m, s] = x86_64_signed_division_magic(i64(d));
+                multiply_high(m);
+                if (i64(d) > 0 and i64(m) < 0) emit(Opcode::Add, x, q);
+                if (i64(d) < 0 and i64(m) > 0) emit(Opcode::Sub, x, q);
+                if (s) emit(Opcode::ShiftRightArithmetic, MOperandImmediate{s, 8}, q);
+                auto sign = MOperandRegister{mod->next_vreg(), 64};
+                emit(Opcode::Move, q, sign);
+                emit(Opcode::ShiftRightLogical, MOperandImmediate{63, 8}, sign);
+                emit(Opcode::Add, sign, q);
+            } else {
+                // t = mulhu(x, m); q = t shr s, or with the add-back,
+                // q = (((x - t) shr 1) + t) shr (s - 1)
+                auto [m, s, add] = x86_64_unsigned_division_magic(d);
+                multiply_high(m);
+                if (add) {
+                    auto sum = MOperandRegister{mod->next_vreg(), 64};
+                    emit(Opcode::Move, x, sum);
+                    emit(Opcode::Sub, q, sum);
+                    emit(Opcode::ShiftRightLogical, MOperandImmediate{1, 8}, sum);
+                    emit(Opcode::Add, q, sum);
+                    emit(Opcode::Move, sum, q);
+                    --s;
+                }
+                if (s) emit(Opcode::ShiftRightLogical, MOperandImmediate{s, 8}, q);
+            }
+
+            if (is_remainder) {
+                auto product = mod->next_vreg();
+                auto mul = MInst(MInst::Kind::Mul, {product, 64});
+                mul.add_operand(imm(d));
+                mul.add_operand(q);
+                lowered.push_back(mul);
+
+                auto sub = MInst(MInst::Kind::Sub, {inst.reg(), 64});
+                sub.add_operand(x);
+                sub.add_operand(MOperandRegister{product, 64});
+                lowered.push_back(sub);
+            }
+        }
+
+        instructions = std::move(lowered);
+    }
+}
+
+/// Divide bytes as 32-bit integers.
+///
+/// A byte divide takes its dividend from all of %ax and leaves the
+/// remainder in %ah, which doesn't fit the patterns for the other
+/// sizes, where the high half of the dividend and the remainder are in
+/// %rdx. So extend both operands to 32 bits, divide those, and use the
+/// low byte of the result:
+///
+/// r2.8 | M.SDiv r0.8, r1.8
+/// becomes the following machine code, GNU syntax
+///     movsx %r0.8, %r3.32
+///     movsx %r1.8, %r4.32
+///     r5.32 | M.SDiv r3.32, r4.32
+///     mov %r5.8, %r2.8
+static void x86_64_widen_byte_division(Module* mod, MFunction& function) {
+    using x86_64::Opcode;
+
+    for (auto& block : function.blocks()) {
+        auto& instructions = block.instructions();
+        std::vector<MInst> lowered{};
+        lowered.reserve(instructions.size());
+        for (auto& inst : instructions) {
+            const bool is_signed = inst.kind() == MInst::Kind::SDiv or inst.kind() == MInst::Kind::SRem;
+            if (
+                not (is_signed or inst.kind() == MInst::Kind::UDiv or inst.kind() == MInst::Kind::URem)
+                or inst.regsize() != 8
+                or inst.regcategory() == +Register::Category::FLOAT
+            ) {
+                lowered.push_back(inst);
+                continue;
+            }
+
+            auto widen = [&](MOperand op) -> MOperand {
+                if (auto* imm = std::get_if<MOperandImmediate>(&op)) {
+                    auto value = is_signed ? u64(i64(i8(imm->value))) : imm->value & 0xff;
+                    return MOperandImmediate{value & 0xffffffff, 32};
+                }
+                auto r = std::get<MOperandRegister>(op);
+                r.defining_use = false;
+                auto wide = MOperandRegister{mod->next_vreg(), 32};
+                auto extend = MInst(usz(is_signed ? Opcode::MoveSignExtended : Opcode::MoveZeroExtended), {0, 0});
+                extend.add_operand(r);
+                extend.add_operand(wide);
+                extend.add_operand_clobber(1);
+                lowered.push_back(extend);
+                return wide;
+            };
+
+            auto wide = MInst(inst.kind(), {mod->next_vreg(), 32});
+            wide.location(inst.location());
+            wide.add_operand(widen(inst.get_operand(0)));
+            wide.add_operand(widen(inst.get_operand(1)));
+            lowered.push_back(wide);
+
+            auto move = MInst(usz(Opcode::Move), {0, 0});
+            move.add_operand(MOperandRegister{wide.reg(), 8});
+            move.add_operand(MOperandRegister{inst.reg(), 8});
+            move.add_operand_clobber(1);
+            lowered.push_back(move);
+        }
+
+        instructions = std::move(lowered);
+    }
+}
+
 void select_instructions(Module* mod, MFunction& function) {
     // Don't selection instructions for empty functions.
     if (function.blocks().empty()) return;
 
     if (mod->context()->target()->is_arch_x86_64()) {
+        x86_64_fuse_compare_and_branch(mod, function);
+        x86_64_lower_select(mod, function);
+        x86_64_fold_addressing_modes(function);
+        x86_64_widen_byte_division(mod, function);
+        x86_64_lower_division_by_constant(mod, function);
+        x86_64_lower_multiply_by_constant(mod, function);
         function = lcc::isel::x86_64::AllPatterns::rewrite(mod, function);
 
         // In-code instruction selection. Ideally, we wouldn't have to do this at
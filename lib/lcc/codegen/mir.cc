@@ -21,7 +21,7 @@ static auto register_category_fmt(Register::Category category) -> std::string {
 [[nodiscard]]
 auto PrintMOperand(const MOperand& op) -> std::string {
     static_assert(
-        std::variant_size_v<MOperand> == 6,
+        std::variant_size_v<MOperand> == 7,
         "Exhaustive handling of MOperand alternatives in debug printing"
     );
     if (std::holds_alternative<MOperandImmediate>(op)) {
@@ -54,6 +54,14 @@ auto PrintMOperand(const MOperand& op) -> std::string {
         return fmt::format("function({})", std::get<MOperandFunction>(op)->names().at(0).name);
     if (std::holds_alternative<MOperandBlock>(op))
         return fmt::format("block({})", std::get<MOperandBlock>(op)->name());
+    if (std::holds_alternative<MOperandMemory>(op)) {
+        // Looks like "mem(r1.64+r2.64*4+8)"
+        auto m = std::get<MOperandMemory>(op);
+        auto index = m.index.value
+                       ? fmt::format("+r{}.{}*{}", m.index.value, m.index.size, m.scale)
+                       : std::string{};
+        return fmt::format("mem(r{}.{}{}{:+})", m.base.value, m.base.size, index, m.displacement);
+    }
     return "<?>";
 }
 
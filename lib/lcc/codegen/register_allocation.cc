@@ -28,6 +28,19 @@ namespace lcc {
 
 constexpr bool RA_PRINT = false;
 
+/// Call `f` with every register an operand reads or writes: the operand
+/// itself if it is a register, or the base and index of a memory operand.
+template <typename Operand, typename Callback>
+void for_each_register(Operand& op, Callback f) {
+    if (std::holds_alternative<MOperandRegister>(op)) {
+        f(std::get<MOperandRegister>(op));
+    } else if (std::holds_alternative<MOperandMemory>(op)) {
+        auto& m = std::get<MOperandMemory>(op);
+        f(m.base);
+        if (m.index.value) f(m.index);
+    }
+}
+
 struct AdjacencyList {
     // List of live indices that interfere with this->value.
     std::vector<usz> adjacencies{};
@@ -83,6 +96,11 @@ struct AdjacencyMatrix {
     const std::vector<Register>& registers;
     std::vector<AdjacencyList> lists{};
 
+    // Hardware registers that virtual registers may be colored with; these
+    // are tracked as live values wherever they hold a value that is read
+    // later (e.g. a parameter).
+    std::vector<usz> allocatable{};
+
     std::unordered_map<usz, usz> _register_id_to_live_index{};
 
     // Find the list with a register value matching the given register id.
@@ -190,6 +208,54 @@ void remove_defining(std::vector<usz>& live_values, const MInst& inst) {
     }
 }
 
+// A hardware register is live from where it is read back to where it is
+// written; a parameter is never written, so it is live from the entry of
+// the function until its last use.
+void remove_written_hardware_registers(std::vector<usz>& live_values, const MInst& inst) {
+    for (auto index : inst.operand_clobbers()) {
+        auto op = inst.get_operand(index);
+        if (not std::holds_alternative<MOperandRegister>(op)) continue;
+        auto reg = std::get<MOperandRegister>(op);
+        if (reg.value < +Module::first_virtual_register)
+            std::erase(live_values, reg.value);
+    }
+
+    for (auto r_id : inst.register_clobbers())
+        std::erase(live_values, r_id);
+}
+
+void record_read_hardware_registers(
+    const AdjacencyMatrix& matrix,
+    const MInst& inst,
+    std::vector<usz>& live_values
+) {
+    // A hardware register that the instruction also overwrites is not
+    // read by it: the only such instruction is one zeroing the register
+    // (i.e. xor of the register with itself).
+    std::vector<usz> written{};
+    for (auto index : inst.operand_clobbers()) {
+        auto op = inst.get_operand(index);
+        if (std::holds_alternative<MOperandRegister>(op))
+            written.push_back(std::get<MOperandRegister>(op).value);
+    }
+
+    for (auto [index, op] : vws::enumerate(inst.all_operands())) {
+        if (
+            std::holds_alternative<MOperandRegister>(op)
+            and rgs::contains(inst.operand_clobbers(), usz(index))
+        ) continue;
+
+        for_each_register(op, [&](const Register& reg) {
+            if (
+                reg.value < +Module::first_virtual_register
+                and rgs::contains(matrix.allocatable, reg.value)
+                and not rgs::contains(written, reg.value)
+                and not rgs::contains(live_values, reg.value)
+            ) live_values.push_back(reg.value);
+        });
+    }
+}
+
 void matrix_set_clobbers(
     AdjacencyMatrix& matrix,
     const std::vector<usz>& live_values,
@@ -258,11 +324,10 @@ void collect_vreg_operands(
         );
     }
     for (auto& op : inst.all_operands()) {
-        if (std::holds_alternative<MOperandRegister>(op)) {
-            auto reg = std::get<MOperandRegister>(op);
+        for_each_register(op, [&](const Register& reg) {
             if (reg.value >= +Module::first_virtual_register)
                 into.push_back({reg, matrix.live_index(reg.value)});
-        }
+        });
     }
 }
 
@@ -327,6 +392,7 @@ void collect_interferences_from_instruction(
     // If the defining use of a virtual register is an operand of this
     // instruction, remove it from live values.
     remove_defining(live_values, inst);
+    remove_written_hardware_registers(live_values, inst);
 
     // fmt::print("live during: {}\n", fmt::join(live_values, ", "));
 
@@ -423,6 +489,7 @@ void collect_interferences_from_instruction(
     // If a virtual register is not live and is seen as an operand, it is
     // added to the vector of live values.
     record_newly_live_values(vreg_operands, inst, live_values);
+    record_read_hardware_registers(matrix, inst, live_values);
 
     if constexpr (RA_PRINT)
         fmt::print("live before: {}\n", fmt::join(live_values, ", "));
@@ -553,14 +620,14 @@ bool instruction_references_register_id(const MInst& inst, usz register_id) {
     if (inst.reg() == register_id)
         return true;
 
+    bool referenced{false};
     for (auto& op : inst.all_operands()) {
-        if (
-            std::holds_alternative<MOperandRegister>(op)
-            and std::get<MOperandRegister>(op).value == register_id
-        ) return true;
+        for_each_register(op, [&](const Register& reg) {
+            if (reg.value == register_id) referenced = true;
+        });
     }
 
-    return false;
+    return referenced;
 }
 
 void insert_spill_unspill(
@@ -666,11 +733,10 @@ void insert_spill_unspill(
                     inst.reg(new_vreg);
 
                 for (auto& op : inst.all_operands()) {
-                    if (std::holds_alternative<MOperandRegister>(op)) {
-                        auto& r = std::get<MOperandRegister>(op);
+                    for_each_register(op, [&](Register& r) {
                         if (r.value == to_spill.value)
                             r.value = new_vreg;
-                    }
+                    });
                 }
             }
 
@@ -774,13 +840,10 @@ auto allocate_registers(
 
             // Replace return register in register operands.
             for (auto& op : inst.all_operands()) {
-                if (std::holds_alternative<MOperandRegister>(op)) {
-                    MOperandRegister reg = std::get<MOperandRegister>(op);
-                    if (reg.value == desc.return_register_to_replace) {
+                for_each_register(op, [&](Register& reg) {
+                    if (reg.value == desc.return_register_to_replace)
                         reg.value = return_register_by_category(+reg.category);
-                        op = reg;
-                    }
-                }
+                });
             }
 
             // Replace return register in register clobbers.
@@ -836,10 +899,9 @@ auto allocate_registers(
             for (auto& inst : block.instructions()) {
                 add_reg(inst.reg(), inst.regsize(), inst.regcategory());
                 for (auto& op : inst.all_operands()) {
-                    if (std::holds_alternative<MOperandRegister>(op)) {
-                        MOperandRegister reg = std::get<MOperandRegister>(op);
+                    for_each_register(op, [&](const Register& reg) {
                         add_reg(reg.value, reg.size, +reg.category);
-                    }
+                    });
                 }
             }
         }
@@ -851,6 +913,8 @@ auto allocate_registers(
     // We walk in reverse because of how control flow tends to work; a single
     // vreg may have multiple defining uses in different predecessor blocks.
     AdjacencyMatrix matrix{registers};
+    for (const auto& [register_category, register_list] : desc.registers)
+        matrix.allocatable.insert(matrix.allocatable.end(), register_list.begin(), register_list.end());
 
     // Collect the interferences into the matrix by walking CFG in reverse.
     collect_interferences(matrix, function);
@@ -883,6 +947,28 @@ auto allocate_registers(
     }
     // fmt::print("Color Assignment Ordering (Live Index): {}\n", fmt::join(coloring_stack, ", "));
 
+    // A virtual register defined by reading a hardware register (i.e. the
+    // copy of a parameter out of its argument register) prefers to be
+    // colored with that hardware register, so the copy becomes a move of a
+    // register into itself, which is never emitted.
+    std::unordered_map<usz, usz> preferred_colors{};
+    for (auto& block : function.blocks()) {
+        for (auto& inst : block.instructions()) {
+            if (
+                not inst.is_defining()
+                or inst.reg() < +Module::first_virtual_register
+                or inst.all_operands().empty()
+                or not std::holds_alternative<MOperandRegister>(inst.all_operands().at(0))
+            ) continue;
+
+            auto source = std::get<MOperandRegister>(inst.all_operands().at(0));
+            if (
+                source.value < +Module::first_virtual_register
+                and rgs::contains(matrix.allocatable, source.value)
+            ) preferred_colors.emplace(inst.reg(), source.value);
+        }
+    }
+
     // STEP FOUR
     // Use coloring stack to assign hardware registers (colors) to virtual
     // registers, ensuring no overlap (interferences/adjacencies).
@@ -896,7 +982,14 @@ auto allocate_registers(
         // Each register id here will be within the correct category, and so
         // should be a viable candidate for us to color this list with;
         // we just have to make sure they don't otherwise interfere.
-        for (auto register_id : register_set) {
+        std::vector<usz> candidates{};
+        if (
+            auto preferred = preferred_colors.find(list.register_value);
+            preferred != preferred_colors.end()
+            and rgs::contains(register_set, preferred->second)
+        ) candidates.push_back(preferred->second);
+        candidates.insert(candidates.end(), register_set.begin(), register_set.end());
+        for (auto register_id : candidates) {
             bool adjacent{false};
             // If a single hardware register makes it through every adjacency without
             // finding one that is already coloured, and specifically coloured with
@@ -988,11 +1081,10 @@ auto allocate_registers(
             }
 
             for (auto& op : instruction.all_operands()) {
-                if (std::holds_alternative<MOperandRegister>(op)) {
-                    auto& reg = std::get<MOperandRegister>(op);
+                for_each_register(op, [&](Register& reg) {
                     if (reg.value >= +Module::first_virtual_register)
                         reg.value = matrix.list_by_register_id(reg.value).color;
-                }
+                });
             }
         }
     }
@@ -1004,6 +1096,9 @@ auto allocate_registers(
         for (usz inst_i = 0; inst_i < block.instructions().size(); ++inst_i) {
             Register result_register{};
             usz current_i = inst_i;
+            // Instructions between the call and its unspills (the copy out of the
+            // return register, if any).
+            usz result_copies{0};
             {
                 auto& inst = block.instructions().at(inst_i);
 
@@ -1043,9 +1138,16 @@ auto allocate_registers(
                 // the result register itself).
 
                 // Skip result register (otherwise we'd clobber our function result out of
-                // existence).
+                // existence). A result wider than a register (e.g. a struct returned in
+                // %rax:%rdx) occupies the return registers following the first, too.
                 if (r == result_register.value)
                     continue;
+                if (result_register.value and result_register.size > 64) {
+                    const auto& returns = desc.return_registers.at((usz) result_register.category);
+                    auto parts = std::min<usz>((result_register.size + 63) / 64, returns.size());
+                    if (rgs::contains(returns | vws::take(parts), r))
+                        continue;
+                }
 
                 // TODO: Is this slot okay? Should it be unique per call site?
                 auto spill_slot = r;
@@ -1072,8 +1174,9 @@ auto allocate_registers(
                 ++current_i; // inserting before moves up current instruction
                 ++inst_i;
 
-                // Don't clobber the result register out of existence by unspilling...
-                if (result_register.value) {
+                // Don't clobber the result register out of existence by unspilling;
+                // copy it out of the return register before anything is unspilled.
+                if (result_register.value and not result_copies) {
                     auto return_register = return_register_by_category((usz) result_register.category);
                     if (result_register.value != return_register) {
                         auto move = MInst(
@@ -1090,6 +1193,7 @@ auto allocate_registers(
                             move
                         );
                         ++inst_i;
+                        result_copies = 1;
                     }
                 }
 
@@ -1106,9 +1210,9 @@ auto allocate_registers(
                 // Slot
                 unspill.add_operand(MOperandImmediate(spill_slot));
 
-                // Inserting unspill instruction after index 'inst_i'
+                // Inserting unspill instruction after the call and the copy of its result.
                 block.instructions().insert(
-                    block.instructions().begin() + (isz) current_i + 1,
+                    block.instructions().begin() + (isz) (current_i + 1 + result_copies),
                     unspill
                 );
                 // NOTE: inserting after does *not* move up current instruction.
@@ -13,6 +13,9 @@
 #include <lcc/ir/core.hh>
 #include <lcc/target.hh>
 #include <lcc/utils.hh>
+#include <lcc/utils/macros.hh>
+#include <lcc/utils/output_buffer.hh>
+#include <lcc/utils/thread_pool.hh>
 #include <lcc/version.hh>
 
 #include <lccbase/context.hh>
@@ -23,12 +26,14 @@
 #include <fmt/ranges.h>
 
 #include <algorithm>
+#include <cstdio>
 #include <filesystem>
 #include <functional>
 #include <ranges>
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 #include <variant>
 #include <vector>
 
@@ -38,10 +43,10 @@ namespace {
 
 static constexpr auto comment_begin = ";#";
 
-auto comment(std::string_view in) {
+void comment(OutputBuffer& out, std::string_view in) {
     while (in.ends_with('\n'))
         in.remove_suffix(1);
-    return fmt::format("{} {}\n", comment_begin, in);
+    out.print("{} {}\n", comment_begin, in);
 }
 
 // NOTE: Does not handle empty string (because we want every input of this
@@ -73,53 +78,69 @@ std::string gnu_mnemonic(Opcode opcode) {
 
 } // namespace
 
-// FIXME: ToString is a bad name for this!
-auto ToString(MFunction& function, MOperand op) -> std::string {
+/// Write an operand directly to the output.
+void emit_operand(OutputBuffer& out, MFunction& function, const MOperand& op) {
     static_assert(
-        std::variant_size_v<MOperand> == 6,
+        std::variant_size_v<MOperand> == 7,
         "Exhaustive handling of MOperand alternatives in x86_64 GNU Assembly backend"
     );
     if (std::holds_alternative<MOperandRegister>(op)) {
         // TODO: Assert that register id is one of the x86_64 register ids...
         MOperandRegister reg = std::get<MOperandRegister>(op);
-        return fmt::format(
+        out.print(
             "%{}",
             ToString(RegisterId(reg.value), reg.size)
         );
+        return;
     }
     if (std::holds_alternative<MOperandImmediate>(op)) {
-        return fmt::format(
+        out.print(
             "${}",
             std::get<MOperandImmediate>(op).value
         );
+        return;
     }
     if (std::holds_alternative<MOperandLocal>(op)) {
-        return fmt::format(
+        out.print(
             "{}(%rbp)",
             function.local_offset(std::get<MOperandLocal>(op))
         );
+        return;
     }
     if (std::holds_alternative<MOperandGlobal>(op)) {
-        return fmt::format(
+        out.print(
             "{}(%rip)",
             safe_name(std::get<MOperandGlobal>(op)->names().at(0).name)
         );
+        return;
     }
     if (std::holds_alternative<MOperandFunction>(op)) {
-        return fmt::format(
-            "{}",
-            std::get<MOperandFunction>(op)->names().at(0).name
-        );
+        out.write(std::get<MOperandFunction>(op)->names().at(0).name);
+        return;
     }
     if (std::holds_alternative<MOperandBlock>(op)) {
-        return fmt::format(
-            "{}",
-            block_name(std::get<MOperandBlock>(op)->name())
-        );
+        out.write(block_name(std::get<MOperandBlock>(op)->name()));
+        return;
+    }
+    if (std::holds_alternative<MOperandMemory>(op)) {
+        // disp(%base,%index,scale)
+        auto m = std::get<MOperandMemory>(op);
+        if (m.displacement) out.print("{}", m.displacement);
+        out.print("(%{}", ToString(RegisterId(m.base.value), 64));
+        if (m.index.value) out.print(",%{},{}", ToString(RegisterId(m.index.value), 64), m.scale);
+        out.write(')');
+        return;
     }
     LCC_ASSERT(false, "Unhandled MOperand kind (index {})", op.index());
 }
 
+// FIXME: ToString is a bad name for this!
+auto ToString(MFunction& function, MOperand op) -> std::string {
+    OutputBuffer out{};
+    emit_operand(out, function, op);
+    return out.take();
+}
+
 enum class StackFrameKind {
     Generate,
     Inherit,
@@ -128,24 +149,25 @@ enum class StackFrameKind {
 };
 
 // Function Header
-void emit_stack_frame_entry(std::string& out, StackFrameKind k) {
+void emit_stack_frame_entry(OutputBuffer& out, StackFrameKind k) {
     switch (k) {
         // push base pointer
         // mov stack pointer to base pointer
         case StackFrameKind::Generate:
-            out += "    push %rbp\n";
+            out.write("    push %rbp\n");
 
             // Update CFA offset, as we now have changed the stack pointer (by 8).
             // `.cfi_def_cfa_offset` updates CFA offset to new expression, but not register.
             // `.cfi_offset` notifies saved register rbp location from CFA.
-            out +=
+            out.write(
                 "    .cfi_def_cfa_offset 16\n"
-                "    .cfi_offset %rbp, -16\n";
+                "    .cfi_offset %rbp, -16\n"
+            );
 
-            out += "    mov %rsp, %rbp\n";
+            out.write("    mov %rsp, %rbp\n");
 
             // Update CFA register, as we now have stored the value of RSP in RBP.
-            out += "    .cfi_def_cfa_register %rbp\n";
+            out.write("    .cfi_def_cfa_register %rbp\n");
 
             return;
 
@@ -158,17 +180,18 @@ void emit_stack_frame_entry(std::string& out, StackFrameKind k) {
 }
 
 // Function Footer
-void emit_stack_frame_exit(std::string& out, StackFrameKind k) {
+void emit_stack_frame_exit(OutputBuffer& out, StackFrameKind k) {
     switch (k) {
         // mov base pointer to stack pointer
         // pop base pointer
         case StackFrameKind::Generate:
-            out +=
+            out.write(
                 "    mov %rbp, %rsp\n"
-                "    pop %rbp\n";
+                "    pop %rbp\n"
+            );
 
             // Update CFA expression since 16(%rbp) is no longer accurate.
-            out += "    .cfi_def_cfa %rsp, 8\n";
+            out.write("    .cfi_def_cfa %rsp, 8\n");
             return;
 
         case StackFrameKind::Inherit:
@@ -185,538 +208,639 @@ bool operand_is_float(MOperand& op) {
                == Register::Category::FLOAT;
 }
 
-void emit_gnu_att_assembly(
-    const fs::path& output_path,
-    Module* module,
-    const MachineDescription& desc,
-    std::vector<MFunction>& mir
-) {
-    LCC_ASSERT(module and module->context());
-
-    std::string out{};
+/// Size of the locals of a function in its stack frame, in bytes.
+auto frame_locals_size(const MFunction& function) -> usz {
+    usz size = rgs::fold_left(
+        vws::transform(function.locals(), [](AllocaInst* l) {
+            return l->allocated_type()->bytes();
+        }),
+        0,
+        std::plus{}
+    );
 
-    // If we ever add optional location information to the MIR (and some
-    // eventually trickles through), this would allow somebody to step through
-    // the source in a debugger like gdb.
-    for (const auto& f : module->context()->files()) {
-        out += fmt::format(
-            "    .file {} \"{}\"\n",
-            f->file_id(),
-            fs::absolute(f->path()).string()
-        );
+    if (size) {
+        constexpr usz alignment = 16;
+        size = utils::AlignTo(size, alignment);
     }
+    return size;
+}
 
-    // Exported globals need to be visible to external programs; we use the
-    // .globl (global) directive for this.
-    // Imported globals /could/ be declared with .extern, but GNU as ignores
-    // these directives anyway, so we just don't emit them.
-    for (auto& var : module->vars()) {
-        for (auto n : var->names()) {
-            if (IsExportedLinkage(n.linkage)) {
-                out += fmt::format("    .globl {}\n", n.name);
-                if (not module->context()->target()->is_platform_windows()) {
-                    // ELF-style symbol definition
-                    out += fmt::format(
-                        "    .type {},@object\n"
-                        "    .size {},{}\n",
-                        n.name,
-                        n.name,
-                        var->allocated_type()->bytes()
-                    );
-                }
-            }
-        }
-    }
+/// The stack frame of a function: its locals, followed by a slot for
+/// each spilled register.
+struct FrameLayout {
+    /// Size of the whole frame in bytes, aligned such that %rsp stays
+    /// 16-byte aligned.
+    usz size{};
 
-    for (auto& function : mir) {
-        bool imported{false};
+    /// Spill ID -> offset of its slot below %rbp.
+    std::unordered_map<usz, usz> spill_offsets{};
 
-        for (auto n : function.names()) {
-            // From GNU as manual: `.extern` is accepted in the source program--for
-            // compatibility with other assemblers--but it is ignored. `as` treats all
-            // undefined symbols as external.
-            if (IsExportedLinkage(n.linkage)) {
-                out += fmt::format("    .globl {}\n", n.name);
-                // ELF-style
-                if (not module->context()->target()->is_platform_windows())
-                    out += fmt::format("    .type {},@function\n", n.name);
-            }
+    /// Spill ID -> register spilled into that slot.
+    std::unordered_map<usz, MOperandRegister> spill_registers{};
+};
 
-            if (IsImportedLinkage(n.linkage))
-                imported = true;
+auto frame_layout(const MFunction& function) -> FrameLayout {
+    FrameLayout frame{};
+    frame.size = frame_locals_size(function);
+
+    // Each spilled register gets a slot of its own.
+    // TODO: These lists are so small, vectors would improve performance
+    // simply due to cache locality and memory footprint.
+    for (auto& block : function.blocks()) {
+        for (auto& instruction : block.instructions()) {
+            if (instruction.opcode() != +MInst::Kind::Spill) continue;
+            auto& r = std::get<MOperandRegister>(instruction.all_operands().at(0));
+            auto i = std::get<MOperandImmediate>(instruction.all_operands().at(1));
+
+            // Unique spills only
+            if (frame.spill_offsets.contains(i.value)) continue;
+
+            LCC_ASSERT(r.size % 8 == 0, "Invalid spilled register size");
+            frame.size += r.size / 8;
+            frame.spill_offsets[i.value] = frame.size;
+            frame.spill_registers[i.value] = r;
         }
-        if (imported) continue;
+    }
 
-        for (auto n : function.names())
-            out += fmt::format("{}:\n", safe_name(n.name));
+    if (frame.size) {
+        constexpr usz alignment = 16;
+        frame.size = utils::AlignTo(frame.size, alignment);
+    }
+    return frame;
+}
 
-        // READABILITY: Comments to denote locals and their offsets.
-        if (function.locals().size()) {
-            out += comment("Locals:");
-            for (auto [i, l] : vws::enumerate(function.locals())) {
-                out += comment(
-                    fmt::format(
-                        "{}, {}(%rbp): {} ({} size, {} align)",
-                        i,
-                        function.local_offset(MOperandLocal{(u32) i, 0}),
-                        l->allocated_type()->string(false),
-                        l->allocated_type()->bytes(),
-                        l->allocated_type()->align_bytes()
-                    )
-                );
-            }
+auto frame_size(const MFunction& function) -> usz {
+    return frame_layout(function).size;
+}
+
+/// Emit the assembly for a single function. Functions are independent of
+/// each other once registers are allocated, so this may be called on
+/// several functions in parallel.
+void emit_function(OutputBuffer& out, Module* module, MFunction& function) {
+    bool imported{false};
+
+    for (auto n : function.names()) {
+        // From GNU as manual: `.extern` is accepted in the source program--for
+        // compatibility with other assemblers--but it is ignored. `as` treats all
+        // undefined symbols as external.
+        if (IsExportedLinkage(n.linkage)) {
+            out.print("    .globl {}\n", n.name);
+            // ELF-style
+            if (not module->context()->target()->is_platform_windows())
+                out.print("    .type {},@function\n", n.name);
         }
 
-        // Keep in mind that debug lines are 1-indexed.
-        //   .loc <file-id> <line-number> [ <column-number> ]
-        if (function.location().seekable(module->context())) {
-            auto l = function.location().seek_line_column(module->context());
-            out += fmt::format(
-                "    .loc {} {} {}\n",
-                function.location().file_id,
-                l.line,
-                l.col
+        if (IsImportedLinkage(n.linkage))
+            imported = true;
+    }
+    if (imported) return;
+
+    for (auto n : function.names())
+        out.print("{}:\n", safe_name(n.name));
+
+    // READABILITY: Comments to denote locals and their offsets.
+    if (function.locals().size()) {
+        comment(out, "Locals:");
+        for (auto [i, l] : vws::enumerate(function.locals())) {
+            comment(
+                out,
+                fmt::format(
+                    "{}, {}(%rbp): {} ({} size, {} align)",
+                    i,
+                    function.local_offset(MOperandLocal{(u32) i, 0}),
+                    l->allocated_type()->string(false),
+                    l->allocated_type()->bytes(),
+                    l->allocated_type()->align_bytes()
+                )
             );
         }
+    }
 
-        // CFA (CIE starts it as %rsp+8)
-        out += "    .cfi_startproc\n";
-
-        // Calculate stack frame size; this is the sum of the size of all locals
-        // and the size of all spilled registers.
-
-        // Sum locals sizes
-        usz stack_frame_size = rgs::fold_left(
-            vws::transform(function.locals(), [](AllocaInst* l) {
-                return l->allocated_type()->bytes();
-            }),
-            0,
-            std::plus{}
+    // Keep in mind that debug lines are 1-indexed.
+    //   .loc <file-id> <line-number> [ <column-number> ]
+    if (function.location().seekable(module->context())) {
+        auto l = function.location().seek_line_column(module->context());
+        out.print(
+            "    .loc {} {} {}\n",
+            function.location().file_id,
+            l.line,
+            l.col
         );
+    }
 
-        if (stack_frame_size) {
-            constexpr usz alignment = 16;
-            stack_frame_size = utils::AlignTo(stack_frame_size, alignment);
+    // CFA (CIE starts it as %rsp+8)
+    out.write("    .cfi_startproc\n");
+
+    // Calculate stack frame size; this is the sum of the size of all locals
+    // and the size of all spilled registers, keeping track of the latter's
+    // frame offsets.
+    auto frame = frame_layout(function);
+    auto& spill_offsets = frame.spill_offsets;
+
+    auto frame_kind = StackFrameKind::Inherit;
+    if (frame.size)
+        frame_kind = StackFrameKind::Generate;
+
+    // READABILITY: Comments to denote spilled registers and their offsets.
+    if (spill_offsets.size()) {
+        comment(out, "Spilled Registers:");
+        for (auto [id, offset] : spill_offsets) {
+            if (frame.spill_registers.contains(id)) {
+                auto r = frame.spill_registers.at(id);
+                comment(
+                    out,
+                    fmt::format(
+                        "ID {}, %{}, -{}(%rbp)",
+                        id,
+                        ToString((RegisterId) r.value, r.size),
+                        offset
+                    )
+                );
+            } else comment(out, fmt::format("ID {}, -{}(%rbp)\n", id, offset));
         }
+    }
 
-        // Sum spilled registers' sizes, keeping track of their frame offsets.
-        // TODO: These lists are so small, vectors would improve performance
-        // simply due to cache locality and memory footprint.
-        std::unordered_map<usz, usz> spill_offsets{};
-        std::unordered_map<usz, MOperandRegister> spill_id_to_register{};
-        for (auto& block : function.blocks()) {
-            for (auto& instruction : block.instructions()) {
-                if (instruction.opcode() == +MInst::Kind::Spill) {
-                    auto& r = std::get<MOperandRegister>(
-                        instruction.all_operands().at(0)
-                    );
-                    auto i = std::get<MOperandImmediate>(
-                        instruction.all_operands().at(1)
-                    );
-
-                    // Unique spills only
-                    if (spill_offsets.contains(i.value))
-                        continue;
+    emit_stack_frame_entry(out, frame_kind);
+
+    if (frame.size)
+        out.print("    sub ${}, %rsp\n", frame.size);
+
+    Location last_location{};
+    for (auto [block_index, block] : vws::enumerate(function.blocks())) {
+        out.print("{}:\n", block_name(block.name()));
+
+        for (auto& instruction : block.instructions()) {
+            // ================================
+            // QUICK PATH OPTIMISATION (don't move a register into itself)
+            // ================================
+            // Sometimes, the compiler can seem kind of dumb, as it produces
+            // instructions that actually don't do anything. In this case, the
+            // compiler converts virtual registers to hardware ones, sometimes the
+            // same hardware ones, and the moves between virtual registers become
+            // moves between the same register, effectively doing nothing.
+            // Since these instructions do nothing, we just don't emit them.
+            if (
+                (instruction.opcode() == +x86_64::Opcode::Move
+                 or instruction.opcode() == +x86_64::Opcode::ScalarFloatMove)
+                and is_reg_reg(instruction)
+            ) {
+                auto [lhs, rhs] = extract_reg_reg(instruction);
+                if (lhs.value == rhs.value)
+                    continue;
+            }
 
-                    LCC_ASSERT(
-                        r.size % 8 == 0,
-                        "Invalid spilled register size"
-                    );
-                    stack_frame_size += r.size / 8;
-                    spill_offsets[i.value] = stack_frame_size;
+            // ================================
+            // QUICK PATH OPTIMISATION (simple jump threading)
+            // ================================
+            if (
+                &block != &function.blocks().back()
+                and instruction.opcode() == +x86_64::Opcode::Jump
+                and is_block(instruction)
+            ) {
+                auto* target_block = extract_block(instruction);
+                auto next_block = function.blocks().at(usz(block_index + 1));
+                if (target_block->name() == next_block.name())
+                    continue;
+            }
 
-                    spill_id_to_register[i.value] = r;
+            // ================================
+            // COPY
+            // ================================
+            if (instruction.opcode() == +MInst::Kind::Copy) {
+                // Move register operand into result register.
+                auto& src = std::get<MOperandRegister>(
+                    instruction.all_operands().at(0)
+                );
+                LCC_ASSERT(src.size % 8 == 0, "Invalid copied source register size");
+
+                auto dst = Register{
+                    instruction.reg(),
+                    (uint) instruction.regsize(),
+                    (Register::Category) instruction.regcategory(),
+                    instruction.is_defining()
+                };
+                LCC_ASSERT(dst.size % 8 == 0, "Invalid copied destination register size");
+
+                auto mnemonic = gnu_mnemonic(Opcode(+x86_64::Opcode::Move));
+                if (src.value >= +x86_64::RegisterId::XMM0) {
+                    if (src.size > 32)
+                        mnemonic += "sd";
+                    else mnemonic += "ss";
                 }
+                out.print(
+                    "    {} {}, {}  {} COPY\n",
+                    mnemonic,
+                    ToString(function, src),
+                    ToString(function, dst),
+                    comment_begin
+                );
+                continue;
+            }
+            // ================================
+            // SPILL
+            // ================================
+            if (instruction.opcode() == +MInst::Kind::Spill) {
+                // Store register operand onto the stack at "spill offset - reg.size"
+                auto& r = std::get<MOperandRegister>(
+                    instruction.all_operands().at(0)
+                );
+                // slot
+                auto i = std::get<MOperandImmediate>(
+                    instruction.all_operands().at(1)
+                );
+                LCC_ASSERT(r.size % 8 == 0, "Invalid spilled register size");
+                auto mnemonic = gnu_mnemonic(Opcode(+x86_64::Opcode::MoveDereferenceRHS));
+                // Append "sd" to mnemonic if saving scalar
+                // FIXME: is_scalar()
+                if (r.value >= +x86_64::RegisterId::XMM0 and r.value <= +x86_64::RegisterId::XMM15)
+                    mnemonic += "sd";
+                out.print(
+                    "    {} {}, -{}(%rbp)  {} SPILL (slot {})\n",
+                    mnemonic,
+                    ToString(function, r),
+                    spill_offsets.at(i.value),
+                    comment_begin,
+                    i.value
+                );
+                continue;
+            }
+            // ================================
+            // UNSPILL
+            // ================================
+            if (instruction.opcode() == +MInst::Kind::Unspill) {
+                // slot
+                auto i = std::get<MOperandImmediate>(
+                    instruction.all_operands().at(0)
+                );
+                // Append "sd" to mnemonic if saving scalar
+                // FIXME: is_scalar()
+                auto mnemonic = gnu_mnemonic(Opcode(+x86_64::Opcode::MoveDereferenceLHS));
+                if (instruction.reg() >= +x86_64::RegisterId::XMM0)
+                    mnemonic += "sd";
+
+                out.print(
+                    "    {} -{}(%rbp), {}  {} UNSPILL (slot {})\n",
+                    mnemonic,
+                    spill_offsets.at(i.value),
+                    ToString(
+                        function,
+                        MOperandRegister(instruction.reg(), (uint) instruction.regsize())
+                    ),
+                    comment_begin,
+                    i.value
+                );
+                continue;
             }
-        }
 
-        auto frame_kind = StackFrameKind::Inherit;
-        if (stack_frame_size)
-            frame_kind = StackFrameKind::Generate;
-
-        // READABILITY: Comments to denote spilled registers and their offsets.
-        if (spill_offsets.size()) {
-            out += comment("Spilled Registers:");
-            for (auto [id, offset] : spill_offsets) {
-                if (spill_id_to_register.contains(id)) {
-                    auto r = spill_id_to_register.at(id);
-                    out += comment(
-                        fmt::format(
-                            "ID {}, %{}, -{}(%rbp)",
-                            id,
-                            ToString((RegisterId) r.value, r.size),
-                            offset
-                        )
+            // ================================
+            // CONFIDENCE CHECK (moves between registers must match sizes)
+            // ================================
+            if (
+                instruction.opcode() == +x86_64::Opcode::Move
+                and is_reg_reg(instruction)
+            ) {
+                auto [lhs, rhs] = extract_reg_reg(instruction);
+                if (lhs.size != rhs.size) {
+                    Diag::ICE(
+                        "Move from register to register has mismatched sizes in basic block {} in function {}",
+                        block.name(),
+                        function.names().at(0).name
                     );
-                } else out += comment(fmt::format("ID {}, -{}(%rbp)\n", id, offset));
+                }
             }
-        }
-
-        emit_stack_frame_entry(out, frame_kind);
-
-        if (stack_frame_size) {
-            constexpr usz alignment = 16;
-            stack_frame_size = utils::AlignTo(stack_frame_size, alignment);
-            out += fmt::format("    sub ${}, %rsp\n", stack_frame_size);
-        }
 
-        Location last_location{};
-        for (auto [block_index, block] : vws::enumerate(function.blocks())) {
-            out += fmt::format("{}:\n", block_name(block.name()));
-
-            for (auto& instruction : block.instructions()) {
-                // ================================
-                // QUICK PATH OPTIMISATION (don't move a register into itself)
-                // ================================
-                // Sometimes, the compiler can seem kind of dumb, as it produces
-                // instructions that actually don't do anything. In this case, the
-                // compiler converts virtual registers to hardware ones, sometimes the
-                // same hardware ones, and the moves between virtual registers become
-                // moves between the same register, effectively doing nothing.
-                // Since these instructions do nothing, we just don't emit them.
-                if (
-                    (instruction.opcode() == +x86_64::Opcode::Move
-                     or instruction.opcode() == +x86_64::Opcode::ScalarFloatMove)
-                    and is_reg_reg(instruction)
-                ) {
-                    auto [lhs, rhs] = extract_reg_reg(instruction);
-                    if (lhs.value == rhs.value)
-                        continue;
+            // ================================
+            // TODO: CFA: Record saved registers
+            // ================================
+            if (
+                instruction.opcode() == +x86_64::Opcode::Push
+                and is_reg(instruction)
+            ) {}
+
+            // ================================
+            // INSTRUCTION FIXUP
+            //   movzx from 32 bit to 64 bit register is just a mov between 32 bit
+            //   registers...
+            // ================================
+            if (
+                instruction.opcode() == +x86_64::Opcode::MoveZeroExtended
+                and is_reg_reg(instruction)
+            ) {
+                auto [lhs, rhs] = extract_reg_reg(instruction);
+                if (lhs.size == 32 and rhs.size == 64) {
+                    instruction.opcode(+x86_64::Opcode::Move);
+                    rhs.size = 32;
+                    instruction.all_operands().at(1) = rhs;
                 }
+            }
 
-                // ================================
-                // QUICK PATH OPTIMISATION (simple jump threading)
-                // ================================
-                if (
-                    &block != &function.blocks().back()
-                    and instruction.opcode() == +x86_64::Opcode::Jump
-                    and is_block(instruction)
-                ) {
-                    auto* target_block = extract_block(instruction);
-                    auto next_block = function.blocks().at(usz(block_index + 1));
-                    if (target_block->name() == next_block.name())
-                        continue;
+            // ================================
+            // INSTRUCTION FIXUP
+            //   There is no movzx into, or imul with an immediate of, a byte
+            //   register; doing it to the 32 bit register leaves the same value
+            //   in the low byte (this is what the object file writer encodes).
+            // ================================
+            if (
+                instruction.opcode() == +x86_64::Opcode::MoveZeroExtended
+                and is_reg_reg(instruction)
+            ) {
+                auto [lhs, rhs] = extract_reg_reg(instruction);
+                if (rhs.size == 8) {
+                    rhs.size = 32;
+                    instruction.all_operands().at(1) = rhs;
                 }
-
-                // ================================
-                // COPY
-                // ================================
-                if (instruction.opcode() == +MInst::Kind::Copy) {
-                    // Move register operand into result register.
-                    auto& src = std::get<MOperandRegister>(
-                        instruction.all_operands().at(0)
-                    );
-                    LCC_ASSERT(src.size % 8 == 0, "Invalid copied source register size");
-
-                    auto dst = Register{
-                        instruction.reg(),
-                        (uint) instruction.regsize(),
-                        (Register::Category) instruction.regcategory(),
-                        instruction.is_defining()
-                    };
-                    LCC_ASSERT(dst.size % 8 == 0, "Invalid copied destination register size");
-
-                    auto mnemonic = gnu_mnemonic(Opcode(+x86_64::Opcode::Move));
-                    if (src.value >= +x86_64::RegisterId::XMM0) {
-                        if (src.size > 32)
-                            mnemonic += "sd";
-                        else mnemonic += "ss";
-                    }
-                    out += fmt::format(
-                        "    {} {}, {}  {} COPY\n",
-                        mnemonic,
-                        ToString(function, src),
-                        ToString(function, dst),
-                        comment_begin
-                    );
-                    continue;
+            }
+            if (
+                instruction.opcode() == +x86_64::Opcode::Multiply
+                and is_imm_reg(instruction)
+            ) {
+                auto [imm, reg] = extract_imm_reg(instruction);
+                if (reg.size == 8) {
+                    reg.size = 32;
+                    instruction.all_operands().at(1) = reg;
                 }
-                // ================================
-                // SPILL
-                // ================================
-                if (instruction.opcode() == +MInst::Kind::Spill) {
-                    // Store register operand onto the stack at "spill offset - reg.size"
-                    auto& r = std::get<MOperandRegister>(
-                        instruction.all_operands().at(0)
-                    );
-                    // slot
-                    auto i = std::get<MOperandImmediate>(
-                        instruction.all_operands().at(1)
+            }
+
+            // Update 1-bit operations (boolean) to the minimum addressable on x86_64: a byte.
+            if (instruction.regsize() == 1) instruction.regsize(8);
+
+            // ================================
+            // INSTRUCTION PROLOGUE (some insts have preceding instructions)
+            // ================================
+            if (instruction.opcode() == +x86_64::Opcode::Return) {
+                emit_stack_frame_exit(out, frame_kind);
+            }
+
+            // ================================
+            // INSTRUCTION DEBUG LOCATION
+            // ================================
+            {
+                auto loc = instruction.location();
+                if (loc.seekable(module->context()) and not loc.equal_position(last_location)) {
+                    auto l = loc.seek_line_column(module->context());
+                    comment(
+                        out,
+                        fmt::format(
+                            "FILE {} ({}), LINE {}, COLUMN {}",
+                            loc.file_id,
+                            fs::absolute(module->context()->file(loc.file_id)->path())
+                                .string(),
+                            l.line,
+                            l.col
+                        )
                     );
-                    LCC_ASSERT(r.size % 8 == 0, "Invalid spilled register size");
-                    auto mnemonic = gnu_mnemonic(Opcode(+x86_64::Opcode::MoveDereferenceRHS));
-                    // Append "sd" to mnemonic if saving scalar
-                    // FIXME: is_scalar()
-                    if (r.value >= +x86_64::RegisterId::XMM0 and r.value <= +x86_64::RegisterId::XMM15)
-                        mnemonic += "sd";
-                    out += fmt::format(
-                        "    {} {}, -{}(%rbp)  {} SPILL (slot {})\n",
-                        mnemonic,
-                        ToString(function, r),
-                        spill_offsets.at(i.value),
-                        comment_begin,
-                        i.value
+                    out.print(
+                        "    .loc {} {} {}\n",
+                        loc.file_id,
+                        l.line,
+                        l.col
                     );
-                    continue;
+                    last_location = loc;
                 }
-                // ================================
-                // UNSPILL
-                // ================================
-                if (instruction.opcode() == +MInst::Kind::Unspill) {
-                    // slot
-                    auto i = std::get<MOperandImmediate>(
-                        instruction.all_operands().at(0)
-                    );
-                    // Append "sd" to mnemonic if saving scalar
-                    // FIXME: is_scalar()
-                    auto mnemonic = gnu_mnemonic(Opcode(+x86_64::Opcode::MoveDereferenceLHS));
-                    if (instruction.reg() >= +x86_64::RegisterId::XMM0)
-                        mnemonic += "sd";
+            }
 
-                    out += fmt::format(
-                        "    {} -{}(%rbp), {}  {} UNSPILL (slot {})\n",
-                        mnemonic,
-                        spill_offsets.at(i.value),
-                        ToString(
-                            function,
-                            MOperandRegister(instruction.reg(), (uint) instruction.regsize())
-                        ),
-                        comment_begin,
-                        i.value
-                    );
-                    continue;
+            // ================================
+            // SIGN-EXTENDED ACCUMULATOR (the mnemonic depends on the size)
+            // ================================
+            if (instruction.opcode() == +x86_64::Opcode::SignExtendAccumulator) {
+                auto size = std::get<MOperandRegister>(instruction.get_operand(0)).size;
+                switch (size) {
+                    default: Diag::ICE("Invalid accumulator sign extension (bitwidth {})", size);
+                    case 64: out.write("    cqto\n"); break;
+                    case 32: out.write("    cltd\n"); break;
+                    case 16: out.write("    cwtd\n"); break;
+                    case 1:
+                    case 8: out.write("    cbtw\n"); break;
                 }
+                continue;
+            }
 
-                // ================================
-                // CONFIDENCE CHECK (moves between registers must match sizes)
-                // ================================
+            // ================================
+            // INSTRUCTION MNEMONIC
+            // ================================
+            out.write("    ");
+            out.write(gnu_mnemonic(Opcode(instruction.opcode())));
+
+            // ================================
+            // CUSTOM INSTRUCTION SUFFIX HANDLING
+            // ================================
+            if (instruction.opcode() == +x86_64::Opcode::MoveDereferenceRHS) {
+                auto lhs = instruction.get_operand(0);
+                auto rhs = instruction.get_operand(1);
                 if (
-                    instruction.opcode() == +x86_64::Opcode::Move
-                    and is_reg_reg(instruction)
+                    std::holds_alternative<MOperandImmediate>(lhs)
+                    and std::holds_alternative<MOperandLocal>(rhs)
                 ) {
-                    auto [lhs, rhs] = extract_reg_reg(instruction);
-                    if (lhs.size != rhs.size) {
-                        Diag::ICE(
-                            "Move from register to register has mismatched sizes in basic block {} in function {}",
-                            block.name(),
-                            function.names().at(0).name
-                        );
+                    // Moving immediate into local (memory) requires mov suffix in GNU.
+
+                    // We use size of immediate to determine how big of a move to do.
+                    auto bitwidth = std::get<MOperandImmediate>(lhs).size;
+                    switch (bitwidth) {
+                        default: LCC_ASSERT(false, "Invalid move (bitwidth {})", bitwidth);
+
+                        case 64: out.write('q'); break;
+                        case 32: out.write('l'); break;
+                        case 16: out.write('w'); break;
+                        case 1:
+                        case 8: out.write('b'); break;
                     }
                 }
+            }
 
-                // ================================
-                // TODO: CFA: Record saved registers
-                // ================================
-                if (
-                    instruction.opcode() == +x86_64::Opcode::Push
-                    and is_reg(instruction)
-                ) {}
-
-                // ================================
-                // INSTRUCTION FIXUP
-                //   movzx from 32 bit to 64 bit register is just a mov between 32 bit
-                //   registers...
-                // ================================
-                if (
-                    instruction.opcode() == +x86_64::Opcode::MoveZeroExtended
-                    and is_reg_reg(instruction)
-                ) {
-                    auto [lhs, rhs] = extract_reg_reg(instruction);
-                    if (lhs.size == 32 and rhs.size == 64) {
-                        instruction.opcode(+x86_64::Opcode::Move);
-                        rhs.size = 32;
-                        instruction.all_operands().at(1) = rhs;
+            // FLOAT: "ss" or "sd" suffix
+            else if (
+                (instruction.opcode() > +x86_64::Opcode::ScalarFloatFENCEBegin
+                 and instruction.opcode() < +x86_64::Opcode::ScalarFloatFENCEEnd)
+                and instruction.all_operands().size() == 2
+            ) {
+                auto lhs = instruction.get_operand(0);
+                auto rhs = instruction.get_operand(1);
+                if (operand_is_float(lhs) or operand_is_float(rhs)) {
+                    usz bitwidth = 0;
+                    if (operand_is_float(lhs))
+                        bitwidth = std::get<MOperandRegister>(lhs).size;
+                    else bitwidth = std::get<MOperandRegister>(rhs).size;
+                    LCC_ASSERT(bitwidth);
+                    switch (bitwidth) {
+                        default:
+                            Diag::ICE(
+                                "Float bitwidths must be 64 or 32 on x86_64..."
+                            );
+                        case 64: out.write('d'); break;
+                        case 32: out.write('s'); break;
                     }
                 }
+            }
 
-                // Update 1-bit operations (boolean) to the minimum addressable on x86_64: a byte.
-                if (instruction.regsize() == 1) instruction.regsize(8);
-
-                // ================================
-                // INSTRUCTION PROLOGUE (some insts have preceding instructions)
-                // ================================
-                if (instruction.opcode() == +x86_64::Opcode::Return) {
-                    emit_stack_frame_exit(out, frame_kind);
+            // ================================
+            // CUSTOM OPERAND HANDLING (dereference register operand on rhs of move)
+            // ================================
+            if (
+                (instruction.opcode() == +x86_64::Opcode::MoveDereferenceRHS
+                 or instruction.opcode() == +x86_64::Opcode::ScalarFloatMoveDereferenceRHS)
+                and std::holds_alternative<MOperandRegister>(instruction.get_operand(1))
+            ) {
+                auto lhs = instruction.get_operand(0);
+                auto rhs = instruction.get_operand(1);
+
+                usz offset = 0;
+                if (instruction.all_operands().size() == 3) {
+                    auto given_offset = instruction.get_operand(2);
+                    LCC_ASSERT(
+                        std::holds_alternative<MOperandImmediate>(given_offset),
+                        "Offset operand of dereferencing move must be an immediate"
+                    );
+                    offset = std::get<MOperandImmediate>(given_offset).value;
                 }
 
-                // ================================
-                // INSTRUCTION DEBUG LOCATION
-                // ================================
-                {
-                    auto loc = instruction.location();
-                    if (loc.seekable(module->context()) and not loc.equal_position(last_location)) {
-                        auto l = loc.seek_line_column(module->context());
-                        out += comment(
-                            fmt::format(
-                                "FILE {} ({}), LINE {}, COLUMN {}",
-                                loc.file_id,
-                                fs::absolute(module->context()->files().at(loc.file_id)->path())
-                                    .string(),
-                                l.line,
-                                l.col
-                            )
-                        );
-                        out += fmt::format(
-                            "    .loc {} {} {}\n",
-                            loc.file_id,
-                            l.line,
-                            l.col
-                        );
-                        last_location = loc;
-                    }
+                if (offset) {
+                    out.print(
+                        " {}, {}({})\n",
+                        ToString(function, lhs),
+                        offset,
+                        ToString(function, rhs)
+                    );
+                } else {
+                    out.print(
+                        " {}, ({})\n",
+                        ToString(function, lhs),
+                        ToString(function, rhs)
+                    );
                 }
+                continue;
+            }
 
-                // ================================
-                // INSTRUCTION MNEMONIC
-                // ================================
-                out += "    ";
-                out += gnu_mnemonic(Opcode(instruction.opcode()));
-
-                // ================================
-                // CUSTOM INSTRUCTION SUFFIX HANDLING
-                // ================================
-                if (instruction.opcode() == +x86_64::Opcode::MoveDereferenceRHS) {
-                    auto lhs = instruction.get_operand(0);
-                    auto rhs = instruction.get_operand(1);
-                    if (
-                        std::holds_alternative<MOperandImmediate>(lhs)
-                        and std::holds_alternative<MOperandLocal>(rhs)
-                    ) {
-                        // Moving immediate into local (memory) requires mov suffix in GNU.
-
-                        // We use size of immediate to determine how big of a move to do.
-                        auto bitwidth = std::get<MOperandImmediate>(lhs).size;
-                        switch (bitwidth) {
-                            default: LCC_ASSERT(false, "Invalid move (bitwidth {})", bitwidth);
-
-                            case 64: out += 'q'; break;
-                            case 32: out += 'l'; break;
-                            case 16: out += 'w'; break;
-                            case 1:
-                            case 8: out += 'b'; break;
-                        }
-                    }
+            // ================================
+            // CUSTOM OPERAND HANDLING (dereference register operand on lhs of move)
+            // ================================
+            if (
+                (instruction.opcode() == +x86_64::Opcode::MoveDereferenceLHS
+                 or instruction.opcode() == +x86_64::Opcode::ScalarFloatMoveDereferenceLHS)
+                and std::holds_alternative<MOperandRegister>(instruction.get_operand(0))
+            ) {
+                auto lhs = instruction.get_operand(0);
+                auto rhs = instruction.get_operand(1);
+                usz offset = 0;
+                if (instruction.all_operands().size() == 3) {
+                    auto given_offset = instruction.get_operand(2);
+                    LCC_ASSERT(
+                        std::holds_alternative<MOperandImmediate>(given_offset),
+                        "Offset operand of dereferencing move must be an immediate"
+                    );
+                    offset = std::get<MOperandImmediate>(given_offset).value;
                 }
+                if (offset)
+                    out.print(" {}({}), {}\n", offset, ToString(function, lhs), ToString(function, rhs));
+                else out.print(" ({}), {}\n", ToString(function, lhs), ToString(function, rhs));
+                continue;
+            }
 
-                // FLOAT: "ss" or "sd" suffix
-                else if (
-                    (instruction.opcode() > +x86_64::Opcode::ScalarFloatFENCEBegin
-                     and instruction.opcode() < +x86_64::Opcode::ScalarFloatFENCEEnd)
-                    and instruction.all_operands().size() == 2
+            // ================================
+            // INSTRUCTION OPERANDS
+            // ================================
+            usz i = 0;
+            for (auto& operand : instruction.all_operands()) {
+                if (i == 0) out.write(' ');
+                else out.write(", ");
+                // Update 1-bit operations (boolean) to the minimum addressable on x86_64: a byte.
+                if (
+                    std::holds_alternative<MOperandRegister>(operand)
+                    and std::get<MOperandRegister>(operand).size == 1
                 ) {
-                    auto lhs = instruction.get_operand(0);
-                    auto rhs = instruction.get_operand(1);
-                    if (operand_is_float(lhs) or operand_is_float(rhs)) {
-                        usz bitwidth = 0;
-                        if (operand_is_float(lhs))
-                            bitwidth = std::get<MOperandRegister>(lhs).size;
-                        else bitwidth = std::get<MOperandRegister>(rhs).size;
-                        LCC_ASSERT(bitwidth);
-                        switch (bitwidth) {
-                            default:
-                                Diag::ICE(
-                                    "Float bitwidths must be 64 or 32 on x86_64..."
-                                );
-                            case 64: out += 'd'; break;
-                            case 32: out += 's'; break;
-                        }
-                    }
+                    auto tmp = std::get<MOperandRegister>(operand);
+                    tmp.size = 8;
+                    operand = tmp;
                 }
+                emit_operand(out, function, operand);
+                ++i;
+            }
+            out.write('\n');
+        }
+    }
 
-                // ================================
-                // CUSTOM OPERAND HANDLING (dereference register operand on rhs of move)
-                // ================================
-                if (
-                    (instruction.opcode() == +x86_64::Opcode::MoveDereferenceRHS
-                     or instruction.opcode() == +x86_64::Opcode::ScalarFloatMoveDereferenceRHS)
-                    and std::holds_alternative<MOperandRegister>(instruction.get_operand(1))
-                ) {
-                    auto lhs = instruction.get_operand(0);
-                    auto rhs = instruction.get_operand(1);
-
-                    usz offset = 0;
-                    if (instruction.all_operands().size() == 3) {
-                        auto given_offset = instruction.get_operand(2);
-                        LCC_ASSERT(
-                            std::holds_alternative<MOperandImmediate>(given_offset),
-                            "Offset operand of dereferencing move must be an immediate"
-                        );
-                        offset = std::get<MOperandImmediate>(given_offset).value;
-                    }
+    out.print("    .cfi_endproc\n");
 
-                    if (offset) {
-                        out += fmt::format(
-                            " {}, {}({})\n",
-                            ToString(function, lhs),
-                            offset,
-                            ToString(function, rhs)
-                        );
-                    } else {
-                        out += fmt::format(
-                            " {}, ({})\n",
-                            ToString(function, lhs),
-                            ToString(function, rhs)
-                        );
-                    }
-                    continue;
-                }
+    for (auto n : function.names()) {
+        if (IsExportedLinkage(n.linkage)) {
+            // ELF-style
+            if (not module->context()->target()->is_platform_windows())
+                out.print("    .size {}, .-{}\n", n.name, n.name);
+        }
+    }
+}
 
-                // ================================
-                // CUSTOM OPERAND HANDLING (dereference register operand on lhs of move)
-                // ================================
-                if (
-                    (instruction.opcode() == +x86_64::Opcode::MoveDereferenceLHS
-                     or instruction.opcode() == +x86_64::Opcode::ScalarFloatMoveDereferenceLHS)
-                    and std::holds_alternative<MOperandRegister>(instruction.get_operand(0))
-                ) {
-                    auto lhs = instruction.get_operand(0);
-                    auto rhs = instruction.get_operand(1);
-                    usz offset = 0;
-                    if (instruction.all_operands().size() == 3) {
-                        auto given_offset = instruction.get_operand(2);
-                        LCC_ASSERT(
-                            std::holds_alternative<MOperandImmediate>(given_offset),
-                            "Offset operand of dereferencing move must be an immediate"
-                        );
-                        offset = std::get<MOperandImmediate>(given_offset).value;
-                    }
-                    if (offset)
-                        out += fmt::format(" {}({}), {}\n", offset, ToString(function, lhs), ToString(function, rhs));
-                    else out += fmt::format(" ({}), {}\n", ToString(function, lhs), ToString(function, rhs));
-                    continue;
-                }
+void emit_gnu_att_assembly(
+    const fs::path& output_path,
+    Module* module,
+    const MachineDescription& desc,
+    std::vector<MFunction>& mir
+) {
+    LCC_ASSERT(module and module->context());
 
-                // ================================
-                // INSTRUCTION OPERANDS
-                // ================================
-                usz i = 0;
-                for (auto& operand : instruction.all_operands()) {
-                    if (i == 0) out += ' ';
-                    else out += ", ";
-                    // Update 1-bit operations (boolean) to the minimum addressable on x86_64: a byte.
-                    if (
-                        std::holds_alternative<MOperandRegister>(operand)
-                        and std::get<MOperandRegister>(operand).size == 1
-                    ) {
-                        auto tmp = std::get<MOperandRegister>(operand);
-                        tmp.size = 8;
-                        operand = tmp;
-                    }
-                    out += ToString(function, operand);
-                    ++i;
+    const bool to_stdout = output_path.empty() or output_path == "-";
+    auto* file = to_stdout ? stdout : File::OpenForWritingOrTerminate(output_path);
+    defer {
+        if (not to_stdout) std::fclose(file);
+    };
+    OutputBuffer out{file};
+
+    // If we ever add optional location information to the MIR (and some
+    // eventually trickles through), this would allow somebody to step through
+    // the source in a debugger like gdb.
+    for (const auto& f : module->context()->files()) {
+        out.print(
+            "    .file {} \"{}\"\n",
+            f->file_id(),
+            fs::absolute(f->path()).string()
+        );
+    }
+
+    // Exported globals need to be visible to external programs; we use the
+    // .globl (global) directive for this.
+    // Imported globals /could/ be declared with .extern, but GNU as ignores
+    // these directives anyway, so we just don't emit them.
+    for (auto& var : module->vars()) {
+        for (auto n : var->names()) {
+            if (IsExportedLinkage(n.linkage)) {
+                out.print("    .globl {}\n", n.name);
+                if (not module->context()->target()->is_platform_windows()) {
+                    // ELF-style symbol definition
+                    out.print(
+                        "    .type {},@object\n"
+                        "    .size {},{}\n",
+                        n.name,
+                        n.name,
+                        var->allocated_type()->bytes()
+                    );
                 }
-                out += '\n';
             }
         }
+    }
 
-        out += fmt::format("    .cfi_endproc\n");
+    // Functions are formatted in parallel on the shared thread pool, one
+    // batch of as many functions as the pool has threads at a time, and
+    // written out in order. Only one batch of text is ever held in memory.
+    auto& pool = utils::ThreadPool::shared();
+    const usz batch_size = pool.size();
+    std::vector<std::string> batch{};
+    for (usz begin = 0; begin < mir.size(); begin += batch_size) {
+        const usz end = std::min(mir.size(), begin + batch_size);
+        if (end - begin == 1) {
+            emit_function(out, module, mir.at(begin));
+            out.maybe_flush();
+            continue;
+        }
 
-        for (auto n : function.names()) {
-            if (IsExportedLinkage(n.linkage)) {
-                // ELF-style
-                if (not module->context()->target()->is_platform_windows())
-                    out += fmt::format("    .size {}, .-{}\n", n.name, n.name);
-            }
+        batch.assign(end - begin, {});
+        pool.for_each_index(end - begin, [&](usz i) {
+            OutputBuffer function_out{};
+            emit_function(function_out, module, mir.at(begin + i));
+            batch[i] = function_out.take();
+        });
+
+        for (auto& text : batch) {
+            out.write(text);
+            out.maybe_flush();
         }
     }
 
@@ -730,10 +854,10 @@ void emit_gnu_att_assembly(
         for (auto n : var->names()) {
             if (not IsImportedLinkage(n.linkage)) {
                 if (not init_vars_present) {
-                    out += "    .section .data\n";
+                    out.write("    .section .data\n");
                     init_vars_present = true;
                 }
-                out += fmt::format("{}:\n", safe_name(n.name));
+                out.print("{}:\n", safe_name(n.name));
                 defines = true;
             }
         }
@@ -757,7 +881,7 @@ void emit_gnu_att_assembly(
 
             case Value::Kind::ArrayConstant: {
                 auto* array_constant = as<ArrayConstant>(var->init());
-                out += fmt::format(
+                out.print(
                     "    .byte {}\n",
                     fmt::join(
                         vws::transform(*array_constant, [&](char c) {
@@ -775,17 +899,17 @@ void emit_gnu_att_assembly(
                     "Oversized integer constant"
                 );
                 // Represent bytes literally
-                out += "    .byte ";
+                out.write("    .byte ");
                 u64 value = integer_constant->value().value();
                 for (usz i = 0; i < integer_constant->type()->bytes(); ++i) {
                     int byte = (value >> (i * 8)) & 0xff;
-                    out += fmt::format("0x{:x}", byte);
+                    out.print("0x{:x}", byte);
                     if (i + 1 < integer_constant->type()->bytes())
-                        out += ", ";
+                        out.write(", ");
                 }
             } break;
         }
-        out += '\n';
+        out.write('\n');
     }
 
     // Emit uninitialized global variable definitions in .bss
@@ -797,13 +921,13 @@ void emit_gnu_att_assembly(
         for (auto n : var->names()) {
             if (n.linkage == Linkage::Exported) {
                 if (not uninit_vars_present) {
-                    out += ".section .bss\n";
+                    out.write(".section .bss\n");
                     uninit_vars_present = true;
                 }
                 // Only emit align directive once, even if there are multiple exported
                 // names.
                 if (not defines) {
-                    out += fmt::format(
+                    out.print(
                         ".align {}\n",
                         var->allocated_type()->align_bytes()
                     );
@@ -811,7 +935,7 @@ void emit_gnu_att_assembly(
 
                 // If safe_name breaks the identifier, well, there's not much we can do,
                 // since the identifier cannot be represented in the output format...
-                out += fmt::format("{}:\n", safe_name(n.name));
+                out.print("{}:\n", safe_name(n.name));
                 defines = true;
             }
         }
@@ -821,14 +945,14 @@ void emit_gnu_att_assembly(
         LCC_ASSERT(not var->init());
         LCC_ASSERT(defines);
 
-        out += fmt::format(
+        out.print(
             ".zero {}\n",
             var->allocated_type()->bytes()
         );
     }
 
     for (auto& section : module->extra_sections()) {
-        out += fmt::format(".section {}\n", section.name);
+        out.print(".section {}\n", section.name);
         LCC_ASSERT(
             not section.is_fill,
             "Sorry, haven't handled fill extra sections"
@@ -839,7 +963,7 @@ void emit_gnu_att_assembly(
         const auto write_byte = [&](u8 byte) {
             return fmt::format("0x{:x}", byte);
         };
-        out += fmt::format(
+        out.print(
             ".byte {}\n",
             fmt::join(vws::transform(section.contents(), write_byte), ",")
         );
@@ -847,19 +971,10 @@ void emit_gnu_att_assembly(
 
     // ELF-style
     if (not module->context()->target()->is_platform_windows())
-        out += ".section .note.GNU-stack\n";
+        out.write(".section .note.GNU-stack\n");
 
-    out += ".ident \"" LCC_IDENT "\"\n";
-
-    if (output_path.empty() or output_path == "-")
-        fmt::print("{}", out);
-    else {
-        File::WriteOrTerminate(
-            out.data(),
-            out.size(),
-            output_path
-        );
-    }
+    out.write(".ident \"" LCC_IDENT "\"\n");
+    out.flush();
 }
 
 } // namespace lcc::x86_64
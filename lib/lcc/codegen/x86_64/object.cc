@@ -334,6 +334,60 @@ static constexpr void mcode_sib_if_r12(Section& text, RegisterId address_registe
         text += sib_byte(0b00, 0b100, 0b100);
 }
 
+/// Write the REX prefix, if one is needed, for an instruction with
+/// `reg` in the reg field of the modrm byte and the memory operand `m`
+/// in the r/m field.
+static void mcode_rex_for_memory(Section& text, bool w, Register reg, const Memory& m) {
+    bool r = reg_topbit(reg);
+    bool x = m.index.value and reg_topbit(m.index);
+    bool b = reg_topbit(m.base);
+    if (w or r or x or b) text += rex_byte(w, r, x, b);
+}
+
+/// Write the modrm byte, SIB byte, and displacement that address the
+/// memory operand `m`, with `reg` in the reg field of the modrm byte.
+/// This handles the special cases from Table 2-5 of the Intel SDM:
+///   - rsp and r12 as base can only be encoded with a SIB byte,
+///   - rbp and r13 as base always need a displacement, as mod = 0b00
+///     with them in the r/m field means "no base",
+///   - rsp can never be an index, as that means "no index".
+static void mcode_memory(Section& text, u8 reg, const Memory& m) {
+    const u8 base = regbits(m.base);
+    const bool has_index = m.index.value != 0;
+
+    u8 mod = 0b10;
+    if (m.displacement == 0 and (base & 0b111) != 0b101) mod = 0b00;
+    else if (m.displacement >= -128 and m.displacement <= 127) mod = 0b01;
+
+    const bool needs_sib = has_index or (base & 0b111) == 0b100;
+    text += modrm_byte(mod, reg, needs_sib ? u8(0b100) : base);
+
+    if (needs_sib) {
+        u8 index = 0b100;
+        if (has_index) {
+            LCC_ASSERT(
+                m.index.value != +RegisterId::RSP,
+                "x86_64 cannot use rsp as the index of a memory operand"
+            );
+            index = regbits(m.index);
+        }
+
+        u8 scale{};
+        switch (m.scale) {
+            case 1: scale = 0b00; break;
+            case 2: scale = 0b01; break;
+            case 4: scale = 0b10; break;
+            case 8: scale = 0b11; break;
+            default: Diag::ICE("x86_64 memory operand scale must be 1, 2, 4, or 8: got {}", m.scale);
+        }
+
+        text += sib_byte(scale, index, base);
+    }
+
+    if (mod == 0b01) text += u8(i8(m.displacement));
+    else if (mod == 0b10) text += as_bytes(i32(m.displacement));
+}
+
 template <usz... ints>
 constexpr bool is_one_of(usz value) {
     return ((ints == value) or ...);
@@ -494,6 +548,58 @@ static void assemble_inst(
         );
     };
 
+    // Just do 32-bit for now. Could technically do smaller jumps if we know we
+    // aren't jumping far.
+    // 0x0f 0x8? cd | Jcc rel32 | D
+    auto jcc = [&](u8 opcode) {
+        std::string name{};
+        if (is_block(inst)) name = extract_block(inst)->name();
+        else if (is_function(inst)) name = extract_function(inst)->names().at(0).name;
+        else Diag::ICE(
+            "Sorry, unhandled form\n    {}\n",
+            PrintMInstImpl(inst, opcode_to_string)
+        );
+
+        text += {0x0f, opcode};
+        // RELOCATION
+        Relocation reloc{};
+        reloc.symbol.kind = Symbol::Kind::FUNCTION;
+        reloc.symbol.byte_offset = text.contents().size();
+        reloc.symbol.name = std::move(name);
+        reloc.symbol.section_name = text.name;
+        reloc.kind = Relocation::Kind::DISPLACEMENT32_PCREL;
+        gobj.relocations.push_back(reloc);
+
+        text += as_bytes(u32(0));
+    };
+
+    // GNU syntax (src, dst operands)
+    // i.e. called with 0x45, would encode:
+    //  0x66 0x0f 0x45 /r | CMOVNE r/m16, r16 | RM
+    //       0x0f 0x45 /r | CMOVNE r/m32, r32 | RM
+    // REX.W 0x0f 0x45 /r | CMOVNE r/m64, r64 | RM
+    // "RM" means the destination is encoded in the reg field of the
+    // modrm byte, and the source in the r/m field.
+    auto cmovcc = [&](u8 opcode) {
+        if (is_reg_reg(inst)) {
+            auto [src, dst] = extract_reg_reg(inst);
+            LCC_ASSERT(
+                src.size == dst.size and (is_one_of<16, 32, 64>(src.size)),
+                "x86_64 CMOVcc requires 16-, 32-, or 64-bit registers of the same size: got {} and {}",
+                src.size,
+                dst.size
+            );
+            u8 modrm = modrm_byte(0b11, regbits(dst), regbits(src));
+            if (src.size == 16) text += prefix16;
+            if (src.size == 64 or reg_topbit(src) or reg_topbit(dst))
+                text += rex_byte(src.size == 64, reg_topbit(dst), false, reg_topbit(src));
+            text += {0x0f, opcode, modrm};
+        } else Diag::ICE(
+            "Sorry, unhandled form\n    {}\n",
+            PrintMInstImpl(inst, opcode_to_string)
+        );
+    };
+
     switch (Opcode(inst.opcode())) {
         case Opcode::Return: {
             // TODO: Stack frame kinds
@@ -673,6 +779,19 @@ static void assemble_inst(
                     text += rex_byte(dst.size == 64, reg_topbit(dst), false, reg_topbit(src));
                 text += {op, modrm};
                 // TODO: mcode_sib_if_r12 ??
+            } else if (is_reg_mem(inst)) {
+                auto [src, mem] = extract_reg_mem(inst);
+
+                LCC_ASSERT((is_one_of<1, 8, 16, 32, 64>(src.size)));
+
+                u8 op = 0x89;
+                if (src.size == 1 or src.size == 8)
+                    op = 0x88;
+
+                if (src.size == 16) text += prefix16;
+                mcode_rex_for_memory(text, src.size == 64, src, mem);
+                text += op;
+                mcode_memory(text, regbits(src), mem);
             }
             // GNU syntax (src, dst operands)
             //        0xc6 /0 ib | MOV imm8, r/m8   | MI
@@ -780,6 +899,19 @@ static void assemble_inst(
                 text += {op, modrm};
                 // TODO: mcode_sib_if_r12 ??
 
+            } else if (is_mem_reg(inst)) {
+                auto [mem, dst] = extract_mem_reg(inst);
+
+                LCC_ASSERT((is_one_of<1, 8, 16, 32, 64>(dst.size)));
+
+                u8 op = 0x8b;
+                if (dst.size == 1 or dst.size == 8)
+                    op = 0x8a;
+
+                if (dst.size == 16) text += prefix16;
+                mcode_rex_for_memory(text, dst.size == 64, dst, mem);
+                text += op;
+                mcode_memory(text, regbits(dst), mem);
             } else Diag::ICE(
                 "Sorry, unhandled form of move (deref lhs)\n    {}\n",
                 PrintMInstImpl(inst, opcode_to_string)
@@ -881,6 +1013,19 @@ static void assemble_inst(
                     text += rex_byte(reg.size == 64, reg_topbit(reg), false, false);
                 text += {op, modrm};
                 text += as_bytes(i32(offset));
+            } else if (is_mem_reg(inst)) {
+                auto [mem, dst] = extract_mem_reg(inst);
+
+                LCC_ASSERT(
+                    (is_one_of<16, 32, 64>(dst.size)),
+                    "x86_64 lea only supports 16, 32, or 64 bit register destination operand: got {}",
+                    dst.size
+                );
+
+                if (dst.size == 16) text += prefix16;
+                mcode_rex_for_memory(text, dst.size == 64, dst, mem);
+                text += u8(0x8d);
+                mcode_memory(text, regbits(dst), mem);
             } else Diag::ICE(
                 "Sorry, invalid form\n    {}\n",
                 PrintMInstImpl(inst, opcode_to_string)
@@ -1091,43 +1236,106 @@ static void assemble_inst(
             );
         } break;
 
-        case Opcode::JumpIfZeroFlag: {
-            // Just do 32-bit for now. Could technically do smaller jumps if we know we
-            // aren't jumping far.
-            // 0x0f 0x84 cd | JZ rel32 | D
-            if (is_block(inst)) {
-                auto block = extract_block(inst);
+        // 0x0f 0x84 cd | JE/JZ rel32 | D
+        case Opcode::JumpIfZeroFlag:
+        case Opcode::JumpIfEqual:
+            jcc(0x84);
+            break;
 
-                text += {0x0f, 0x84};
-                // RELOCATION
-                Relocation reloc{};
-                reloc.symbol.kind = Symbol::Kind::FUNCTION;
-                reloc.symbol.byte_offset = text.contents().size();
-                reloc.symbol.name = block->name();
-                reloc.symbol.section_name = text.name;
-                reloc.kind = Relocation::Kind::DISPLACEMENT32_PCREL;
-                gobj.relocations.push_back(reloc);
+        // 0x0f 0x85 cd | JNE rel32 | D
+        case Opcode::JumpIfNotEqual:
+            jcc(0x85);
+            break;
 
-                text += as_bytes(u32(0));
-            } else if (is_function(inst)) {
-                auto function = extract_function(inst);
+        // 0x0f 0x82 cd | JB rel32 | D
+        case Opcode::JumpIfLessUnsigned:
+            jcc(0x82);
+            break;
 
-                text += {0x0f, 0x84};
-                // RELOCATION
-                Relocation reloc{};
-                reloc.symbol.kind = Symbol::Kind::FUNCTION;
-                reloc.symbol.byte_offset = text.contents().size();
-                reloc.symbol.name = function->names().at(0).name;
-                reloc.symbol.section_name = text.name;
-                reloc.kind = Relocation::Kind::DISPLACEMENT32_PCREL;
-                gobj.relocations.push_back(reloc);
+        // 0x0f 0x83 cd | JAE rel32 | D
+        case Opcode::JumpIfEqualOrGreaterUnsigned:
+            jcc(0x83);
+            break;
 
-                text += as_bytes(u32(0));
-            } else Diag::ICE(
-                "Sorry, unhandled form\n    {}\n",
-                PrintMInstImpl(inst, opcode_to_string)
-            );
-        } break;
+        // 0x0f 0x86 cd | JBE rel32 | D
+        case Opcode::JumpIfEqualOrLessUnsigned:
+            jcc(0x86);
+            break;
+
+        // 0x0f 0x87 cd | JA rel32 | D
+        case Opcode::JumpIfGreaterUnsigned:
+            jcc(0x87);
+            break;
+
+        // 0x0f 0x8c cd | JL rel32 | D
+        case Opcode::JumpIfLessSigned:
+            jcc(0x8c);
+            break;
+
+        // 0x0f 0x8d cd | JGE rel32 | D
+        case Opcode::JumpIfEqualOrGreaterSigned:
+            jcc(0x8d);
+            break;
+
+        // 0x0f 0x8e cd | JLE rel32 | D
+        case Opcode::JumpIfEqualOrLessSigned:
+            jcc(0x8e);
+            break;
+
+        // 0x0f 0x8f cd | JG rel32 | D
+        case Opcode::JumpIfGreaterSigned:
+            jcc(0x8f);
+            break;
+
+        // 0x0f 0x42 /r | CMOVB r/m, r | RM
+        case Opcode::MoveIfLessUnsigned:
+            cmovcc(0x42);
+            break;
+
+        // 0x0f 0x43 /r | CMOVAE r/m, r | RM
+        case Opcode::MoveIfEqualOrGreaterUnsigned:
+            cmovcc(0x43);
+            break;
+
+        // 0x0f 0x44 /r | CMOVE r/m, r | RM
+        case Opcode::MoveIfEqual:
+            cmovcc(0x44);
+            break;
+
+        // 0x0f 0x45 /r | CMOVNE r/m, r | RM
+        case Opcode::MoveIfNotEqual:
+            cmovcc(0x45);
+            break;
+
+        // 0x0f 0x46 /r | CMOVBE r/m, r | RM
+        case Opcode::MoveIfEqualOrLessUnsigned:
+            cmovcc(0x46);
+            break;
+
+        // 0x0f 0x47 /r | CMOVA r/m, r | RM
+        case Opcode::MoveIfGreaterUnsigned:
+            cmovcc(0x47);
+            break;
+
+        // 0x0f 0x4c /r | CMOVL r/m, r | RM
+        case Opcode::MoveIfLessSigned:
+            cmovcc(0x4c);
+            break;
+
+        // 0x0f 0x4d /r | CMOVGE r/m, r | RM
+        case Opcode::MoveIfEqualOrGreaterSigned:
+            cmovcc(0x4d);
+            break;
+
+        // 0x0f 0x4e /r | CMOVLE r/m, r | RM
+        case Opcode::MoveIfEqualOrLessSigned:
+            cmovcc(0x4e);
+            break;
+
+        // 0x0f 0x4f /r | CMOVG r/m, r | RM
+        case Opcode::MoveIfGreaterSigned:
+            cmovcc(0x4f);
+            break;
 
         case Opcode::Sub: {
             // GNU syntax (src, dst operands)
@@ -1246,6 +1454,48 @@ static void assemble_inst(
             );
         } break;
 
+        case Opcode::UnsignedMultiplyWide:
+        case Opcode::SignedMultiplyWide: {
+            if (is_reg(inst)) {
+                auto reg = extract_reg(inst);
+                // GNU syntax
+                //  0x66 0xf7 /4 | MUL r/m16  | M
+                //       0xf7 /4 | MUL r/m32  | M
+                // REX.W 0xf7 /4 | MUL r/m64  | M
+                //       0xf7 /5 | IMUL r/m.. | M
+                LCC_ASSERT(
+                    (is_one_of<16, 32, 64>(reg.size)),
+                    "x86_64 wide multiply requires a 16, 32, or 64-bit operand"
+                );
+                u8 digit = Opcode(inst.opcode()) == Opcode::UnsignedMultiplyWide ? 4 : 5;
+                u8 modrm = modrm_byte(0b11, digit, regbits(reg));
+
+                if (reg.size == 16) text += prefix16;
+                if (reg.size == 64 or reg_topbit(reg))
+                    text += rex_byte(reg.size == 64, false, false, reg_topbit(reg));
+                text += {0xf7, modrm};
+            } else Diag::ICE(
+                "Sorry, unhandled form\n    {}\n",
+                PrintMInstImpl(inst, opcode_to_string)
+            );
+        } break;
+
+        case Opcode::SignExtendAccumulator: {
+            //  0x66 0x98 | CBW | AX := sign-extend of AL
+            //  0x66 0x99 | CWD | DX:AX := sign-extend of AX
+            //       0x99 | CDQ | EDX:EAX := sign-extend of EAX
+            // REX.W 0x99 | CQO | RDX:RAX := sign-extend of RAX
+            auto size = std::get<MOperandRegister>(inst.get_operand(0)).size;
+            switch (size) {
+                default: Diag::ICE("Invalid accumulator sign extension (bitwidth {})", size);
+                case 64: text += {rex_byte(true, false, false, false), 0x99}; break;
+                case 32: text += u8(0x99); break;
+                case 16: text += {prefix16, 0x99}; break;
+                case 1:
+                case 8: text += {prefix16, 0x98}; break;
+            }
+        } break;
+
         case Opcode::MoveZeroExtended: {
             // GNU syntax (src, dst operands)
             //  0x66 0x0f 0xb6 /r | MOVZX r/m8, r16   | RM
@@ -22,7 +22,9 @@
 #include <cctype>
 #include <functional>
 #include <iterator>
+#include <mutex>
 #include <ranges>
+#include <shared_mutex>
 #include <span>
 #include <string>
 #include <string_view>
@@ -60,6 +62,27 @@ Function::Function(
     mod->add_function(std::unique_ptr<Function>(this));
 }
 
+Function::~Function() = default;
+
+auto Function::dominator_tree() -> DomTree& {
+    if (not dom_tree) dom_tree = std::make_unique<DomTree>(this);
+    return *dom_tree;
+}
+
+void Function::invalidate_dominator_tree() {
+    dom_tree.reset();
+}
+
+void Function::cfg_edge_erased(Block* from, Block* to) {
+    if (dom_tree and not dom_tree->erase_edge(from, to))
+        invalidate_dominator_tree();
+}
+
+void Function::cfg_edge_inserted(Block* from, Block* to) {
+    if (dom_tree and not dom_tree->insert_edge(from, to))
+        invalidate_dominator_tree();
+}
+
 GlobalVariable::GlobalVariable(
     Module* mod,
     Type* t,
@@ -250,6 +273,17 @@ auto Type::string(bool use_colour) const -> std::string {
     LCC_UNREACHABLE();
 }
 
+/// Look up a type in the type caches of a context. The caches
+/// are only locked for reading here, so concurrent lookups of types
+/// that already exist don’t block each other; on a miss, the caller
+/// locks them exclusively and must look again before creating the
+/// type, since another thread may have created it in the meantime.
+template <typename Callable>
+static auto LookupType(Context* ctx, Callable lookup) {
+    std::shared_lock lock{ctx->type_cache_mutex};
+    return lookup();
+}
+
 /// Get or create a function type.
 FunctionType* FunctionType::Get(
     Context* ctx,
@@ -261,18 +295,25 @@ FunctionType* FunctionType::Get(
     LCC_ASSERT(ctx and ret);
 
     // Look in ctx type cache.
-    const auto& found = rgs::find_if(
-        ctx->function_types,
-        [&](const Type* t) {
-            const FunctionType* f = as<FunctionType>(t);
-            return f->ret() == ret
-               and rgs::equal(f->params(), params)
-               and f->variadic() == is_variadic
-               and f->noreturn() == is_noreturn;
-        }
-    );
-    if (found != ctx->function_types.end())
-        return as<FunctionType>(*found);
+    auto Lookup = [&]() -> FunctionType* {
+        const auto& found = rgs::find_if(
+            ctx->function_types,
+            [&](const Type* t) {
+                const FunctionType* f = as<FunctionType>(t);
+                return f->ret() == ret
+                   and rgs::equal(f->params(), params)
+                   and f->variadic() == is_variadic
+                   and f->noreturn() == is_noreturn;
+            }
+        );
+        if (found != ctx->function_types.end())
+            return as<FunctionType>(*found);
+        return nullptr;
+    };
+
+    if (auto* t = LookupType(ctx, Lookup)) return t;
+    std::unique_lock lock{ctx->type_cache_mutex};
+    if (auto* t = Lookup()) return t;
 
     FunctionType* out = new (ctx) FunctionType(
         ret,
@@ -288,11 +329,16 @@ IntegerType* IntegerType::Get(Context* ctx, usz bitwidth) {
     LCC_ASSERT(ctx);
 
     // Look in ctx type cache.
-    const auto& found = std::find_if(ctx->integer_types.begin(), ctx->integer_types.end(), [&](const std::pair<usz, Type*>& pair) {
-        return pair.first == bitwidth;
-    });
-    if (found != ctx->integer_types.end())
-        return as<IntegerType>(found->second);
+    auto Lookup = [&]() -> IntegerType* {
+        auto found = ctx->integer_types.find(bitwidth);
+        if (found != ctx->integer_types.end())
+            return as<IntegerType>(found->second);
+        return nullptr;
+    };
+
+    if (auto* t = LookupType(ctx, Lookup)) return t;
+    std::unique_lock lock{ctx->type_cache_mutex};
+    if (auto* t = Lookup()) return t;
 
     // Create new type and store in cache.
     IntegerType* out = new (ctx) IntegerType(bitwidth);
@@ -304,15 +350,16 @@ FractionalType* FractionalType::Get(Context* ctx, usz bitwidth) {
     LCC_ASSERT(ctx);
 
     // Look in ctx type cache.
-    const auto& found = std::find_if(
-        ctx->fractional_types.begin(),
-        ctx->fractional_types.end(),
-        [&](const std::pair<usz, Type*>& pair) {
-            return pair.first == bitwidth;
-        }
-    );
-    if (found != ctx->fractional_types.end())
-        return as<FractionalType>(found->second);
+    auto Lookup = [&]() -> FractionalType* {
+        auto found = ctx->fractional_types.find(bitwidth);
+        if (found != ctx->fractional_types.end())
+            return as<FractionalType>(found->second);
+        return nullptr;
+    };
+
+    if (auto* t = LookupType(ctx, Lookup)) return t;
+    std::unique_lock lock{ctx->type_cache_mutex};
+    if (auto* t = Lookup()) return t;
 
     // Create new type and store in cache.
     FractionalType* out = new (ctx) FractionalType(bitwidth);
@@ -324,15 +371,22 @@ ArrayType* ArrayType::Get(Context* ctx, usz length, Type* element_type) {
     LCC_ASSERT(ctx and element_type);
 
     // Look in ctx type cache.
-    const auto& found = rgs::find_if(
-        ctx->array_types,
-        [&](const Type* t) {
-            const ArrayType* a = as<ArrayType>(t);
-            return a->length() == length && a->element_type() == element_type;
-        }
-    );
-    if (found != ctx->array_types.end())
-        return as<ArrayType>(*found);
+    auto Lookup = [&]() -> ArrayType* {
+        const auto& found = rgs::find_if(
+            ctx->array_types,
+            [&](const Type* t) {
+                const ArrayType* a = as<ArrayType>(t);
+                return a->length() == length && a->element_type() == element_type;
+            }
+        );
+        if (found != ctx->array_types.end())
+            return as<ArrayType>(*found);
+        return nullptr;
+    };
+
+    if (auto* t = LookupType(ctx, Lookup)) return t;
+    std::unique_lock lock{ctx->type_cache_mutex};
+    if (auto* t = Lookup()) return t;
 
     ArrayType* out = new (ctx) ArrayType(length, element_type);
     ctx->array_types.push_back(out);
@@ -348,18 +402,25 @@ StructType* StructType::Get(
     LCC_ASSERT(ctx);
 
     // Look in ctx type cache.
-    const auto& found = rgs::find_if(ctx->struct_types, [&](const Type* t) {
-        const StructType* s = as<StructType>(t);
-        return s->named()
-                 ? s->name() == name
-                       and rgs::equal(s->members(), member_types)
-                 : rgs::equal(
-                       as<StructType>(ctx->struct_types[usz(s->index())])->members(),
-                       member_types
-                   );
-    });
-    if (found != ctx->struct_types.end())
-        return as<StructType>(*found);
+    auto Lookup = [&]() -> StructType* {
+        const auto& found = rgs::find_if(ctx->struct_types, [&](const Type* t) {
+            const StructType* s = as<StructType>(t);
+            return s->named()
+                     ? s->name() == name
+                           and rgs::equal(s->members(), member_types)
+                     : rgs::equal(
+                           as<StructType>(ctx->struct_types[usz(s->index())])->members(),
+                           member_types
+                       );
+        });
+        if (found != ctx->struct_types.end())
+            return as<StructType>(*found);
+        return nullptr;
+    };
+
+    if (auto* t = LookupType(ctx, Lookup)) return t;
+    std::unique_lock lock{ctx->type_cache_mutex};
+    if (auto* t = Lookup()) return t;
 
     StructType* out;
     if (not name.empty())
@@ -382,8 +443,10 @@ void Block::insert_before(std::unique_ptr<Inst> to_insert, Inst* before) {
     auto before_it = rgs::find_if(inst_list, [&](const auto& i) {
         return i.get() == before;
     });
+    auto inserted = to_insert.get();
     to_insert->parent = this;
     inst_list.insert(before_it, std::move(to_insert));
+    TerminatorInserted(inserted);
 }
 
 void Block::insert_after(std::unique_ptr<Inst> to_insert, Inst* after) {
@@ -391,8 +454,10 @@ void Block::insert_after(std::unique_ptr<Inst> to_insert, Inst* after) {
     auto after_it = rgs::find_if(inst_list, [&](const auto& i) {
         return i.get() == after;
     });
+    auto inserted = to_insert.get();
     to_insert->parent = this;
     inst_list.insert(after_it + 1, std::move(to_insert));
+    TerminatorInserted(inserted);
 }
 
 Inst* Block::insert(std::unique_ptr<Inst> i, bool force) {
@@ -403,10 +468,16 @@ Inst* Block::insert(std::unique_ptr<Inst> i, bool force) {
     auto inserted = i.get();
     i->parent = this;
     inst_list.emplace_back(std::move(i));
+    TerminatorInserted(inserted);
 
     return inserted;
 }
 
+void Block::TerminatorInserted(Inst* i) {
+    if (not parent or terminator() != i) return;
+    for (auto s : successors()) parent->cfg_edge_inserted(this, s);
+}
+
 bool Block::has_predecessor(Block* block) const {
     LCC_ASSERT(block);
     auto* term = block->terminator();
@@ -442,7 +513,8 @@ usz Block::id() const {
     );
 }
 
-auto Inst::Children() -> Generator<Value**> {
+auto Inst::Children() -> OperandSlots {
+    OperandSlots slots{};
     switch (kind()) {
         case Kind::Block:
         case Kind::Function:
@@ -461,52 +533,64 @@ auto Inst::Children() -> Generator<Value**> {
 
         case Kind::Call: {
             auto* c = as<CallInst>(this);
-            co_yield &c->callee_value;
-            for (auto& a : c->arguments) co_yield &a;
+            slots.add(&c->callee_value);
+            slots.add_run(c->arguments.data(), c->arguments.size());
         } break;
 
         case Kind::GetElementPtr: {
             auto* gep = as<GEPInst>(this);
-            co_yield &gep->pointer;
-            co_yield &gep->index;
+            slots.add(&gep->pointer);
+            slots.add(&gep->index);
         } break;
 
         case Kind::GetMemberPtr: {
             auto* gmp = as<GetMemberPtrInst>(this);
-            co_yield &gmp->pointer;
-            co_yield &gmp->index;
+            slots.add(&gmp->pointer);
+            slots.add(&gmp->index);
         } break;
 
         case Kind::Intrinsic: {
             auto* i = as<IntrinsicInst>(this);
-            for (auto* a : i->operand_list)
-                co_yield &a;
+            slots.add_run(i->operand_list.data(), i->operand_list.size());
         } break;
 
         case Kind::Load: {
             auto* load = as<LoadInst>(this);
-            co_yield &load->pointer;
+            slots.add(&load->pointer);
         } break;
 
         case Kind::Phi: {
             auto* phi = as<PhiInst>(this);
-            for (auto& [value, _] : phi->incoming) co_yield &value;
+            if (not phi->incoming.empty()) {
+                slots.add_run(
+                    &phi->incoming.front().value,
+                    phi->incoming.size(),
+                    sizeof(PhiInst::IncomingValue)
+                );
+            }
+        } break;
+
+        case Kind::Select: {
+            auto* sel = as<SelectInst>(this);
+            slots.add(&sel->condition);
+            slots.add(&sel->if_true);
+            slots.add(&sel->if_false);
         } break;
 
         case Kind::Store: {
             auto* s = as<StoreInst>(this);
-            co_yield &s->pointer;
-            co_yield &s->value;
+            slots.add(&s->pointer);
+            slots.add(&s->value);
         } break;
 
         case Kind::CondBranch: {
             auto* br = as<CondBranchInst>(this);
-            co_yield &br->condition;
+            slots.add(&br->condition);
         } break;
 
         case Kind::Return: {
             auto* ret = as<ReturnInst>(this);
-            if (ret->has_value()) co_yield &ret->value;
+            if (ret->has_value()) slots.add(&ret->value);
         } break;
 
         case Kind::ZExt:
@@ -517,7 +601,7 @@ auto Inst::Children() -> Generator<Value**> {
         case Kind::Copy:
         case Kind::Compl: {
             auto* u = cast<UnaryInstBase>(this);
-            co_yield &u->op;
+            slots.add(&u->op);
         } break;
 
         case Kind::Add:
@@ -544,10 +628,11 @@ auto Inst::Children() -> Generator<Value**> {
         case Kind::UGt:
         case Kind::UGe: {
             auto* b = cast<BinaryInst>(this);
-            co_yield &b->left;
-            co_yield &b->right;
+            slots.add(&b->left);
+            slots.add(&b->right);
         } break;
     }
+    return slots;
 }
 
 void Inst::EraseImpl() {
@@ -575,26 +660,63 @@ void Inst::EraseImpl() {
     }
 }
 
-auto Inst::children() const -> Generator<Value*> {
+auto Inst::children() const -> InstChildren {
     /// const_cast is fine since this does not mutate the instruction.
     auto* self = const_cast<Inst*>(this);
-    for (auto* v : self->Children()) co_yield *v;
+    InstChildren children{self->Children()};
 
     /// Include blocks if there are any.
-    if (auto* br = cast<BranchInst>(self)) co_yield br->target();
+    if (auto* br = cast<BranchInst>(self)) children.add_block(br->target());
     else if (auto* cond_br = cast<CondBranchInst>(self)) {
-        co_yield cond_br->then_block();
-        co_yield cond_br->else_block();
+        children.add_block(cond_br->then_block());
+        children.add_block(cond_br->else_block());
     }
+    return children;
 }
 
 void Inst::PerformErasure() {
     LCC_ASSERT(users().empty(), "Cannot remove used instruction");
-    if (parent) {
-        std::erase_if(parent->instructions(), [&](const auto& i) {
-            return i.get() == this;
-        });
-    }
+    if (parent) RemoveFromParent();
+}
+
+void Inst::RemoveFromParent() {
+    /// Removing a terminator removes all edges out of its block.
+    auto f = parent->function();
+    bool was_terminator = f and parent->terminator() == this;
+    std::vector<Block*> successors;
+    if (was_terminator)
+        for (auto s : parent->successors()) successors.push_back(s);
+
+    auto block = parent;
+    std::erase_if(block->instructions(), [&](const auto& i) {
+        return i.get() == this;
+    });
+
+    for (auto s : successors) f->cfg_edge_erased(block, s);
+
+    /// If a replacement was inserted in front of the terminator (see
+    /// `replace_with()`), that is the terminator now.
+    if (was_terminator and block->terminator())
+        for (auto s : block->successors()) f->cfg_edge_inserted(block, s);
+}
+
+void Inst::move_before(Inst* before) {
+    LCC_ASSERT(parent and before and before->parent, "Cannot move floating instruction");
+    LCC_ASSERT(not is_terminator(), "Cannot move a terminator");
+    auto& list = parent->instructions();
+    auto it = rgs::find_if(list, [&](const auto& i) { return i.get() == this; });
+    LCC_ASSERT(it != list.end(), "Instruction is not in its parent block");
+    auto self = std::move(*it);
+    list.erase(it);
+    before->parent->insert_before(std::move(self), before);
+}
+
+void Inst::UpdateSuccessor(Block*& op, Block* newval) {
+    auto old = op;
+    UpdateOperand(op, newval);
+    if (old == newval or not parent or not parent->function()) return;
+    if (old) parent->function()->cfg_edge_erased(parent, old);
+    if (newval) parent->function()->cfg_edge_inserted(parent, newval);
 }
 
 void Inst::erase() {
@@ -613,11 +735,7 @@ void Inst::erase_cascade() {
         users().front()->erase_cascade();
 
     // Remove the instruction from the instruction list.
-    if (parent) {
-        std::erase_if(parent->instructions(), [&](const auto& i) {
-            return i.get() == this;
-        });
-    }
+    if (parent) RemoveFromParent();
 }
 
 auto Inst::instructions_before_this() -> std::vector<Inst*> {
@@ -717,6 +835,9 @@ void Block::erase() {
         "Cannot remove used block"
     );
 
+    /// Block indices change, so the dominator tree has to go.
+    if (parent) parent->invalidate_dominator_tree();
+
     /// Erase all instructions in this block.
     while (not inst_list.empty())
         inst_list.back()->erase_cascade();
@@ -745,6 +866,10 @@ void Block::merge(lcc::Block* b) {
         or parent == b->parent
     );
 
+    // Merging removes a block, so the dominator tree has to go.
+    if (parent) parent->invalidate_dominator_tree();
+    if (b->parent) b->parent->invalidate_dominator_tree();
+
     // For every Phi user of this block, if it is contained within the block
     // being merged, replace every use of the phi with the incoming value from
     // this block.
@@ -873,44 +998,61 @@ struct LCCIRPrinter : IRPrinter<LCCIRPrinter, 2> {
         Print("{}; LCC Module '{}'{}\n", C(P::Comment), mod->name(), C(P::Reset));
     }
 
-    std::string Ty(Type* ty) {
+    /// Write the inline representation of a type.
+    template <typename Out>
+    auto WriteTy(Out out, Type* ty) -> Out {
         LCC_ASSERT(ty, "Cannot stringify null Type");
-        if (auto struct_type = cast<StructType>(ty)) {
-            return fmt::format(
-                "{}@{}{}",
-                C(P::Name),
-                struct_type->string(false),
-                C(P::Reset)
-            );
-        } else if (auto arr = cast<ArrayType>(ty)) {
-            return fmt::format(
-                "{}{}[{}{}{}]{}",
-                Ty(arr->element_type()),
-                C(P::Filler),
-                C(P::Literal),
-                arr->length(),
-                C(P::Filler),
-                C(P::Reset)
-            );
-        } else if (auto f = cast<FunctionType>(ty)) {
-            auto ToString = [&](auto t) { return Ty(t); };
-            auto separator = fmt::format("{}, ", C(P::Filler));
-            auto variadic
-                = f->variadic()
-                    ? fmt::format(" {}variadic", C(P::Filler))
-                    : "";
-            return fmt::format(
-                "{}{}({}{}){}{}",
-                Ty(f->ret()),
-                C(P::Filler),
-                fmt::join(vws::transform(f->params(), ToString), separator),
-                C(P::Filler),
-                variadic,
-                C(P::Reset)
-            );
-        }
+        switch (ty->kind) {
+            case Type::Kind::Unknown: return fmt::format_to(out, "{}<?>{}", C(P::Type), C(P::Reset));
+            case Type::Kind::Pointer: return fmt::format_to(out, "{}ptr{}", C(P::Type), C(P::Reset));
+            case Type::Kind::Void: return fmt::format_to(out, "{}void{}", C(P::Type), C(P::Reset));
+
+            case Type::Kind::Integer: {
+                auto integer = as<IntegerType>(ty);
+                return fmt::format_to(out, "{}i{}{}", C(P::Type), integer->bitwidth(), C(P::Reset));
+            }
+
+            case Type::Kind::Fractional: {
+                auto fractional = as<FractionalType>(ty);
+                return fmt::format_to(out, "{}f{}{}", C(P::Type), fractional->bitwidth(), C(P::Reset));
+            }
+
+            case Type::Kind::Struct: {
+                auto struct_type = as<StructType>(ty);
+                if (struct_type->named())
+                    return fmt::format_to(out, "{}@{}{}", C(P::Name), struct_type->name(), C(P::Reset));
+                return fmt::format_to(out, "{}@__struct_{}{}", C(P::Name), struct_type->index(), C(P::Reset));
+            }
+
+            case Type::Kind::Array: {
+                auto arr = as<ArrayType>(ty);
+                return fmt::format_to(
+                    out,
+                    "{}{}[{}{}{}]{}",
+                    Ty(arr->element_type()),
+                    C(P::Filler),
+                    C(P::Literal),
+                    arr->length(),
+                    C(P::Filler),
+                    C(P::Reset)
+                );
+            }
 
-        return ty->string(_use_colour);
+            case Type::Kind::Function: {
+                auto f = as<FunctionType>(ty);
+                out = fmt::format_to(out, "{}{}(", Ty(f->ret()), C(P::Filler));
+                bool first = true;
+                for (auto* param : f->params()) {
+                    if (first) first = false;
+                    else out = fmt::format_to(out, "{}, ", C(P::Filler));
+                    out = fmt::format_to(out, "{}", Ty(param));
+                }
+                out = fmt::format_to(out, "{})", C(P::Filler));
+                if (f->variadic()) out = fmt::format_to(out, " {}variadic", C(P::Filler));
+                return fmt::format_to(out, "{}", C(P::Reset));
+            }
+        }
+        LCC_UNREACHABLE();
     }
 
     void PrintStructType(Type* t) {
@@ -1068,21 +1210,9 @@ struct LCCIRPrinter : IRPrinter<LCCIRPrinter, 2> {
                     Print("{}", Val(arg));
                 }
 
-                auto variadic
-                    = callee_ty->variadic()
-                        ? fmt::format(" {}variadic", C(P::Filler))
-                        : "";
-
-                if (callee_ty->ret()->is_void())
-                    Print("{}){}", C(P::Filler), variadic);
-                else {
-                    Print(
-                        "{}){} -> {}",
-                        C(P::Filler),
-                        variadic,
-                        Ty(callee_ty->ret())
-                    );
-                }
+                Print("{})", C(P::Filler));
+                if (callee_ty->variadic()) Print(" {}variadic", C(P::Filler));
+                if (not callee_ty->ret()->is_void()) Print(" -> {}", Ty(callee_ty->ret()));
                 return;
             }
 
@@ -1122,11 +1252,13 @@ struct LCCIRPrinter : IRPrinter<LCCIRPrinter, 2> {
                         "Unimplemented intrinsic in LCC IR printer"
                     );
 
-                    case IntrinsicKind::MemCopy: {
+                    case IntrinsicKind::MemCopy:
+                    case IntrinsicKind::MemSet: {
                         Print(
-                            "    {}intrinsic {}@memcpy{}({}{}, {}{}, {}{})",
+                            "    {}intrinsic {}@{}{}({}{}, {}{}, {}{})",
                             C(P::Opcode),
                             C(P::Name),
+                            intrinsic->intrinsic_kind() == IntrinsicKind::MemCopy ? "memcpy" : "memset",
                             C(P::Filler),
                             Val(operands[0]),
                             C(P::Filler),
@@ -1154,9 +1286,14 @@ struct LCCIRPrinter : IRPrinter<LCCIRPrinter, 2> {
 
             case Value::Kind::Phi: {
                 auto* phi = as<PhiInst>(i);
-                const auto separator = fmt::format("{}, ", C(P::Filler));
-                const auto FormatPHIVal = [this](auto& val) {
-                    return fmt::format(
+                PrintTemp(i);
+                Print("phi {}{}, ", Ty(phi->type()), C(P::Filler));
+
+                bool first = true;
+                for (auto& val : phi->operands()) {
+                    if (first) first = false;
+                    else Print("{}, ", C(P::Filler));
+                    Print(
                         "{}[{} {}: {}{}]",
                         C(P::Filler),
                         Val(val.block, false),
@@ -1164,17 +1301,20 @@ struct LCCIRPrinter : IRPrinter<LCCIRPrinter, 2> {
                         Val(val.value, false),
                         C(P::Filler)
                     );
-                };
+                }
+                return;
+            }
 
+            case Value::Kind::Select: {
+                auto* select = as<SelectInst>(i);
                 PrintTemp(i);
                 Print(
-                    "phi {}{}, {}",
-                    Ty(phi->type()),
+                    "select {}{}, {}{}, {}",
+                    Val(select->cond(), false),
                     C(P::Filler),
-                    fmt::join(
-                        vws::transform(phi->operands(), FormatPHIVal),
-                        separator
-                    )
+                    Val(select->then_value(), true),
+                    C(P::Filler),
+                    Val(select->else_value(), false)
                 );
                 return;
             }
@@ -1239,14 +1379,14 @@ struct LCCIRPrinter : IRPrinter<LCCIRPrinter, 2> {
             case Value::Kind::Neg: {
                 auto* neg = as<UnaryInstBase>(i);
                 PrintTemp(i);
-                Print("negate {}", Index(i), Val(neg->operand()));
+                Print("neg {}", Val(neg->operand()));
                 return;
             }
 
             case Value::Kind::Compl: {
                 auto* c = as<UnaryInstBase>(i);
                 PrintTemp(i);
-                Print("compl {}", Index(i), Val(c->operand()));
+                Print("compl {}", Val(c->operand()));
                 return;
             }
 
@@ -1311,26 +1451,24 @@ struct LCCIRPrinter : IRPrinter<LCCIRPrinter, 2> {
         else Print("= {}0\n", C(P::Literal));
     }
 
-    /// Get the inline representation of a value.
+    /// Write the inline representation of a value.
     ///
     /// In some contexts, the type is obvious (e.g. the address
     /// of a store is always of type \c ptr), so there is no reason
     /// to include it in the printout. The type is omitted if \c false
     /// is passed for \c include_type.
-    [[nodiscard]]
-    auto Val(Value* v, bool include_type = true) -> std::string {
+    template <typename Out>
+    auto WriteVal(Out out, Value* v, bool include_type) -> Out {
         LCC_ASSERT(v);
 
         const auto Format =
             [&]<typename... Args>(
                 fmt::format_string<Args...> fmt,
                 Args&&... args
-            ) -> std::string {
-            std::string val;
+            ) -> Out {
             if (include_type)
-                fmt::format_to(It(val), "{} ", Ty(v->type()));
-            fmt::format_to(It(val), fmt, std::forward<Args>(args)...);
-            return val;
+                out = fmt::format_to(out, "{} ", Ty(v->type()));
+            return fmt::format_to(out, fmt, std::forward<Args>(args)...);
         };
 
         switch (v->kind()) {
@@ -1369,7 +1507,8 @@ struct LCCIRPrinter : IRPrinter<LCCIRPrinter, 2> {
                 );
 
             case Value::Kind::Block: {
-                return fmt::format(
+                return fmt::format_to(
+                    out,
                     "{}{}{}%bb{}",
                     C(P::Type),
                     include_type ? "block " : "",
@@ -1379,16 +1518,14 @@ struct LCCIRPrinter : IRPrinter<LCCIRPrinter, 2> {
             }
 
             case Value::Kind::GlobalVariable: {
-                std::string val;
                 if (include_type)
-                    fmt::format_to(It(val), "{}ptr ", C(P::Type));
-                fmt::format_to(
-                    It(val),
+                    out = fmt::format_to(out, "{}ptr ", C(P::Type));
+                return fmt::format_to(
+                    out,
                     "{}@{}",
                     C(P::Temp),
                     as<GlobalVariable>(v)->names().at(0).name
                 );
-                return val;
             }
 
             /// TODO: Format this differently based on the array type?
@@ -1397,21 +1534,12 @@ struct LCCIRPrinter : IRPrinter<LCCIRPrinter, 2> {
 
                 // String
                 if (a->is_string_literal()) {
-                    static const auto FormatChar = [](u8 c) {
-                        return std::isprint(c) and c != '\"'
-                                 ? std::string{char(c)}
-                                 : fmt::format("\\{:02X}", u8(c));
-                    };
-
-                    return Format(
-                        "{}\"{}\"{}",
-                        C(P::Literal),
-                        fmt::join(
-                            std::span<const char>(a->data(), a->size()) | vws::transform(FormatChar),
-                            ""
-                        ),
-                        C(P::Reset)
-                    );
+                    out = Format("{}\"", C(P::Literal));
+                    for (u8 c : std::span<const char>(a->data(), a->size())) {
+                        if (std::isprint(c) and c != '\"') *out++ = char(c);
+                        else out = fmt::format_to(out, "\\{:02X}", c);
+                    }
+                    return fmt::format_to(out, "\"{}", C(P::Reset));
                 }
 
                 // Array
@@ -1456,6 +1584,7 @@ struct LCCIRPrinter : IRPrinter<LCCIRPrinter, 2> {
             case Value::Kind::Call:
             case Value::Kind::Load:
             case Value::Kind::Phi:
+            case Value::Kind::Select:
             case Value::Kind::ZExt:
             case Value::Kind::SExt:
             case Value::Kind::Trunc:
@@ -1520,6 +1649,7 @@ struct LCCIRPrinter : IRPrinter<LCCIRPrinter, 2> {
             case Value::Kind::GetMemberPtr:
             case Value::Kind::Load:
             case Value::Kind::Phi:
+            case Value::Kind::Select:
             case Value::Kind::ZExt:
             case Value::Kind::SExt:
             case Value::Kind::Trunc:
@@ -1628,8 +1758,13 @@ auto Module::as_lcc_ir(bool use_colour) -> std::string {
     );
 }
 
-auto Value::string() const -> std::string {
-    return LCCIRPrinter::PrintValue(this, true);
+void Module::emit_lcc_ir(std::FILE* file, bool use_colour) {
+    LCCIRPrinter::Emit(this, use_colour, file);
+    fmt::print(file, "{}", lcc::Colours{use_colour}(lcc::Colour::Reset));
+}
+
+auto Value::string(bool use_colour) const -> std::string {
+    return LCCIRPrinter::PrintValue(this, use_colour);
 }
 
 void Value::print() const {
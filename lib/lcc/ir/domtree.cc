@@ -3,6 +3,7 @@
 #include <hdronly/lcc/fixcompilers.hh>
 #include <hdronly/lcc/typedefs.hh>
 
+#include <numeric>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -84,8 +85,6 @@ struct DomTreeBuilder {
     // if there isn't one.
     Buffer<usz>& idoms;
 
-    Buffer<std::vector<usz>>& children;
-
     Function* f;
 
     // Flag indicating whether we’ve already visited a node.
@@ -180,10 +179,8 @@ private:
                 if (total[v] == 0) {
                     auto x = contr.find(parents[v]);
                     if (u == x) {
-                        for (auto w : same.elements(v)) {
+                        for (auto w : same.elements(v))
                             idoms[w] = u;
-                            children[u].push_back(w);
-                        }
                     } else {
                         same.unite(x, v);
                     }
@@ -219,29 +216,117 @@ private:
 } // namespace lcc
 
 lcc::DomTree::DomTree(Function* function, bool compute_dominance_frontiers)
-    : f(function) {
+    : f(function), has_frontiers(compute_dominance_frontiers) {
+    child_offsets.assign(function->blocks().size() + 1, 0);
+    df_offsets.assign(function->blocks().size() + 1, 0);
     if (function->blocks().empty()) return;
 
     /// Build dominator tree.
-    DomTreeBuilder{idoms, children, function}.Build();
+    DomTreeBuilder{idoms, function}.Build();
+    ComputeChildren();
 
     /// Compute dominance frontiers.
-    if (not compute_dominance_frontiers)
-        return;
-
-    for (auto [i, a] : vws::enumerate(function->blocks())) {
-        for (auto b : a->successors()) {
-            for (
-                Block* x = a.get();
-                not strictly_dominates(x, b);
-                /** No Increment */
-            ) {
-                auto x_id = x->id();
-                df[x_id].push_back(b);
-                x = function->blocks()[idoms[x_id]].get();
-            }
-        }
+    if (compute_dominance_frontiers) ComputeFrontiers();
+}
+
+void lcc::DomTree::AddToFrontiers(std::span<const usz> nodes, Block* b) {
+    if (nodes.empty()) return;
+
+    /// Inserting into the flat list one node at a time would shift
+    /// the rest of it every time, so lay it out again in one go, with
+    /// the new entry at the end of each node's frontier.
+    std::vector<usz> added(df_offsets.size() - 1, 0);
+    for (auto i : nodes) added[i]++;
+
+    std::vector<Block*> list;
+    list.reserve(df_list.size() + nodes.size());
+    usz shift = 0;
+    for (usz i = 0; i < added.size(); i++) {
+        list.insert(list.end(), df_list.begin() + isz(df_offsets[i]), df_list.begin() + isz(df_offsets[i + 1]));
+        list.insert(list.end(), added[i], b);
+        df_offsets[i] += shift;
+        shift += added[i];
+    }
+
+    df_offsets.back() += shift;
+    df_list = std::move(list);
+}
+
+void lcc::DomTree::ComputeChildren() {
+    /// Count the children of each node first so we can lay them
+    /// out in one list, sorted by parent.
+    rgs::fill(child_offsets, 0);
+    for (usz i = RootId + 1; i < idoms.size(); i++)
+        if (idoms[i] != InvalidId)
+            child_offsets[idoms[i] + 1]++;
+
+    std::partial_sum(child_offsets.begin(), child_offsets.end(), child_offsets.begin());
+    child_list.resize(child_offsets.back());
+
+    std::vector<usz> next{child_offsets.begin(), child_offsets.end() - 1};
+    for (usz i = RootId + 1; i < idoms.size(); i++)
+        if (idoms[i] != InvalidId)
+            child_list[next[idoms[i]]++] = i;
+}
+
+void lcc::DomTree::ComputeFrontiers() {
+    /// Same as above: count first, then fill in.
+    auto ForEachEdge = [&](auto cb) {
+        for (auto [i, a] : vws::enumerate(f->blocks()))
+            for (auto b : a->successors())
+                ForEachFrontierOf(usz(i), b, [&](usz x) { cb(x, b); });
+    };
+
+    rgs::fill(df_offsets, 0);
+    ForEachEdge([&](usz x, Block*) { df_offsets[x + 1]++; });
+
+    std::partial_sum(df_offsets.begin(), df_offsets.end(), df_offsets.begin());
+    df_list.resize(df_offsets.back());
+
+    std::vector<usz> next{df_offsets.begin(), df_offsets.end() - 1};
+    ForEachEdge([&](usz x, Block* b) { df_list[next[x]++] = b; });
+    has_frontiers = true;
+}
+
+auto lcc::DomTree::insert_edge(Block* from, Block* to) -> bool {
+    auto from_id = from->id();
+    auto to_id = to->id();
+
+    /// An edge out of an unreachable block changes nothing.
+    if (idoms[from_id] == InvalidId) return true;
+
+    /// An edge that makes a block reachable adds a whole subgraph.
+    if (idoms[to_id] == InvalidId) return false;
+
+    /// If the immediate dominator of `to` dominates `from`, any new
+    /// path through this edge already passes through every dominator
+    /// of every block, so only the frontiers change.
+    if (to_id != RootId and not dominates(f->blocks()[idoms[to_id]].get(), from))
+        return false;
+
+    if (has_frontiers) {
+        std::vector<usz> nodes;
+        ForEachFrontierOf(from_id, to, [&](usz x) { nodes.push_back(x); });
+        AddToFrontiers(nodes, to);
     }
+    return true;
+}
+
+auto lcc::DomTree::erase_edge(Block* from, Block* to) -> bool {
+    /// The edge may still be there, e.g. if a conditional branch
+    /// had the same block as both targets.
+    if (to->has_predecessor(from)) return true;
+
+    /// An edge out of an unreachable block changes nothing.
+    auto from_id = from->id();
+    if (idoms[from_id] == InvalidId) return true;
+
+    /// Removing a back edge to a dominator doesn’t remove any block
+    /// from the paths to any other block. Everything else may change
+    /// the dominators.
+    if (not dominates(to, from)) return false;
+    if (has_frontiers) ComputeFrontiers();
+    return true;
 }
 
 auto lcc::DomTree::debug() const -> std::string {
@@ -376,19 +376,25 @@ struct LLVMIRPrinter : IRPrinter<LLVMIRPrinter, 0> {
                     "PHI instruction has no valid incoming values"
                 );
 
-                const auto FormatPHIVal = [this](auto& val) {
-                    return fmt::format(
-                        "[{}, {}]",
-                        Val(val.value, false),
-                        Val(val.block, false)
-                    );
-                };
+                Print("    %{} = phi {} ", Index(i), Ty(phi->type()));
+
+                bool first = true;
+                for (auto& val : phi->operands()) {
+                    if (first) first = false;
+                    else Print(", ");
+                    Print("[{}, {}]", Val(val.value, false), Val(val.block, false));
+                }
+                return;
+            }
 
+            case Value::Kind::Select: {
+                auto select = as<SelectInst>(i);
                 Print(
-                    "    %{} = phi {} {}",
+                    "    %{} = select {}, {}, {}",
                     Index(i),
-                    Ty(phi->type()),
-                    fmt::join(vws::transform(phi->operands(), FormatPHIVal), ", ")
+                    Val(select->cond()),
+                    Val(select->then_value()),
+                    Val(select->else_value())
                 );
                 return;
             }
@@ -428,14 +434,15 @@ struct LLVMIRPrinter : IRPrinter<LLVMIRPrinter, 0> {
         auto name = v->names().at(0).name;
         auto linkage = v->names().at(0).linkage;
         Print(
-            "{} = {} {} {} {}, align {}\n",
+            "{} = {} {} {} ",
             FormatName(name),
             IsImportedLinkage(linkage) ? "external" : "private",
             is_string ? "unnamed_addr constant" : "global",
-            Ty(v->allocated_type()),
-            v->init() ? Val(v->init(), false) : "zeroinitializer",
-            v->type()->align()
+            Ty(v->allocated_type())
         );
+        if (v->init()) Print("{}", Val(v->init(), false));
+        else Print("zeroinitializer");
+        Print(", align {}\n", v->type()->align());
     }
 
     /// Check if the LLVM instruction that is emitted for
@@ -460,6 +467,7 @@ struct LLVMIRPrinter : IRPrinter<LLVMIRPrinter, 0> {
             case Value::Kind::GetMemberPtr:
             case Value::Kind::Load:
             case Value::Kind::Phi:
+            case Value::Kind::Select:
             case Value::Kind::ZExt:
             case Value::Kind::SExt:
             case Value::Kind::Trunc:
@@ -522,30 +530,39 @@ struct LLVMIRPrinter : IRPrinter<LLVMIRPrinter, 0> {
 
     /// Format a name for use in LLVM IR.
     auto FormatName(std::string_view name) -> std::string {
+        std::string out{};
+        WriteName(std::back_inserter(out), name);
+        return out;
+    };
+
+    template <typename Out>
+    static auto WriteName(Out out, std::string_view name) -> Out {
         auto printable = rgs::none_of(
             name,
             [](auto c) { return std::isspace(c); }
         );
-        if (printable) return fmt::format("@{}", name);
-        else return fmt::format("@\"{}\"", name);
+        if (printable) return fmt::format_to(out, "@{}", name);
+        else return fmt::format_to(out, "@\"{}\"", name);
     };
 
-    /// Get the LLVM representation of a type.
-    auto Ty(Type* ty) -> std::string {
+    /// Write the LLVM representation of a type.
+    template <typename Out>
+    auto WriteTy(Out out, Type* ty) -> Out {
         switch (ty->kind) {
             /// Ill-formed.
             case Type::Kind::Unknown: LCC_UNREACHABLE();
-            case Type::Kind::Pointer: return "ptr";
-            case Type::Kind::Void: return "void";
+            case Type::Kind::Pointer: return fmt::format_to(out, "ptr");
+            case Type::Kind::Void: return fmt::format_to(out, "void");
 
             /// Function types may only appear in direct calls or
             /// function declarations, in which case they are always
             /// receive special treatment, so if we encounter one
             /// in the wild, it has to be a function pointer.
-            case Type::Kind::Function: return "ptr";
+            case Type::Kind::Function: return fmt::format_to(out, "ptr");
 
             case Type::Kind::Integer: {
-                return fmt::format(
+                return fmt::format_to(
+                    out,
                     "i{}",
                     as<IntegerType>(ty)->bits()
                 );
@@ -555,7 +572,7 @@ struct LLVMIRPrinter : IRPrinter<LLVMIRPrinter, 0> {
                 auto f = as<FractionalType>(ty);
 
                 if (f->bitwidth() <= 32)
-                    return "float";
+                    return fmt::format_to(out, "float");
 
                 // FIXME: We don't support double constants yet
                 // if (f->bitwidth() <= 64)
@@ -565,35 +582,39 @@ struct LLVMIRPrinter : IRPrinter<LLVMIRPrinter, 0> {
             }
 
             case Type::Kind::Array:
-                return fmt::format(
+                return fmt::format_to(
+                    out,
                     "[{} x {}]",
                     as<ArrayType>(ty)->length(),
                     Ty(as<ArrayType>(ty)->element_type())
                 );
 
-            case Type::Kind::Struct:
-                return fmt::format("%{}", GetStructName(as<StructType>(ty)));
+            case Type::Kind::Struct: {
+                auto struct_type = as<StructType>(ty);
+                if (struct_type->named()) return fmt::format_to(out, "%struct.{}", struct_type->name());
+                return fmt::format_to(out, "%struct.{}", struct_type->index());
+            }
         }
 
         LCC_UNREACHABLE();
     }
 
-    /// Get the LLVM representation of a value.
-    auto Val(Value* v, bool include_type = true) -> std::string {
+    /// Write the LLVM representation of a value.
+    template <typename Out>
+    auto WriteVal(Out out, Value* v, bool include_type) -> Out {
         const auto Format =
             [&]<typename... Args>(
                 fmt::format_string<Args...> fmt,
                 Args&&... args
-            ) -> std::string {
-            std::string val;
-            if (include_type) fmt::format_to(It(val), "{} ", Ty(v->type()));
-            fmt::format_to(It(val), fmt, std::forward<Args>(args)...);
-            return val;
+            ) -> Out {
+            if (include_type) out = fmt::format_to(out, "{} ", Ty(v->type()));
+            return fmt::format_to(out, fmt, std::forward<Args>(args)...);
         };
 
         switch (v->kind()) {
             case Value::Kind::Block:
-                return fmt::format(
+                return fmt::format_to(
+                    out,
                     "{}%bb{}",
                     include_type ? "label " : "",
                     Index(as<Block>(v))
@@ -601,19 +622,15 @@ struct LLVMIRPrinter : IRPrinter<LLVMIRPrinter, 0> {
 
             /// A function name in the wild can only be a function pointer.
             case Value::Kind::Function: {
-                std::string val;
-                if (include_type) val += "ptr ";
+                if (include_type) out = fmt::format_to(out, "ptr ");
                 // TODO: Multiple names and all that.
-                val += FormatName(as<Function>(v)->names().at(0).name);
-                return val;
+                return WriteName(out, as<Function>(v)->names().at(0).name);
             }
 
             case Value::Kind::GlobalVariable: {
-                std::string val;
-                if (include_type) val += "ptr ";
+                if (include_type) out = fmt::format_to(out, "ptr ");
                 // TODO: Multiple names and all that.
-                val += FormatName(as<GlobalVariable>(v)->names().at(0).name);
-                return val;
+                return WriteName(out, as<GlobalVariable>(v)->names().at(0).name);
             }
 
             case Value::Kind::IntegerConstant:
@@ -663,35 +680,26 @@ struct LLVMIRPrinter : IRPrinter<LLVMIRPrinter, 0> {
 
                 /// String.
                 if (a->is_string_literal()) {
-                    static const auto FormatChar = [](u8 c) {
-                        return std::isprint(c) and c != '\"'
-                                 ? std::string{char(c)}
-                                 : fmt::format("\\{:02X}", u8(c));
-                    };
-
-                    return Format(
-                        "c\"{}\"",
-                        fmt::join(
-                            std::span<const char>(a->data(), a->size()) | vws::transform(FormatChar),
-                            ""
-                        )
-                    );
+                    out = Format("c\"");
+                    for (u8 c : std::span<const char>(a->data(), a->size())) {
+                        if (std::isprint(c) and c != '\"') *out++ = char(c);
+                        else out = fmt::format_to(out, "\\{:02X}", c);
+                    }
+                    *out++ = '"';
+                    return out;
                 }
 
                 /// Array.
                 else {
-                    return Format(
-                        "[{}]",
-                        fmt::join(
-                            vws::transform(
-                                std::span<const char>(a->data(), a->size()),
-                                [](const auto c) {
-                                    return fmt::format("i8 {}", u8(c));
-                                }
-                            ),
-                            ", "
-                        )
-                    );
+                    out = Format("[");
+                    bool first = true;
+                    for (u8 c : std::span<const char>(a->data(), a->size())) {
+                        if (first) first = false;
+                        else out = fmt::format_to(out, ", ");
+                        out = fmt::format_to(out, "i8 {}", c);
+                    }
+                    *out++ = ']';
+                    return out;
                 }
             }
 
@@ -705,6 +713,7 @@ struct LLVMIRPrinter : IRPrinter<LLVMIRPrinter, 0> {
             case Value::Kind::Call:
             case Value::Kind::Load:
             case Value::Kind::Phi:
+            case Value::Kind::Select:
             case Value::Kind::ZExt:
             case Value::Kind::SExt:
             case Value::Kind::Trunc:
@@ -755,3 +764,7 @@ struct LLVMIRPrinter : IRPrinter<LLVMIRPrinter, 0> {
 auto lcc::Module::as_llvm_ir() -> std::string {
     return LLVMIRPrinter::Print(this, false);
 }
+
+void lcc::Module::emit_llvm_ir(std::FILE* file) {
+    LLVMIRPrinter::Emit(this, false, file);
+}
@@ -22,11 +22,13 @@
 #include <lcc/target.hh>
 #include <lcc/utils.hh>
 #include <lcc/utils/ir_printer.hh>
+#include <lcc/utils/macros.hh>
 #include <lcc/version.hh>
 
 #include <fmt/format.h>
 #include <fmt/ranges.h>
 
+#include <cstdio>
 #include <cstdlib>
 #include <filesystem>
 #include <memory>
@@ -738,6 +740,7 @@ void Module::lower() {
     // Lowering not needed for LCC SSA IR or LLVM textual IR...
     if (
         context()->format() == Format::lcc_ssa_ir
+        or context()->format() == Format::lcc_binary_ir
         or context()->format() == Format::llvm_textual_ir
         or context()->format() == Format::wasm_textual
     ) return;
@@ -766,23 +769,39 @@ void Module::emit(std::filesystem::path output_file_path) {
         case Format::LCC_IR:
         case Format::LCC_SSA_IR: {
             if (to_stdout)
-                fmt::print("{}", as_lcc_ir(context()->option_use_colour()));
+                emit_lcc_ir(stdout, context()->option_use_colour());
             else {
-                auto lcc_ir = as_lcc_ir(false);
-                File::WriteOrTerminate(lcc_ir.data(), lcc_ir.size(), output_file_path);
+                auto* f = File::OpenForWritingOrTerminate(output_file_path);
+                defer { std::fclose(f); };
+                emit_lcc_ir(f, false);
+            }
+        } break;
+
+        case Format::LCC_BINARY_IR: {
+            if (to_stdout) emit_binary_ir(stdout);
+            else {
+                auto* f = File::OpenForWritingOrTerminate(output_file_path);
+                defer { std::fclose(f); };
+                emit_binary_ir(f);
             }
         } break;
 
         case Format::LLVM_TEXTUAL_IR: {
-            auto llvm_ir = as_llvm_ir();
-            if (to_stdout) fmt::print("{}", llvm_ir);
-            else File::WriteOrTerminate(llvm_ir.data(), llvm_ir.size(), output_file_path);
+            if (to_stdout) emit_llvm_ir(stdout);
+            else {
+                auto* f = File::OpenForWritingOrTerminate(output_file_path);
+                defer { std::fclose(f); };
+                emit_llvm_ir(f);
+            }
         } break;
 
         case Format::WASM_TEXTUAL: {
-            auto wasm_text = as_wat();
-            if (to_stdout) fmt::print("{}", wasm_text);
-            else File::WriteOrTerminate(wasm_text.data(), wasm_text.size(), output_file_path);
+            if (to_stdout) emit_wat(stdout);
+            else {
+                auto* f = File::OpenForWritingOrTerminate(output_file_path);
+                defer { std::fclose(f); };
+                emit_wat(f);
+            }
         } break;
 
         case Format::COFF_OBJECT:
@@ -0,0 +1,1040 @@
+#include <lccbase/context.hh>
+#include <lccbase/diags.hh>
+#include <lccbase/file.hh>
+#include <lcc/core.hh>
+#include <lcc/fractionals.hh>
+#include <lcc/ir/core.hh>
+#include <lcc/ir/module.hh>
+#include <lcc/ir/type.hh>
+#include <lcc/stringmap.hh>
+#include <lcc/utils.hh>
+#include <lcc/utils/output_buffer.hh>
+
+#include <cstdio>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/// Binary LCC IR
+///
+/// This is a compact encoding of the same module the textual IR
+/// describes, meant for handing modules between tools without
+/// paying for printing and parsing text. All integers are unsigned
+/// LEB128 unless stated otherwise.
+///
+///   magic "LCCB", version
+///   string table: count, then (length, bytes) per string
+///   type table:   count, then (tag, payload) per type; a type only
+///                 ever refers to types before it
+///   globals:      count, then (name, linkage, allocated type, init)
+///   functions:    count, then (name count, (name, linkage)..., type,
+///                 calling convention) for every function, followed
+///                 by the body of every function:
+///                   block count, block names,
+///                   instruction count, instruction types,
+///                   per block: instruction count, instructions
+///
+/// Instructions are numbered in order across the whole function;
+/// operands refer to instructions, parameters, blocks, globals and
+/// functions by index, so there are no names to resolve. Constants
+/// are stored inline. The types of all instructions are stored up
+/// front so that a reader can create a correctly typed stand-in for
+/// an instruction that is used before it is defined (e.g. by a phi).
+///
+/// Source locations and extra sections are not stored, just like in
+/// the textual IR.
+namespace lcc {
+namespace {
+constexpr std::string_view BinaryIRMagic = "LCCB";
+constexpr u64 BinaryIRVersion = 2;
+
+enum struct TypeTag : u8 {
+    Unknown,
+    Pointer,
+    Void,
+    Integer,
+    Fractional,
+    Array,
+    Function,
+    Struct,
+};
+
+/// What an operand refers to. This is stored in the low bits of
+/// the operand; the rest is the index of the value, if any.
+enum struct ValueTag : u8 {
+    None,
+    Inst,
+    Parameter,
+    Block,
+    Global,
+    Function,
+    IntegerConstant,
+    FractionalConstant,
+    ArrayConstant,
+    Poison,
+};
+
+constexpr u64 ValueTagBits = 4;
+constexpr u64 ValueTagMask = (1 << ValueTagBits) - 1;
+
+class BinaryIRWriter {
+    Module& mod;
+    OutputBuffer& out;
+
+    StringMap<usz> string_indices{};
+    std::vector<std::string_view> strings{};
+
+    std::unordered_map<Type*, usz> type_indices{};
+    std::vector<Type*> types{};
+
+    std::unordered_map<const Value*, usz> global_indices{};
+    std::unordered_map<const Value*, usz> function_indices{};
+
+    /// Indices of the instructions and blocks of the function that
+    /// is currently being written.
+    std::unordered_map<const Value*, usz> inst_indices{};
+    std::unordered_map<const Value*, usz> block_indices{};
+
+public:
+    BinaryIRWriter(Module& m, OutputBuffer& o) : mod(m), out(o) {}
+
+    void write_module() {
+        for (auto [i, var] : vws::enumerate(mod.vars()))
+            global_indices[var.get()] = usz(i);
+        for (auto [i, f] : vws::enumerate(mod.code()))
+            function_indices[f.get()] = usz(i);
+        Collect();
+
+        out.write(BinaryIRMagic);
+        Varint(BinaryIRVersion);
+
+        Varint(strings.size());
+        for (auto s : strings) {
+            Varint(s.size());
+            out.write(s);
+        }
+
+        Varint(types.size());
+        for (auto* t : types) WriteType(t);
+        out.maybe_flush();
+
+        Varint(mod.vars().size());
+        for (auto& var : mod.vars()) {
+            LCC_ASSERT(not var->names().empty(), "Global variable has no name");
+            Varint(StringIndex(var->names().front().name));
+            Varint(u64(var->names().front().linkage));
+            Varint(TypeIndex(var->allocated_type()));
+            WriteValue(var->init());
+        }
+
+        Varint(mod.code().size());
+        for (auto& f : mod.code()) {
+            Varint(f->names().size());
+            for (const auto& n : f->names()) {
+                Varint(StringIndex(n.name));
+                Varint(u64(n.linkage));
+            }
+            Varint(TypeIndex(f->type()));
+            Varint(u64(f->call_conv()));
+        }
+        out.maybe_flush();
+
+        for (auto& f : mod.code()) {
+            WriteFunctionBody(f.get());
+            out.maybe_flush();
+        }
+    }
+
+private:
+    void Varint(u64 value) {
+        while (value >= 0x80) {
+            out.write(char((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out.write(char(value));
+    }
+
+    auto StringIndex(std::string_view s) -> usz {
+        auto it = string_indices.find(s);
+        LCC_ASSERT(it != string_indices.end(), "String '{}' was not collected", s);
+        return it->second;
+    }
+
+    auto TypeIndex(Type* t) -> usz {
+        auto it = type_indices.find(t);
+        LCC_ASSERT(it != type_indices.end(), "Type was not collected");
+        return it->second;
+    }
+
+    void AddString(std::string_view s) {
+        if (string_indices.contains(s)) return;
+        /// Names are mostly handed out by value, so keep a view of
+        /// the key rather than the argument.
+        auto [it, _] = string_indices.emplace(std::string{s}, strings.size());
+        strings.push_back(it->first);
+    }
+
+    /// Add a type after all the types it refers to.
+    void AddType(Type* t) {
+        if (type_indices.contains(t)) return;
+        if (auto* a = cast<ArrayType>(t)) {
+            AddType(a->element_type());
+        } else if (auto* f = cast<FunctionType>(t)) {
+            AddType(f->ret());
+            for (auto* p : f->params()) AddType(p);
+        } else if (auto* s = cast<StructType>(t)) {
+            for (auto* m : s->members()) AddType(m);
+            if (s->named()) AddString(s->name());
+        }
+        type_indices[t] = types.size();
+        types.push_back(t);
+    }
+
+    void AddValue(Value* v) {
+        if (v and not is<Inst, Block, Parameter, Function, GlobalVariable>(v))
+            AddType(v->type());
+    }
+
+    /// Gather all strings and types so they can be written out
+    /// before anything that refers to them.
+    void Collect() {
+        for (auto& var : mod.vars()) {
+            for (const auto& n : var->names()) AddString(n.name);
+            AddType(var->allocated_type());
+            AddValue(var->init());
+        }
+
+        for (auto& f : mod.code()) {
+            for (const auto& n : f->names()) AddString(n.name);
+            AddType(f->type());
+            for (auto& b : f->blocks()) {
+                AddString(b->name());
+                for (auto& inst : b->instructions()) {
+                    auto* i = inst.get();
+                    AddType(i->type());
+                    switch (i->kind()) {
+                        case Value::Kind::Alloca:
+                            AddType(as<AllocaInst>(i)->allocated_type());
+                            break;
+                        case Value::Kind::Call:
+                            AddType(as<CallInst>(i)->function_type());
+                            break;
+                        case Value::Kind::GetElementPtr:
+                        case Value::Kind::GetMemberPtr:
+                            AddType(as<GEPBaseInst>(i)->base_type());
+                            break;
+                        default: break;
+                    }
+                    for (auto* c : i->children()) AddValue(c);
+                }
+            }
+        }
+    }
+
+    void WriteType(Type* t) {
+        if (t == Type::UnknownTy) {
+            Varint(u64(TypeTag::Unknown));
+        } else if (t->is_ptr()) {
+            Varint(u64(TypeTag::Pointer));
+        } else if (t->is_void()) {
+            Varint(u64(TypeTag::Void));
+        } else if (auto* i = cast<IntegerType>(t)) {
+            Varint(u64(TypeTag::Integer));
+            Varint(i->bitwidth());
+        } else if (auto* fr = cast<FractionalType>(t)) {
+            Varint(u64(TypeTag::Fractional));
+            Varint(fr->bitwidth());
+        } else if (auto* a = cast<ArrayType>(t)) {
+            Varint(u64(TypeTag::Array));
+            Varint(a->length());
+            Varint(TypeIndex(a->element_type()));
+        } else if (auto* f = cast<FunctionType>(t)) {
+            Varint(u64(TypeTag::Function));
+            Varint(TypeIndex(f->ret()));
+            Varint(f->params().size());
+            for (auto* p : f->params()) Varint(TypeIndex(p));
+            Varint(u64(f->variadic()) | u64(f->noreturn()) << 1);
+        } else if (auto* s = cast<StructType>(t)) {
+            Varint(u64(TypeTag::Struct));
+            /// Index of the name plus one, or zero if unnamed.
+            Varint(s->named() ? StringIndex(s->name()) + 1 : 0);
+            /// Alignment plus one; this wraps ‘not set’ around to zero.
+            Varint(u64(s->alignment()) + 1);
+            Varint(s->members().size());
+            for (auto* m : s->members()) Varint(TypeIndex(m));
+        } else {
+            Diag::ICE("Cannot write type {} to binary IR", t->string());
+        }
+    }
+
+    void Ref(ValueTag tag, usz index = 0) {
+        Varint(u64(index) << ValueTagBits | u64(tag));
+    }
+
+    void WriteValue(Value* v) {
+        if (not v) return Ref(ValueTag::None);
+        switch (v->kind()) {
+            case Value::Kind::Block:
+                return Ref(ValueTag::Block, block_indices.at(v));
+            case Value::Kind::Function:
+                return Ref(ValueTag::Function, function_indices.at(v));
+            case Value::Kind::GlobalVariable:
+                return Ref(ValueTag::Global, global_indices.at(v));
+            case Value::Kind::Parameter:
+                return Ref(ValueTag::Parameter, as<Parameter>(v)->index());
+
+            case Value::Kind::IntegerConstant:
+                Ref(ValueTag::IntegerConstant);
+                Varint(TypeIndex(v->type()));
+                Varint(as<IntegerConstant>(v)->value().value());
+                return;
+
+            case Value::Kind::FractionalConstant:
+                Ref(ValueTag::FractionalConstant);
+                Varint(TypeIndex(v->type()));
+                Varint(as<FractionalConstant>(v)->value().whole);
+                Varint(as<FractionalConstant>(v)->value().fractional);
+                return;
+
+            case Value::Kind::ArrayConstant: {
+                auto* a = as<ArrayConstant>(v);
+                Ref(ValueTag::ArrayConstant);
+                Varint(TypeIndex(v->type()));
+                Varint(a->is_string_literal());
+                Varint(a->size());
+                out.write(std::string_view{a->data(), a->size()});
+                return;
+            }
+
+            case Value::Kind::Poison:
+                Ref(ValueTag::Poison);
+                Varint(TypeIndex(v->type()));
+                return;
+
+            default:
+                LCC_ASSERT(is<Inst>(v));
+                return Ref(ValueTag::Inst, inst_indices.at(v));
+        }
+    }
+
+    void WriteFunctionBody(Function* f) {
+        inst_indices.clear();
+        block_indices.clear();
+
+        Varint(f->blocks().size());
+        for (auto& b : f->blocks()) {
+            block_indices[b.get()] = block_indices.size();
+            Varint(StringIndex(b->name()));
+        }
+
+        for (auto& b : f->blocks())
+            for (auto& i : b->instructions())
+                inst_indices[i.get()] = inst_indices.size();
+
+        Varint(inst_indices.size());
+        for (auto& b : f->blocks())
+            for (auto& i : b->instructions())
+                Varint(TypeIndex(i->type()));
+
+        for (auto& b : f->blocks()) {
+            Varint(b->instructions().size());
+            for (auto& i : b->instructions()) WriteInst(i.get());
+        }
+    }
+
+    void WriteInst(Inst* i) {
+        Varint(u64(i->kind()));
+        switch (i->kind()) {
+            case Value::Kind::Alloca:
+                Varint(TypeIndex(as<AllocaInst>(i)->allocated_type()));
+                return;
+
+            case Value::Kind::Call: {
+                auto* c = as<CallInst>(i);
+                Varint(TypeIndex(c->function_type()));
+                Varint(u64(c->call_conv()));
+                Varint(u64(c->is_tail_call()) | u64(c->is_force_inline()) << 1);
+                WriteValue(c->callee());
+                Varint(c->args().size());
+                for (auto* a : c->args()) WriteValue(a);
+                return;
+            }
+
+            case Value::Kind::GetElementPtr:
+            case Value::Kind::GetMemberPtr: {
+                auto* g = as<GEPBaseInst>(i);
+                Varint(TypeIndex(g->base_type()));
+                WriteValue(g->ptr());
+                WriteValue(g->idx());
+                return;
+            }
+
+            case Value::Kind::Intrinsic: {
+                auto* intrinsic = as<IntrinsicInst>(i);
+                Varint(u64(intrinsic->intrinsic_kind()));
+                Varint(intrinsic->operands().size());
+                for (auto* o : intrinsic->operands()) WriteValue(o);
+                return;
+            }
+
+            case Value::Kind::Load:
+                WriteValue(as<LoadInst>(i)->ptr());
+                return;
+
+            case Value::Kind::Phi: {
+                auto* phi = as<PhiInst>(i);
+                Varint(phi->operands().size());
+                for (const auto& incoming : phi->operands()) {
+                    WriteValue(incoming.value);
+                    Varint(block_indices.at(incoming.block));
+                }
+                return;
+            }
+
+            case Value::Kind::Select: {
+                auto* select = as<SelectInst>(i);
+                WriteValue(select->cond());
+                WriteValue(select->then_value());
+                WriteValue(select->else_value());
+                return;
+            }
+
+            case Value::Kind::Store:
+                WriteValue(as<StoreInst>(i)->val());
+                WriteValue(as<StoreInst>(i)->ptr());
+                return;
+
+            case Value::Kind::Branch:
+                Varint(block_indices.at(as<BranchInst>(i)->target()));
+                return;
+
+            case Value::Kind::CondBranch: {
+                auto* br = as<CondBranchInst>(i);
+                WriteValue(br->cond());
+                Varint(block_indices.at(br->then_block()));
+                Varint(block_indices.at(br->else_block()));
+                return;
+            }
+
+            case Value::Kind::Return:
+                WriteValue(as<ReturnInst>(i)->val());
+                return;
+
+            case Value::Kind::Unreachable:
+                return;
+
+            case Value::Kind::ZExt:
+            case Value::Kind::SExt:
+            case Value::Kind::Trunc:
+            case Value::Kind::Bitcast:
+            case Value::Kind::Neg:
+            case Value::Kind::Copy:
+            case Value::Kind::Compl:
+                WriteValue(as<UnaryInstBase>(i)->operand());
+                return;
+
+            case Value::Kind::Add:
+            case Value::Kind::Sub:
+            case Value::Kind::Mul:
+            case Value::Kind::SDiv:
+            case Value::Kind::UDiv:
+            case Value::Kind::SRem:
+            case Value::Kind::URem:
+            case Value::Kind::Shl:
+            case Value::Kind::Sar:
+            case Value::Kind::Shr:
+            case Value::Kind::And:
+            case Value::Kind::Or:
+            case Value::Kind::Xor:
+            case Value::Kind::Eq:
+            case Value::Kind::Ne:
+            case Value::Kind::SLt:
+            case Value::Kind::SLe:
+            case Value::Kind::SGt:
+            case Value::Kind::SGe:
+            case Value::Kind::ULt:
+            case Value::Kind::ULe:
+            case Value::Kind::UGt:
+            case Value::Kind::UGe:
+                WriteValue(as<BinaryInst>(i)->lhs());
+                WriteValue(as<BinaryInst>(i)->rhs());
+                return;
+
+            case Value::Kind::IntegerConstant:
+            case Value::Kind::FractionalConstant:
+            case Value::Kind::ArrayConstant:
+            case Value::Kind::Poison:
+            case Value::Kind::Block:
+            case Value::Kind::Function:
+            case Value::Kind::GlobalVariable:
+            case Value::Kind::Parameter:
+                LCC_UNREACHABLE();
+        }
+        LCC_UNREACHABLE();
+    }
+};
+
+/// Reads binary IR straight out of the buffer it is given; nothing
+/// is copied except into the module that is being built, so the
+/// buffer may just as well be a mapped file.
+///
+/// On malformed input, an error is issued, everything after that is
+/// read as zeroes, and no module is returned. The contents of the
+/// IR itself (e.g. that both operands of an add have the same type)
+/// are only checked by the usual IR assertions, just like with IR
+/// built by a frontend.
+class BinaryIRReader {
+    Context* ctx;
+    std::unique_ptr<Module> mod;
+    const char* ptr;
+    const char* end;
+    bool malformed{false};
+
+    std::vector<std::string_view> strings{};
+    std::vector<Type*> types{};
+    std::vector<GlobalVariable*> globals{};
+    std::vector<Function*> functions{};
+
+    /// State of the function that is currently being read.
+    Function* function{};
+    std::vector<Block*> blocks{};
+    std::vector<Type*> inst_types{};
+    std::vector<Inst*> insts{};
+
+    /// Stand-ins for instructions that are used before they are
+    /// read. These are replaced once the entire function is read.
+    std::vector<PoisonValue*> forward_refs{};
+    bool has_forward_refs{false};
+
+public:
+    BinaryIRReader(Context* context, std::span<const char> data)
+        : ctx(context),
+          mod(std::make_unique<Module>(context)),
+          ptr(data.data()),
+          end(data.data() + data.size()) {}
+
+    auto read_module() -> std::unique_ptr<Module> {
+        if (
+            usz(end - ptr) < BinaryIRMagic.size()
+            or std::string_view{ptr, BinaryIRMagic.size()} != BinaryIRMagic
+        ) {
+            Error("not a binary LCC IR file");
+            return nullptr;
+        }
+        ptr += BinaryIRMagic.size();
+
+        if (auto version = Varint(); version != BinaryIRVersion) {
+            Error("unsupported version {} (expected {})", version, BinaryIRVersion);
+            return nullptr;
+        }
+
+        auto string_count = Count();
+        strings.reserve(string_count);
+        for (usz i = 0; i < string_count; ++i) {
+            auto size = Count();
+            strings.emplace_back(ptr, size);
+            ptr += size;
+        }
+
+        auto type_count = Count();
+        types.reserve(type_count);
+        for (usz i = 0; i < type_count and not malformed; ++i)
+            types.push_back(ReadType());
+
+        auto global_count = Count();
+        for (usz i = 0; i < global_count and not malformed; ++i) {
+            auto name = StringRef();
+            auto linkage = Enum<Linkage>(Linkage::Reexported);
+            auto* type = TypeRef();
+            auto* init = ReadValue();
+            if (malformed) break;
+            globals.push_back(new (*mod) GlobalVariable(
+                mod.get(),
+                type,
+                std::string{name},
+                linkage,
+                init
+            ));
+        }
+
+        auto function_count = Count();
+        for (usz i = 0; i < function_count and not malformed; ++i) {
+            auto name_count = Count();
+            std::vector<IRName> names{};
+            for (usz n = 0; n < name_count; ++n) {
+                auto name = StringRef();
+                names.emplace_back(std::string{name}, Enum<Linkage>(Linkage::Reexported));
+            }
+            auto* type = cast<FunctionType>(TypeRef());
+            auto cc = Enum<CallConv>(CallConv::Glint);
+            if (not type) Error("function type expected");
+            if (names.empty()) Error("function without a name");
+            if (malformed) break;
+
+            auto* f = new (*mod) Function(
+                mod.get(),
+                std::move(names.front().name),
+                type,
+                names.front().linkage,
+                cc
+            );
+            for (auto& n : names | vws::drop(1))
+                f->add_name(std::move(n.name), n.linkage);
+            functions.push_back(f);
+        }
+
+        for (auto* f : functions) {
+            if (malformed) break;
+            ReadFunctionBody(f);
+        }
+
+        if (not malformed and ptr != end)
+            Error("trailing data after module");
+        if (malformed) return nullptr;
+        return std::move(mod);
+    }
+
+private:
+    template <typename... Args>
+    void Error(fmt::format_string<Args...> fmt, Args&&... args) {
+        if (malformed) return;
+        malformed = true;
+        Diag::Error(
+            "Malformed binary IR: {}",
+            fmt::format(fmt, std::forward<Args>(args)...)
+        );
+    }
+
+    auto Byte() -> u8 {
+        if (ptr == end) {
+            Error("unexpected end of input");
+            return 0;
+        }
+        return u8(*ptr++);
+    }
+
+    auto Varint() -> u64 {
+        u64 value{};
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            auto b = Byte();
+            value |= u64(b & 0x7f) << shift;
+            if (not (b & 0x80)) return value;
+        }
+        Error("integer too large");
+        return 0;
+    }
+
+    /// Read a count of things that each take up at least one byte,
+    /// so that a corrupt count can't make us allocate a huge buffer.
+    auto Count() -> usz {
+        auto count = Varint();
+        if (count > u64(end - ptr)) {
+            Error("count {} exceeds the size of the input", count);
+            return 0;
+        }
+        return usz(count);
+    }
+
+    auto Index(usz size, std::string_view what) -> usz {
+        auto index = Varint();
+        if (index >= size) {
+            Error("{} index {} out of range", what, index);
+            return 0;
+        }
+        return usz(index);
+    }
+
+    template <typename E>
+    auto Enum(E last) -> E {
+        auto value = Varint();
+        if (value > u64(last)) {
+            Error("invalid enumerator {}", value);
+            return E{};
+        }
+        return E(value);
+    }
+
+    auto StringRef() -> std::string_view {
+        if (strings.empty()) {
+            Error("string index out of range");
+            return {};
+        }
+        return strings[Index(strings.size(), "string")];
+    }
+
+    auto TypeRef() -> Type* {
+        if (types.empty()) {
+            Error("type index out of range");
+            return Type::UnknownTy;
+        }
+        return types[Index(types.size(), "type")];
+    }
+
+    auto BlockRef() -> Block* {
+        if (blocks.empty()) {
+            Error("block index out of range");
+            return nullptr;
+        }
+        return blocks[Index(blocks.size(), "block")];
+    }
+
+    auto ReadType() -> Type* {
+        switch (Enum<TypeTag>(TypeTag::Struct)) {
+            case TypeTag::Unknown: return Type::UnknownTy;
+            case TypeTag::Pointer: return Type::PtrTy;
+            case TypeTag::Void: return Type::VoidTy;
+            case TypeTag::Integer: return IntegerType::Get(ctx, usz(Varint()));
+            case TypeTag::Fractional: return FractionalType::Get(ctx, usz(Varint()));
+
+            case TypeTag::Array: {
+                auto length = usz(Varint());
+                auto* elem = TypeRef();
+                return ArrayType::Get(ctx, length, elem);
+            }
+
+            case TypeTag::Function: {
+                auto* ret = TypeRef();
+                auto param_count = Count();
+                std::vector<Type*> params{};
+                params.reserve(param_count);
+                for (usz i = 0; i < param_count; ++i) params.push_back(TypeRef());
+                auto flags = Varint();
+                return FunctionType::Get(ctx, ret, std::move(params), flags & 1, flags & 2);
+            }
+
+            case TypeTag::Struct: {
+                auto name_index = Varint();
+                std::string name{};
+                if (name_index) {
+                    if (name_index > strings.size()) Error("string index out of range");
+                    else name = strings[usz(name_index - 1)];
+                }
+                auto align = usz(Varint() - 1);
+                auto member_count = Count();
+                std::vector<Type*> members{};
+                members.reserve(member_count);
+                for (usz i = 0; i < member_count; ++i) members.push_back(TypeRef());
+                return StructType::Get(ctx, std::move(members), align, std::move(name));
+            }
+        }
+        LCC_UNREACHABLE();
+    }
+
+    /// Get the instruction with the given index, or a stand-in for
+    /// it if it hasn't been read yet.
+    auto InstRef(u64 index) -> Value* {
+        if (index >= insts.size()) {
+            Error("instruction index {} out of range", index);
+            return new (*mod) PoisonValue(Type::UnknownTy);
+        }
+        if (insts[usz(index)]) return insts[usz(index)];
+        auto*& ref = forward_refs[usz(index)];
+        if (not ref) ref = new (*mod) PoisonValue(inst_types[usz(index)]);
+        has_forward_refs = true;
+        return ref;
+    }
+
+    auto ReadValue() -> Value* {
+        auto ref = Varint();
+        auto index = ref >> ValueTagBits;
+        switch (ValueTag(ref & ValueTagMask)) {
+            case ValueTag::None: return nullptr;
+            case ValueTag::Inst: return InstRef(index);
+
+            case ValueTag::Parameter:
+                if (not function or index >= function->param_count()) break;
+                return function->param(usz(index));
+
+            case ValueTag::Block:
+                if (index >= blocks.size()) break;
+                return blocks[usz(index)];
+
+            case ValueTag::Global:
+                if (index >= globals.size()) break;
+                return globals[usz(index)];
+
+            case ValueTag::Function:
+                if (index >= functions.size()) break;
+                return functions[usz(index)];
+
+            case ValueTag::IntegerConstant: {
+                auto* type = TypeRef();
+                auto value = Varint();
+                if (not is<IntegerType>(type) or type->bits() > 64) {
+                    Error("integer constant of non-integer type");
+                    return nullptr;
+                }
+                return new (*mod) IntegerConstant(type, aint(type->bits(), value));
+            }
+
+            case ValueTag::FractionalConstant: {
+                auto* type = TypeRef();
+                FixedPointNumber value{};
+                value.whole = Varint();
+                value.fractional = Varint();
+                return new (*mod) FractionalConstant(type, value);
+            }
+
+            case ValueTag::ArrayConstant: {
+                auto* type = TypeRef();
+                bool is_string_literal = Varint();
+                auto size = Count();
+                std::vector<char> data{ptr, ptr + size};
+                ptr += size;
+                return new (*mod) ArrayConstant(type, std::move(data), is_string_literal);
+            }
+
+            case ValueTag::Poison:
+                return new (*mod) PoisonValue(TypeRef());
+        }
+
+        Error("invalid operand {:#x}", ref);
+        return nullptr;
+    }
+
+    /// Read an operand that must be present.
+    auto Operand() -> Value* {
+        auto* v = ReadValue();
+        if (not v) {
+            Error("missing operand");
+            return new (*mod) PoisonValue(Type::UnknownTy);
+        }
+        return v;
+    }
+
+    auto ReadInst(usz index) -> Inst* {
+        using K = Value::Kind;
+        auto kind = Enum<K>(K::UGe);
+        auto* type = inst_types[index];
+        if (kind < K::Alloca) {
+            Error("value kind {} is not an instruction", +kind);
+            return nullptr;
+        }
+
+        switch (kind) {
+            case K::Alloca: return new (*mod) AllocaInst(TypeRef());
+
+            case K::Call: {
+                auto* ftype = cast<FunctionType>(TypeRef());
+                auto cc = Enum<CallConv>(CallConv::Glint);
+                auto flags = Varint();
+                auto* callee = Operand();
+                auto arg_count = Count();
+                std::vector<Value*> args{};
+                args.reserve(arg_count);
+                for (usz i = 0; i < arg_count; ++i) args.push_back(Operand());
+                if (not ftype) {
+                    Error("call without a function type");
+                    return nullptr;
+                }
+                auto* call = new (*mod) CallInst(callee, ftype, std::move(args), {}, cc);
+                if (flags & 1) call->set_tail_call();
+                if (flags & 2) call->set_force_inline();
+                return call;
+            }
+
+            case K::GetElementPtr: {
+                auto* base = TypeRef();
+                auto* p = Operand();
+                auto* idx = Operand();
+                return new (*mod) GEPInst(base, p, idx);
+            }
+
+            case K::GetMemberPtr: {
+                auto* base = TypeRef();
+                auto* p = Operand();
+                auto* idx = Operand();
+                return new (*mod) GetMemberPtrInst(base, p, idx);
+            }
+
+            case K::Intrinsic: {
+                auto intrinsic = Enum<IntrinsicKind>(IntrinsicKind::SystemCall);
+                auto operand_count = Count();
+                std::vector<Value*> operands{};
+                operands.reserve(operand_count);
+                for (usz i = 0; i < operand_count; ++i) operands.push_back(Operand());
+                return new (*mod) IntrinsicInst(intrinsic, std::move(operands));
+            }
+
+            case K::Load: return new (*mod) LoadInst(type, Operand());
+
+            case K::Phi: {
+                auto* phi = new (*mod) PhiInst(type);
+                auto incoming_count = Count();
+                for (usz i = 0; i < incoming_count; ++i) {
+                    auto* value = Operand();
+                    auto* block = BlockRef();
+                    if (malformed) break;
+                    phi->set_incoming(value, block);
+                }
+                return phi;
+            }
+
+            case K::Select: {
+                auto* cond = Operand();
+                auto* then = Operand();
+                auto* otherwise = Operand();
+                return new (*mod) SelectInst(cond, then, otherwise);
+            }
+
+            case K::Store: {
+                auto* val = Operand();
+                auto* p = Operand();
+                return new (*mod) StoreInst(val, p);
+            }
+
+            case K::Branch: {
+                auto* target = BlockRef();
+                if (malformed) return nullptr;
+                return new (*mod) BranchInst(target);
+            }
+
+            case K::CondBranch: {
+                auto* cond = Operand();
+                auto* then = BlockRef();
+                auto* otherwise = BlockRef();
+                if (malformed) return nullptr;
+                return new (*mod) CondBranchInst(cond, then, otherwise);
+            }
+
+            case K::Return: return new (*mod) ReturnInst(ReadValue());
+            case K::Unreachable: return new (*mod) UnreachableInst();
+
+            case K::ZExt: return new (*mod) ZExtInst(Operand(), type);
+            case K::SExt: return new (*mod) SExtInst(Operand(), type);
+            case K::Trunc: return new (*mod) TruncInst(Operand(), type);
+            case K::Bitcast: return new (*mod) BitcastInst(Operand(), type);
+            case K::Neg: return new (*mod) NegInst(Operand());
+            case K::Copy: return new (*mod) CopyInst(Operand());
+            case K::Compl: return new (*mod) ComplInst(Operand());
+
+#define BINARY(name)                                    \
+    case K::name: {                                     \
+        auto* lhs = Operand();                          \
+        auto* rhs = Operand();                          \
+        return new (*mod) name##Inst(lhs, rhs);         \
+    }
+            BINARY(Add)
+            BINARY(Sub)
+            BINARY(Mul)
+            BINARY(SDiv)
+            BINARY(UDiv)
+            BINARY(SRem)
+            BINARY(URem)
+            BINARY(Shl)
+            BINARY(Sar)
+            BINARY(Shr)
+            BINARY(And)
+            BINARY(Or)
+            BINARY(Xor)
+            BINARY(Eq)
+            BINARY(Ne)
+            BINARY(SLt)
+            BINARY(SLe)
+            BINARY(SGt)
+            BINARY(SGe)
+            BINARY(ULt)
+            BINARY(ULe)
+            BINARY(UGt)
+            BINARY(UGe)
+#undef BINARY
+
+            case K::IntegerConstant:
+            case K::FractionalConstant:
+            case K::ArrayConstant:
+            case K::Poison:
+            case K::Block:
+            case K::Function:
+            case K::GlobalVariable:
+            case K::Parameter:
+                LCC_UNREACHABLE();
+        }
+        LCC_UNREACHABLE();
+    }
+
+    void ReadFunctionBody(Function* f) {
+        function = f;
+        blocks.clear();
+        insts.clear();
+        inst_types.clear();
+        forward_refs.clear();
+        has_forward_refs = false;
+
+        auto block_count = Count();
+        for (usz i = 0; i < block_count; ++i) {
+            auto* b = new (*mod) Block(std::string{StringRef()});
+            f->append_block(std::unique_ptr<Block>(b));
+            blocks.push_back(b);
+        }
+
+        auto inst_count = Count();
+        inst_types.reserve(inst_count);
+        for (usz i = 0; i < inst_count; ++i) inst_types.push_back(TypeRef());
+        insts.resize(inst_types.size());
+        forward_refs.resize(inst_types.size());
+
+        usz index = 0;
+        for (auto* b : blocks) {
+            auto count = Count();
+            for (usz i = 0; i < count and not malformed; ++i, ++index) {
+                if (index >= insts.size()) {
+                    Error("more instructions than declared");
+                    return;
+                }
+                auto* inst = ReadInst(index);
+                if (malformed) {
+                    delete inst;
+                    return;
+                }
+                b->insert(std::unique_ptr<Inst>(inst));
+                insts[index] = inst;
+            }
+        }
+
+        if (index != insts.size()) {
+            Error("fewer instructions than declared");
+            return;
+        }
+
+        if (not has_forward_refs) return;
+
+        std::unordered_map<Value*, Value*> replacements{};
+        for (auto [i, ref] : vws::enumerate(forward_refs))
+            if (ref) replacements[ref] = insts[usz(i)];
+
+        for (auto* b : blocks) {
+            for (auto& i : b->instructions()) {
+                i->replace_children<PoisonValue>([&](PoisonValue* p) -> Value* {
+                    auto it = replacements.find(p);
+                    return it == replacements.end() ? nullptr : it->second;
+                });
+            }
+        }
+
+        for (auto* ref : forward_refs) delete ref;
+    }
+};
+} // namespace
+
+auto Module::as_binary_ir() -> std::string {
+    OutputBuffer out{};
+    BinaryIRWriter{*this, out}.write_module();
+    return out.take();
+}
+
+void Module::emit_binary_ir(std::FILE* file) {
+    OutputBuffer out{file};
+    BinaryIRWriter{*this, out}.write_module();
+}
+
+auto Module::ParseBinary(Context* ctx, std::span<const char> data) -> std::unique_ptr<Module> {
+    return BinaryIRReader{ctx, data}.read_module();
+}
+
+auto Module::ParseBinary(Context* ctx, File& file) -> std::unique_ptr<Module> {
+    return ParseBinary(ctx, std::span<const char>{file.data(), file.size()});
+}
+} // namespace lcc
@@ -14,7 +14,8 @@
 #include <lccbase/context.hh>
 
 #include <algorithm>
-#include <unordered_map>
+#include <bit>
+#include <unordered_set>
 #include <variant>
 #include <vector>
 
@@ -42,6 +43,7 @@ constexpr auto ir_nary_inst_kind_to_mir(Value::Kind kind) -> MInst::Kind {
         case Kind::Intrinsic:
         case Kind::Load:
         case Kind::Phi:
+        case Kind::Select:
         case Kind::Store:
         case Kind::Branch:
         case Kind::CondBranch:
@@ -85,13 +87,10 @@ constexpr auto ir_nary_inst_kind_to_mir(Value::Kind kind) -> MInst::Kind {
     LCC_UNREACHABLE();
 }
 
-auto assign_virtual_register(
-    Module& mod,
-    std::unordered_map<Value*, usz>& virts,
-    Value* v
-) {
+auto assign_virtual_register(Module& mod, Value* v) {
     // Don't double-assign registers.
-    if (virts.contains(v)) return;
+    auto* inst = cast<Inst>(v);
+    if (not inst or inst->virtual_register()) return;
     // Otherwise, don't assign registers to values that don't require them.
     switch (v->kind()) {
         // Instructions that can never produce a value
@@ -119,6 +118,7 @@ auto assign_virtual_register(
         case Value::Kind::Intrinsic:
         case Value::Kind::Load:
         case Value::Kind::Phi:
+        case Value::Kind::Select:
         case Value::Kind::ZExt:
         case Value::Kind::SExt:
         case Value::Kind::Trunc:
@@ -152,11 +152,174 @@ auto assign_virtual_register(
             break;
     }
     // Actually assign unique virtual register to the given value.
-    virts[v] = mod.next_vreg();
+    inst->virtual_register(mod.next_vreg());
+}
+
+// Whether LowerSmallMemoryIntrinsic() can expand a MemCopy or MemSet
+// intrinsic inline, i.e. it has a small, constant size (and, for a
+// MemSet, a constant fill byte).
+auto IsSmallMemoryIntrinsic(IntrinsicInst* intrinsic) -> bool {
+    auto operands = intrinsic->operands();
+    LCC_ASSERT(operands.size() == 3, "Invalid number of operands to memory intrinsic");
+
+    auto* size = cast<IntegerConstant>(operands[2]);
+    if (not size or size->value().value() > x86_64::MaxInlineMemoryIntrinsicBytes)
+        return false;
+
+    // MemSet needs a constant byte to build the stored value from.
+    return intrinsic->intrinsic_kind() != IntrinsicKind::MemSet
+        or is<IntegerConstant>(operands[1]);
+}
+
+// Expand a MemCopy or MemSet intrinsic with a small, constant size into
+// loads and stores through general purpose registers. Returns false if
+// the intrinsic has to be lowered to a call instead.
+auto LowerSmallMemoryIntrinsic(
+    MIRBuildContext& build_ctx,
+    Function* function,
+    MFunction& f,
+    MBlock& bb,
+    IntrinsicInst* intrinsic
+) -> bool {
+    if (
+        not build_ctx.mod.context()->target()->is_arch_x86_64()
+        or not IsSmallMemoryIntrinsic(intrinsic)
+    ) return false;
+
+    auto operands = intrinsic->operands();
+    auto* size = as<IntegerConstant>(operands[2]);
+    auto* fill = cast<IntegerConstant>(operands[1]);
+
+    // Split into the largest moves that fit: 8, 4, 2, then 1 byte(s).
+    struct Chunk {
+        usz offset;
+        usz bytes;
+    };
+    std::vector<Chunk> chunks{};
+    for (usz offset = 0, total = size->value().value(); offset < total;) {
+        auto bytes = std::bit_floor(std::min(total - offset, x86_64::GeneralPurposeBytewidth));
+        chunks.push_back({offset, bytes});
+        offset += bytes;
+    }
+
+    // Address of a pointer operand plus an offset. Offsets into a local
+    // are folded into the operand; anything else gets an add.
+    auto Address = [&](Value* ptr, usz offset) -> MOperand {
+        auto ref = build_ctx.moperand_value_reference(function, f, ptr);
+        if (is<AllocaInst>(ptr)) {
+            auto local = std::get<MOperandLocal>(ref);
+            local.offset += i32(offset);
+            return local;
+        }
+
+        // There is no store into a global, so always get its address.
+        if (not offset and not std::holds_alternative<MOperandGlobal>(ref))
+            return ref;
+
+        auto address = MInst(
+            offset ? MInst::Kind::Add : MInst::Kind::Copy,
+            {build_ctx.mod.next_vreg(), x86_64::GeneralPurposeBitwidth}
+        );
+        address.location(intrinsic->location());
+        address.add_operand(ref);
+        if (offset) address.add_operand(MOperandImmediate(offset, 32));
+        bb.add_instruction(address);
+        return MOperandRegister(address.reg(), uint(address.regsize()));
+    };
+
+    auto Store = [&](MOperandRegister value, Chunk chunk) {
+        value.size = uint(chunk.bytes * 8);
+        auto store = MInst(MInst::Kind::Store, {build_ctx.virt(intrinsic), 0});
+        store.location(intrinsic->location());
+        store.add_operand(value);
+        store.add_operand(Address(operands[0], chunk.offset));
+        bb.add_instruction(store);
+    };
+
+    if (intrinsic->intrinsic_kind() == IntrinsicKind::MemSet) {
+        // Every store takes its value from the low bytes of one register
+        // holding the fill byte repeated across all eight bytes.
+        auto byte = fill->value().value() & 0xff;
+        auto value = MInst(MInst::Kind::Copy, {build_ctx.mod.next_vreg(), x86_64::GeneralPurposeBitwidth});
+        value.location(intrinsic->location());
+        value.add_operand(MOperandImmediate(byte * 0x0101010101010101, x86_64::GeneralPurposeBitwidth));
+        bb.add_instruction(value);
+
+        for (auto chunk : chunks) Store(MOperandRegister(value.reg(), uint(value.regsize())), chunk);
+        return true;
+    }
+
+    // Load everything before storing anything so that overlapping copies
+    // behave like memmove().
+    std::vector<MOperandRegister> values{};
+    for (auto chunk : chunks) {
+        auto load = MInst(MInst::Kind::Load, {build_ctx.mod.next_vreg(), uint(chunk.bytes * 8)});
+        load.location(intrinsic->location());
+        load.add_operand(Address(operands[1], chunk.offset));
+        bb.add_instruction(load);
+        values.emplace_back(load.reg(), uint(load.regsize()));
+    }
+
+    for (auto [value, chunk] : vws::zip(values, chunks)) Store(value, chunk);
+    return true;
+}
+
+// Lower a MemCopy or MemSet intrinsic to a call to `callee` (memcpy() or
+// memset()), which takes the intrinsic's operands in the same order.
+void LowerMemoryIntrinsicCall(
+    MIRBuildContext& build_ctx,
+    Function* function,
+    MFunction& f,
+    MBlock& bb,
+    IntrinsicInst* intrinsic,
+    Function* callee
+) {
+    LCC_ASSERT(intrinsic->operands().size() == 3, "Invalid number of operands to memory intrinsic");
+
+    auto* target = build_ctx.mod.context()->target();
+    std::vector<usz> arg_regs{};
+    // TODO: Static assert for handling of targets.
+    if (target->is_platform_windows()) {
+        rgs::transform(
+            cconv::msx64::arg_regs,
+            std::back_inserter(arg_regs),
+            [](auto r) { return +r; }
+        );
+    } else if (target->is_cconv_sysv()) {
+        rgs::transform(
+            cconv::sysv::arg_regs,
+            std::back_inserter(arg_regs),
+            [](auto r) { return +r; }
+        );
+    } else {
+        Diag::ICE("Unhandled target in argument lowering for memory intrinsic");
+    }
+
+    usz arg_regs_used = 0;
+    for (auto op : intrinsic->operands()) {
+        auto copy = MInst(
+            MInst::Kind::Copy,
+            {arg_regs.at(arg_regs_used++), uint(op->type()->bits())}
+        );
+        copy.location(intrinsic->location());
+        copy.add_operand(build_ctx.moperand_value_reference(function, f, op));
+        bb.add_instruction(copy);
+    }
+
+    auto call = MInst(MInst::Kind::Call, {0, 0});
+    call.location(intrinsic->location());
+    call.add_operand(callee);
+    bb.add_instruction(call);
 }
 } // namespace
 
 void MIRBuildContext::populate_virts() {
+    // Clear registers left over from any previous MIR generation.
+    for (auto& function : mod.code())
+        for (auto& block : function->blocks())
+            for (auto& instruction : block->instructions())
+                instruction->virtual_register(0);
+
     for (auto& function : mod.code()) {
         for (auto& block : function->blocks()) {
             for (
@@ -165,12 +328,14 @@ void MIRBuildContext::populate_virts() {
                     [](const auto& p) { return p.get(); }
                 )
             ) {
-                assign_virtual_register(mod, virts, instruction);
+                assign_virtual_register(mod, instruction);
                 for (auto child : instruction->children())
-                    assign_virtual_register(mod, virts, child);
+                    assign_virtual_register(mod, child);
             }
         }
     }
+
+    minsts.resize(mod.next_vreg_ref() - Module::first_virtual_register);
 }
 
 void MIRBuildContext::populate_funcs() {
@@ -194,6 +359,40 @@ void MIRBuildContext::populate_funcs() {
         CallConv::C
     );
 
+    // Unlike memcpy, memset is only declared if some MemSet can't be
+    // expanded inline, and a declaration already in the module is reused.
+    auto NeedsMemSetCall = [&](Inst* inst) {
+        auto* intrinsic = cast<IntrinsicInst>(inst);
+        return intrinsic
+           and intrinsic->intrinsic_kind() == IntrinsicKind::MemSet
+           and not (mod.context()->target()->is_arch_x86_64() and IsSmallMemoryIntrinsic(intrinsic));
+    };
+    auto needs_memset = rgs::any_of(mod.code(), [&](auto& function) {
+        return rgs::any_of(function->blocks(), [&](auto& block) {
+            return rgs::any_of(block->instructions(), [&](auto& inst) { return NeedsMemSetCall(inst.get()); });
+        });
+    });
+    if (needs_memset) {
+        auto existing = rgs::find_if(mod.code(), [](auto& function) { return function->has_name("memset"); });
+        if (existing != mod.code().end()) func_memset = existing->get();
+        else {
+            auto* memset_ty = FunctionType::Get(
+                mod.context(),
+                Type::VoidTy,
+                {Type::PtrTy,
+                 IntegerType::Get(mod.context(), 32),
+                 IntegerType::Get(mod.context(), x86_64::GeneralPurposeBitwidth)}
+            );
+            func_memset = new (mod) Function(
+                &mod,
+                "memset",
+                memset_ty,
+                Linkage::Imported,
+                CallConv::C
+            );
+        }
+    }
+
     // Give all the blocks unique names...
     // LCC MIR wants all blocks to have unique names.
     // It's important to make this change to the IR, since MIR block operands
@@ -239,15 +438,56 @@ void MIRBuildContext::populate_funcs() {
     }
 }
 
+void MIRBuildContext::index_minsts(MBlock& block) {
+    if (&block != indexed_block) {
+        indexed_block = &block;
+        indexed_count = 0;
+    }
+
+    auto& instructions = block.instructions();
+    for (; indexed_count < instructions.size(); ++indexed_count) {
+        auto reg = instructions.at(indexed_count).reg();
+        if (reg < Module::first_virtual_register) continue;
+        reg -= Module::first_virtual_register;
+
+        // Registers allocated during MIR generation are never looked up.
+        if (reg >= minsts.size()) continue;
+
+        // The first instruction to define a register is the one we want.
+        if (minsts.at(reg).block) continue;
+        minsts.at(reg) = {&block, indexed_count};
+    }
+}
+
+void MIRBuildContext::remove_minst(MBlock& block, usz virtual_register) {
+    // Record everything before removing, so the count stays in sync; the
+    // positions of later instructions are fixed up on lookup.
+    index_minsts(block);
+    block.remove_inst_by_reg(virtual_register);
+    indexed_count = block.instructions().size();
+}
+
 auto MIRBuildContext::minst_by_virtual_register(usz virtual_register) -> MInst* {
-    for (auto& mfunc : funcs) {
-        for (auto& mblock : mfunc.blocks()) {
-            for (auto& instruction : mblock.instructions()) {
-                if (instruction.reg() == virtual_register)
-                    return &instruction;
-            }
+    if (virtual_register < Module::first_virtual_register) return nullptr;
+    auto index = virtual_register - Module::first_virtual_register;
+    if (index >= minsts.size()) return nullptr;
+
+    auto& [block, position] = minsts.at(index);
+    if (not block) return nullptr;
+
+    // The instruction may have moved if something before it was removed.
+    auto& instructions = block->instructions();
+    if (position < instructions.size() and instructions.at(position).reg() == virtual_register)
+        return &instructions.at(position);
+
+    for (auto [i, instruction] : vws::enumerate(instructions)) {
+        if (instruction.reg() == virtual_register) {
+            position = usz(i);
+            return &instruction;
         }
     }
+
+    block = nullptr;
     return nullptr;
 }
 
@@ -258,7 +498,7 @@ auto MIRBuildContext::moperand_value_reference(
 ) -> MOperand {
     // Find MInst if possible, add to use count.
     usz regsize{0};
-    if (auto* inst = minst_by_virtual_register(virts[v])) {
+    if (auto* inst = minst_by_virtual_register(virt(v))) {
         inst->add_use();
         regsize = inst->regsize();
     }
@@ -341,13 +581,13 @@ auto MIRBuildContext::moperand_value_reference(
                         using Kinds = cconv::sysv::ParameterDescription::Parameter::Kinds;
                         case Kinds::SingleRegister:
                             return MOperandRegister(
-                                +cconv::sysv::arg_regs.at(param_info.arg_regs_used),
+                                parameter_registers.at(param),
                                 uint(param->type()->bits())
                             );
 
                         case Kinds::Scalar:
                             return MOperandRegister(
-                                +cconv::sysv::scalar_regs.at(param_info.arg_scalars_used),
+                                parameter_registers.at(param),
                                 uint(param->type()->bits()),
                                 Register::Category::FLOAT
                             );
@@ -424,6 +664,7 @@ auto MIRBuildContext::moperand_value_reference(
         case Value::Kind::Intrinsic:
         case Value::Kind::Load:
         case Value::Kind::Phi:
+        case Value::Kind::Select:
         case Value::Kind::Store:
         case Value::Kind::Branch:
         case Value::Kind::CondBranch:
@@ -467,7 +708,7 @@ auto MIRBuildContext::moperand_value_reference(
         register_category = Register::Category::FLOAT;
 
     return MOperandRegister{
-        virts[v],
+        virt(v),
         uint(regsize),
         register_category
     };
@@ -523,6 +764,44 @@ auto Module::mir() -> std::vector<MFunction> {
         }
     }
 
+    // SysV ONLY: Copy register parameters into virtual registers
+    if (context()->target()->is_cconv_sysv()) {
+        for (auto [f_index, function] : vws::enumerate(code())) {
+            auto& f = build_ctx.funcs.at(usz(f_index));
+            if (f.blocks().empty()) continue;
+
+            auto param_desc = cconv::sysv::parameter_description(function.get());
+            for (auto& param : function->params()) {
+                auto param_info = param_desc.info.at(param->index());
+                usz arg_reg{};
+                auto category = Register::Category::DEFAULT;
+                switch (param_info.kind()) {
+                    using Kinds = cconv::sysv::ParameterDescription::Parameter::Kinds;
+                    case Kinds::SingleRegister:
+                        arg_reg = +cconv::sysv::arg_regs.at(param_info.arg_regs_used);
+                        break;
+
+                    case Kinds::Scalar:
+                        arg_reg = +cconv::sysv::scalar_regs.at(param_info.arg_scalars_used);
+                        category = Register::Category::FLOAT;
+                        break;
+
+                    // Double register parameters are stored straight from their argument
+                    // registers (see StoreInst), and memory parameters stay where they are.
+                    case Kinds::DoubleRegister:
+                    case Kinds::Memory:
+                        continue;
+                }
+
+                auto bits = uint(param->type()->bits());
+                auto copy = MInst(MInst::Kind::Copy, {next_vreg(), bits, category});
+                copy.add_operand(MOperandRegister(arg_reg, bits, category));
+                f.blocks().at(0).add_instruction(copy);
+                build_ctx.parameter_registers[param.get()] = copy.reg();
+            }
+        }
+    }
+
     // The actual generation part
     for (auto [f_index, function] : vws::enumerate(code())) {
         auto& f = build_ctx.funcs.at(usz(f_index));
@@ -536,6 +815,10 @@ auto Module::mir() -> std::vector<MFunction> {
                     }
                 )
             ) {
+                // Make machine instructions generated so far findable by
+                // virtual register.
+                build_ctx.index_minsts(bb);
+
                 auto register_category = Register::Category::UNSPECIFIED;
                 if (is<FractionalType>(instruction->type()))
                     register_category = Register::Category::FLOAT;
@@ -557,7 +840,7 @@ auto Module::mir() -> std::vector<MFunction> {
                         auto* copy_ir = as<CopyInst>(instruction);
                         auto copy = MInst(
                             MInst::Kind::Copy,
-                            {build_ctx.virts[instruction],
+                            {build_ctx.virt(instruction),
                              uint(copy_ir->type()->bits()),
                              register_category}
                         );
@@ -585,7 +868,7 @@ auto Module::mir() -> std::vector<MFunction> {
 
                         auto phi = MInst(
                             MInst::Kind::Phi,
-                            {build_ctx.virts[instruction],
+                            {build_ctx.virt(instruction),
                              uint(phi_ir->type()->bits()),
                              register_category}
                         );
@@ -597,6 +880,27 @@ auto Module::mir() -> std::vector<MFunction> {
                         bb.add_instruction(phi);
                     } break;
 
+                    case Value::Kind::Select: {
+                        auto* select_ir = as<SelectInst>(instruction);
+                        auto select = MInst(
+                            MInst::Kind::Select,
+                            {build_ctx.virt(instruction),
+                             uint(select_ir->type()->bits()),
+                             register_category}
+                        );
+                        select.location(select_ir->location());
+                        select.add_operand(
+                            build_ctx.moperand_value_reference(function.get(), f, select_ir->cond())
+                        );
+                        select.add_operand(
+                            build_ctx.moperand_value_reference(function.get(), f, select_ir->then_value())
+                        );
+                        select.add_operand(
+                            build_ctx.moperand_value_reference(function.get(), f, select_ir->else_value())
+                        );
+                        bb.add_instruction(select);
+                    } break;
+
                     case Value::Kind::Call: {
                         auto* call_ir = as<CallInst>(instruction);
 
@@ -677,7 +981,7 @@ auto Module::mir() -> std::vector<MFunction> {
                                         auto arg_mir = build_ctx.moperand_value_reference(function.get(), f, arg);
                                         LCC_ASSERT(std::holds_alternative<MOperandRegister>(arg_mir));
                                         auto arg_reg = std::get<MOperandRegister>(arg_mir);
-                                        bb.remove_inst_by_reg(arg_reg.value);
+                                        build_ctx.remove_minst(bb, arg_reg.value);
 
                                         // Get a reference to a pointer to the argument.
                                         Value* arg_ptr{nullptr};
@@ -812,7 +1116,7 @@ auto Module::mir() -> std::vector<MFunction> {
 
                                                     // In doing the copying and stuff, we have effectively loaded the thing
                                                     // manually. So, we remove the load that was there before.
-                                                    bb.remove_inst_by_reg(build_ctx.virts[load_arg]);
+                                                    build_ctx.remove_minst(bb, build_ctx.virt(load_arg));
 
                                                 } else {
                                                     LCC_TODO(
@@ -848,7 +1152,7 @@ auto Module::mir() -> std::vector<MFunction> {
 
                         auto call = MInst(
                             MInst::Kind::Call,
-                            {build_ctx.virts[instruction],
+                            {build_ctx.virt(instruction),
                              uint(call_ir->function_type()->ret()->bits()),
                              register_category}
                         );
@@ -882,46 +1186,21 @@ auto Module::mir() -> std::vector<MFunction> {
                     case Value::Kind::Intrinsic: {
                         auto intrinsic = as<IntrinsicInst>(instruction);
                         switch (intrinsic->intrinsic_kind()) {
-                            case IntrinsicKind::MemCopy: {
-                                LCC_ASSERT(intrinsic->operands().size() == 3, "Invalid number of operands to memcpy intrinsic");
-
-                                std::vector<usz> arg_regs{};
-                                // TODO: Static assert for handling of targets.
-                                if (_ctx->target()->is_platform_windows()) {
-                                    rgs::transform(
-                                        cconv::msx64::arg_regs,
-                                        std::back_inserter(arg_regs),
-                                        [](auto r) { return +r; }
-                                    );
-                                } else if (_ctx->target()->is_cconv_sysv()) {
-                                    rgs::transform(
-                                        cconv::sysv::arg_regs,
-                                        std::back_inserter(arg_regs),
-                                        [](auto r) { return +r; }
-                                    );
-                                } else {
-                                    Diag::ICE("Unhandled target in argument lowering for memcpy intrinsic");
-                                }
-
-                                usz arg_regs_used = 0;
-                                for (auto op : intrinsic->operands()) {
-                                    auto copy = MInst(
-                                        MInst::Kind::Copy,
-                                        {arg_regs.at(arg_regs_used++), uint(op->type()->bits())}
-                                    );
-                                    copy.location(intrinsic->location());
-                                    copy.add_operand(build_ctx.moperand_value_reference(function.get(), f, op));
-                                    bb.add_instruction(copy);
-                                }
+                            case IntrinsicKind::MemCopy:
+                                // Small copies don't need a call.
+                                if (LowerSmallMemoryIntrinsic(build_ctx, function.get(), f, bb, intrinsic))
+                                    break;
+                                LowerMemoryIntrinsicCall(build_ctx, function.get(), f, bb, intrinsic, build_ctx.func_memcpy);
+                                break;
 
-                                auto call = MInst(MInst::Kind::Call, {0, 0});
-                                call.location(intrinsic->location());
-                                call.add_operand(build_ctx.func_memcpy);
-                                bb.add_instruction(call);
-                            } break;
+                            case IntrinsicKind::MemSet:
+                                if (LowerSmallMemoryIntrinsic(build_ctx, function.get(), f, bb, intrinsic))
+                                    break;
+                                LCC_ASSERT(build_ctx.func_memset, "MemSet needs memset(), but it was not declared");
+                                LowerMemoryIntrinsicCall(build_ctx, function.get(), f, bb, intrinsic, build_ctx.func_memset);
+                                break;
 
                             case IntrinsicKind::DebugTrap:
-                            case IntrinsicKind::MemSet:
                             case IntrinsicKind::SystemCall:
                                 LCC_TODO("Generate MIR for IntrinsicInst");
                         }
@@ -930,7 +1209,7 @@ auto Module::mir() -> std::vector<MFunction> {
                     case Value::Kind::GetElementPtr: {
                         auto* gep_ir = as<GEPInst>(instruction);
                         Register reg{
-                            build_ctx.virts[instruction],
+                            build_ctx.virt(instruction),
                             uint(gep_ir->type()->bits()),
                             register_category
                         };
@@ -977,7 +1256,7 @@ auto Module::mir() -> std::vector<MFunction> {
 
                     case Value::Kind::GetMemberPtr: {
                         auto gmp_ir = as<GetMemberPtrInst>(instruction);
-                        auto reg = Register{build_ctx.virts[instruction], uint(gmp_ir->type()->bits())};
+                        auto reg = Register{build_ctx.virt(instruction), uint(gmp_ir->type()->bits())};
 
                         LCC_ASSERT(
                             gmp_ir->idx()->kind() == Value::Kind::IntegerConstant,
@@ -1012,7 +1291,7 @@ auto Module::mir() -> std::vector<MFunction> {
                         // size is zero.
                         auto branch = MInst(
                             MInst::Kind::Branch,
-                            {build_ctx.virts[instruction], 0}
+                            {build_ctx.virt(instruction), 0}
                         );
                         branch.location(branch_ir->location());
                         auto op = build_ctx.moperand_value_reference(function.get(), f, branch_ir->target());
@@ -1033,7 +1312,7 @@ auto Module::mir() -> std::vector<MFunction> {
                         // size is zero.
                         auto branch = MInst(
                             MInst::Kind::CondBranch,
-                            {build_ctx.virts[instruction], 0}
+                            {build_ctx.virt(instruction), 0}
                         );
                         branch.location(branch_ir->location());
                         branch.add_operand(build_ctx.moperand_value_reference(function.get(), f, branch_ir->cond()));
@@ -1061,7 +1340,7 @@ auto Module::mir() -> std::vector<MFunction> {
                         // size is zero.
                         auto unreachable = MInst(
                             MInst::Kind::Unreachable,
-                            {build_ctx.virts[instruction], 0}
+                            {build_ctx.virt(instruction), 0}
                         );
                         unreachable.location(as<UnreachableInst>(instruction)->location());
                         bb.add_instruction(unreachable);
@@ -1090,7 +1369,7 @@ auto Module::mir() -> std::vector<MFunction> {
 
                             auto store_a = MInst(
                                 MInst::Kind::Store,
-                                {build_ctx.virts[instruction], 0}
+                                {build_ctx.virt(instruction), 0}
                             );
                             store_a.location(store_ir->location());
                             store_a.add_operand(reg_a);
@@ -1106,7 +1385,7 @@ auto Module::mir() -> std::vector<MFunction> {
 
                             auto store_b = MInst(
                                 MInst::Kind::Store,
-                                {build_ctx.virts[instruction], 0}
+                                {build_ctx.virt(instruction), 0}
                             );
                             store_b.location(store_ir->location());
                             store_b.add_operand(reg_b);
@@ -1144,7 +1423,7 @@ auto Module::mir() -> std::vector<MFunction> {
 
                                         auto store_a = MInst(
                                             MInst::Kind::Store,
-                                            {build_ctx.virts[instruction], 0}
+                                            {build_ctx.virt(instruction), 0}
                                         );
                                         store_a.location(store_ir->location());
                                         store_a.add_operand(reg_a);
@@ -1160,7 +1439,7 @@ auto Module::mir() -> std::vector<MFunction> {
 
                                         auto store_b = MInst(
                                             MInst::Kind::Store,
-                                            {build_ctx.virts[instruction], 0}
+                                            {build_ctx.virt(instruction), 0}
                                         );
                                         store_b.location(store_ir->location());
                                         store_b.add_operand(reg_b);
@@ -1180,7 +1459,7 @@ auto Module::mir() -> std::vector<MFunction> {
                         // size is zero.
                         auto store = MInst(
                             MInst::Kind::Store,
-                            {build_ctx.virts[instruction], 0}
+                            {build_ctx.virt(instruction), 0}
                         );
                         store.location(store_ir->location());
                         store.add_operand(build_ctx.moperand_value_reference(function.get(), f, store_ir->val()));
@@ -1192,7 +1471,7 @@ auto Module::mir() -> std::vector<MFunction> {
                         auto* load_ir = as<LoadInst>(instruction);
                         auto load = MInst(
                             MInst::Kind::Load,
-                            {build_ctx.virts[instruction],
+                            {build_ctx.virt(instruction),
                              uint(load_ir->type()->bits()),
                              register_category}
                         );
@@ -1263,7 +1542,7 @@ auto Module::mir() -> std::vector<MFunction> {
                         if (ret_ir->has_value()) regsize = ret_ir->val()->type()->bits();
                         auto ret = MInst(
                             MInst::Kind::Return,
-                            {build_ctx.virts[instruction], uint(regsize), register_category}
+                            {build_ctx.virt(instruction), uint(regsize), register_category}
                         );
                         ret.location(ret_ir->location());
                         if (ret_ir->has_value())
@@ -1281,7 +1560,7 @@ auto Module::mir() -> std::vector<MFunction> {
                         auto* unary_ir = as<UnaryInstBase>(instruction);
                         auto unary = MInst(
                             ir_nary_inst_kind_to_mir(unary_ir->kind()),
-                            {build_ctx.virts[instruction],
+                            {build_ctx.virt(instruction),
                              uint(unary_ir->type()->bits()),
                              register_category}
                         );
@@ -1317,7 +1596,7 @@ auto Module::mir() -> std::vector<MFunction> {
                         auto* binary_ir = as<BinaryInst>(instruction);
                         auto binary = MInst(
                             ir_nary_inst_kind_to_mir(binary_ir->kind()),
-                            {build_ctx.virts[instruction],
+                            {build_ctx.virt(instruction),
                              uint(binary_ir->type()->bits()),
                              register_category}
                         );
@@ -1332,6 +1611,7 @@ auto Module::mir() -> std::vector<MFunction> {
                     } break;
                 }
             }
+            build_ctx.index_minsts(bb);
         }
     }
 
@@ -1366,7 +1646,7 @@ auto Module::mir() -> std::vector<MFunction> {
                         while (uses and uses--) copy.add_use();
 
                         static_assert(
-                            std::variant_size_v<MOperand> == 6,
+                            std::variant_size_v<MOperand> == 7,
                             "Exhaustive handling of MOperand alternatives in phi2copy"
                         );
                         if (std::holds_alternative<MOperandImmediate>(op)) {
@@ -1387,6 +1667,8 @@ auto Module::mir() -> std::vector<MFunction> {
                             copy.add_operand(std::get<MOperandFunction>(op));
                         } else if (std::holds_alternative<MOperandBlock>(op)) {
                             copy.add_operand(std::get<MOperandBlock>(op));
+                        } else if (std::holds_alternative<MOperandMemory>(op)) {
+                            Diag::ICE("Phi value cannot be a memory operand");
                         } else LCC_ASSERT(false, "Unhandled MIR operand alternative");
 
                         phi_operand_block->add_instruction(copy, true);
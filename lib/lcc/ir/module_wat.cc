@@ -4,91 +4,78 @@
 #include <lcc/ir/module.hh>
 #include <lcc/ir/type.hh>
 #include <lcc/utils.hh>
+#include <lcc/utils/output_buffer.hh>
 
+#include <cstdio>
 #include <string>
-#include <unordered_map>
 
 namespace lcc {
 
 // Forward declaration
-auto wat_inst(Module& m, Inst* i) -> std::string;
-
-auto wat_parameter_name(Parameter* p) -> std::string {
-    LCC_ASSERT(p);
-    return fmt::format("$p{}", p->index());
-}
-
-auto wat_block_name(Block* bb) -> std::string {
-    LCC_ASSERT(bb);
-    return fmt::format("${}", bb->name());
-}
+void wat_inst(OutputBuffer& out, Module& m, Inst* i);
 
 auto wat_function_name(Function* f) -> std::string {
     LCC_ASSERT(f);
     if (f->names().empty()) {
         LCC_TODO("WAT Handle unnamed function");
-        return fmt::format("lambda{}", "TODO");
+        return "lambda";
     }
-    return fmt::format("${}", f->names().at(0).name);
+    return f->names().at(0).name;
 }
 
-auto wat_local_name(AllocaInst* a) -> std::string {
+auto wat_local_index(AllocaInst* a) -> usz {
     LCC_ASSERT(a);
     // FIXME: hacky
-    return fmt::format("$tmp{}", a->instructions_before_this().size());
+    return a->instructions_before_this().size();
 }
 
 auto wat_global_name(GlobalVariable* g) -> std::string {
     LCC_ASSERT(g);
     LCC_ASSERT(g->names().size());
-    return fmt::format("${}", g->names().at(0).name);
+    return g->names().at(0).name;
 }
 
-auto wat_type(Module& m, Type* t) -> std::string {
+void wat_type(OutputBuffer& out, Module& m, Type* t) {
     switch (t->kind) {
         case Type::Kind::Unknown:
             LCC_UNREACHABLE();
 
         case Type::Kind::Integer: {
             auto i = as<IntegerType>(t);
-            if (i->bitwidth() <= 32) return "i32";
-            if (i->bitwidth() <= 64) return "i64";
+            if (i->bitwidth() <= 32) return out.write("i32");
+            if (i->bitwidth() <= 64) return out.write("i64");
             LCC_ASSERT(false, "WAT Overlarge integer type");
         }
 
         case Type::Kind::Fractional: {
             auto f = as<FractionalType>(t);
-            if (f->bitwidth() <= 32) return "f32";
-            if (f->bitwidth() <= 64) return "f64";
+            if (f->bitwidth() <= 32) return out.write("f32");
+            if (f->bitwidth() <= 64) return out.write("f64");
             LCC_ASSERT(false, "WAT Overlarge fractional type");
         }
 
         // In WebAssembly, pointers are i32's that contain an offset into the linear memory region.
-        case Type::Kind::Pointer: return "i32";
+        case Type::Kind::Pointer: return out.write("i32");
 
         // In WebAssembly 3.0, structs may be represented by the `struct` and
         // `field` operators.
         case Type::Kind::Struct: {
             auto s = as<StructType>(t);
-            std::string fields{};
+            out.write("(struct");
             for (auto member : s->members()) {
-                fields += fmt::format(
-                    " {}",
-                    wat_type(m, member)
-                );
+                out.write(' ');
+                wat_type(out, m, member);
             }
-            return fmt::format(
-                "(struct{})",
-                fields
-            );
+            out.write(')');
+            return;
         }
 
         case Type::Kind::Array: {
             auto a = as<ArrayType>(t);
-            return fmt::format(
-                "(array {})",
-                wat_type(m, a->element_type())
-            );
+            out.write("(array ");
+            wat_type(out, m, a->element_type());
+            out.write(')');
+            return;
         }
 
         case Type::Kind::Void:
@@ -101,9 +88,33 @@ auto wat_type(Module& m, Type* t) -> std::string {
     LCC_UNREACHABLE();
 }
 
-// Get WAT representation of a given value. NOTE: May result in
+// Whether the WAT representation of a given value is already wrapped in
+// parentheses; this must agree with what wat_value() writes.
+auto wat_is_parenthesised(Value* v) -> bool {
+    switch (v->kind()) {
+        case Value::Kind::IntegerConstant:
+        case Value::Kind::FractionalConstant:
+        case Value::Kind::GlobalVariable:
+        case Value::Kind::Parameter:
+        case Value::Kind::Alloca:
+            return false;
+
+        // Arguments are pushed first, so a call begins with its first argument.
+        case Value::Kind::Call: {
+            auto c = as<CallInst>(v);
+            return not c->args().empty() and wat_is_parenthesised(c->args().front());
+        }
+
+        case Value::Kind::Load:
+            return wat_is_parenthesised(as<LoadInst>(v)->ptr());
+
+        default: return true;
+    }
+}
+
+// Write WAT representation of a given value. NOTE: May result in
 // multiple WAT instructions.
-auto wat_value(Module& m, Value* v) -> std::string {
+void wat_value(OutputBuffer& out, Module& m, Value* v) {
     LCC_ASSERT(v);
 
     switch (v->kind()) {
@@ -115,10 +126,10 @@ auto wat_value(Module& m, Value* v) -> std::string {
         case Value::Kind::IntegerConstant: {
             auto integer_value = as<IntegerConstant>(v)->value().value();
             if (v->type()->bits() <= 32)
-                return fmt::format("i32.const {}", integer_value);
+                return out.print("i32.const {}", integer_value);
 
             if (v->type()->bits() <= 64)
-                return fmt::format("i64.const {}", integer_value);
+                return out.print("i64.const {}", integer_value);
 
             Diag::ICE(
                 "WAT cannot handle integer constant of bitsize {}",
@@ -129,77 +140,38 @@ auto wat_value(Module& m, Value* v) -> std::string {
         case Value::Kind::FractionalConstant: {
             auto fractional_value = as<FractionalConstant>(v)->value();
             if (v->type()->bits() <= 32)
-                return fmt::format("f32.const {}", fractional_value);
+                return out.print("f32.const {}", fractional_value);
 
             LCC_TODO("Convert fractional constant to f64 WAT constant");
         }
 
-        case Value::Kind::GlobalVariable: {
-            auto g = as<GlobalVariable>(v);
-            return fmt::format("global.get {}", wat_global_name(g));
-        }
+        case Value::Kind::GlobalVariable:
+            return out.print("global.get ${}", wat_global_name(as<GlobalVariable>(v)));
 
         case Value::Kind::Block: {
-            std::string o{};
-            for (auto& c : as<Block>(v)->instructions())
-                o += fmt::format("{}\n", wat_value(m, c.get()));
-            return fmt::format(
-                "(block {}\n{})",
-                wat_block_name(as<Block>(v)),
-                o
-            );
-        }
-
-        case Value::Kind::Parameter: {
-            return fmt::format(
-                "local.get {}",
-                wat_parameter_name(as<Parameter>(v))
-            );
-        }
-
-        case Value::Kind::Alloca: {
-            auto a = as<AllocaInst>(v);
-            return fmt::format("local.get {}", wat_local_name(a));
+            out.print("(block ${}\n", as<Block>(v)->name());
+            for (auto& c : as<Block>(v)->instructions()) {
+                wat_value(out, m, c.get());
+                out.write('\n');
+            }
+            out.write(')');
+            return;
         }
 
-        case Value::Kind::Call: {
-            auto c = as<CallInst>(v);
-
-            std::string o{};
-
-            // Push argument values to stack
-            for (auto a : c->args()) {
-                o += wat_value(m, a);
-                o += '\n';
-            }
+        case Value::Kind::Parameter:
+            return out.print("local.get $p{}", as<Parameter>(v)->index());
 
-            // Perform call
-            switch (c->callee()->kind()) {
-                default: LCC_ASSERT(false, "WAT Unhandled callee kind");
-                case Value::Kind::Function: {
-                    o += fmt::format(
-                        "call {}",
-                        as<Function>((c->callee()))->names().at(0).name
-                    );
-                } break;
-            }
+        case Value::Kind::Alloca:
+            return out.print("local.get $tmp{}", wat_local_index(as<AllocaInst>(v)));
 
-            return o;
-        }
+        case Value::Kind::Call:
+        case Value::Kind::Load:
+            return wat_inst(out, m, as<Inst>(v));
 
         // These are not values (probably instructions).
         case Value::Kind::Return:
         case Value::Kind::Store: LCC_UNREACHABLE();
 
-        case Value::Kind::Load: {
-            auto l = as<LoadInst>(v);
-            return fmt::format(
-                "{}\n{}.load",
-                wat_value(m, l->ptr()),
-                wat_type(m, l->type())
-            );
-        }
-
         case Value::Kind::ZExt:
         case Value::Kind::SExt:
         case Value::Kind::Trunc:
@@ -229,8 +201,9 @@ auto wat_value(Module& m, Value* v) -> std::string {
         case Value::Kind::UGe:
         case Value::Kind::Mul:
         case Value::Kind::Add:
-        case Value::Kind::Sub: {
-            return wat_inst(m, as<Inst>(v));
+        case Value::Kind::Sub:
+        case Value::Kind::Select: {
+            return wat_inst(out, m, as<Inst>(v));
         }
 
         case Value::Kind::GetElementPtr:
@@ -247,33 +220,18 @@ auto wat_value(Module& m, Value* v) -> std::string {
     LCC_UNREACHABLE();
 }
 
-auto wat_inst(Module& m, Inst* i) -> std::string {
-    LCC_ASSERT(i);
-
-    // Ensure a string is wrapped in parentheses (begins with opening parens,
-    // ends with closing parens). Assumes input has matched parens.
-    const auto paren_wrap = [](std::string in) -> std::string {
-        if (in.size() and in.front() != '(') {
-            return fmt::format("({})", in);
-        }
-        return in;
-    };
+// Write a value, ensuring it is wrapped in parentheses.
+void wat_operand(OutputBuffer& out, Module& m, Value* v) {
+    if (wat_is_parenthesised(v)) return wat_value(out, m, v);
+    out.write('(');
+    wat_value(out, m, v);
+    out.write(')');
+}
 
-    const auto binary = [&](std::string_view op) {
-        LCC_ASSERT(
-            i->type()->bits() <= 64,
-            "WAT: Overlarge type of binary instruction"
-        );
-        auto b = as<BinaryInst>(i);
-        return fmt::format(
-            "({} {} {})",
-            op,
-            paren_wrap(wat_value(m, b->lhs())),
-            paren_wrap(wat_value(m, b->rhs()))
-        );
-    };
+void wat_inst(OutputBuffer& out, Module& m, Inst* i) {
+    LCC_ASSERT(i);
 
-    const auto inst_type = [](Inst* inst) {
+    const auto inst_type = [](Inst* inst) -> std::string_view {
         auto bitwidth = inst->type()->bits();
         LCC_ASSERT(
             bitwidth <= 64,
@@ -282,18 +240,29 @@ auto wat_inst(Module& m, Inst* i) -> std::string {
             bitwidth
         );
         // Bitwidth is either 32 or 64.
-        if (bitwidth <= 32)
-            bitwidth = 32;
-        else bitwidth = 64;
-
         if (is<FractionalType>(inst->type()))
-            return fmt::format("f{}", bitwidth);
+            return bitwidth <= 32 ? "f32" : "f64";
+
+        return bitwidth <= 32 ? "i32" : "i64";
+    };
 
-        return fmt::format("i{}", bitwidth);
+    const auto binary = [&](std::string_view mnemonic) {
+        LCC_ASSERT(
+            i->type()->bits() <= 64,
+            "WAT: Overlarge type of binary instruction"
+        );
+        auto b = as<BinaryInst>(i);
+        out.print("({}.{} ", inst_type(i), mnemonic);
+        wat_operand(out, m, b->lhs());
+        out.write(' ');
+        wat_operand(out, m, b->rhs());
+        out.write(')');
     };
 
-    const auto inst_with_type = [&](std::string_view mnemonic) {
-        return fmt::format("{}.{}", inst_type(i), mnemonic);
+    const auto unary = [&](std::string_view mnemonic, i64 constant) {
+        out.print("({0}.{1} ({0}.const {2}) ", inst_type(i), mnemonic, constant);
+        wat_value(out, m, as<UnaryInstBase>(i)->operand());
+        out.write(')');
     };
 
     switch (i->kind()) {
@@ -313,31 +282,29 @@ auto wat_inst(Module& m, Inst* i) -> std::string {
         // Local definitions handled in function definition.
         case Value::Kind::Alloca:
             // no-op
-            return std::string("");
+            return;
 
         case Value::Kind::Call: {
             auto c = as<CallInst>(i);
 
-            std::string o{};
-
             // Push argument values to stack
             for (auto a : c->args()) {
-                o += wat_value(m, a);
-                o += '\n';
+                wat_value(out, m, a);
+                out.write('\n');
             }
 
             // Perform call
             switch (c->callee()->kind()) {
                 default: LCC_ASSERT(false, "WAT Unhandled callee kind");
                 case Value::Kind::Function: {
-                    o += fmt::format(
+                    out.print(
                         "call {}",
                         as<Function>((c->callee()))->names().at(0).name
                     );
                 } break;
             }
 
-            return o;
+            return;
         }
 
         case Value::Kind::Store: {
@@ -345,117 +312,106 @@ auto wat_inst(Module& m, Inst* i) -> std::string {
             // Store to local uses local.set
             if (auto a = cast<AllocaInst>(s->ptr())) {
                 // TODO: sketchy parens
-                return fmt::format(
-                    "(local.set {} ({}))",
-                    wat_local_name(a),
-                    wat_value(m, s->val())
-                );
+                out.print("(local.set $tmp{} (", wat_local_index(a));
+                wat_value(out, m, s->val());
+                out.write("))");
+                return;
             }
             // Store to global uses global.set
             if (auto g = cast<GlobalVariable>(s->ptr())) {
                 // TODO: sketchy parens
-                return fmt::format(
-                    "(global.set {} ({}))",
-                    wat_global_name(g),
-                    wat_value(m, s->val())
-                );
+                out.print("(global.set ${} (", wat_global_name(g));
+                wat_value(out, m, s->val());
+                out.write("))");
+                return;
             }
             LCC_ASSERT(false, "WAT Unhandled store position");
         }
 
         case Value::Kind::Load: {
             auto l = as<LoadInst>(i);
-            return fmt::format(
-                "{}\n{}.load",
-                wat_value(m, l->ptr()),
-                wat_type(m, l->type())
-            );
+            wat_value(out, m, l->ptr());
+            out.write('\n');
+            wat_type(out, m, l->type());
+            out.write(".load");
+            return;
         }
 
         case Value::Kind::Return: {
             auto r = as<ReturnInst>(i);
             // TODO: sketchy parens
-            if (r->has_value())
-                return fmt::format("(return ({}))", wat_value(m, r->val()));
-            return "return";
-        }
-
-        case Value::Kind::Add: return binary(inst_with_type("add"));
-        case Value::Kind::Sub: return binary(inst_with_type("sub"));
-        case Value::Kind::Mul: return binary(inst_with_type("mul"));
-        case Value::Kind::SDiv: return binary(inst_with_type("div_s"));
-        case Value::Kind::UDiv: return binary(inst_with_type("div_u"));
-        case Value::Kind::SRem: return binary(inst_with_type("rem_s"));
-        case Value::Kind::URem: return binary(inst_with_type("rem_u"));
-        case Value::Kind::And: return binary(inst_with_type("and"));
-        case Value::Kind::Or: return binary(inst_with_type("or"));
-        case Value::Kind::Eq: return binary(inst_with_type("eq"));
-        case Value::Kind::Ne: return binary(inst_with_type("ne"));
-        case Value::Kind::SLt: return binary(inst_with_type("lt_s"));
-        case Value::Kind::SLe: return binary(inst_with_type("le_s"));
-        case Value::Kind::SGt: return binary(inst_with_type("gt_s"));
-        case Value::Kind::SGe: return binary(inst_with_type("ge_s"));
-        case Value::Kind::ULt: return binary(inst_with_type("lt_u"));
-        case Value::Kind::ULe: return binary(inst_with_type("le_u"));
-        case Value::Kind::UGt: return binary(inst_with_type("gt_u"));
-        case Value::Kind::UGe: return binary(inst_with_type("ge_u"));
-        case Value::Kind::Xor: return binary(inst_with_type("xor"));
-        case Value::Kind::Shl: return binary(inst_with_type("shl"));
-        case Value::Kind::Sar: return binary(inst_with_type("shr_s"));
-        case Value::Kind::Shr: return binary(inst_with_type("shr_u"));
-
-        case Value::Kind::Compl: {
-            // WASM doesn't have a bitwise not; instead, they recommend XORing with
-            // negative one (-1).
-            // TODO: Error if non-integer type.
-            return fmt::format(
-                "({} ({}.const -1) {})",
-                inst_with_type("xor"),
-                inst_type(i),
-                wat_value(m, as<UnaryInstBase>(i)->operand())
-            );
-        }
-
-        case Value::Kind::Neg: {
-            // WASM doesn't have an integer negation; instead, they recommend
-            // subtracting the integer from zero, letting wrapping handle things.
-            return fmt::format(
-                "({} ({}.const 0) {})",
-                inst_with_type("sub"),
-                inst_type(i),
-                wat_value(m, as<UnaryInstBase>(i)->operand())
-            );
-        }
+            if (not r->has_value()) return out.write("return");
+            out.write("(return (");
+            wat_value(out, m, r->val());
+            out.write("))");
+            return;
+        }
+
+        case Value::Kind::Add: return binary("add");
+        case Value::Kind::Sub: return binary("sub");
+        case Value::Kind::Mul: return binary("mul");
+        case Value::Kind::SDiv: return binary("div_s");
+        case Value::Kind::UDiv: return binary("div_u");
+        case Value::Kind::SRem: return binary("rem_s");
+        case Value::Kind::URem: return binary("rem_u");
+        case Value::Kind::And: return binary("and");
+        case Value::Kind::Or: return binary("or");
+        case Value::Kind::Eq: return binary("eq");
+        case Value::Kind::Ne: return binary("ne");
+        case Value::Kind::SLt: return binary("lt_s");
+        case Value::Kind::SLe: return binary("le_s");
+        case Value::Kind::SGt: return binary("gt_s");
+        case Value::Kind::SGe: return binary("ge_s");
+        case Value::Kind::ULt: return binary("lt_u");
+        case Value::Kind::ULe: return binary("le_u");
+        case Value::Kind::UGt: return binary("gt_u");
+        case Value::Kind::UGe: return binary("ge_u");
+        case Value::Kind::Xor: return binary("xor");
+        case Value::Kind::Shl: return binary("shl");
+        case Value::Kind::Sar: return binary("shr_s");
+        case Value::Kind::Shr: return binary("shr_u");
+
+        // WASM doesn't have a bitwise not; instead, they recommend XORing with
+        // negative one (-1).
+        // TODO: Error if non-integer type.
+        case Value::Kind::Compl: return unary("xor", -1);
+
+        // WASM doesn't have an integer negation; instead, they recommend
+        // subtracting the integer from zero, letting wrapping handle things.
+        case Value::Kind::Neg: return unary("sub", 0);
 
-        case Value::Kind::Branch: {
-            auto t = as<BranchInst>(i)->target();
-            return fmt::format("br {}", wat_block_name(t));
-        }
+        case Value::Kind::Branch:
+            return out.print("br ${}", as<BranchInst>(i)->target()->name());
 
         case Value::Kind::Unreachable:
-            return "unreachable";
+            return out.write("unreachable");
 
         case Value::Kind::CondBranch: {
             auto b = as<CondBranchInst>(i);
-            return fmt::format(
-                "{}\n"
-                "br_if {}",
-                wat_value(m, b->cond()),
-                wat_block_name(b->then_block())
-            );
+            wat_value(out, m, b->cond());
+            out.print("\nbr_if ${}", b->then_block()->name());
+            return;
         }
 
-        case Value::Kind::ZExt: {
-            return fmt::format(
-                "(i64.extend_i32_u {})",
-                wat_value(m, as<UnaryInstBase>(i)->operand())
-            );
+        case Value::Kind::Select: {
+            // WASM's select takes the condition last.
+            auto s = as<SelectInst>(i);
+            out.write("(select ");
+            wat_value(out, m, s->then_value());
+            out.write(' ');
+            wat_value(out, m, s->else_value());
+            out.write(' ');
+            wat_value(out, m, s->cond());
+            out.write(')');
+            return;
         }
+
+        case Value::Kind::ZExt:
         case Value::Kind::SExt: {
-            return fmt::format(
-                "(i64.extend_i32_s {})",
-                wat_value(m, as<UnaryInstBase>(i)->operand())
-            );
+            out.write(is<ZExtInst>(i) ? "(i64.extend_i32_u " : "(i64.extend_i32_s ");
+            wat_value(out, m, as<UnaryInstBase>(i)->operand());
+            out.write(')');
+            return;
         }
 
         case Value::Kind::GetElementPtr:
@@ -472,12 +428,12 @@ auto wat_inst(Module& m, Inst* i) -> std::string {
     LCC_UNREACHABLE();
 }
 
-auto wat_function_signature(Module& m, Function* f) -> std::string {
-    auto o = fmt::format("func {}", wat_function_name(f));
+void wat_function_signature(OutputBuffer& out, Module& m, Function* f) {
+    out.print("func ${}", wat_function_name(f));
 
     for (auto n : f->names()) {
         if (IsExportedLinkage(n.linkage)) {
-            o += fmt::format(
+            out.print(
                 " (export \"{}\")",
                 n.name
             );
@@ -486,83 +442,64 @@ auto wat_function_signature(Module& m, Function* f) -> std::string {
     }
 
     for (auto& p : f->params()) {
-        o += fmt::format(
-            " (param {} {})",
-            wat_parameter_name(p.get()),
-            wat_type(m, p->type())
-        );
+        out.print(" (param $p{} ", p->index());
+        wat_type(out, m, p->type());
+        out.write(')');
     }
     if (not as<FunctionType>(f->type())->ret()->is_void()) {
-        o += fmt::format(
-            " (result {})",
-            wat_type(m, as<FunctionType>(f->type())->ret())
-        );
+        out.write(" (result ");
+        wat_type(out, m, as<FunctionType>(f->type())->ret());
+        out.write(')');
     }
-    return o;
 }
 
 // DOES NOT HANDLE IMPORTED FUNCTIONS
-auto wat_function(Module& m, Function* f) -> std::string {
+void wat_function(OutputBuffer& out, Module& m, Function* f) {
     LCC_ASSERT(f);
 
-    std::string o = fmt::format(
-        "({}",
-        wat_function_signature(m, f)
-    );
+    out.write('(');
+    wat_function_signature(out, m, f);
     for (auto& bb : f->blocks()) {
         for (auto& i : bb->instructions()) {
             if (auto a = cast<AllocaInst>(i.get())) {
-                o += fmt::format(
-                    "\n  (local {} {})",
-                    wat_local_name(a),
-                    wat_type(m, a->allocated_type())
-                );
+                out.print("\n  (local $tmp{} ", wat_local_index(a));
+                wat_type(out, m, a->allocated_type());
+                out.write(')');
             }
         }
     }
 
-    std::unordered_map<Block*, std::string> block_names{};
-    for (auto& bb : f->blocks())
-        block_names.emplace(bb.get(), fmt::format("$bb{}", bb->id()));
-
     for (auto& bb : f->blocks()) {
-        auto block_wasm_text = fmt::format("(block {})\n", block_names.at(bb.get()));
+        // block indent
+        out.print("\n  (block $bb{})\n", bb->id());
 
         // block instructions
         for (auto& i : bb->instructions()) {
-            auto i_wat = wat_inst(m, i.get());
-            // Some IR instructions are no-ops in webassembly, and we return an empty
-            // string for those.
-            if (i_wat.size()) {
-                // instruction indent
-                block_wasm_text += "    ";
-                block_wasm_text += i_wat;
-                block_wasm_text += '\n';
-            }
-        }
+            // Some IR instructions are no-ops in webassembly, and write nothing.
+            if (is<AllocaInst>(i.get())) continue;
 
-        o += '\n';
-        o += "  "; // block indent
-        o += block_wasm_text;
+            // instruction indent
+            out.write("    ");
+            wat_inst(out, m, i.get());
+            out.write('\n');
+        }
     }
 
     // function closer
-    o += ')';
-    return o;
+    out.write(')');
 }
 
-[[nodiscard]]
-auto Module::as_wat() -> std::string {
+void wat_module(OutputBuffer& out, Module& m) {
     // TODO: What function is the "start" function? We have no way of knowing
     // this currently. It'd be nice if a language could give us a heads-up for
     // a specific function being "the" function. For Glint modules, would be
     // the initialisation function. For Glint programs, "main".
 
-    std::string out{"(module\n"};
+    out.write("(module\n");
 
     // Imports must come before all non-import definitions.
     for (
-        auto* f : vws::transform(code(), [](const auto& p) {
+        auto* f : vws::transform(m.code(), [](const auto& p) {
             return p.get();
         })
     ) {
@@ -580,16 +517,13 @@ auto Module::as_wat() -> std::string {
         }
 
         if (not imported) continue;
-        out += fmt::format(
-            "(import \"{}\" \"{}\" {})\n",
-            "env",
-            imported_name,
-            wat_function(*this, f)
-        );
+        out.print("(import \"{}\" \"{}\" ", "env", imported_name);
+        wat_function(out, m, f);
+        out.write(")\n");
     }
 
     for (
-        auto* g : vws::transform(vars(), [](const auto& p) {
+        auto* g : vws::transform(m.vars(), [](const auto& p) {
             return p.get();
         })
     ) {
@@ -606,50 +540,55 @@ auto Module::as_wat() -> std::string {
         if (g->init() and is<ArrayConstant>(g->init())) {
             auto array = as<ArrayConstant>(g->init());
             std::span array_span{array->data(), array->size()};
-            out += fmt::format(
-                "(global {} (import \"\" \"{}\") externref)\n",
+            out.print(
+                "(global ${} (import \"\" \"{}\") externref)\n",
                 wat_global_name(g),
                 array_span
             );
             continue;
         }
 
+        out.print("(global ${} ", wat_global_name(g));
+        wat_type(out, m, g->allocated_type());
         if (g->init()) {
             // TODO: sketchy parens
-            out += fmt::format(
-                "(global {} {} ({}))\n",
-                wat_global_name(g),
-                wat_type(*this, g->allocated_type()),
-                wat_value(*this, g->init())
-            );
-        } else {
-            out += fmt::format(
-                "(global {} {})\n",
-                wat_global_name(g),
-                wat_type(*this, g->allocated_type())
-            );
+            out.write(" (");
+            wat_value(out, m, g->init());
+            out.write(')');
         }
+        out.write(")\n");
     }
 
-    for (auto& f : code()) {
+    for (auto& f : m.code()) {
         bool imported{false};
-        std::string_view imported_name{};
         for (auto n : f->names()) {
             if (IsImportedLinkage(n.linkage)) {
                 imported = true;
-                imported_name = n.name;
                 break;
             }
         }
         if (imported) continue;
 
-        out += fmt::format("{}\n", wat_function(*this, f.get()));
+        wat_function(out, m, f.get());
+        out.write('\n');
+        out.maybe_flush();
     }
 
     // module closer
-    out += ')';
+    out.write(')');
+}
+
+[[nodiscard]]
+auto Module::as_wat() -> std::string {
+    OutputBuffer out{};
+    wat_module(out, *this);
+    return out.take();
+}
 
-    return out;
+void Module::emit_wat(std::FILE* file) {
+    OutputBuffer out{file};
+    wat_module(out, *this);
+    out.flush();
 }
 
 } // namespace lcc
@@ -14,8 +14,8 @@
 #include <lcc/utils/result.hh>
 
 #include <array>
+#include <charconv>
 #include <cstdlib>
-#include <deque>
 #include <memory>
 #include <string>
 #include <string_view>
@@ -65,6 +65,7 @@ enum struct TokenKind {
     Global,
     Integer,
     Fraction,
+    String,
     Indent,
 
     Colon,
@@ -91,6 +92,7 @@ constexpr auto StringifyEnum(TokenKind t) -> std::string_view {
         case TokenKind::Global: return "global";
         case TokenKind::Integer: return "integer";
         case TokenKind::Fraction: return "fraction";
+        case TokenKind::String: return "string";
         case TokenKind::Indent: return "indentation";
         case TokenKind::Newline: return "newline";
         case TokenKind::Colon: return ":";
@@ -109,8 +111,8 @@ constexpr auto StringifyEnum(TokenKind t) -> std::string_view {
 }
 
 std::unordered_map<std::string, IntrinsicKind> intrinsic_kinds{
-    {"memcpy", IntrinsicKind::MemCopy}
-    // TODO: memset
+    {"memcpy", IntrinsicKind::MemCopy},
+    {"memset", IntrinsicKind::MemSet},
 };
 
 class Parser : syntax::Lexer<syntax::Token<TokenKind>> {
@@ -121,30 +123,55 @@ class Parser : syntax::Lexer<syntax::Token<TokenKind>> {
     using syntax::Lexer<Token>::Warning;
     using syntax::Lexer<Token>::Note;
 
-    /// Because of forward references, values in the IR may
-    /// not be fully constructed when they are first created.
+    /// A temporary or global that is referred to by name. Names
+    /// are resolved to slots as soon as they are read, so that the
+    /// rest of the parser only ever deals in indices.
     ///
-    /// Since names of temporaries are generally short, copying
-    /// these around should not be a problem because of SSO.
+    /// Because of forward references, values in the IR may not be
+    /// fully constructed when they are first created; uses of a
+    /// value that hasn't been defined yet are recorded in its slot
+    /// and patched once the entire function (or module) is read.
+    struct Slot {
+        std::string name;
+        Value* value{};
+        std::vector<std::pair<Inst*, Value**>> value_fixups{};
+        std::vector<std::pair<Inst*, Block**>> block_fixups{};
+    };
     struct Temporary {
-        std::string data;
+        usz slot;
     };
     struct Global {
-        std::string data;
+        usz slot;
     };
     using IRValue = std::variant<Value*, Temporary, Global>;
 
-    std::deque<Token> lookahead_tokens{};
+    /// Temporaries whose name is a number (which is how we print
+    /// them) are at most this far past the highest one seen so far;
+    /// anything beyond that is looked up by name instead.
+    static constexpr usz MaxTemporaryNumberGap = 1 << 16;
+
+    /// The most tokens we ever need to look ahead.
+    static constexpr usz MaxLookAhead = 4;
+
+    /// Tokens lexed ahead of the current one, as a ring buffer.
+    /// Tokens are swapped in and out of it rather than copied, so
+    /// their text buffers are reused.
+    std::array<Token, MaxLookAhead> lookahead_tokens{};
+    usz lookahead_start{};
+    usz lookahead_count{};
     bool looking_ahead = false;
     bool last_token_was_newline = false;
-    StringMap<Value*> temporaries{};
-    StringMap<Value*> globals{};
-    StringMap<Type*> named_types{};
 
-    /// Unresolved values.
-    StringMap<std::vector<std::pair<Inst*, Block**>>> block_fixups{};
-    StringMap<std::vector<std::pair<Inst*, Value**>>> temporary_fixups{};
-    StringMap<std::vector<std::pair<Inst*, Value**>>> global_fixups{};
+    /// Temporaries of the current function.
+    std::vector<Slot> temporaries{};
+    /// Slot index + 1 of `%N`, indexed by N; 0 if there is none yet.
+    std::vector<usz> numbered_temporaries{};
+    StringMap<usz> named_temporaries{};
+
+    std::vector<Slot> globals{};
+    StringMap<usz> global_names{};
+
+    StringMap<Type*> named_types{};
 
 public:
     std::unique_ptr<Module> mod{};
@@ -180,10 +207,54 @@ private:
         return At(Tk::Keyword) and tok.text == text;
     }
 
-    void AddTemporary(std::string name, Value* val) {
-        if (temporaries.contains(name))
-            Error(ErrorId::Miscellaneous, "Duplicate temporary '{}'", name);
-        temporaries[std::move(name)] = val;
+    /// Get the slot of a temporary, by its name without the '%'.
+    auto TemporarySlot(std::string_view name) -> usz {
+        usz number{};
+        auto* name_end = name.data() + name.size();
+        auto [end, ec] = std::from_chars(name.data(), name_end, number);
+        if (
+            ec == std::errc{}
+            and end == name_end
+            and number < numbered_temporaries.size() + MaxTemporaryNumberGap
+        ) {
+            if (number >= numbered_temporaries.size())
+                numbered_temporaries.resize(number + 1);
+            auto& index = numbered_temporaries[number];
+            if (not index) {
+                temporaries.emplace_back(std::string{name});
+                index = temporaries.size();
+            }
+            return index - 1;
+        }
+
+        if (auto it = named_temporaries.find(name); it != named_temporaries.end())
+            return it->second;
+        named_temporaries.emplace(std::string{name}, temporaries.size());
+        temporaries.emplace_back(std::string{name});
+        return temporaries.size() - 1;
+    }
+
+    /// Get the slot of a global, by its name without the '@'.
+    auto GlobalSlot(std::string_view name) -> usz {
+        if (auto it = global_names.find(name); it != global_names.end())
+            return it->second;
+        global_names.emplace(std::string{name}, globals.size());
+        globals.emplace_back(std::string{name});
+        return globals.size() - 1;
+    }
+
+    void AddTemporary(usz slot, Value* val) {
+        auto& t = temporaries[slot];
+        if (t.value)
+            Error(ErrorId::Miscellaneous, "Duplicate temporary '%{}'", t.name);
+        t.value = val;
+    }
+
+    /// Forget all temporaries of the previous function.
+    void ResetTemporaries() {
+        temporaries.clear();
+        numbered_temporaries.clear();
+        named_temporaries.clear();
     }
 
     /// Like At(), but consume the token if it matches.
@@ -209,22 +280,24 @@ private:
     auto LookAhead(usz n) -> Token*;
     void NextIdentifier();
     void NextNumber();
+    void NextString();
     void NextToken();
 
     template <typename Instruction>
-    auto ParseBinary(std::string tmp) -> Result<Inst*>;
+    auto ParseBinary(usz tmp) -> Result<Inst*>;
 
     template <typename Instruction>
-    auto ParseCast(std::string tmp) -> Result<Inst*>;
+    auto ParseCast(usz tmp) -> Result<Inst*>;
 
     template <typename Instruction>
-    auto ParseGEP(std::string tmp) -> Result<Inst*>;
+    auto ParseGEP(usz tmp) -> Result<Inst*>;
 
     auto ParseBlock() -> Result<Block*>;
     auto ParseCall(bool tail) -> Result<CallInst*>;
     auto ParseIntrinsic() -> Result<IntrinsicInst*>;
     auto ParseCallConv() -> CallConv;
-    auto ParseFunction() -> Result<void>;
+    auto ParseFunction(std::string name, Location loc) -> Result<void>;
+    auto ParseGlobalVariable(std::string name) -> Result<void>;
     auto ParseLiteral(std::string_view lit) -> Result<void>;
     auto ParseInstruction() -> Result<Inst*>;
     auto ParseType() -> Result<Type*>;
@@ -317,6 +390,51 @@ private:
 
 } // namespace lcc::parser
 
+/// Strings are printed with every byte that isn't printable, and
+/// the quote itself, written as a backslash and two hex digits.
+void lcc::parser::Parser::NextString() {
+    tok.kind = TokenKind::String;
+    tok.text.clear();
+
+    // Yeet opening quote
+    NextChar();
+
+    const auto HexValue = [](u32 c) -> u32 {
+        if (IsDecimalDigit(c)) return c - '0';
+        if (c >= 'a' and c <= 'f') return c - 'a' + 10;
+        return c - 'A' + 10;
+    };
+
+    while (lastc != '"') {
+        if (lastc == 0 or lastc == '\n') {
+            Error(ErrorId::InvalidLiteral, "Unterminated string literal");
+            return;
+        }
+
+        if (lastc != '\\') {
+            tok.text += char(lastc);
+            NextChar();
+            continue;
+        }
+
+        // Yeet backslash
+        NextChar();
+        u32 value{};
+        for (int i = 0; i < 2; ++i) {
+            if (not IsHexDigit(lastc)) {
+                Error(ErrorId::InvalidLiteral, "Expected two hex digits after '\\' in string literal");
+                return;
+            }
+            value = value * 16 + HexValue(lastc);
+            NextChar();
+        }
+        tok.text += char(value);
+    }
+
+    // Yeet closing quote
+    NextChar();
+}
+
 void lcc::parser::Parser::NextIdentifier() {
     tok.kind = TokenKind::Keyword;
     while (IsIdentContinue(lastc)) {
@@ -440,7 +558,7 @@ void lcc::parser::Parser::NextNumber() {
         }
 
         /// If the next character is a space or delimiter, then this is a literal 0.
-        if (IsSpace(lastc) or lastc == ',') return;
+        if (IsSpace(lastc) or lastc == ',' or lastc == ']' or lastc == ')' or lastc == 0) return;
 
         /// Anything else is an error.
         Error(ErrorId::InvalidLiteral, "Invalid integer literal");
@@ -466,9 +584,10 @@ void lcc::parser::Parser::NextToken() {
     tok.kind = TokenKind::Invalid;
     tok.text.clear();
 
-    if (not looking_ahead and not lookahead_tokens.empty()) {
-        tok = std::move(lookahead_tokens.front());
-        lookahead_tokens.pop_front();
+    if (not looking_ahead and lookahead_count) {
+        std::swap(tok, lookahead_tokens[lookahead_start]);
+        lookahead_start = (lookahead_start + 1) % MaxLookAhead;
+        --lookahead_count;
         return;
     }
 
@@ -549,11 +668,14 @@ void lcc::parser::Parser::NextToken() {
 
         case '%':
             NextChar();
-            tok.text = '%';
             NextIdentifier();
             tok.kind = TokenKind::Temporary;
             break;
 
+        case '"':
+            NextString();
+            break;
+
         case '\n':
             tok.kind = TokenKind::Newline;
             NextChar();
@@ -646,26 +768,27 @@ void lcc::parser::Parser::NextToken() {
 auto lcc::parser::Parser::LookAhead(usz n) -> Token* {
     if (n == 0) return &tok;
 
-    /// If we already have enough tokens, just return the nth token.
-    const auto idx = n - 1;
-    if (idx < lookahead_tokens.size()) return &lookahead_tokens[idx];
+    LCC_ASSERT(n <= MaxLookAhead, "Cannot look ahead {} tokens", n);
+    const auto Nth = [&](usz i) -> Token& {
+        return lookahead_tokens[(lookahead_start + i) % MaxLookAhead];
+    };
 
-    /// Otherwise, lex enough tokens.
+    /// Lex as many tokens as we don't have yet. The current token
+    /// is parked in the slot of the token to lex in the meantime.
     tempset looking_ahead = true;
-    auto current = std::move(tok);
-    for (usz i = lookahead_tokens.size(); i < n; i++) {
-        tok = {};
+    for (; lookahead_count < n; ++lookahead_count) {
+        auto& t = Nth(lookahead_count);
+        std::swap(tok, t);
         NextToken();
-        lookahead_tokens.push_back(std::move(tok));
+        std::swap(tok, t);
     }
-    tok = std::move(current);
 
     /// Return the nth token.
-    return &lookahead_tokens[idx];
+    return &Nth(n - 1);
 }
 
 template <typename Instruction>
-auto lcc::parser::Parser::ParseBinary(std::string tmp) -> Result<Inst*> {
+auto lcc::parser::Parser::ParseBinary(usz tmp) -> Result<Inst*> {
     auto loc = tok.location;
     NextToken();
     auto lhs = ParseValue();
@@ -683,7 +806,7 @@ auto lcc::parser::Parser::ParseBinary(std::string tmp) -> Result<Inst*> {
 
     SetValue(inst, inst->left, lhs->second);
     SetValue(inst, inst->right, *rhs);
-    AddTemporary(std::move(tmp), inst);
+    AddTemporary(tmp, inst);
     return inst;
 }
 
@@ -692,7 +815,7 @@ auto lcc::parser::Parser::ParseBlock() -> Result<Block*> {
     if (not At(Tk::Keyword))
         return Error(ErrorId::Expected, "Expected block name");
     auto* b = new (*mod) Block(tok.text);
-    AddTemporary("%" + b->name(), b);
+    AddTemporary(TemporarySlot(b->name()), b);
     NextToken();
     if (not Consume(Tk::Colon))
         return Error(ErrorId::Expected, "Expected ':'");
@@ -832,7 +955,7 @@ auto lcc::parser::Parser::ParseCallConv() -> CallConv {
 }
 
 template <typename Instruction>
-auto lcc::parser::Parser::ParseCast(std::string tmp) -> Result<Inst*> {
+auto lcc::parser::Parser::ParseCast(usz tmp) -> Result<Inst*> {
     NextToken();
     auto val = ParseValue();
     auto to = ParseLiteral("to");
@@ -841,19 +964,11 @@ auto lcc::parser::Parser::ParseCast(std::string tmp) -> Result<Inst*> {
         return Diag();
     auto inst = new (*mod) Instruction(*ty, tok.location);
     SetValue(inst, inst->op, val->second);
-    AddTemporary(std::move(tmp), inst);
+    AddTemporary(tmp, inst);
     return inst;
 }
 
-auto lcc::parser::Parser::ParseFunction() -> Result<void> {
-    /// Parse name and colon.
-    if (not At(Tk::Keyword))
-        return Error(ErrorId::Expected, "Expected function name");
-    auto name = tok.text;
-    auto loc = tok.location;
-    // Eat name
-    NextToken();
-
+auto lcc::parser::Parser::ParseFunction(std::string name, Location loc) -> Result<void> {
     // Eat lparen to open linkage string
     if (not Consume(Tk::LParen))
         return Error(ErrorId::Expected, "Expected '('");
@@ -932,10 +1047,11 @@ auto lcc::parser::Parser::ParseFunction() -> Result<void> {
     );
 
     /// Check for duplicates.
-    for (auto n : f->names()) {
-        if (globals.contains(n.name))
+    for (const auto& n : f->names()) {
+        auto& g = globals[GlobalSlot(n.name)];
+        if (g.value)
             Error(ErrorId::Miscellaneous, "Duplicate global symbol '{}'", n.name);
-        globals[n.name] = f;
+        g.value = f;
     }
 
     /// Colon means we have a body.
@@ -944,16 +1060,12 @@ auto lcc::parser::Parser::ParseFunction() -> Result<void> {
         return Error(ErrorId::Expected, "Expected line break");
 
     /// Register mappings for function arguments.
-    temporaries.clear();
+    ResetTemporaries();
     for (const auto& [i, arg] : vws::enumerate(names)) {
         if (arg.empty()) continue;
-        AddTemporary(std::move(arg), f->param(usz(i)));
+        AddTemporary(TemporarySlot(arg), f->param(usz(i)));
     }
 
-    /// Clear the last function’s fixup lists.
-    temporary_fixups.clear();
-    block_fixups.clear();
-
     /// Parse blocks.
     while (Consume(Tk::Indent)) {
         auto b = ParseBlock();
@@ -961,36 +1073,94 @@ auto lcc::parser::Parser::ParseFunction() -> Result<void> {
         f->append_block(std::unique_ptr<Block>(*b));
     }
 
-    /// Fix up temporaries.
-    for (auto& [tmp, fixups] : temporary_fixups) {
-        auto it = temporaries.find(tmp);
-        if (it == temporaries.end())
-            return Error(ErrorId::Miscellaneous, "Unknown value '{}'", tmp);
-        for (auto elem : fixups) {
-            *elem.second = it->second;
-            Inst::AddUse(it->second, elem.first);
+    /// Fix up temporaries and blocks.
+    for (auto& t : temporaries) {
+        if (not t.value_fixups.empty()) {
+            if (not t.value)
+                return Error(ErrorId::Miscellaneous, "Unknown value '%{}'", t.name);
+            for (auto elem : t.value_fixups) {
+                *elem.second = t.value;
+                Inst::AddUse(t.value, elem.first);
+            }
         }
-    }
 
-    /// Fix up blocks.
-    for (auto [tmp, fixups] : block_fixups) {
-        auto it = temporaries.find(tmp);
-        if (it == temporaries.end())
-            return Error(ErrorId::Miscellaneous, "Unknown block '{}'", tmp);
-        auto* b = cast<Block>(it->second);
-        if (not b)
-            return Error(ErrorId::Miscellaneous, "'{}' is not a block", tmp);
-        for (auto elem : fixups) {
-            *elem.second = b;
-            Inst::AddUse(b, elem.first);
+        if (not t.block_fixups.empty()) {
+            if (not t.value)
+                return Error(ErrorId::Miscellaneous, "Unknown block '%{}'", t.name);
+            auto* b = cast<Block>(t.value);
+            if (not b)
+                return Error(ErrorId::Miscellaneous, "'%{}' is not a block", t.name);
+            for (auto elem : t.block_fixups) {
+                *elem.second = b;
+                Inst::AddUse(b, elem.first);
+            }
         }
     }
 
     return {};
 }
 
+/// A global variable is either imported, or defined with a string
+/// or (for one that is zero-initialised) an integer:
+///
+///   stdout : ptr external
+///   .str.0 : i8[6] = "hello\00"
+///   counter : i64 = 0
+auto lcc::parser::Parser::ParseGlobalVariable(std::string name) -> Result<void> {
+    // Eat colon
+    NextToken();
+
+    auto ty = ParseType();
+    if (not ty) return ty.diag();
+
+    auto linkage = Linkage::Internal;
+    Value* init{};
+    if (At(Tk::Keyword) and tok.text == "external") {
+        NextToken();
+        linkage = Linkage::Imported;
+    } else {
+        if (not Consume(Tk::Equals))
+            return Error(ErrorId::Expected, "Expected '=' or 'external'");
+
+        if (At(Tk::String)) {
+            if ((*ty)->bytes() != tok.text.size()) {
+                return Error(
+                    ErrorId::InvalidLiteral,
+                    "String of {} bytes does not match type {}",
+                    tok.text.size(),
+                    **ty
+                );
+            }
+            init = new (*mod) ArrayConstant(
+                *ty,
+                {tok.text.begin(), tok.text.end()},
+                true
+            );
+        } else if (At(Tk::Integer)) {
+            if (tok.integer_value)
+                init = new (*mod) IntegerConstant(*ty, tok.integer_value);
+        } else return Error(ErrorId::Expected, "Expected initialiser of global variable");
+        NextToken();
+    }
+
+    auto* var = new (*mod) GlobalVariable(
+        mod.get(),
+        *ty,
+        name,
+        linkage,
+        init
+    );
+
+    auto& g = globals[GlobalSlot(name)];
+    if (g.value)
+        Error(ErrorId::Miscellaneous, "Duplicate global symbol '{}'", name);
+    g.value = var;
+
+    return {};
+}
+
 template <typename Instruction>
-auto lcc::parser::Parser::ParseGEP(std::string tmp) -> Result<Inst*> {
+auto lcc::parser::Parser::ParseGEP(usz tmp) -> Result<Inst*> {
     auto loc = tok.location;
     NextToken();
     auto ty = ParseType();
@@ -1003,7 +1173,7 @@ auto lcc::parser::Parser::ParseGEP(std::string tmp) -> Result<Inst*> {
     auto gep = new (*mod) Instruction(*ty, loc);
     SetValue(gep, gep->pointer, *ptr);
     SetValue(gep, gep->index, idx->second);
-    AddTemporary(std::move(tmp), gep);
+    AddTemporary(tmp, gep);
     return gep;
 }
 
@@ -1102,7 +1272,7 @@ auto lcc::parser::Parser::ParseInstruction() -> Result<Inst*> {
     if (not At(Tk::Temporary))
         return Error(ErrorId::Expected, "Expected instruction");
     auto loc = tok.location;
-    auto tmp = tok.text;
+    auto tmp = TemporarySlot(tok.text);
     NextToken();
     (void) ConsumeOrError(Tk::Equals);
     if (not At(Tk::Keyword))
@@ -1113,7 +1283,7 @@ auto lcc::parser::Parser::ParseInstruction() -> Result<Inst*> {
         auto res = ParseType();
         if (res.is_diag()) return res.diag();
         auto alloca = new (*mod) AllocaInst(*res, loc);
-        AddTemporary(std::move(tmp), alloca);
+        AddTemporary(tmp, alloca);
         return alloca;
     }
 
@@ -1123,19 +1293,19 @@ auto lcc::parser::Parser::ParseInstruction() -> Result<Inst*> {
         if (arg.is_diag()) return arg.diag();
         auto copy = new (*mod) CopyInst(arg->first, loc);
         SetValue(copy, copy->op, arg->second);
-        AddTemporary(std::move(tmp), copy);
+        AddTemporary(tmp, copy);
         return copy;
     }
 
     if (tok.text == "call") {
         auto call = ParseCall(false);
         if (call.is_diag()) return call.diag();
-        AddTemporary(std::move(tmp), *call);
+        AddTemporary(tmp, *call);
         return call;
     }
 
-    if (tok.text == "gep") return ParseGEP<GEPInst>(std::move(tmp));
-    if (tok.text == "gmp") return ParseGEP<GetMemberPtrInst>(std::move(tmp));
+    if (tok.text == "gep") return ParseGEP<GEPInst>(tmp);
+    if (tok.text == "gmp") return ParseGEP<GetMemberPtrInst>(tmp);
 
     if (tok.text == "load") {
         NextToken();
@@ -1146,7 +1316,7 @@ auto lcc::parser::Parser::ParseInstruction() -> Result<Inst*> {
             return Diag();
         auto load = new (*mod) LoadInst(*ty, loc);
         SetValue(load, load->pointer, *ptr);
-        AddTemporary(std::move(tmp), load);
+        AddTemporary(tmp, load);
         return load;
     }
 
@@ -1178,17 +1348,36 @@ auto lcc::parser::Parser::ParseInstruction() -> Result<Inst*> {
             SetValue(phi, inc.value, values[usz(i)]);
         }
 
-        AddTemporary(std::move(tmp), phi);
+        AddTemporary(tmp, phi);
         return phi;
     }
 
+    if (tok.text == "select") {
+        NextToken();
+        auto cond = ParseUntypedValue(Type::I1Ty);
+        auto com1 = ConsumeOrError(Tk::Comma);
+        auto then = ParseValue();
+        auto com2 = ConsumeOrError(Tk::Comma);
+        if (IsError(cond, com1, then, com2))
+            return Diag();
+        auto otherwise = ParseUntypedValue(then->first);
+        if (otherwise.is_diag()) return otherwise.diag();
+
+        auto select = new (*mod) SelectInst(then->first, loc);
+        SetValue(select, select->condition, *cond);
+        SetValue(select, select->if_true, then->second);
+        SetValue(select, select->if_false, *otherwise);
+        AddTemporary(tmp, select);
+        return select;
+    }
+
     if (tok.text == "neg") {
         NextToken();
         auto val = ParseValue();
         if (val.is_diag()) return val.diag();
         auto neg = new (*mod) NegInst(val->first, loc);
         SetValue(neg, neg->op, val->second);
-        AddTemporary(std::move(tmp), neg);
+        AddTemporary(tmp, neg);
         return neg;
     }
 
@@ -1198,37 +1387,37 @@ auto lcc::parser::Parser::ParseInstruction() -> Result<Inst*> {
         if (val.is_diag()) return val.diag();
         auto c = new (*mod) ComplInst(val->first, loc);
         SetValue(c, c->op, val->second);
-        AddTemporary(std::move(tmp), c);
+        AddTemporary(tmp, c);
         return c;
     }
 
-    if (tok.text == "add") return ParseBinary<AddInst>(std::move(tmp));
-    if (tok.text == "sub") return ParseBinary<SubInst>(std::move(tmp));
-    if (tok.text == "mul") return ParseBinary<MulInst>(std::move(tmp));
-    if (tok.text == "sdiv") return ParseBinary<SDivInst>(std::move(tmp));
-    if (tok.text == "udiv") return ParseBinary<UDivInst>(std::move(tmp));
-    if (tok.text == "srem") return ParseBinary<SRemInst>(std::move(tmp));
-    if (tok.text == "urem") return ParseBinary<URemInst>(std::move(tmp));
-    if (tok.text == "and") return ParseBinary<AndInst>(std::move(tmp));
-    if (tok.text == "or") return ParseBinary<OrInst>(std::move(tmp));
-    if (tok.text == "xor") return ParseBinary<XorInst>(std::move(tmp));
-    if (tok.text == "shl") return ParseBinary<ShlInst>(std::move(tmp));
-    if (tok.text == "shr") return ParseBinary<ShrInst>(std::move(tmp));
-    if (tok.text == "sar") return ParseBinary<SarInst>(std::move(tmp));
-    if (tok.text == "eq") return ParseBinary<EqInst>(std::move(tmp));
-    if (tok.text == "ne") return ParseBinary<NeInst>(std::move(tmp));
-    if (tok.text == "slt") return ParseBinary<SLtInst>(std::move(tmp));
-    if (tok.text == "sle") return ParseBinary<SLeInst>(std::move(tmp));
-    if (tok.text == "sgt") return ParseBinary<SGtInst>(std::move(tmp));
-    if (tok.text == "sge") return ParseBinary<SGeInst>(std::move(tmp));
-    if (tok.text == "ult") return ParseBinary<ULtInst>(std::move(tmp));
-    if (tok.text == "ule") return ParseBinary<ULeInst>(std::move(tmp));
-    if (tok.text == "ugt") return ParseBinary<UGtInst>(std::move(tmp));
-    if (tok.text == "uge") return ParseBinary<UGeInst>(std::move(tmp));
-    if (tok.text == "bitcast") return ParseCast<BitcastInst>(std::move(tmp));
-    if (tok.text == "zext") return ParseCast<ZExtInst>(std::move(tmp));
-    if (tok.text == "sext") return ParseCast<SExtInst>(std::move(tmp));
-    if (tok.text == "trunc") return ParseCast<TruncInst>(std::move(tmp));
+    if (tok.text == "add") return ParseBinary<AddInst>(tmp);
+    if (tok.text == "sub") return ParseBinary<SubInst>(tmp);
+    if (tok.text == "mul") return ParseBinary<MulInst>(tmp);
+    if (tok.text == "sdiv") return ParseBinary<SDivInst>(tmp);
+    if (tok.text == "udiv") return ParseBinary<UDivInst>(tmp);
+    if (tok.text == "srem") return ParseBinary<SRemInst>(tmp);
+    if (tok.text == "urem") return ParseBinary<URemInst>(tmp);
+    if (tok.text == "and") return ParseBinary<AndInst>(tmp);
+    if (tok.text == "or") return ParseBinary<OrInst>(tmp);
+    if (tok.text == "xor") return ParseBinary<XorInst>(tmp);
+    if (tok.text == "shl") return ParseBinary<ShlInst>(tmp);
+    if (tok.text == "shr") return ParseBinary<ShrInst>(tmp);
+    if (tok.text == "sar") return ParseBinary<SarInst>(tmp);
+    if (tok.text == "eq") return ParseBinary<EqInst>(tmp);
+    if (tok.text == "ne") return ParseBinary<NeInst>(tmp);
+    if (tok.text == "slt") return ParseBinary<SLtInst>(tmp);
+    if (tok.text == "sle") return ParseBinary<SLeInst>(tmp);
+    if (tok.text == "sgt") return ParseBinary<SGtInst>(tmp);
+    if (tok.text == "sge") return ParseBinary<SGeInst>(tmp);
+    if (tok.text == "ult") return ParseBinary<ULtInst>(tmp);
+    if (tok.text == "ule") return ParseBinary<ULeInst>(tmp);
+    if (tok.text == "ugt") return ParseBinary<UGtInst>(tmp);
+    if (tok.text == "uge") return ParseBinary<UGeInst>(tmp);
+    if (tok.text == "bitcast") return ParseCast<BitcastInst>(tmp);
+    if (tok.text == "zext") return ParseCast<ZExtInst>(tmp);
+    if (tok.text == "sext") return ParseCast<SExtInst>(tmp);
+    if (tok.text == "trunc") return ParseCast<TruncInst>(tmp);
 
     return Error(
         ErrorId::Miscellaneous,
@@ -1255,18 +1444,33 @@ auto lcc::parser::Parser::ParseModule() -> Result<void> {
             continue;
         }
 
-        if (auto err = ParseFunction(); err.is_diag())
+        // Functions and global variables both start with their name;
+        // a colon right after it means a global variable.
+        if (not At(Tk::Keyword))
+            return Error(ErrorId::Expected, "Expected function or global variable name");
+        auto name = tok.text;
+        auto loc = tok.location;
+        // Eat name
+        NextToken();
+
+        if (At(Tk::Colon)) {
+            if (auto err = ParseGlobalVariable(std::move(name)); err.is_diag())
+                return err.diag();
+            continue;
+        }
+
+        if (auto err = ParseFunction(std::move(name), loc); err.is_diag())
             return err.diag();
     }
 
     /// Fix up references to globals.
-    for (auto&& [name, fixups] : global_fixups) {
-        auto it = globals.find(name);
-        if (it == globals.end())
-            return Error(ErrorId::Miscellaneous, "Unknown global '{}'", name);
-        for (auto elem : fixups) {
-            *elem.second = it->second;
-            Inst::AddUse(it->second, elem.first);
+    for (auto& g : globals) {
+        if (g.value_fixups.empty()) continue;
+        if (not g.value)
+            return Error(ErrorId::Miscellaneous, "Unknown global '{}'", g.name);
+        for (auto elem : g.value_fixups) {
+            *elem.second = g.value;
+            Inst::AddUse(g.value, elem.first);
         }
     }
 
@@ -1382,19 +1586,17 @@ auto lcc::parser::Parser::ParseUntypedValue(Type* assumed_type) -> Result<IRValu
     }
 
     if (At(Tk::Global)) {
-        auto text = tok.text;
+        auto slot = GlobalSlot(tok.text);
         NextToken();
-        auto it = globals.find(text);
-        if (it == globals.end()) return IRValue{Global{std::move(text)}};
-        return IRValue{it->second};
+        if (auto* v = globals[slot].value) return IRValue{v};
+        return IRValue{Global{slot}};
     }
 
     if (At(Tk::Temporary)) {
-        auto text = tok.text;
+        auto slot = TemporarySlot(tok.text);
         NextToken();
-        auto it = temporaries.find(text);
-        if (it == temporaries.end()) return IRValue{Temporary{std::move(text)}};
-        return IRValue{it->second};
+        if (auto* v = temporaries[slot].value) return IRValue{v};
+        return IRValue{Temporary{slot}};
     }
 
     if (At(Tk::Integer)) {
@@ -1432,9 +1634,9 @@ void lcc::parser::Parser::SetValue(Inst* parent, Value*& val, IRValue v) {
         val = *value;
         Inst::AddUse(*value, parent);
     } else if (auto g = std::get_if<Global>(&v)) {
-        global_fixups[g->data].emplace_back(parent, &val);
+        globals[g->slot].value_fixups.emplace_back(parent, &val);
     } else {
-        temporary_fixups[std::get<Temporary>(v).data].emplace_back(parent, &val);
+        temporaries[std::get<Temporary>(v).slot].value_fixups.emplace_back(parent, &val);
     }
 }
 
@@ -1450,8 +1652,8 @@ void lcc::parser::Parser::SetBlock(Inst* parent, lcc::Block*& val, lcc::parser::
     } else if ([[maybe_unused]] auto* g = std::get_if<Global>(&v)) {
         Error(ErrorId::Miscellaneous, "Value does not name a block");
     } else {
-        block_fixups[std::get<Temporary>(v).data]
-            .emplace_back(parent, &val);
+        temporaries[std::get<Temporary>(v).slot]
+            .block_fixups.emplace_back(parent, &val);
     }
 }
 
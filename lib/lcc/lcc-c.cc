@@ -5,6 +5,60 @@
 #include <lcc/ir/type.hh>
 #include <lcc/lcc-c.h>
 #include <lcc/target.hh>
+#include <lcc/utils/rtti.hh>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace {
+using lcc::usz;
+
+auto Unwrap(LccModuleRef module) -> lcc::Module* {
+    return reinterpret_cast<lcc::Module*>(module);
+}
+
+auto Unwrap(LccValueRef value) -> lcc::Value* {
+    return reinterpret_cast<lcc::Value*>(value);
+}
+
+auto Wrap(lcc::Value* value) -> LccValueRef {
+    return reinterpret_cast<LccValueRef>(value);
+}
+
+template <typename T>
+auto Get(T* value) -> lcc::Value* { return value; }
+
+template <typename T>
+auto Get(const std::unique_ptr<T>& value) -> lcc::Value* { return value.get(); }
+
+/// Get the element at an index, or nullptr if it is out of bounds.
+template <typename T>
+auto At(const std::vector<T>& values, int64_t index) -> LccValueRef {
+    if (index < 0 or usz(index) >= values.size()) return nullptr;
+    return Wrap(Get(values[usz(index)]));
+}
+
+/// Copy (a part of) a list of values to a caller-provided array.
+template <typename T>
+auto CopyOut(
+    const std::vector<T>& values,
+    LccValueRef* out,
+    int64_t first,
+    int64_t capacity
+) -> int64_t {
+    if (first < 0 or capacity <= 0 or usz(first) >= values.size()) return 0;
+    auto count = std::min(usz(capacity), values.size() - usz(first));
+    for (usz i = 0; i < count; ++i) out[i] = Wrap(Get(values[usz(first) + i]));
+    return int64_t(count);
+}
+
+auto Functions(LccModuleRef module) -> auto& { return Unwrap(module)->code(); }
+auto Variables(LccModuleRef module) -> auto& { return Unwrap(module)->vars(); }
+auto Blocks(LccValueRef function) -> auto& { return lcc::as<lcc::Function>(Unwrap(function))->blocks(); }
+auto Instructions(LccValueRef block) -> auto& { return lcc::as<lcc::Block>(Unwrap(block))->instructions(); }
+auto Users(LccValueRef value) -> auto& { return lcc::as<lcc::UseTrackingValue>(Unwrap(value))->users(); }
+} // namespace
 
 extern "C" {
 
@@ -51,4 +105,121 @@ LccModuleRef lcc_module_create(LccContextRef context) {
     auto* lcc_context = reinterpret_cast<lcc::Context*>(context);
     return reinterpret_cast<LccModuleRef>(new lcc::Module(lcc_context));
 }
+
+/// Get the number of functions declared/defined in this LCC module.
+int64_t lcc_module_get_function_count(LccModuleRef module) {
+    return int64_t(Functions(module).size());
+}
+
+/// Get the function declared/defined in this LCC module at the given index.
+LccValueRef lcc_module_get_function_at_index(LccModuleRef module, int64_t index) {
+    return At(Functions(module), index);
+}
+
+/// Get the number of (global) variables declared/defined in this LCC module.
+int64_t lcc_module_get_variable_count(LccModuleRef module) {
+    return int64_t(Variables(module).size());
+}
+
+/// Get the (global) variable declared/defined in this LCC module at the given index.
+LccValueRef lcc_module_get_variable_at_index(LccModuleRef module, int64_t index) {
+    return At(Variables(module), index);
+}
+
+/// Get the instruction count for this block.
+int64_t lcc_get_block_instruction_count(LccValueRef block) {
+    return int64_t(Instructions(block).size());
+}
+
+/// Get the instruction in this block at the given index.
+LccValueRef lcc_get_block_instruction_at_index(LccValueRef block, int64_t index) {
+    return At(Instructions(block), index);
+}
+
+/// Gets the number of blocks in this function.
+int64_t lcc_get_function_block_count(LccValueRef function) {
+    return int64_t(Blocks(function).size());
+}
+
+/// Gets the block in this function at the given index.
+LccValueRef lcc_get_function_block_at_index(LccValueRef function, int64_t index) {
+    return At(Blocks(function), index);
+}
+
+/// Get the number of users of this instruction.
+int64_t lcc_get_instruction_user_count(LccValueRef instruction) {
+    return int64_t(Users(instruction).size());
+}
+
+/// Get the user of this instruction at the given index.
+LccValueRef lcc_get_instruction_user_at_index(LccValueRef instruction, int64_t index) {
+    return At(Users(instruction), index);
+}
+
+/// Copy the functions declared/defined in this LCC module.
+int64_t lcc_module_get_functions(LccModuleRef module, LccValueRef* out, int64_t first, int64_t capacity) {
+    return CopyOut(Functions(module), out, first, capacity);
+}
+
+/// Copy the (global) variables declared/defined in this LCC module.
+int64_t lcc_module_get_variables(LccModuleRef module, LccValueRef* out, int64_t first, int64_t capacity) {
+    return CopyOut(Variables(module), out, first, capacity);
+}
+
+/// Copy the blocks in this function.
+int64_t lcc_get_function_blocks(LccValueRef function, LccValueRef* out, int64_t first, int64_t capacity) {
+    return CopyOut(Blocks(function), out, first, capacity);
+}
+
+/// Copy the instructions in this block.
+int64_t lcc_get_block_instructions(LccValueRef block, LccValueRef* out, int64_t first, int64_t capacity) {
+    return CopyOut(Instructions(block), out, first, capacity);
+}
+
+/// Copy the users of this value.
+int64_t lcc_get_value_users(LccValueRef value, LccValueRef* out, int64_t first, int64_t capacity) {
+    return CopyOut(Users(value), out, first, capacity);
+}
+
+/// Get a cursor over the functions in this LCC module.
+LccCursor lcc_module_function_cursor(LccModuleRef module) {
+    return {module, 0, LCC_CURSOR_MODULE_FUNCTIONS};
+}
+
+/// Get a cursor over the (global) variables in this LCC module.
+LccCursor lcc_module_variable_cursor(LccModuleRef module) {
+    return {module, 0, LCC_CURSOR_MODULE_VARIABLES};
+}
+
+/// Get a cursor over the blocks in this function.
+LccCursor lcc_function_block_cursor(LccValueRef function) {
+    return {function, 0, LCC_CURSOR_FUNCTION_BLOCKS};
+}
+
+/// Get a cursor over the instructions in this block.
+LccCursor lcc_block_instruction_cursor(LccValueRef block) {
+    return {block, 0, LCC_CURSOR_BLOCK_INSTRUCTIONS};
+}
+
+/// Get a cursor over the users of this value.
+LccCursor lcc_value_user_cursor(LccValueRef value) {
+    return {value, 0, LCC_CURSOR_VALUE_USERS};
+}
+
+/// Get the next value and advance the cursor, or NULL if there are
+/// no more values.
+LccValueRef lcc_cursor_next(LccCursor* cursor) {
+    auto* module = static_cast<LccModuleRef>(const_cast<void*>(cursor->container));
+    auto* value = static_cast<LccValueRef>(const_cast<void*>(cursor->container));
+    LccValueRef next{};
+    switch (cursor->kind) {
+        case LCC_CURSOR_MODULE_FUNCTIONS: next = At(Functions(module), cursor->index); break;
+        case LCC_CURSOR_MODULE_VARIABLES: next = At(Variables(module), cursor->index); break;
+        case LCC_CURSOR_FUNCTION_BLOCKS: next = At(Blocks(value), cursor->index); break;
+        case LCC_CURSOR_BLOCK_INSTRUCTIONS: next = At(Instructions(value), cursor->index); break;
+        case LCC_CURSOR_VALUE_USERS: next = At(Users(value), cursor->index); break;
+    }
+    if (next) ++cursor->index;
+    return next;
+}
 }
@@ -12,10 +12,13 @@
 #include <lccbase/context.hh>
 
 #include <algorithm>
+#include <bit>
+#include <chrono>
 #include <concepts>
 #include <filesystem>
 #include <functional>
 #include <iterator>
+#include <string>
 #include <string_view>
 #include <type_traits>
 #include <unordered_map>
@@ -53,6 +56,28 @@ void emit_a_stage(Module* mod, std::string_view id) {
 template <typename Pass>
 void emit_a_stage(Module* mod) { emit_a_stage(mod, Pass::abbreviation); }
 
+/// What one run of an optimisation pass did. Kept in memory and
+/// printed once optimisation is done, if `---opt-log` is given.
+struct PassLogEntry {
+    struct FunctionChange {
+        std::string name;
+        isz instruction_delta;
+
+        /// The function after the pass, if `---opt-log-ir` is given.
+        std::string ir{};
+    };
+
+    std::string_view pass;
+    std::chrono::steady_clock::duration time{};
+    std::vector<FunctionChange> changes{};
+};
+
+auto instruction_count(Function* f) -> usz {
+    usz count{};
+    for (auto& b : f->blocks()) count += b->instructions().size();
+    return count;
+}
+
 /// Base class for all optimisation passes.
 /// Optimisation pass that runs on an instruction kind.
 struct OptimisationPass {
@@ -95,6 +120,16 @@ protected:
         return i;
     }
 
+    /// Create a new instruction, and insert it before another instruction.
+    template <typename Instruction, typename... Args>
+    auto CreateBefore(Inst* before, Args&&... args) -> Instruction* {
+        LCC_ASSERT(before->block(), "Cannot insert before floating instruction");
+        auto* i = new (*mod) Instruction(std::forward<Args>(args)...);
+        before->block()->insert_before(std::unique_ptr<Inst>(i), before);
+        SetChanged();
+        return i;
+    }
+
     /// Replace an instruction with a value.
     auto Replace(Inst* i, Value* v) {
         i->replace_with(v);
@@ -110,8 +145,36 @@ protected:
     /// Mark that this pass has changed the module.
     void SetChanged() { has_changed = true; }
 
+    /// Mark that this pass has changed a function. Module passes use
+    /// this to say which functions they changed.
+    void SetChanged(Function* f) {
+        SetChanged();
+        if (rgs::find(functions_changed, f) == functions_changed.end())
+            functions_changed.push_back(f);
+    }
+
+    /// Mark that this pass is about to remove a function from the
+    /// module.
+    void SetRemoved(Function* f) {
+        SetChanged();
+        std::erase(functions_changed, f);
+        functions_removed.emplace_back(f->names().at(0).name, -isz(instruction_count(f)));
+    }
+
+public:
+    /// Functions this pass changed, in the order they were first changed.
+    [[nodiscard]]
+    auto changed_functions() const -> const std::vector<Function*>& { return functions_changed; }
+
+    /// Functions this pass removed, along with how many instructions
+    /// went with them.
+    [[nodiscard]]
+    auto removed_functions() const -> const std::vector<PassLogEntry::FunctionChange>& { return functions_removed; }
+
 private:
     bool has_changed = false;
+    std::vector<Function*> functions_changed{};
+    std::vector<PassLogEntry::FunctionChange> functions_removed{};
 };
 
 /// Optimisation pass that runs on an instruction kind.
@@ -181,9 +244,129 @@ private:
         return Result{false, {}, {}};
     }
 
+    /// Division by a constant is done with a multiplication by a
+    /// 'magic number' and shifts (Granlund and Montgomery, "Division
+    /// by Invariant Integers using Multiplication"). The high half of
+    /// the product is taken from a multiplication in 64 bits, so this
+    /// only works for dividends up to 32 bits. The IR has no way to
+    /// get at the high half of a 64-bit multiplication, so 64-bit
+    /// divisions are left to instruction selection.
+    static constexpr u64 max_magic_bits = 32;
+
+    struct Magic {
+        u64 multiplier;
+        u64 shift;
+    };
+
+    /// Get the smallest shift `p` and multiplier `m = ceil(2^p / d)`
+    /// such that `floor(x * m / 2^p) == floor(x / d)` for every
+    /// unsigned `x` of at most `bits` bits.
+    ///
+    /// With `m * d = 2^p + e`, that holds if `e <= 2^(p - bits)`, which
+    /// is always true once `2^(p - bits) >= d`.
+    static auto DivisionMagic(u64 d, u64 bits) -> Magic {
+        LCC_ASSERT(d > 1 and bits <= max_magic_bits);
+        for (u64 p = bits;; ++p) {
+            u64 m = ((u64(1) << p) + d - 1) / d;
+            u64 e = m * d - (u64(1) << p);
+            if (e <= (u64(1) << (p - bits))) return {m, p};
+        }
+    }
+
+    /// Compute `x udiv d` before `i` without dividing. Returns null
+    /// if that isn't possible or worth it.
+    auto UnsignedQuotient(Inst* i, Value* x, aint d) -> Value* {
+        auto bits = d.bits();
+        auto loc = i->location();
+        auto Int = [&](u64 value) { return MakeInt(aint{bits, value}); };
+        if (d.value() < 2) return nullptr;
+
+        /// Division by a power of two is a right shift.
+        if (d.is_power_of_two()) return CreateBefore<ShrInst>(i, x, Int(d.log2()), loc);
+
+        /// A divisor above half the range goes into x at most once.
+        if (d.is_negative()) {
+            auto* ge = CreateBefore<UGeInst>(i, x, MakeInt(d), loc);
+            return CreateBefore<ZExtInst>(i, ge, x->type(), loc);
+        }
+
+        if (bits > max_magic_bits) return nullptr;
+        auto [m, p] = DivisionMagic(d.value(), bits);
+        auto* i64_ty = IntegerType::Get(mod->context(), 64);
+        auto* wide = CreateBefore<ZExtInst>(i, x, i64_ty, loc);
+
+        /// The product fits in 64 bits: x * m >> p.
+        if (bits + u64(std::bit_width(m)) <= 64) {
+            auto* product = CreateBefore<MulInst>(i, MakeInt(aint{64, m}), wide, loc);
+            auto* high = CreateBefore<ShrInst>(i, product, MakeInt(aint{64, p}), loc);
+            return CreateBefore<TruncInst>(i, high, x->type(), loc);
+        }
+
+        /// Otherwise, m is one bit too wide; multiply by m - 2^bits
+        /// and add x back in, halving first so the sum can't overflow:
+        ///   t = x * (m - 2^bits) >> bits
+        ///   q = (((x - t) >> 1) + t) >> (p - bits - 1)
+        auto* product = CreateBefore<MulInst>(i, MakeInt(aint{64, m - (u64(1) << bits)}), wide, loc);
+        auto* high = CreateBefore<ShrInst>(i, product, MakeInt(aint{64, bits}), loc);
+        auto* t = CreateBefore<TruncInst>(i, high, x->type(), loc);
+        auto* diff = CreateBefore<SubInst>(i, x, t, loc);
+        auto* half = CreateBefore<ShrInst>(i, diff, Int(1), loc);
+        auto* sum = CreateBefore<AddInst>(i, half, t, loc);
+        if (p - bits - 1 == 0) return sum;
+        return CreateBefore<ShrInst>(i, sum, Int(p - bits - 1), loc);
+    }
+
+    /// Compute `x sdiv d` before `i` without dividing. Returns null
+    /// if that isn't possible or worth it.
+    auto SignedQuotient(Inst* i, Value* x, aint d) -> Value* {
+        auto bits = d.bits();
+        auto loc = i->location();
+        auto Int = [&](u64 value) { return MakeInt(aint{bits, value}); };
+        if (bits < 2) return nullptr;
+
+        /// Note that the magnitude of the smallest value is still
+        /// right when read as unsigned.
+        auto magnitude = d.is_negative() ? (-d).value() : d.value();
+        if (magnitude < 2) return nullptr;
+
+        Value* q{};
+
+        /// Division by a power of two 2^k is an arithmetic right shift,
+        /// after adding 2^k - 1 to negative dividends so the result is
+        /// rounded towards zero:
+        ///   q = (x + ((x sar (k - 1)) shr (bits - k))) sar k
+        if (std::has_single_bit(magnitude)) {
+            auto k = u64(std::countr_zero(magnitude));
+            Value* sign = k == 1 ? x : CreateBefore<SarInst>(i, x, Int(k - 1), loc);
+            auto* bias = CreateBefore<ShrInst>(i, sign, Int(bits - k), loc);
+            auto* sum = CreateBefore<AddInst>(i, x, bias, loc);
+            q = CreateBefore<SarInst>(i, sum, Int(k), loc);
+        }
+
+        /// Otherwise, this is the unsigned case for the magnitude of
+        /// x; the arithmetic shift rounds down, so 1 is added to the
+        /// result for negative dividends:
+        ///   q = (sext(x) * m sar p) + (x shr (bits - 1))
+        else {
+            if (bits > max_magic_bits) return nullptr;
+            auto [m, p] = DivisionMagic(magnitude, bits - 1);
+            auto* i64_ty = IntegerType::Get(mod->context(), 64);
+            auto* wide = CreateBefore<SExtInst>(i, x, i64_ty, loc);
+            auto* product = CreateBefore<MulInst>(i, MakeInt(aint{64, m}), wide, loc);
+            auto* high = CreateBefore<SarInst>(i, product, MakeInt(aint{64, p}), loc);
+            auto* floor = CreateBefore<TruncInst>(i, high, x->type(), loc);
+            auto* negative = CreateBefore<ShrInst>(i, x, Int(bits - 1), loc);
+            q = CreateBefore<AddInst>(i, floor, negative, loc);
+        }
+
+        if (d.is_negative()) q = CreateBefore<NegInst>(i, q, loc);
+        return q;
+    }
+
     /// Handle signed and unsigned division.
-    template <typename DivInst, typename ShiftInst, auto Eval>
+    template <typename DivInst, auto Eval>
     void DivImpl(Inst* i) {
+        static constexpr bool is_signed = std::is_same_v<DivInst, SDivInst>;
         auto d = as<DivInst>(i);
         auto rhs = cast<IntegerConstant>(d->rhs());
         if (not rhs) return;
@@ -199,15 +382,49 @@ private:
             Replace(i, Eval(lhs->value(), rhs->value()));
         }
 
-        /// Division by a power of two is a right shift (note that
-        /// this only works for *unsigned* division; for signed
-        /// division, we defer optimising this to the backend).
-        else {
-            if constexpr (std::is_same_v<DivInst, UDivInst>) {
-                if (rhs->value().is_power_of_two()) {
-                    Replace<ShiftInst>(i, d->lhs(), MakeInt(rhs->value().log2()), d->location());
-                }
-            }
+        /// Otherwise, try to get rid of the division altogether.
+        else if (
+            auto* q = is_signed
+                        ? SignedQuotient(i, d->lhs(), rhs->value())
+                        : UnsignedQuotient(i, d->lhs(), rhs->value())
+        ) Replace(i, q);
+    }
+
+    /// Handle signed and unsigned remainder.
+    template <typename RemInst, auto Eval>
+    void RemImpl(Inst* i) {
+        static constexpr bool is_signed = std::is_same_v<RemInst, SRemInst>;
+        auto r = as<RemInst>(i);
+        auto rhs = cast<IntegerConstant>(r->rhs());
+        if (not rhs) return;
+
+        auto d = rhs->value();
+        auto loc = r->location();
+
+        /// Check for division by zero.
+        if (d == 0) Replace<PoisonValue>(i, r->type());
+
+        /// Nothing is left over when dividing by 1 (or -1).
+        else if (d == 1 or (is_signed and -d == 1)) Replace(i, aint{d.bits(), aint::Word(0)});
+
+        /// Evaluate the remainder if both operands are constants.
+        else if (auto lhs = cast<IntegerConstant>(r->lhs())) {
+            Replace(i, Eval(lhs->value(), d));
+        }
+
+        /// The unsigned remainder of a power of two is a mask.
+        else if (not is_signed and d.is_power_of_two()) {
+            Replace<AndInst>(i, r->lhs(), MakeInt(d - aint{d.bits(), aint::Word(1)}), loc);
+        }
+
+        /// Otherwise, x - (x / d) * d, with the division done as above.
+        else if (
+            auto* q = is_signed
+                        ? SignedQuotient(i, r->lhs(), d)
+                        : UnsignedQuotient(i, r->lhs(), d)
+        ) {
+            auto* product = CreateBefore<MulInst>(i, MakeInt(d), q, loc);
+            Replace<SubInst>(i, r->lhs(), product, loc);
         }
     }
 
@@ -264,6 +481,15 @@ public:
                 else if (br->then_block() == br->else_block()) Replace<BranchInst>(i, br->then_block());
             } break;
 
+            case Value::Kind::Select: {
+                auto* sel = as<SelectInst>(i);
+                auto* cond = cast<IntegerConstant>(sel->cond());
+
+                /// Same as above.
+                if (cond) Replace(i, cond->value() == 1 ? sel->then_value() : sel->else_value());
+                else if (sel->then_value() == sel->else_value()) Replace(i, sel->then_value());
+            } break;
+
             case Value::Kind::Add: {
                 auto* add = as<AddInst>(i);
                 auto* lhs = cast<IntegerConstant>(add->lhs());
@@ -434,11 +660,19 @@ public:
             } break;
 
             case Value::Kind::SDiv:
-                DivImpl<SDivInst, SarInst, [](auto l, auto r) { return l.sdiv(r); }>(i);
+                DivImpl<SDivInst, [](auto l, auto r) { return l.sdiv(r); }>(i);
                 break;
 
             case Value::Kind::UDiv:
-                DivImpl<UDivInst, ShrInst, [](auto l, auto r) { return l.udiv(r); }>(i);
+                DivImpl<UDivInst, [](auto l, auto r) { return l.udiv(r); }>(i);
+                break;
+
+            case Value::Kind::SRem:
+                RemImpl<SRemInst, [](auto l, auto r) { return l.srem(r); }>(i);
+                break;
+
+            case Value::Kind::URem:
+                RemImpl<URemInst, [](auto l, auto r) { return l.urem(r); }>(i);
                 break;
 
             case Value::Kind::Eq: CmpImpl<&aint::operator== >(i); break;
@@ -791,7 +1025,7 @@ struct SSAConstructionPass : InstructionRewritePass {
     }
 
     void run_on_function(Function* f) {
-        DomTree dom_tree{f};
+        auto& dom_tree = f->dominator_tree();
 
         /// Determine what allocas we can convert.
         auto optimisable = utils::to_vec(allocas | vws::filter(Optimisable));
@@ -981,6 +1215,143 @@ struct CFGSimplePass : InstructionRewritePass {
     }
 };
 
+/// If-conversion.
+///
+/// Turn small diamonds and triangles in the control flow graph
+/// into straight-line code by executing both arms unconditionally
+/// and replacing the PHIs at the join point with selects, which
+/// the backend can lower to conditional moves.
+///
+/// The arms are left unreachable; CFGSimplePass cleans them up.
+struct IfConversionPass : InstructionRewritePass {
+    static constexpr auto abbreviation = "ifcvt";
+
+    /// Maximum number of instructions in an arm that we are
+    /// willing to execute unconditionally.
+    static constexpr usz max_arm_size = 3;
+
+private:
+    /// Check if an instruction can be executed even if it
+    /// wasn’t going to be, i.e. it can’t trap and has no
+    /// side effects.
+    static auto Speculatable(Inst* i) -> bool {
+        switch (i->kind()) {
+            default: return false;
+            case Value::Kind::GetElementPtr:
+            case Value::Kind::GetMemberPtr:
+            case Value::Kind::Select:
+            case Value::Kind::ZExt:
+            case Value::Kind::SExt:
+            case Value::Kind::Trunc:
+            case Value::Kind::Bitcast:
+            case Value::Kind::Neg:
+            case Value::Kind::Copy:
+            case Value::Kind::Compl:
+            case Value::Kind::Add:
+            case Value::Kind::Sub:
+            case Value::Kind::Mul:
+            case Value::Kind::Shl:
+            case Value::Kind::Sar:
+            case Value::Kind::Shr:
+            case Value::Kind::And:
+            case Value::Kind::Or:
+            case Value::Kind::Xor:
+            case Value::Kind::Eq:
+            case Value::Kind::Ne:
+            case Value::Kind::SLt:
+            case Value::Kind::SLe:
+            case Value::Kind::SGt:
+            case Value::Kind::SGe:
+            case Value::Kind::ULt:
+            case Value::Kind::ULe:
+            case Value::Kind::UGt:
+            case Value::Kind::UGe:
+                return true;
+        }
+    }
+
+    /// If `arm` is only reachable from `fork`, consists of a few
+    /// speculatable instructions, and ends with a direct branch,
+    /// get the block it branches to.
+    static auto HoistableArm(Block* arm, Block* fork) -> Block* {
+        if (arm == fork or arm->predecessor_count() != 1) return nullptr;
+        auto* br = cast<BranchInst>(arm->terminator());
+        if (not br or arm->instructions().size() - 1 > max_arm_size) return nullptr;
+        for (auto& i : arm->instructions())
+            if (i.get() != br and not Speculatable(i.get()))
+                return nullptr;
+        return br->target();
+    }
+
+public:
+    void atfork(Block* fork) {
+        auto* br = as<CondBranchInst>(fork->terminator());
+        if (br->cond()->type() != Type::I1Ty) return;
+        if (br->then_block() == br->else_block()) return;
+
+        /// Find the join block and the blocks that flow into it
+        /// on either side. In a diamond, both arms branch to the
+        /// join block; in a triangle, one of them *is* the join
+        /// block, and the fork flows into it directly.
+        auto* then_join = HoistableArm(br->then_block(), fork);
+        auto* else_join = HoistableArm(br->else_block(), fork);
+        Block* join{};
+        Block* then_pred = br->then_block();
+        Block* else_pred = br->else_block();
+        if (then_join and then_join == else_join) {
+            join = then_join;
+        } else if (then_join and then_join == br->else_block()) {
+            join = then_join;
+            else_pred = fork;
+        } else if (else_join and else_join == br->then_block()) {
+            join = else_join;
+            then_pred = fork;
+        } else {
+            return;
+        }
+
+        if (join == fork) return;
+
+        /// We can only select between values that fit in a register.
+        for (auto& i : join->instructions()) {
+            auto* phi = cast<PhiInst>(i.get());
+            if (not phi) break;
+            if (not (is<IntegerType>(phi->type()) or phi->type()->is_ptr()) or phi->type()->bits() > 64) return;
+            if (not phi->get_incoming(then_pred) or not phi->get_incoming(else_pred)) return;
+
+            /// The backends have no way of conditionally moving the
+            /// address of a function into a register.
+            if (is<Function>(phi->get_incoming(then_pred)) or is<Function>(phi->get_incoming(else_pred))) return;
+        }
+
+        /// Hoist the arms into the fork.
+        for (auto* arm : {then_pred, else_pred}) {
+            if (arm == fork) continue;
+            while (arm->instructions().size() > 1)
+                arm->instructions().front()->move_before(br);
+        }
+
+        /// Select the incoming values instead of branching.
+        for (auto& i : join->instructions()) {
+            auto* phi = cast<PhiInst>(i.get());
+            if (not phi) break;
+
+            Value* v = phi->get_incoming(then_pred);
+            if (auto* e = phi->get_incoming(else_pred); v != e) {
+                auto* sel = new (*mod) SelectInst(br->cond(), v, e, phi->location());
+                fork->insert_before(std::unique_ptr<Inst>(sel), br);
+                v = sel;
+            }
+
+            phi->remove_incoming(then_pred);
+            phi->remove_incoming(else_pred);
+            phi->set_incoming(v, fork);
+        }
+
+        Replace<BranchInst>(br, join, br->location());
+    }
+};
+
 /// Eliminate instructions whose results are unused if they have no side-effects.
 struct DCEPass : InstructionRewritePass {
     static constexpr auto abbreviation = "dce";
@@ -993,6 +1364,7 @@ struct DCEPass : InstructionRewritePass {
             case Value::Kind::GetElementPtr:
             case Value::Kind::Load:
             case Value::Kind::Phi:
+            case Value::Kind::Select:
             case Value::Kind::ZExt:
             case Value::Kind::SExt:
             case Value::Kind::Trunc:
@@ -1053,6 +1425,7 @@ struct FunctionDCEPass : ModuleRewritePass {
             }
 
             /// Yeet.
+            SetRemoved(f);
             mod->code().erase(mod->code().begin() + isz(i));
         }
     }
@@ -1063,13 +1436,18 @@ struct PrintDOMTreePass : InstructionRewritePass {
     static constexpr auto abbreviation = "print-dom";
 
     static void run_on_function(Function* f) {
-        fmt::print("{}", DomTree{f, false}.debug());
+        fmt::print("{}", f->dominator_tree().debug());
     }
 };
 
 struct Optimiser {
     Module* mod{nullptr};
 
+    /// Change log; only kept if requested.
+    bool keep_log{false};
+    bool log_ir{false};
+    std::vector<PassLogEntry> log{};
+
     enum class OptimisationLevel {
         Invalid = 0,
         /// May increase code size at cost of better performance i.e. function
@@ -1110,6 +1488,8 @@ struct Optimiser {
         LCC_ASSERT(+opt_level);
         if (emit_stages(mod))
             emit_a_stage(mod, "untouched");
+        log_ir = mod->context()->has_option("opt-log-ir");
+        keep_log = log_ir or mod->context()->has_option("opt-log");
     }
 
     Optimiser(Module* m, int o)
@@ -1131,6 +1511,7 @@ struct Optimiser {
                 StoreForwardingPass,
                 CFGSimplePass,
                 SSAConstructionPass,
+                IfConversionPass,
                 DCEPass,
                 FunctionDCEPass
             >();
@@ -1162,6 +1543,7 @@ struct Optimiser {
             else if (s == FunctionDCEPass::abbreviation) (void) RunPass<FunctionDCEPass>();
             else if (s == SSAConstructionPass::abbreviation) (void) RunPass<SSAConstructionPass>();
             else if (s == CFGSimplePass::abbreviation) (void) RunPass<CFGSimplePass>();
+            else if (s == IfConversionPass::abbreviation) (void) RunPass<IfConversionPass>();
             else if (s == PrintDOMTreePass::abbreviation) (void) RunPass<PrintDOMTreePass>();
             else if (s == "*") run();
             else Diag::Fatal(
@@ -1178,6 +1560,7 @@ struct Optimiser {
                         FunctionDCEPass::abbreviation,
                         SSAConstructionPass::abbreviation,
                         CFGSimplePass::abbreviation,
+                        IfConversionPass::abbreviation,
                         PrintDOMTreePass::abbreviation
                     },
                     ","
@@ -1186,7 +1569,44 @@ struct Optimiser {
         }
     }
 
+    /// Print the change log, if there is one.
+    void print_log() const {
+        if (not keep_log) return;
+
+        std::chrono::steady_clock::duration total{};
+        for (const auto& entry : log) total += entry.time;
+
+        fmt::print(stderr, "Optimisation log ({} pass runs, {:.3f}ms):\n", log.size(), Milliseconds(total));
+        for (const auto& entry : log) {
+            fmt::print(
+                stderr,
+                "  {:<12} {:>9.3f}ms  {}\n",
+                entry.pass,
+                Milliseconds(entry.time),
+                entry.changes.empty() ? "no change" : fmt::format("{} functions changed", entry.changes.size())
+            );
+            for (const auto& change : entry.changes) {
+                fmt::print(stderr, "    {} ({:+} instructions)\n", change.name, change.instruction_delta);
+                if (not change.ir.empty()) fmt::print(stderr, "{}", change.ir);
+            }
+        }
+    }
+
 private:
+    static auto Milliseconds(std::chrono::steady_clock::duration d) -> double {
+        return std::chrono::duration<double, std::milli>(d).count();
+    }
+
+    /// Record that a pass changed a function.
+    void LogChange(PassLogEntry* entry, Function* f, usz instructions_before) {
+        if (not entry) return;
+        entry->changes.emplace_back(
+            f->names().at(0).name,
+            isz(instruction_count(f)) - isz(instructions_before),
+            log_ir ? f->string(false) : std::string{}
+        );
+    }
+
     template <typename... Passes>
     void RunPasses() {
         /// Run all passes so long as at least one of them returns true.
@@ -1196,11 +1616,15 @@ private:
     template <typename Pass>
     [[nodiscard]]
     auto RunPass() -> bool {
+        PassLogEntry entry{Pass::abbreviation};
+        auto* log_entry = keep_log ? &entry : nullptr;
+        auto start = std::chrono::steady_clock::now();
+
         bool changed{false};
         if constexpr (std::derived_from<Pass, InstructionRewritePass>) {
-            changed = RunPassOnInstructions<Pass>();
+            changed = RunPassOnInstructions<Pass>(log_entry);
         } else if constexpr (std::derived_from<Pass, ModuleRewritePass>) {
-            changed = RunPassOnModule<Pass>();
+            changed = RunPassOnModule<Pass>(log_entry);
         } else {
             static_assert(
                 always_false<Pass>,
@@ -1208,6 +1632,11 @@ private:
             );
         }
 
+        if (keep_log) {
+            entry.time = std::chrono::steady_clock::now() - start;
+            log.push_back(std::move(entry));
+        }
+
         // Emit IR after each optimisation pass that changes the output, if requested.
         if (changed and emit_stages(mod))
             emit_a_stage<Pass>(mod);
@@ -1217,10 +1646,11 @@ private:
 
     template <typename Pass>
     [[nodiscard]]
-    auto RunPassOnInstructions() -> bool {
+    auto RunPassOnInstructions(PassLogEntry* log_entry) -> bool {
         bool changed = false;
         for (auto& f : mod->code()) {
             Pass p{{mod}};
+            auto instructions_before = log_entry ? instruction_count(f.get()) : 0;
 
             /// Use indices here to avoid iterator invalidation.
             for (usz block_index = 0; block_index < f->blocks().size(); block_index++) {
@@ -1259,13 +1689,14 @@ private:
                 if constexpr (requires { &Pass::atfork; }) {
                     auto& b = f->blocks()[block_index];
                     if (b->terminator() and is<CondBranchInst>(b->terminator()))
-                        p.atfork(b);
+                        p.atfork(b.get());
                 }
             }
 
             if constexpr (requires { &Pass::run_on_function; })
                 p.run_on_function(f.get());
 
+            if (p.changed()) LogChange(log_entry, f.get(), instructions_before);
             changed = p.changed() or changed;
         }
         return changed;
@@ -1273,9 +1704,28 @@ private:
 
     template <typename Pass>
     [[nodiscard]]
-    auto RunPassOnModule() -> bool {
+    auto RunPassOnModule(PassLogEntry* log_entry) -> bool {
+        // A module pass marks each function it changes or removes, so
+        // only the size of each function beforehand is needed.
+        std::unordered_map<Function*, usz> instructions_before{};
+        if (log_entry) {
+            for (auto& f : mod->code())
+                instructions_before[f.get()] = instruction_count(f.get());
+        }
+
         Pass p{{mod}};
         p.run();
+
+        if (log_entry) {
+            for (auto* f : p.changed_functions()) {
+                // Functions the pass added weren't there to count.
+                auto before = instructions_before.find(f);
+                LogChange(log_entry, f, before == instructions_before.end() ? 0 : before->second);
+            }
+            for (const auto& removed : p.removed_functions())
+                log_entry->changes.push_back(removed);
+        }
+
         return p.changed();
     }
 };
@@ -1286,9 +1736,11 @@ private:
 void lcc::opt::Optimise(Module* module, int opt_level) {
     Optimiser o{module, opt_level};
     o.run();
+    o.print_log();
 }
 
 void lcc::opt::RunPasses(lcc::Module* module, std::string_view passes) {
     Optimiser o{module, 0};
     o.run_passes(passes);
+    o.print_log();
 }
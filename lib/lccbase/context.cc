@@ -2,9 +2,14 @@
 
 #include <lcc/ir/type.hh>
 
+#include <atomic>
 #include <filesystem>
 #include <limits>
 #include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <thread>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -13,7 +18,11 @@ lcc::Context::Context(
     const Format* format,
     const lcc::Context::Options& options
 )
-    : _options(options)
+    : serial([] {
+        static std::atomic<u64> next{1};
+        return next++;
+    }())
+    , _options(options)
     , _target(target)
     , _format(format) {
     static std::once_flag once;
@@ -32,26 +41,135 @@ lcc::Context::~Context() {
             delete type;
 }
 
-auto lcc::Context::get_or_load_file(fs::path path) -> File& {
-    auto f = rgs::find_if(owned_files, [&](const auto& e) {
-        return e->path() == path;
+auto lcc::Context::intern(std::string_view name) -> u32 {
+    {
+        std::shared_lock lock{identifiers_mutex};
+        if (auto found = identifier_ids.find(name); found != identifier_ids.end())
+            return found->second;
+    }
+
+    // Someone else may have interned it while we weren't holding the lock.
+    std::unique_lock lock{identifiers_mutex};
+    if (auto found = identifier_ids.find(name); found != identifier_ids.end())
+        return found->second;
+
+    // The key views our own copy of the name, not the caller's.
+    auto id = u32(identifiers.size());
+    identifier_ids.emplace(identifiers.emplace_back(name), id);
+    return id;
+}
+
+auto lcc::Context::interned(std::string_view name) const -> u32 {
+    std::shared_lock lock{identifiers_mutex};
+    auto found = identifier_ids.find(name);
+    return found == identifier_ids.end() ? 0 : found->second;
+}
+
+auto lcc::Context::identifier(u32 id) const -> std::string_view {
+    std::shared_lock lock{identifiers_mutex};
+    LCC_ASSERT(id < identifiers.size(), "Identifier id {} was never interned", id);
+    return identifiers[id];
+}
+
+void lcc::Context::report_diagnostic(Diag& d) {
+    /// The buffer this thread reported to last, and whose it is.
+    thread_local u64 last_serial{0};
+    thread_local DiagnosticBuffer* last_buffer{};
+
+    if (last_serial != serial) {
+        std::scoped_lock lock{diagnostics_mutex};
+        auto& buffer = diagnostic_buffers[std::this_thread::get_id()];
+        if (not buffer) buffer = std::make_unique<DiagnosticBuffer>();
+        last_serial = serial;
+        last_buffer = buffer.get();
+    }
+
+    std::scoped_lock lock{last_buffer->mutex};
+    last_buffer->reports.emplace_back(d.kind, d.where, d.message);
+}
+
+auto lcc::Context::diagnostics() const -> std::vector<DiagnosticReport> {
+    using Group = std::span<const DiagnosticReport>;
+    static constexpr auto key = [](const DiagnosticReport& r) {
+        return std::tie(r.where.file_id, r.where.pos, r.where.len, r.kind, r.message);
+    };
+
+    std::vector<std::vector<DiagnosticReport>> reports{};
+    {
+        std::scoped_lock lock{diagnostics_mutex};
+        reports.reserve(diagnostic_buffers.size());
+        for (const auto& [_, buffer] : diagnostic_buffers) {
+            std::scoped_lock buffer_lock{buffer->mutex};
+            if (not buffer->reports.empty())
+                reports.push_back(buffer->reports);
+        }
+    }
+
+    /// If only one thread reported anything, its order is the order
+    /// in which things were reported, and there is nothing to merge.
+    if (reports.empty()) return {};
+    if (reports.size() == 1) return std::move(reports.front());
+
+    /// Split each thread's diagnostics into groups of a diagnostic and
+    /// the notes that follow it.
+    std::vector<Group> groups{};
+    for (const auto& r : reports) {
+        for (usz start = 0, end = 0; start < r.size(); start = end) {
+            end = start + 1;
+            while (end < r.size() and r[end].kind == Diag::Kind::Note) ++end;
+            groups.emplace_back(r.data() + start, end - start);
+        }
+    }
+
+    rgs::sort(groups, [](Group a, Group b) {
+        return rgs::lexicographical_compare(a, b, {}, key, key);
     });
-    if (f != owned_files.end()) return **f;
 
-    /// Load the file.
+    std::vector<DiagnosticReport> out{};
+    for (auto g : groups) out.insert(out.end(), g.begin(), g.end());
+    return out;
+}
+
+void lcc::Context::clear_diagnostics() {
+    std::scoped_lock lock{diagnostics_mutex};
+    for (auto& [_, buffer] : diagnostic_buffers) {
+        std::scoped_lock buffer_lock{buffer->mutex};
+        buffer->reports.clear();
+    }
+}
+
+auto lcc::Context::get_or_load_file(fs::path path) -> File& {
+    auto key = path.string();
+    {
+        std::scoped_lock lock{files_mutex};
+        if (auto f = files_by_path.find(key); f != files_by_path.end())
+            return *f->second;
+    }
+
+    /// Load the file. This is done without holding the lock so other
+    /// threads can keep looking up files in the meantime.
     auto contents = File::LoadFileData(path);
-    return make_file(std::move(path), std::move(contents));
+    std::unique_ptr<File> f{new File(*this, std::move(path), std::move(contents))};
+
+    /// Another thread may have loaded the same file while we were
+    /// reading it; if so, use that one and drop ours.
+    std::scoped_lock lock{files_mutex};
+    if (auto existing = files_by_path.find(key); existing != files_by_path.end())
+        return *existing->second;
+    return register_file(std::move(f));
 }
 
 auto lcc::Context::make_file(fs::path name, std::vector<char>&& contents) -> File& {
-    /// Create the file.
-    auto* fptr = new File(
-        *this,
-        std::move(name),
-        std::move(contents)
-    );
-    fptr->_id = u32(owned_files.size());
-    LCC_ASSERT(fptr->_id <= std::numeric_limits<u16>::max());
-    owned_files.emplace_back(fptr);
+    std::unique_ptr<File> f{new File(*this, std::move(name), std::move(contents))};
+    std::scoped_lock lock{files_mutex};
+    return register_file(std::move(f));
+}
+
+auto lcc::Context::register_file(std::unique_ptr<File> f) -> File& {
+    f->_id = u32(owned_files.size());
+    LCC_ASSERT(f->_id <= std::numeric_limits<u16>::max());
+    auto* fptr = owned_files.emplace_back(std::move(f)).get();
+    /// If there are several files with the same name, the first one wins.
+    files_by_path.try_emplace(fptr->path().string(), fptr);
     return *fptr;
 }
@@ -10,6 +10,8 @@
 #include <algorithm>
 #include <cstdlib>
 #include <filesystem>
+#include <iterator>
+#include <mutex>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -21,6 +23,14 @@
 using Kind = lcc::Diag::Kind;
 
 namespace {
+/// Print diagnostic output to stderr, or to this thread's diagnostic
+/// output buffer, if it has one.
+template <typename... Args>
+void Print(fmt::format_string<Args...> fmt, Args&&... args) {
+    if (lcc::Diag::output) fmt::format_to(std::back_inserter(*lcc::Diag::output), fmt, std::forward<Args>(args)...);
+    else fmt::print(stderr, fmt, std::forward<Args>(args)...);
+}
+
 // "foo\nbar" -> "foo\nbar"
 // "foo\r\n\r\rbar" -> "foo\r\n\r\rbar"
 // "foo\r\n\r\r" -> "foo"
@@ -83,6 +93,12 @@ constexpr auto Name(lcc::Diag::Kind kind) -> std::string_view {
 } // namespace
 
 void lcc::Diag::HandleFatalErrors() {
+    // We're about to exit, so whatever was buffered would be lost.
+    if (output and (kind == Kind::ICError or kind == Kind::FError)) {
+        fmt::print(stderr, "{}", *output);
+        output->clear();
+    }
+
     // Print backtrace, if requested.
     if (context and context->option_diag_backtrace())
         lcc::platform::PrintBacktrace();
@@ -104,15 +120,14 @@ void lcc::Diag::PrintDiagWithoutLocation() {
     Colours C(ShouldUseColour());
 
     /// Print the message.
-    fmt::print(
-        stderr,
+    Print(
         "{}{}{}: {}",
         C(Bold),
         C(KindColour(kind)),
         Name(kind),
         C(Reset)
     );
-    fmt::print(stderr, "{}\n", message);
+    Print("{}\n", message);
     HandleFatalErrors();
 }
 
@@ -210,6 +225,11 @@ void lcc::Diag::print() {
     if (context and context->diagnostics_are_suppressed())
         return;
 
+    // Don’t interleave diagnostics printed by different threads. This
+    // is recursive because attached diagnostics are printed from here.
+    static std::recursive_mutex print_mutex;
+    std::scoped_lock lock{print_mutex};
+
     // Don’t print the same diagnostic twice.
     defer { kind = Kind::None; };
 
@@ -240,13 +260,10 @@ void lcc::Diag::print() {
     // exist, its position is out of bounds or 0, or its length is 0, then we
     // skip printing the location.
     Colours C(ShouldUseColour());
-    const auto& fs = context->files();
     if (not where.seekable(context)) {
         // Even if the location is invalid, print the file name if we can.
-        if (where.file_id < fs.size()) {
-            const auto& file = *fs[where.file_id].get();
-            fmt::print(stderr, "{}{}: ", C(Bold), file.path().string());
-        }
+        if (const auto* file = context->file(where.file_id))
+            Print("{}{}: ", C(Bold), file->path().string());
 
         // Print the message.
         PrintDiagWithoutLocation();
@@ -269,9 +286,9 @@ void lcc::Diag::print() {
         = detail::LocationLineRange(*context, where);
 
     // Print the file name, line number, and column number.
-    const auto& file = *fs[where.file_id].get();
-    fmt::print(stderr, "{}{}:{}:{}: ", C(Bold), fs::relative(file.path()).string(), line, col);
-    // fmt::print(stderr, "{}{}:{}:{}: ", C(Bold), file_link(file.path()), line, col);
+    const auto& file = *context->file(where.file_id);
+    Print("{}{}:{}:{}: ", C(Bold), fs::relative(file.path()).string(), line, col);
+    // Print("{}{}:{}:{}: ", C(Bold), file_link(file.path()), line, col);
 
     // Print the diagnostic name and message.
     // TODO: If message is multiple lines, format it a little differently to
@@ -282,16 +299,15 @@ void lcc::Diag::print() {
 
     if (not message_newline_offsets.empty()) {
         // Print message prefix
-        fmt::print(stderr, "{}{}:{} ", C(KindColour(kind)), Name(kind), C(Reset));
+        Print("{}{}:{} ", C(KindColour(kind)), Name(kind), C(Reset));
 
         usz printed_offset = 0;
         for (auto newline_offset : message_newline_offsets) {
             // Do indentation for continuing lines, but only if the lines don't begin
             // with their own indentation already.
             if (printed_offset != 0 and message.at(printed_offset) != ' ')
-                fmt::print(stderr, "    ");
-            fmt::print(
-                stderr,
+                Print("    ");
+            Print(
                 "{}",
                 std::string_view(
                     message.begin() + isz(printed_offset),
@@ -302,9 +318,8 @@ void lcc::Diag::print() {
         }
         // Last part of format without a trailing newline.
         if (not message.ends_with('\n')) {
-            if (message.at(printed_offset) != ' ') fmt::print(stderr, "    ");
-            fmt::print(
-                stderr,
+            if (message.at(printed_offset) != ' ') Print("    ");
+            Print(
                 "{}\n",
                 std::string_view(
                     message.begin() + isz(printed_offset),
@@ -313,8 +328,7 @@ void lcc::Diag::print() {
             );
         }
     } else {
-        fmt::print(
-            stderr,
+        Print(
             "{}{}: {}{} [{}{}{}]\n",
             C(KindColour(kind)),
             Name(kind),
@@ -328,9 +342,9 @@ void lcc::Diag::print() {
 
     // Print the line up to the start of the location, the range in the right
     // colour, and the rest of the line.
-    fmt::print(stderr, " {} | {}", line, before);
-    fmt::print(stderr, "{}{}{}{}", C(Bold), C(KindColour(kind)), range, C(Reset));
-    fmt::print(stderr, "{}\n", after);
+    Print(" {} | {}", line, before);
+    Print("{}{}{}{}", C(Bold), C(KindColour(kind)), range, C(Reset));
+    Print("{}\n", after);
 
     // Determine the number of digits in the line number.
     const auto digits = NumberWidth(line);
@@ -341,19 +355,19 @@ void lcc::Diag::print() {
         // We first pad the line based on the number of digits in the line number
         // and append more spaces to line us up with the range.
         for (usz i = 0; i < digits + before.size() + sizeof("  | ") - 1; ++i)
-            fmt::print(stderr, " ");
+            Print(" ");
 
         // Finally, print the underline itself.
-        fmt::print(stderr, "{}{}", C(Bold), C(KindColour(kind)));
-        for (usz i = 0; i < range.size(); ++i) fmt::print(stderr, "~");
-        fmt::print(stderr, "{}\n", C(Reset));
+        Print("{}{}", C(Bold), C(KindColour(kind)));
+        for (usz i = 0; i < range.size(); ++i) Print("~");
+        Print("{}\n", C(Reset));
     }
 
     // Print fixes
     // TODO: It may be cool to emit a .diff file that could be applied with
     // `patch` by the user such that the diagnostic is removed.
     if (fixes.size()) {
-        fmt::print(stderr, "To get rid of this diagnostic, you could apply the following edits\n");
+        Print("To get rid of this diagnostic, you could apply the following edits\n");
         for (auto fix : fixes) {
             if (not fix.location.seekable(context)) continue;
             switch (fix.kind) {
@@ -372,19 +386,19 @@ void lcc::Diag::print() {
 
                     // Print the line up to the start of the location, the range in the right
                     // colour, and the rest of the line.
-                    fmt::print(stderr, " {} | {}", replace_line, replace_before);
-                    fmt::print(stderr, "{}{}{}", C(Colour::BoldRed), replace_range, C(Reset));
-                    fmt::print(stderr, "{}\n", replace_after);
+                    Print(" {} | {}", replace_line, replace_before);
+                    Print("{}{}{}", C(Colour::BoldRed), replace_range, C(Reset));
+                    Print("{}\n", replace_after);
 
                     // Print the replacement text.
 
                     // We first pad the line based on the number of digits in the line number
                     // and append more spaces to line us up with the range.
                     for (usz i = 0; i < digits + before.size() + sizeof("  | ") - 1; ++i)
-                        fmt::print(stderr, " ");
+                        Print(" ");
 
                     // Finally, print the replacement text itself.
-                    fmt::print(stderr, "{}{}{}\n", C(Colour::BoldGreen), fix.text, C(Reset));
+                    Print("{}{}{}\n", C(Colour::BoldGreen), fix.text, C(Reset));
                 } break;
                 // foo.g:1:0:
                 //  1 | return 69; (; in green)
@@ -396,24 +410,23 @@ void lcc::Diag::print() {
                         = detail::LocationLineRange(*context, fix.location);
 
                     // Print the line before the inserted text
-                    fmt::print(stderr, " {} | {}", insert_line, insert_before);
-                    fmt::print(stderr, "{}{}{}", C(BoldGreen), fix.text, C(Reset));
-                    fmt::print(stderr, "{}{}\n", insert_range, insert_after);
+                    Print(" {} | {}", insert_line, insert_before);
+                    Print("{}{}{}", C(BoldGreen), fix.text, C(Reset));
+                    Print("{}{}\n", insert_range, insert_after);
 
                     // We first pad the line based on the number of digits in the line number
                     // and append more spaces to line us up with the range.
-                    fmt::print(
-                        stderr,
+                    Print(
                         "{:{}}",
                         "",
                         digits + insert_before.size() + sizeof("  | ") - 1
                     );
 
                     // Finally, print the underline itself.
-                    fmt::print(stderr, "{}", C(Bold));
+                    Print("{}", C(Bold));
                     for (usz i = 0; i < insert_range.size(); ++i)
-                        fmt::print(stderr, "~");
-                    fmt::print(stderr, "{}\n", C(Reset));
+                        Print("~");
+                    Print("{}\n", C(Reset));
                 } break;
             }
         }
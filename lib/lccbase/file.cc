@@ -86,6 +86,12 @@ void lcc::File::WriteOrTerminate(const void* data, usz size, const fs::path& fil
         Diag::Fatal("Failed to write to file '{}': {}", file.string(), std::strerror(errno));
 }
 
+auto lcc::File::OpenForWritingOrTerminate(const fs::path& file) -> std::FILE* {
+    auto* f = std::fopen(file.string().c_str(), "wb");
+    if (not f) Diag::Fatal("Failed to write to file '{}': {}", file.string(), std::strerror(errno));
+    return f;
+}
+
 lcc::File::File(Context& context, fs::path name, std::vector<char>&& contents)
     : _context(context)
     , _file_path(std::move(name))
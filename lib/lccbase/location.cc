@@ -3,9 +3,8 @@
 #include <lcc/utils.hh>
 
 bool lcc::Location::seekable(const lcc::Context* ctx) const {
-    auto& files = ctx->files();
-    if (file_id >= files.size()) return false;
-    const auto* f = files[file_id].get();
+    const auto* f = ctx->file(file_id);
+    if (not f) return false;
     return is_valid() and ((pos + len <= f->size()) or pos == f->size());
 }
 
@@ -17,8 +16,7 @@ auto lcc::Location::seek(const lcc::Context* ctx) const -> LocInfo {
     LocInfo info{};
 
     /// Get the file that the location is in.
-    auto& files = ctx->files();
-    const auto* f = files.at(file_id).get();
+    const auto* f = ctx->file(file_id);
 
     // If the location starts on a newline, which line would we prefer
     // to gather? I believe the previous line would make more sense.
@@ -100,8 +98,7 @@ auto lcc::Location::seek_line_column(const lcc::Context* ctx) const -> LocInfoSh
     LocInfoShort info{};
 
     /// Get the file that the location is in.
-    auto& files = ctx->files();
-    const auto* f = files.at(file_id).get();
+    const auto* f = ctx->file(file_id);
 
     /// Seek back to the start of the line.
     const char* const data = f->data();
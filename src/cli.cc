@@ -80,7 +80,7 @@ void help() {
         {"  --color", "Whether to include colors colours in the output (default: auto)\n"},
         {"", "    always, auto, never\n"},
         {"  -x", "What language to parse input code as (default: extension based)\n"},
-        {"", "    glint, c, ir\n"},
+        {"", "    glint, c, ir, binary_ir\n"},
         {"  -t", "What format to emit code in (default: matches building system)\n"},
         {"", "    x86_64_linux, x86_64_windows\n"},
         {"  -f", "What format to emit code in (default: asm)\n"},
@@ -92,9 +92,10 @@ void help() {
         {"", "                    AT&T style assembly: source THEN destination operands.\n"},
         {"", "        wat: WebAssembly Textual Format (S-expressions).\n"},
         {"", "    obj: elf, coff\n"},
-        {"", "    IR: ir, ssa_ir, llvm\n"},
+        {"", "    IR: ir, ssa_ir, binary_ir, llvm\n"},
         {"", "        ir:     LCC's own IR, lowered for target architecture\n"},
         {"", "        ssa_ir: LCC's own IR in SSA form\n"},
+        {"", "        binary_ir: LCC's own IR in SSA form, binary encoded\n"},
         {"", "        llvm:   Textual IR for the Low Level Virtual Machine\n"},
     }}.get());
     // clang-format on
@@ -201,7 +202,7 @@ auto parse(int argc, const char** argv) -> Options {
         } else if (arg == "-x") {
             // What language to parse input code as
             auto lang = next_arg();
-            if (lang != "glint" and lang != "ir" and lang != "c") {
+            if (lang != "glint" and lang != "ir" and lang != "binary_ir" and lang != "c") {
                 fmt::print("CLI ERROR: Invalid lang {}\n", lang);
                 std::exit(1);
             }
@@ -78,6 +78,10 @@ auto ConvertFileExtensionToOutputFormat(
             replacement = ".lcc";
             break;
 
+        case lcc::Format::LCC_BINARY_IR:
+            replacement = ".lccb";
+            break;
+
         case lcc::Format::WASM_TEXTUAL:
             replacement = ".wat";
             break;
@@ -449,6 +453,16 @@ void GenerateOutputFile(
         return;
     }
 
+    if (
+        options.language == "binary_ir"
+        or (options.language == "default" and path_str.ends_with(".lccb"))
+    ) {
+        auto ir = lcc::Module::ParseBinary(&context, file);
+        if (not ir) context.set_error();
+        EmitModule(ir.get(), path_str, output_file_path, options);
+        return;
+    }
+
     if (
         options.language == "glint"
         or (options.language == "default" and path_str.ends_with(".g"))
@@ -522,6 +536,8 @@ auto main(int argc, const char** argv) -> int {
         format = lcc::Format::lcc_ir;
     } else if (options.format == "ssa_ir") {
         format = lcc::Format::lcc_ssa_ir;
+    } else if (options.format == "binary_ir") {
+        format = lcc::Format::lcc_binary_ir;
     } else if (options.format == "asm" || options.format == "gnu-as-att") {
         format = lcc::Format::gnu_as_att_assembly;
     } else if (options.format == "wat") {
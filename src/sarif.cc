@@ -156,7 +156,7 @@ std::string as_sarif(lcc::Context& ctx, std::string_view command_line) {
             JSONObject physical_location{};
 
             JSONObject artifact_location{};
-            const auto path = ctx.files().at(d.where.file_id)->path();
+            const auto path = ctx.file(d.where.file_id)->path();
             artifact_location.add_property("uri", path.string());
             artifact_location.add_property("uriBaseId", "PWD");
             physical_location.add_property("artifactLocation", artifact_location);
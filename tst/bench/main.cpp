@@ -0,0 +1,659 @@
+#include <fmt/format.h>
+
+#include <glint/parser.hh>
+#include <language_c/parser.hh>
+#include <lcc/calling_convention.hh>
+#include <lcc/codegen/isel.hh>
+#include <lcc/codegen/mir.hh>
+#include <lcc/codegen/register_allocation.hh>
+#include <lcc/core.hh>
+#include <lcc/format.hh>
+#include <lcc/ir/core.hh>
+#include <lcc/ir/module.hh>
+#include <lcc/lcc-c.h>
+#include <lcc/target.hh>
+#include <lcc/utils.hh>
+
+#include <lccbase/context.hh>
+#include <lccbase/file.hh>
+
+#include <algorithm>
+#include <chrono>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+using lcc::usz;
+
+const lcc::Target* default_target =
+#if defined(LCC_PLATFORM_WINDOWS)
+    lcc::Target::x86_64_windows;
+#elif defined(__APPLE__) or defined(__linux__)
+    lcc::Target::x86_64_linux;
+#else
+#    error "Unsupported target"
+#endif
+
+/// Default format
+const lcc::Format* default_format = lcc::Format::gnu_as_att_assembly;
+
+/// Options for the contexts benchmarks run in.
+const lcc::Context::Options default_options{
+    lcc::Context::DoNotUseColour,
+    lcc::Context::DoNotPrintStats,
+    lcc::Context::DoNotDiagBacktrace,
+    lcc::Context::DoNotPrintAST,
+    lcc::Context::DoNotStopatLex,
+    lcc::Context::DoNotStopatSyntax,
+    lcc::Context::DoNotStopatSema,
+    lcc::Context::DoNotPrintMachineIR,
+    lcc::Context::DoNotStopatMIR
+};
+
+/// Measures the time between calls to start() and stop(), so that a
+/// benchmark can prepare its input without that being measured.
+class Stopwatch {
+    std::chrono::steady_clock::duration _elapsed{};
+    std::chrono::steady_clock::time_point _started{};
+
+public:
+    void start() { _started = std::chrono::steady_clock::now(); }
+    void stop() { _elapsed += std::chrono::steady_clock::now() - _started; }
+
+    [[nodiscard]]
+    auto seconds() const -> double {
+        return std::chrono::duration<double>(_elapsed).count();
+    }
+};
+
+struct Benchmark {
+    std::string_view name;
+    std::string_view description;
+
+    /// What a benchmark counts, e.g. "instruction" or "byte".
+    std::string_view unit;
+
+    /// The default size of the input.
+    usz size;
+
+    /// Whether the time per unit must stay (about) the same when the
+    /// input grows, i.e. the measured work must be linear in its size.
+    bool linear;
+
+    /// Run the benchmark for an input of (about) the given size, and
+    /// return how many units of work it measured.
+    auto (*run)(usz size, Stopwatch& stopwatch) -> usz;
+};
+
+/// A module of `functions` functions, each with a chain of `length`
+/// arithmetic instructions that all use the previous one and the
+/// parameters, ending in a call to the previous function.
+auto GenerateModule(usz functions, usz length) -> std::string {
+    std::string out{};
+    for (usz f = 0; f < functions; ++f) {
+        out += fmt::format("func{} (internal): ccc i64(i64 %0, i64 %1):\n  bb0:\n", f);
+        usz last = 1;
+        for (usz i = 0; i < length; ++i) {
+            static constexpr std::string_view ops[]{"add", "sub", "mul", "xor", "and", "or"};
+            out += fmt::format(
+                "    %{} = {} i64 %{}, %{}\n",
+                last + 1,
+                ops[i % std::size(ops)],
+                last,
+                i % 2
+            );
+            ++last;
+        }
+        if (f) {
+            out += fmt::format("    %{} = call @func{} (i64 %{}, i64 %0) -> i64\n", last + 1, f - 1, last);
+            ++last;
+        }
+        out += fmt::format("    return i64 %{}\n", last);
+    }
+    return out;
+}
+
+auto ParseModule(lcc::Context& context, std::string_view source) -> std::unique_ptr<lcc::Module> {
+    auto& file = context.create_file("bench.lcc", lcc::utils::to_vec(source));
+    auto mod = lcc::Module::Parse(&context, file);
+    if (not mod) {
+        fmt::print(stderr, "ERROR! Generated benchmark input failed to parse\n");
+        std::exit(1);
+    }
+    return mod;
+}
+
+/// Count the instructions in a module.
+auto InstructionCount(lcc::Module& mod) -> usz {
+    usz count{};
+    for (auto& f : mod.code())
+        for (auto& b : f->blocks())
+            count += b->instructions().size();
+    return count;
+}
+
+/// IR -> MIR, for a module of `size` functions.
+auto BenchIRToMIR(usz size, Stopwatch& stopwatch) -> usz {
+    lcc::Context context{default_target, default_format, default_options};
+    auto mod = ParseModule(context, GenerateModule(size, 32));
+    mod->lower();
+
+    stopwatch.start();
+    auto mir = mod->mir();
+    stopwatch.stop();
+
+    return InstructionCount(*mod);
+}
+
+/// Textual IR -> IR, for a module of `size` functions.
+auto BenchIRParse(usz size, Stopwatch& stopwatch) -> usz {
+    lcc::Context context{default_target, default_format, default_options};
+    auto source = GenerateModule(size, 32);
+
+    stopwatch.start();
+    auto mod = ParseModule(context, source);
+    stopwatch.stop();
+
+    return source.size();
+}
+
+/// Sizes of the structs in GenerateStructModule().
+constexpr usz struct_sizes[]{16, 24, 32, 48, 64};
+
+/// A module of `functions` functions that each zero and then copy one
+/// struct of every size in `struct_sizes`, through the memory intrinsics
+/// that struct initialisation and assignment lower to.
+auto GenerateStructModule(usz functions) -> std::string {
+    std::string out{};
+    for (usz f = 0; f < functions; ++f) {
+        out += fmt::format("structs{} (internal): ccc void():\n  bb0:\n", f);
+        usz last = 0;
+        for (auto bytes : struct_sizes) {
+            out += fmt::format("    %{} = alloca i8[{}]\n", last, bytes);
+            out += fmt::format("    %{} = alloca i8[{}]\n", last + 1, bytes);
+            out += fmt::format("    intrinsic @memset(ptr %{}, i8 0, i64 {})\n", last, bytes);
+            out += fmt::format("    intrinsic @memcpy(ptr %{}, ptr %{}, i64 {})\n", last + 1, last, bytes);
+            last += 2;
+        }
+        out += "    return\n";
+    }
+    return out;
+}
+
+/// IR -> register allocated MIR, for a module of `size` functions that
+/// copy and zero structs.
+auto BenchStructCopies(usz size, Stopwatch& stopwatch) -> usz {
+    lcc::Context context{default_target, default_format, default_options};
+    auto mod = ParseModule(context, GenerateStructModule(size));
+    auto desc = lcc::cconv::machine_description(&context);
+    mod->lower();
+
+    stopwatch.start();
+    auto mir = mod->mir();
+    for (auto& function : mir) {
+        lcc::select_instructions(mod.get(), function);
+        if (not lcc::allocate_registers(desc, function, mod->next_vreg_ref())) {
+            fmt::print(stderr, "ERROR! Register allocation failed for {}\n", function.names().at(0).name);
+            std::exit(1);
+        }
+    }
+    stopwatch.stop();
+
+    // One memset and one memcpy per struct.
+    return size * 2 * std::size(struct_sizes);
+}
+
+/// Print a module of `size` functions with `emit(module, file)`, and
+/// return how many bytes were written.
+template <typename Emit>
+auto IRPrint(usz size, Stopwatch& stopwatch, Emit emit) -> usz {
+    lcc::Context context{default_target, default_format, default_options};
+    auto mod = ParseModule(context, GenerateModule(size, 32));
+    auto* file = std::tmpfile();
+    if (not file) {
+        fmt::print(stderr, "ERROR! Could not open a temporary file to print into\n");
+        std::exit(1);
+    }
+
+    stopwatch.start();
+    emit(*mod, file);
+    stopwatch.stop();
+
+    auto bytes = std::ftell(file);
+    std::fclose(file);
+    return usz(std::max(bytes, 0L));
+}
+
+auto BenchPrintLCCIR(usz size, Stopwatch& stopwatch) -> usz {
+    return IRPrint(size, stopwatch, [](lcc::Module& mod, std::FILE* file) {
+        mod.emit_lcc_ir(file, false);
+    });
+}
+
+auto BenchPrintLLVMIR(usz size, Stopwatch& stopwatch) -> usz {
+    return IRPrint(size, stopwatch, [](lcc::Module& mod, std::FILE* file) {
+        mod.emit_llvm_ir(file);
+    });
+}
+
+auto BenchPrintWAT(usz size, Stopwatch& stopwatch) -> usz {
+    return IRPrint(size, stopwatch, [](lcc::Module& mod, std::FILE* file) {
+        mod.emit_wat(file);
+    });
+}
+
+/// A Glint source of `size` lines of declarations, mostly identifiers.
+auto GenerateGlint(usz size) -> std::string {
+    // With a macro defined, every token is checked for being its name.
+    std::string out{"macro unused emits 0 endmacro\n"};
+    for (usz i = 0; i < size; ++i) {
+        out += fmt::format(
+            "value_{} :: previous_value_{} + some_longer_identifier_{} * {};\n",
+            i % 1000,
+            i % 997,
+            i % 13,
+            i
+        );
+    }
+    return out;
+}
+
+/// Lex `size` lines of Glint.
+auto BenchGlintLex(usz size, Stopwatch& stopwatch) -> usz {
+    lcc::Context context{default_target, default_format, default_options};
+    auto source = GenerateGlint(size);
+    auto& file = context.create_file("bench.g", lcc::utils::to_vec(source));
+
+    stopwatch.start();
+    auto tokens = lcc::glint::Parser::GetTokens(&context, file);
+    stopwatch.stop();
+
+    if (context.has_error()) {
+        fmt::print(stderr, "ERROR! Generated benchmark input failed to lex\n");
+        std::exit(1);
+    }
+    return source.size();
+}
+
+/// A C source of `size` statements, each expanding nested function-like
+/// macros that paste and stringify their arguments.
+auto GenerateMacros(usz size) -> std::string {
+    std::string out{
+        "#define add(a, b) ((a) + (b))\n"
+        "#define twice(x) add(x, x)\n"
+        "#define quad(x) twice(twice(x))\n"
+        "#define cat(a, b) a ## b\n"
+        "#define str(x) #x\n"
+        "#define both(a, b) add(quad(cat(a, b)), str(a))\n"
+        "\n"
+    };
+    for (usz i = 0; i < size; ++i)
+        out += fmt::format("both({}, {});\n", 1 + i % 9, i % 10);
+    return out;
+}
+
+/// Preprocess and parse `size` statements of macro-heavy C.
+auto BenchCMacros(usz size, Stopwatch& stopwatch) -> usz {
+    lcc::Context context{default_target, default_format, default_options};
+    auto source = GenerateMacros(size);
+    auto& file = context.create_file("bench.c", lcc::utils::to_vec(source));
+
+    stopwatch.start();
+    auto tu = lcc::language_c::Parser::Parse(&context, file);
+    stopwatch.stop();
+
+    if (context.has_error()) {
+        fmt::print(stderr, "ERROR! Generated benchmark input failed to parse\n");
+        std::exit(1);
+    }
+    return source.size();
+}
+
+/// Visit every instruction of a module of `size` functions, and every
+/// user of each, through the C API with `visit(module)`.
+template <typename Visit>
+auto CAPIWalk(usz size, Stopwatch& stopwatch, Visit visit) -> usz {
+    lcc::Context context{default_target, default_format, default_options};
+    auto mod = ParseModule(context, GenerateModule(size, 32));
+    auto module = reinterpret_cast<LccModuleRef>(mod.get());
+
+    static constexpr usz walks = 20;
+    usz values{};
+    stopwatch.start();
+    for (usz i = 0; i < walks; ++i) values += visit(module);
+    stopwatch.stop();
+    return values;
+}
+
+/// One call per function, block, instruction and user.
+auto BenchCAPIAtIndex(usz size, Stopwatch& stopwatch) -> usz {
+    return CAPIWalk(size, stopwatch, [](LccModuleRef module) {
+        usz values{};
+        for (int64_t f = 0; f < lcc_module_get_function_count(module); ++f) {
+            auto function = lcc_module_get_function_at_index(module, f);
+            for (int64_t b = 0; b < lcc_get_function_block_count(function); ++b) {
+                auto block = lcc_get_function_block_at_index(function, b);
+                for (int64_t i = 0; i < lcc_get_block_instruction_count(block); ++i) {
+                    auto inst = lcc_get_block_instruction_at_index(block, i);
+                    for (int64_t u = 0; u < lcc_get_instruction_user_count(inst); ++u)
+                        values += lcc_get_instruction_user_at_index(inst, u) != nullptr;
+                    ++values;
+                }
+            }
+        }
+        return values;
+    });
+}
+
+/// Copy values out in batches, through a small caller-provided array.
+auto BenchCAPIBulk(usz size, Stopwatch& stopwatch) -> usz {
+    return CAPIWalk(size, stopwatch, [](LccModuleRef module) {
+        static constexpr int64_t batch = 64;
+        LccValueRef functions[batch], blocks[batch], insts[batch], users[batch];
+        usz values{};
+        for (int64_t f = 0, fn; (fn = lcc_module_get_functions(module, functions, f, batch)); f += fn) {
+            for (int64_t fi = 0; fi < fn; ++fi) {
+                for (int64_t b = 0, bn; (bn = lcc_get_function_blocks(functions[fi], blocks, b, batch)); b += bn) {
+                    for (int64_t bi = 0; bi < bn; ++bi) {
+                        for (int64_t i = 0, in; (in = lcc_get_block_instructions(blocks[bi], insts, i, batch)); i += in) {
+                            for (int64_t ii = 0; ii < in; ++ii) {
+                                for (int64_t u = 0, un; (un = lcc_get_value_users(insts[ii], users, u, batch)); u += un)
+                                    values += usz(un);
+                                ++values;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        return values;
+    });
+}
+
+/// Iterate with cursors.
+auto BenchCAPICursor(usz size, Stopwatch& stopwatch) -> usz {
+    return CAPIWalk(size, stopwatch, [](LccModuleRef module) {
+        usz values{};
+        auto functions = lcc_module_function_cursor(module);
+        while (auto function = lcc_cursor_next(&functions)) {
+            auto blocks = lcc_function_block_cursor(function);
+            while (auto block = lcc_cursor_next(&blocks)) {
+                auto insts = lcc_block_instruction_cursor(block);
+                while (auto inst = lcc_cursor_next(&insts)) {
+                    auto users = lcc_value_user_cursor(inst);
+                    while (lcc_cursor_next(&users)) ++values;
+                    ++values;
+                }
+            }
+        }
+        return values;
+    });
+}
+
+/// Walk the operands of every instruction of a module of `size`
+/// functions a few times over, with `walk(inst, sum)`.
+template <typename Walk>
+auto OperandWalk(usz size, Stopwatch& stopwatch, Walk walk) -> usz {
+    lcc::Context context{default_target, default_format, default_options};
+    auto mod = ParseModule(context, GenerateModule(size, 32));
+
+    static constexpr usz walks = 20;
+    usz operands{};
+    uintptr_t sum{};
+    stopwatch.start();
+    for (usz i = 0; i < walks; ++i) {
+        for (auto& f : mod->code()) {
+            for (auto& b : f->blocks()) {
+                for (auto& inst : b->instructions())
+                    operands += walk(inst.get(), sum);
+            }
+        }
+    }
+    stopwatch.stop();
+
+    // Don't let the walk be optimised away.
+    if (sum == 42) fmt::print("");
+    return operands;
+}
+
+/// Walk operands with Inst::children(), which doesn't allocate.
+auto BenchOperandWalk(usz size, Stopwatch& stopwatch) -> usz {
+    return OperandWalk(size, stopwatch, [](lcc::Inst* inst, uintptr_t& sum) {
+        usz count{};
+        for (auto child : inst->children()) {
+            sum += uintptr_t(child);
+            ++count;
+        }
+        return count;
+    });
+}
+
+/// Walk operands the way they were walked when every walk allocated
+/// (a coroutine frame, then), for comparison.
+auto BenchOperandWalkAllocating(usz size, Stopwatch& stopwatch) -> usz {
+    return OperandWalk(size, stopwatch, [](lcc::Inst* inst, uintptr_t& sum) {
+        std::vector<lcc::Value*> children{inst->children().begin(), inst->children().end()};
+        for (auto child : children) sum += uintptr_t(child);
+        return children.size();
+    });
+}
+
+const Benchmark benchmarks[]{
+    {
+        "ir-to-mir",
+        "Build MIR (Module::mir()) from a module of many small functions",
+        "instruction",
+        2000,
+        true,
+        BenchIRToMIR,
+    },
+    {
+        "ir-parse",
+        "Parse textual LCC IR of a module of many small functions",
+        "byte",
+        2000,
+        true,
+        BenchIRParse,
+    },
+    {
+        "struct-copies",
+        "Build, select and allocate MIR for functions that zero and copy structs",
+        "intrinsic",
+        2000,
+        true,
+        BenchStructCopies,
+    },
+    {
+        "print-lcc-ir",
+        "Print a module of many small functions as LCC IR",
+        "byte",
+        2000,
+        true,
+        BenchPrintLCCIR,
+    },
+    {
+        "print-llvm-ir",
+        "Print a module of many small functions as LLVM IR",
+        "byte",
+        2000,
+        true,
+        BenchPrintLLVMIR,
+    },
+    {
+        "print-wat",
+        "Print a module of many small functions as WebAssembly text",
+        "byte",
+        2000,
+        true,
+        BenchPrintWAT,
+    },
+    {
+        "glint-lex",
+        "Lex Glint that is mostly identifiers, with a macro defined",
+        "byte",
+        20000,
+        true,
+        BenchGlintLex,
+    },
+    {
+        "c-macros",
+        "Preprocess and parse C that expands nested function-like macros",
+        "byte",
+        20000,
+        true,
+        BenchCMacros,
+    },
+    {
+        "c-api-at-index",
+        "Visit every instruction and user through the C API, one call per value",
+        "value",
+        2000,
+        false,
+        BenchCAPIAtIndex,
+    },
+    {
+        "c-api-bulk",
+        "Like c-api-at-index, but copying values out in batches of 64",
+        "value",
+        2000,
+        false,
+        BenchCAPIBulk,
+    },
+    {
+        "c-api-cursor",
+        "Like c-api-at-index, but iterating with cursors",
+        "value",
+        2000,
+        false,
+        BenchCAPICursor,
+    },
+    {
+        "operand-walk",
+        "Walk the operands of every instruction in a module",
+        "operand",
+        2000,
+        true,
+        BenchOperandWalk,
+    },
+    {
+        "operand-walk-allocating",
+        "Like operand-walk, but copying each instruction's operands into a new vector",
+        "operand",
+        2000,
+        false,
+        BenchOperandWalkAllocating,
+    },
+};
+
+struct Result {
+    double seconds{std::numeric_limits<double>::infinity()};
+    usz units{};
+
+    [[nodiscard]]
+    auto nanoseconds_per_unit() const -> double { return seconds * 1e9 / double(std::max<usz>(units, 1)); }
+};
+
+/// Run a benchmark a few times and keep the fastest run, which is
+/// the one least disturbed by everything else the machine is doing.
+auto Run(const Benchmark& b, usz size, usz repetitions) -> Result {
+    Result best{};
+    for (usz i = 0; i < repetitions; ++i) {
+        Stopwatch stopwatch{};
+        auto units = b.run(size, stopwatch);
+        if (stopwatch.seconds() < best.seconds)
+            best = {stopwatch.seconds(), units};
+    }
+    return best;
+}
+
+void Print(const Benchmark& b, usz size, Result r) {
+    fmt::print(
+        "{:<24} n={:<8} {:>10.3f} ms {:>10.1f} ns/{} ({} {}s)\n",
+        b.name,
+        size,
+        r.seconds * 1e3,
+        r.nanoseconds_per_unit(),
+        b.unit,
+        r.units,
+        b.unit
+    );
+}
+} // namespace
+
+int main(int argc, const char** argv) {
+    double scale{1};
+    usz repetitions{5};
+    std::vector<std::string_view> selected{};
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg{argv[i]};
+        auto Number = [&](auto& out) {
+            if (i + 1 >= argc) {
+                fmt::print(stderr, "ERROR! Expected a number following {}\n", arg);
+                std::exit(1);
+            }
+            std::string_view value{argv[++i]};
+            auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), out);
+            if (ec != std::errc{} or end != value.data() + value.size() or out <= 0) {
+                fmt::print(stderr, "ERROR! Expected a positive number following {}\n", arg);
+                std::exit(1);
+            }
+        };
+
+        if (arg == "--list") {
+            for (const auto& b : benchmarks)
+                fmt::print("{:<24} {}\n", b.name, b.description);
+            return 0;
+        }
+        if (arg == "--scale") Number(scale);
+        else if (arg == "--repeat") Number(repetitions);
+        else if (arg.starts_with("-")) {
+            fmt::print(stderr, "WARNING: Ignoring unhandled command line option `{}'\n", arg);
+        } else selected.emplace_back(arg);
+    }
+
+    for (auto name : selected) {
+        if (std::ranges::none_of(benchmarks, [&](const auto& b) { return b.name == name; })) {
+            fmt::print(stderr, "ERROR! No benchmark named {}; see --list\n", name);
+            return 1;
+        }
+    }
+
+    // A linear benchmark is also run with an input four times as big; if
+    // the time per unit grows by more than this factor, it isn't linear.
+    // Quadratic work would take four times as long per unit.
+    constexpr double max_linear_growth = 2.5;
+    constexpr usz growth = 4;
+
+    bool ok{true};
+    for (const auto& b : benchmarks) {
+        if (not selected.empty() and not std::ranges::contains(selected, b.name))
+            continue;
+
+        auto size = std::max<usz>(1, usz(double(b.size) * scale));
+        auto r = Run(b, size, repetitions);
+        Print(b, size, r);
+        if (not b.linear) continue;
+
+        auto bigger = Run(b, size * growth, repetitions);
+        Print(b, size * growth, bigger);
+        auto ratio = bigger.nanoseconds_per_unit() / r.nanoseconds_per_unit();
+        if (ratio > max_linear_growth) {
+            fmt::print(
+                "  FAIL: {}x the input took {:.2f}x as long per {}; expected linear time\n",
+                growth,
+                ratio,
+                b.unit
+            );
+            ok = false;
+        }
+    }
+
+    return ok ? 0 : 1;
+}
@@ -1,9 +1,13 @@
 #include <hdronly/lcc/typedefs.hh>
 
+#include <langtest/langtest.hh>
+
 #include <lcc/calling_convention.hh>
 #include <lcc/codegen/isel.hh>
 #include <lcc/codegen/mir.hh>
 #include <lcc/codegen/register_allocation.hh>
+#include <lcc/codegen/x86_64/assembly.hh>
+#include <lcc/codegen/x86_64/object.hh>
 #include <lcc/codegen/x86_64/x86_64.hh>
 #include <lcc/core.hh>
 #include <lcc/format.hh>
@@ -18,9 +22,15 @@
 #include <lccbase/context.hh>
 
 #include <fmt/format.h>
+#include <fmt/ranges.h>
 
+#include <algorithm>
+#include <cctype>
+#include <charconv>
 #include <cstdlib>
 #include <filesystem>
+#include <memory>
+#include <optional>
 #include <span>
 #include <string>
 #include <string_view>
@@ -36,11 +46,15 @@ struct MIRInstructionMatcher {
     std::vector<lcc::usz> operand_clobbers{};
     // List of register values that this instruction clobbers.
     std::vector<lcc::usz> register_clobbers{};
+    // Names of the blocks referenced by block operands, in order.
+    std::vector<std::string> block_names{};
+    // Names of the functions referenced by function operands, in order.
+    std::vector<std::string> function_names{};
 
     [[nodiscard]]
     bool match(lcc::MInst input) {
         if (input.opcode() != lcc::usz(opcode)) {
-            fmt::print(
+            langtest::print(
                 "  Instruction opcode does not match expected...\n"
                 "    GOT {} (0x{:x}), EXPECTED {} (0x{:x})\n",
                 lcc::x86_64::opcode_to_string(input.opcode()),
@@ -52,7 +66,7 @@ struct MIRInstructionMatcher {
         }
 
         if (input.all_operands().size() != operands.size()) {
-            fmt::print(
+            langtest::print(
                 "  Operand count does not match expected...\n"
                 "    GOT {}, EXPECTED {}\n",
                 input.all_operands().size(),
@@ -60,9 +74,11 @@ struct MIRInstructionMatcher {
             );
             return false;
         }
+        lcc::usz block_operand{0};
+        lcc::usz function_operand{0};
         for (auto [expected, got] : lcc::vws::zip(operands, input.all_operands())) {
             if (expected.index() != got.index()) {
-                fmt::print(
+                langtest::print(
                     "  Operand variant type does not match expected...\n"
                     "    GOT {}, EXPECTED {}\n",
                     got.index(),
@@ -72,14 +88,14 @@ struct MIRInstructionMatcher {
             }
 
             static_assert(
-                std::variant_size_v<lcc::MOperand> == 6,
+                std::variant_size_v<lcc::MOperand> == 7,
                 "Exhaustive handling of MOperand kinds in CodeTest"
             );
             if (std::holds_alternative<lcc::MOperandRegister>(got)) {
                 auto r_got = std::get<lcc::MOperandRegister>(got);
                 auto r_expected = std::get<lcc::MOperandRegister>(expected);
                 if (r_got.value != r_expected.value) {
-                    fmt::print(
+                    langtest::print(
                         "  Register operand value does not match expected...\n"
                         "    GOT {}, EXPECTED {}\n",
                         r_got.value,
@@ -88,7 +104,7 @@ struct MIRInstructionMatcher {
                     return false;
                 }
                 if (r_got.size != r_expected.size) {
-                    fmt::print(
+                    langtest::print(
                         "  Register operand size does not match expected...\n"
                         "    GOT {}, EXPECTED {}\n",
                         r_got.size,
@@ -100,7 +116,7 @@ struct MIRInstructionMatcher {
                 auto imm_got = std::get<lcc::MOperandImmediate>(got);
                 auto imm_expected = std::get<lcc::MOperandImmediate>(expected);
                 if (imm_got.value != imm_expected.value) {
-                    fmt::print(
+                    langtest::print(
                         "  Immediate operand value does not match expected...\n"
                         "    GOT {}, EXPECTED {}\n",
                         imm_got.value,
@@ -109,7 +125,7 @@ struct MIRInstructionMatcher {
                     return false;
                 }
                 if (imm_got.size != imm_expected.size) {
-                    fmt::print(
+                    langtest::print(
                         "  Immediate operand size does not match expected...\n"
                         "    GOT {}, EXPECTED {}\n",
                         imm_got.size,
@@ -128,7 +144,7 @@ struct MIRInstructionMatcher {
                         expected_index = "INVALID";
                     else expected_index = fmt::format("{}", local_expected.index);
 
-                    fmt::print(
+                    langtest::print(
                         "  Local index does not match expected...\n"
                         "    GOT {}, EXPECTED {}\n",
                         local_got.index,
@@ -137,7 +153,7 @@ struct MIRInstructionMatcher {
                     return false;
                 }
                 if (local_got.offset != local_expected.offset) {
-                    fmt::print(
+                    langtest::print(
                         "  Local offset does not match expected...\n"
                         "    GOT {}, EXPECTED {}\n",
                         local_got.offset,
@@ -145,11 +161,53 @@ struct MIRInstructionMatcher {
                     );
                     return false;
                 }
+            } else if (std::holds_alternative<lcc::MOperandMemory>(got)) {
+                auto mem_got = std::get<lcc::MOperandMemory>(got);
+                auto mem_expected = std::get<lcc::MOperandMemory>(expected);
+                if (
+                    mem_got.base.value != mem_expected.base.value
+                    or mem_got.index.value != mem_expected.index.value
+                    or (mem_got.index.value and mem_got.scale != mem_expected.scale)
+                    or mem_got.displacement != mem_expected.displacement
+                ) {
+                    langtest::print(
+                        "  Memory operand does not match expected...\n"
+                        "    GOT {}, EXPECTED {}\n",
+                        lcc::PrintMOperand(mem_got),
+                        lcc::PrintMOperand(mem_expected)
+                    );
+                    return false;
+                }
+            } else if (std::holds_alternative<lcc::MOperandBlock>(got)) {
+                auto block_got = std::get<lcc::MOperandBlock>(got);
+                const auto& name_expected = block_names.at(block_operand++);
+                if (block_got->name() != name_expected) {
+                    langtest::print(
+                        "  Block operand does not match expected...\n"
+                        "    GOT {}, EXPECTED {}\n",
+                        block_got->name(),
+                        name_expected
+                    );
+                    return false;
+                }
+            } else if (std::holds_alternative<lcc::MOperandFunction>(got)) {
+                auto function_got = std::get<lcc::MOperandFunction>(got);
+                auto name_got = function_got->names().at(0).name;
+                const auto& name_expected = function_names.at(function_operand++);
+                if (name_got != name_expected) {
+                    langtest::print(
+                        "  Function operand does not match expected...\n"
+                        "    GOT {}, EXPECTED {}\n",
+                        name_got,
+                        name_expected
+                    );
+                    return false;
+                }
             } else LCC_TODO("Implement matcher for MOperand type index {}...", got.index());
         }
 
         if (input.operand_clobbers().size() != operand_clobbers.size()) {
-            fmt::print(
+            langtest::print(
                 "  Operand clobber count does not match expected...\n"
                 "    GOT {}, EXPECTED {}\n",
                 input.operand_clobbers().size(),
@@ -159,7 +217,7 @@ struct MIRInstructionMatcher {
         }
         for (auto [expected, got] : lcc::vws::zip(operand_clobbers, input.operand_clobbers())) {
             if (expected != got) {
-                fmt::print(
+                langtest::print(
                     "  Operand clobber values do not match expected...\n"
                     "    GOT {}, EXPECTED {}\n",
                     got,
@@ -170,7 +228,7 @@ struct MIRInstructionMatcher {
         }
 
         if (input.register_clobbers().size() != register_clobbers.size()) {
-            fmt::print(
+            langtest::print(
                 "  Register clobber count does not match expected...\n"
                 "    GOT {}, EXPECTED {}\n",
                 input.register_clobbers().size(),
@@ -180,7 +238,7 @@ struct MIRInstructionMatcher {
         }
         for (auto [expected, got] : lcc::vws::zip(register_clobbers, input.register_clobbers())) {
             if (expected != got) {
-                fmt::print(
+                langtest::print(
                     "  Register clobber values do not match expected...\n"
                     "    GOT {}, EXPECTED {}",
                     got,
@@ -200,13 +258,13 @@ struct MIRBlockMatcher {
     [[nodiscard]]
     bool match(std::vector<lcc::MInst> input) {
         if (input.size() != instructions.size()) {
-            fmt::print("  Instruction count did not match expected...\n");
+            langtest::print("  Instruction count did not match expected...\n");
             return false;
         }
 
         for (auto [expected, got] : lcc::vws::zip(instructions, input)) {
             if (not expected.match(got)) {
-                fmt::print(
+                langtest::print(
                     "  Instruction did not match expected...\n    {}\n",
                     lcc::PrintMInstImpl(got, lcc::x86_64::opcode_to_string)
                 );
@@ -225,13 +283,13 @@ struct MIRFunctionMatcher {
     [[nodiscard]]
     bool match(std::vector<lcc::MBlock> input) {
         if (input.size() != blocks.size()) {
-            fmt::print("  Block count did not match expected...\n");
+            langtest::print("  Block count did not match expected...\n");
             return false;
         }
 
         for (auto [expected, got] : lcc::vws::zip(blocks, input)) {
             if (not expected.match(got.instructions())) {
-                fmt::print("  Block contents did not match expected...\n");
+                langtest::print("  Block contents did not match expected...\n");
                 return false;
             }
         }
@@ -246,13 +304,13 @@ struct MIRMatcher {
     [[nodiscard]]
     bool match(std::vector<lcc::MFunction>& mir) {
         if (mir.size() != functions.size()) {
-            fmt::print("  MIR function count did not match expected...\n");
+            langtest::print("  MIR function count did not match expected...\n");
             return false;
         }
 
         for (auto [expected, got] : lcc::vws::zip(functions, mir)) {
             if (not expected.match(got.blocks())) {
-                fmt::print("  Blocks of function {} did not match expected...\n", got.names().at(0).name);
+                langtest::print("  Blocks of function {} did not match expected...\n", got.names().at(0).name);
                 return false;
             }
         }
@@ -261,9 +319,65 @@ struct MIRMatcher {
     }
 };
 
+/// Quantitative properties the generated code must have, on top of
+/// matching the expected MIR. Counts are over all functions.
+struct CodeLimits {
+    std::optional<lcc::usz> max_instructions{};
+    std::optional<lcc::usz> max_moves{};
+    std::optional<lcc::usz> max_spills{};
+    std::optional<lcc::usz> max_reloads{};
+    // In bytes; applies to every function on its own.
+    std::optional<lcc::usz> max_stack_frame{};
+    // Whether there must (true) or must not (false) be calls.
+    std::optional<bool> calls{};
+    // Whether the code must exceed at least one of the limits above, so
+    // that a test can show a limit being enforced.
+    bool exceeded{false};
+
+    bool check(const std::vector<lcc::MFunction>& mir) const {
+        lcc::usz instructions{};
+        lcc::usz moves{};
+        lcc::usz spills{};
+        lcc::usz reloads{};
+        lcc::usz stack_frame{};
+        lcc::usz call_count{};
+        for (const auto& function : mir) {
+            stack_frame = std::max(stack_frame, lcc::x86_64::frame_size(function));
+            for (const auto& block : function.blocks()) {
+                for (const auto& inst : block.instructions()) {
+                    ++instructions;
+                    if (inst.opcode() == lcc::usz(lcc::x86_64::Opcode::Move)) ++moves;
+                    if (inst.opcode() == lcc::usz(lcc::MInst::Kind::Spill)) ++spills;
+                    if (inst.opcode() == lcc::usz(lcc::MInst::Kind::Unspill)) ++reloads;
+                    if (inst.opcode() == lcc::usz(lcc::x86_64::Opcode::Call)) ++call_count;
+                }
+            }
+        }
+
+        bool ok{true};
+        auto Check = [&](std::string_view what, lcc::usz got, std::optional<lcc::usz> max) {
+            if (max and got > *max) {
+                if (not exceeded) langtest::print("  Expected at most {} {}, but got {}\n", *max, what, got);
+                ok = false;
+            }
+        };
+        Check("instructions", instructions, max_instructions);
+        Check("moves", moves, max_moves);
+        Check("spills", spills, max_spills);
+        Check("reloads", reloads, max_reloads);
+        Check("bytes of stack frame", stack_frame, max_stack_frame);
+        if (calls and *calls != (call_count != 0)) {
+            if (not exceeded) langtest::print("  Expected {}calls, but got {}\n", *calls ? "" : "no ", call_count);
+            ok = false;
+        }
+        return ok;
+    }
+};
+
 [[nodiscard]]
 bool run_test(
     MIRMatcher& matcher,
+    const CodeLimits& limits,
     std::string_view test_source,
     const lcc::Target* target,
     const lcc::Format* format,
@@ -336,7 +450,16 @@ bool run_test(
     //     );
     // }
 
-    return matcher.match(machine_ir);
+    // Check the limits even if the MIR doesn't match, so a failure
+    // reports everything that is wrong.
+    bool matched = matcher.match(machine_ir);
+    bool within_limits = limits.check(machine_ir);
+    if (limits.exceeded) {
+        if (within_limits)
+            langtest::print("  Expected to exceed a limit, but stayed within all of them\n");
+        return matched and not within_limits;
+    }
+    return matched and within_limits;
 }
 
 lcc::x86_64::RegisterId register_operand_value(std::string_view operand) {
@@ -531,6 +654,26 @@ MIRInstructionMatcher parse_instruction_matcher(
         out.opcode = lcc::operator+(lcc::x86_64::Opcode::Test);
     else if (instruction_opcode == "jz")
         out.opcode = lcc::operator+(lcc::x86_64::Opcode::JumpIfZeroFlag);
+    else if (instruction_opcode == "je")
+        out.opcode = lcc::operator+(lcc::x86_64::Opcode::JumpIfEqual);
+    else if (instruction_opcode == "jne")
+        out.opcode = lcc::operator+(lcc::x86_64::Opcode::JumpIfNotEqual);
+    else if (instruction_opcode == "jb")
+        out.opcode = lcc::operator+(lcc::x86_64::Opcode::JumpIfLessUnsigned);
+    else if (instruction_opcode == "jl")
+        out.opcode = lcc::operator+(lcc::x86_64::Opcode::JumpIfLessSigned);
+    else if (instruction_opcode == "ja")
+        out.opcode = lcc::operator+(lcc::x86_64::Opcode::JumpIfGreaterUnsigned);
+    else if (instruction_opcode == "jg")
+        out.opcode = lcc::operator+(lcc::x86_64::Opcode::JumpIfGreaterSigned);
+    else if (instruction_opcode == "jbe")
+        out.opcode = lcc::operator+(lcc::x86_64::Opcode::JumpIfEqualOrLessUnsigned);
+    else if (instruction_opcode == "jle")
+        out.opcode = lcc::operator+(lcc::x86_64::Opcode::JumpIfEqualOrLessSigned);
+    else if (instruction_opcode == "jae")
+        out.opcode = lcc::operator+(lcc::x86_64::Opcode::JumpIfEqualOrGreaterUnsigned);
+    else if (instruction_opcode == "jge")
+        out.opcode = lcc::operator+(lcc::x86_64::Opcode::JumpIfEqualOrGreaterSigned);
     else if (instruction_opcode == "sete")
         out.opcode = lcc::operator+(lcc::x86_64::Opcode::SetByteIfEqual);
     else if (instruction_opcode == "setne")
@@ -551,6 +694,30 @@ MIRInstructionMatcher parse_instruction_matcher(
         out.opcode = lcc::operator+(lcc::x86_64::Opcode::SetByteIfGreaterUnsigned);
     else if (instruction_opcode == "setg")
         out.opcode = lcc::operator+(lcc::x86_64::Opcode::SetByteIfGreaterSigned);
+    else if (instruction_opcode == "cmove")
+        out.opcode = lcc::operator+(lcc::x86_64::Opcode::MoveIfEqual);
+    else if (instruction_opcode == "cmovne")
+        out.opcode = lcc::operator+(lcc::x86_64::Opcode::MoveIfNotEqual);
+    else if (instruction_opcode == "cmovbe")
+        out.opcode = lcc::operator+(lcc::x86_64::Opcode::MoveIfEqualOrLessUnsigned);
+    else if (instruction_opcode == "cmovle")
+        out.opcode = lcc::operator+(lcc::x86_64::Opcode::MoveIfEqualOrLessSigned);
+    else if (instruction_opcode == "cmovae")
+        out.opcode = lcc::operator+(lcc::x86_64::Opcode::MoveIfEqualOrGreaterUnsigned);
+    else if (instruction_opcode == "cmovge")
+        out.opcode = lcc::operator+(lcc::x86_64::Opcode::MoveIfEqualOrGreaterSigned);
+    else if (instruction_opcode == "cmovb")
+        out.opcode = lcc::operator+(lcc::x86_64::Opcode::MoveIfLessUnsigned);
+    else if (instruction_opcode == "cmovl")
+        out.opcode = lcc::operator+(lcc::x86_64::Opcode::MoveIfLessSigned);
+    else if (instruction_opcode == "cmova")
+        out.opcode = lcc::operator+(lcc::x86_64::Opcode::MoveIfGreaterUnsigned);
+    else if (instruction_opcode == "cmovg")
+        out.opcode = lcc::operator+(lcc::x86_64::Opcode::MoveIfGreaterSigned);
+    else if (instruction_opcode == "spill")
+        out.opcode = lcc::usz(lcc::MInst::Kind::Spill);
+    else if (instruction_opcode == "unspill")
+        out.opcode = lcc::usz(lcc::MInst::Kind::Unspill);
     else if (instruction_opcode == "movss" or instruction_opcode == "movsd")
         out.opcode = lcc::operator+(lcc::x86_64::Opcode::ScalarFloatMove);
     else if (instruction_opcode == "movss.dereflhs" or instruction_opcode == "movsd.dereflhs")
@@ -638,7 +805,35 @@ MIRInstructionMatcher parse_instruction_matcher(
         };
         SkipWhitespaceWithinLine();
 
-        if (operand.starts_with("r") or operand.starts_with("xmm")) {
+        if (operand.starts_with("mem(")) {
+            // Looks like "mem(rax+rcx*8+16)"; registers are always 64 bit.
+            lcc::MOperandMemory mem{};
+            auto inner = std::string_view{operand}.substr(4);
+            if (not inner.ends_with(')')) {
+                fmt::print(stderr, "ERROR! Expected `)` to close memory operand, got `{}`\n", operand);
+                std::exit(1);
+            }
+            inner.remove_suffix(1);
+
+            auto next_part = [&]() {
+                auto end = inner.find_first_of("+-", 1);
+                auto part = inner.substr(0, end);
+                inner.remove_prefix(part.size());
+                return std::string{part};
+            };
+
+            mem.base = {lcc::operator+(register_operand_value(next_part())), 64};
+            while (not inner.empty()) {
+                auto part = next_part();
+                auto star = part.find('*');
+                if (star != std::string::npos) {
+                    mem.index = {lcc::operator+(register_operand_value(part.substr(1))), 64};
+                    mem.scale = lcc::u8(std::stoi(part.substr(star + 1)));
+                } else mem.displacement = std::stoi(part);
+            }
+
+            out.operands.emplace_back(mem);
+        } else if (operand.starts_with("r") or operand.starts_with("xmm")) {
             lcc::Register r{};
 
             r.value = lcc::operator+(register_operand_value(operand));
@@ -664,6 +859,26 @@ MIRInstructionMatcher parse_instruction_matcher(
             local.offset = offset_value;
 
             out.operands.emplace_back(local);
+        } else if (operand.starts_with("block(")) {
+            // Looks like "block(bb1)"; only the name is compared.
+            auto name = std::string_view{operand}.substr(6);
+            if (not name.ends_with(')')) {
+                fmt::print(stderr, "ERROR! Expected `)` to close block operand, got `{}`\n", operand);
+                std::exit(1);
+            }
+            name.remove_suffix(1);
+            out.block_names.emplace_back(name);
+            out.operands.emplace_back(lcc::MOperandBlock{});
+        } else if (operand.starts_with("function(")) {
+            // Looks like "function(callee)"; only the name is compared.
+            auto name = std::string_view{operand}.substr(9);
+            if (not name.ends_with(')')) {
+                fmt::print(stderr, "ERROR! Expected `)` to close function operand, got `{}`\n", operand);
+                std::exit(1);
+            }
+            name.remove_suffix(1);
+            out.function_names.emplace_back(name);
+            out.operands.emplace_back(lcc::MOperandFunction{});
         } else if (operand.size() and isdigit(operand.front())) {
             // Looks like "3.32"
             // 3  -> immediate value
@@ -889,10 +1104,42 @@ struct Test {
     std::string name{};
 
     bool should_skip{false};
+
+    CodeLimits limits{};
 };
 
+/// Parse a specifier of the form `:<name> <count>` into `out`.
+///
+/// \return False if the specifier isn't called `name`.
+bool parse_count_specifier(
+    std::string_view specifier,
+    std::string_view name,
+    std::optional<lcc::usz>& out
+) {
+    if (not specifier.starts_with(name)) return false;
+    auto count = specifier.substr(name.size());
+    while (not count.empty() and std::isspace(static_cast<unsigned char>(count.front())))
+        count.remove_prefix(1);
+    while (not count.empty() and std::isspace(static_cast<unsigned char>(count.back())))
+        count.remove_suffix(1);
+
+    lcc::usz value{};
+    auto [end, ec] = std::from_chars(count.data(), count.data() + count.size(), value);
+    if (ec != std::errc{} or end != count.data() + count.size()) {
+        fmt::print(
+            "ERROR! Expected a count following test specifier \"{}\"\n",
+            name
+        );
+        std::exit(1);
+    }
+
+    out = value;
+    return true;
+}
+
 Test parse_test(std::vector<char>& inputs, lcc::usz& i) {
     bool should_skip{false};
+    CodeLimits limits{};
 
     auto ToNewline = [&]() {
         while (i < inputs.size() and inputs.at(i) != '\n')
@@ -935,6 +1182,20 @@ Test parse_test(std::vector<char>& inputs, lcc::usz& i) {
 
         if (specifier.starts_with(":skip")) {
             should_skip = true;
+        } else if (specifier.starts_with(":calls")) {
+            limits.calls = true;
+        } else if (specifier.starts_with(":no-calls")) {
+            limits.calls = false;
+        } else if (specifier.starts_with(":exceeds-limits")) {
+            limits.exceeded = true;
+        } else if (
+            parse_count_specifier(specifier, ":max-instructions", limits.max_instructions)
+            or parse_count_specifier(specifier, ":max-moves", limits.max_moves)
+            or parse_count_specifier(specifier, ":max-spills", limits.max_spills)
+            or parse_count_specifier(specifier, ":max-reloads", limits.max_reloads)
+            or parse_count_specifier(specifier, ":max-stack-frame", limits.max_stack_frame)
+        ) {
+            // Nothing else to do.
         } else {
             fmt::print(
                 "ERROR! Invalid test specifier \"{}\"\n",
@@ -1001,7 +1262,7 @@ Test parse_test(std::vector<char>& inputs, lcc::usz& i) {
         matchers.emplace_back(target, parse_matcher(test_result));
     }
 
-    return {matchers, test_source, test_name, should_skip};
+    return {matchers, test_source, test_name, should_skip, limits};
 }
 
 std::string_view ToString(const lcc::Target* t) {
@@ -1119,54 +1380,199 @@ void to_sarif(const CodeTestContext& context, std::string command_line) {
     (void) lcc::File::Write(sarif_data.data(), sarif_data.size(), "codetest.sarif");
 }
 
+/// Assemble a load through each memory operand form the x86_64 object
+/// emitter treats specially (SIB for an rsp/r12 base, a forced disp8 for
+/// an rbp/r13 base, disp8 vs disp32, REX.X for an index) and compare the
+/// bytes against what GNU as emits for the same instruction.
+void check_memory_operand_encodings(CodeTestContext& context, lcc::Colours C) {
+    using lcc::x86_64::RegisterId;
+    struct EncodingTest {
+        std::string_view name;
+        RegisterId base;
+        RegisterId index;
+        lcc::u8 scale;
+        lcc::i32 displacement;
+        std::vector<lcc::u8> expected;
+    };
+    const std::vector<EncodingTest> tests{
+        {"mov (%rsp), %rax", RegisterId::RSP, RegisterId::INVALID, 1, 0, {0x48, 0x8b, 0x04, 0x24}},
+        {"mov (%r12), %rax", RegisterId::R12, RegisterId::INVALID, 1, 0, {0x49, 0x8b, 0x04, 0x24}},
+        {"mov (%rbp), %rax", RegisterId::RBP, RegisterId::INVALID, 1, 0, {0x48, 0x8b, 0x45, 0x00}},
+        {"mov (%r13), %rax", RegisterId::R13, RegisterId::INVALID, 1, 0, {0x49, 0x8b, 0x45, 0x00}},
+        {"mov 8(%rax), %rax", RegisterId::RAX, RegisterId::INVALID, 1, 8, {0x48, 0x8b, 0x40, 0x08}},
+        {"mov -128(%rax), %rax", RegisterId::RAX, RegisterId::INVALID, 1, -128, {0x48, 0x8b, 0x40, 0x80}},
+        {"mov 128(%rax), %rax", RegisterId::RAX, RegisterId::INVALID, 1, 128, {0x48, 0x8b, 0x80, 0x80, 0x00, 0x00, 0x00}},
+        {"mov (%rdi,%rsi,8), %rax", RegisterId::RDI, RegisterId::RSI, 8, 0, {0x48, 0x8b, 0x04, 0xf7}},
+        {"mov 16(%rsp,%rcx,2), %rax", RegisterId::RSP, RegisterId::RCX, 2, 16, {0x48, 0x8b, 0x44, 0x4c, 0x10}},
+        {"mov -32(%rbp,%rcx,4), %rax", RegisterId::RBP, RegisterId::RCX, 4, -32, {0x48, 0x8b, 0x44, 0x8d, 0xe0}},
+        {"mov (%r13,%rdx,1), %rax", RegisterId::R13, RegisterId::RDX, 1, 0, {0x49, 0x8b, 0x44, 0x15, 0x00}},
+        {"mov (%rax,%r9,2), %rax", RegisterId::RAX, RegisterId::R9, 2, 0, {0x4a, 0x8b, 0x04, 0x48}},
+    };
+
+    // push %rbp; mov %rsp, %rbp
+    static constexpr lcc::u8 prologue_size = 4;
+
+    auto ctx = lcc::Context{
+        lcc::Target::x86_64_linux,
+        lcc::Format::elf_object,
+        {
+            lcc::Context::UseColour,
+            lcc::Context::DoNotPrintStats,
+            lcc::Context::DoNotDiagBacktrace,
+            lcc::Context::DoNotPrintAST,
+            lcc::Context::DoNotStopatLex,
+            lcc::Context::DoNotStopatSyntax,
+            lcc::Context::DoNotStopatSema,
+            lcc::Context::DoNotPrintMachineIR,
+            lcc::Context::DoNotStopatMIR,
+        }
+    };
+    auto desc = lcc::cconv::machine_description(&ctx);
+
+    fmt::print("Memory Operand Encodings:\n");
+    for (const auto& t : tests) {
+        lcc::MOperandMemory mem{};
+        mem.base = {lcc::usz(t.base), 64};
+        if (t.index != RegisterId::INVALID)
+            mem.index = {lcc::usz(t.index), 64};
+        mem.scale = t.scale;
+        mem.displacement = t.displacement;
+
+        auto load = lcc::MInst(lcc::usz(lcc::x86_64::Opcode::MoveDereferenceLHS), {0, 0});
+        load.add_operand(mem);
+        load.add_operand(lcc::MOperandRegister(lcc::usz(RegisterId::RAX), 64));
+
+        lcc::MBlock block{"bb0"};
+        block.add_instruction(load);
+        std::vector<lcc::MFunction> functions{};
+        auto& function = functions.emplace_back(lcc::CallConv::C);
+        function.names().push_back({"f", lcc::Linkage::Exported});
+        function.add_block(block);
+
+        auto mod = std::make_unique<lcc::Module>(&ctx);
+        auto gobj = lcc::x86_64::emit_mcode_gobj(mod.get(), desc, functions);
+        const auto& text = gobj.section(".text").contents();
+        auto got = std::span{text}.subspan(std::min<lcc::usz>(prologue_size, text.size()));
+
+        bool passed = lcc::rgs::equal(got, t.expected);
+        fmt::print("  {}: ", t.name);
+        context.record_test(passed, ctx.target(), t.name);
+        if (passed) {
+            fmt::print(
+                "{}PASSED{}\n",
+                C(lcc::Colour::BoldGreen),
+                C(lcc::Colour::Reset)
+            );
+        } else fmt::print(
+            "{}FAILED{}\n    GOT {:02x}, EXPECTED {:02x}\n",
+            C(lcc::Colour::BoldRed),
+            C(lcc::Colour::Reset),
+            fmt::join(got, " "),
+            fmt::join(t.expected, " ")
+        );
+    }
+}
+
 int main(int argc, char** argv) {
+    for (auto i = 1; i < argc; ++i) {
+        std::string_view arg{argv[i]};
+        if (arg.starts_with("-j")) {
+            auto jobs = arg.substr(2);
+            if (jobs.empty() and i + 1 < argc) jobs = argv[++i];
+            if (not langtest::parse_job_count(jobs)) {
+                fmt::print("ERROR: invalid number of jobs `{}`\n", jobs);
+                return 1;
+            }
+            continue;
+        }
+        fmt::print(stderr, "WARNING: Ignoring unhandled command line option `{}'\n", arg);
+    }
+
     lcc::Colours C{true};
     CodeTestContext context{};
+    langtest::TestContext timings{};
     {
         // Read all files in corpus/
         // TODO: Recursively
+        std::vector<std::filesystem::path> paths{};
         for (const auto& entry : std::filesystem::directory_iterator("corpus")) {
             if (entry.is_regular_file()) {
-                fmt::print("{}:\n", entry.path().lexically_normal().string());
-
-                auto inputs = lcc::File::Read(entry.path());
-                lcc::usz i{0};
-                while (i < inputs.size()) {
-                    auto t = parse_test(inputs, i);
-                    if (t.should_skip) continue;
-                    fmt::print("{}\n", t.name);
-                    for (auto m : t.matchers) {
-                        fmt::print("  {}: ", ToString(m.target));
-                        // Run the test with the given matcher and target,
-                        // and print a useful message.
-                        bool passed = run_test(
-                            m.matcher,
-                            t.source,
-                            m.target,
-                            lcc::Format::gnu_as_att_assembly,
-                            0,
-                            ""
-                        );
-                        context.record_test(passed, m.target, t.name);
-                        if (passed) {
-                            fmt::print(
-                                "{}PASSED{}\n",
-                                C(lcc::Colour::BoldGreen),
-                                C(lcc::Colour::Reset)
-                            );
-                        } else fmt::print(
-                            "{}FAILED{}\n",
-                            C(lcc::Colour::BoldRed),
-                            C(lcc::Colour::Reset)
-                        );
-                    }
-                }
+                paths.push_back(entry.path());
             } else if (entry.is_directory()) {
                 // TODO: Recurse...
             }
         }
+        // Report files in the same order every time.
+        lcc::rgs::sort(paths);
+
+        // Every test is run once per matcher (calling convention).
+        struct Run {
+            lcc::usz file;
+            const Test* test;
+            CCMatcher matcher;
+        };
+        std::vector<std::vector<Test>> tests(paths.size());
+        for (lcc::usz file = 0; file < paths.size(); ++file) {
+            auto inputs = lcc::File::Read(paths[file]);
+            lcc::usz i{0};
+            while (i < inputs.size()) {
+                auto t = parse_test(inputs, i);
+                if (t.should_skip) continue;
+                tests[file].push_back(std::move(t));
+            }
+        }
+        std::vector<Run> runs{};
+        for (lcc::usz file = 0; file < tests.size(); ++file)
+            for (const auto& t : tests[file])
+                for (const auto& m : t.matchers)
+                    runs.emplace_back(file, &t, m);
+
+        auto results = langtest::run_tests(runs.size(), [&](lcc::usz i) {
+            return run_test(
+                runs[i].matcher.matcher,
+                runs[i].test->limits,
+                runs[i].test->source,
+                runs[i].matcher.target,
+                lcc::Format::gnu_as_att_assembly,
+                0,
+                ""
+            );
+        });
+
+        const Test* previous_test{};
+        for (lcc::usz i = 0; i < runs.size(); ++i) {
+            const auto& run = runs[i];
+            const auto& result = results[i];
+            if (i == 0 or runs[i - 1].file != run.file)
+                fmt::print("{}:\n", paths[run.file].lexically_normal().string());
+            if (run.test != previous_test)
+                fmt::print("{}\n", run.test->name);
+            previous_test = run.test;
+
+            fmt::print("{}", result.output);
+            fmt::print("  {}: ", ToString(run.matcher.target));
+            context.record_test(result.passed, run.matcher.target, run.test->name);
+            timings.record_test(
+                fmt::format("{}: {}", ToString(run.matcher.target), run.test->name),
+                result.passed,
+                result.time
+            );
+            if (result.passed) {
+                fmt::print(
+                    "{}PASSED{}\n",
+                    C(lcc::Colour::BoldGreen),
+                    C(lcc::Colour::Reset)
+                );
+            } else fmt::print(
+                "{}FAILED{}\n",
+                C(lcc::Colour::BoldRed),
+                C(lcc::Colour::Reset)
+            );
+        }
     }
 
+    check_memory_operand_encodings(context, C);
+
     std::string command_line{argv[0]};
     for (auto i = 1; i < argc; ++i) {
         command_line += ' ';
@@ -1181,6 +1587,8 @@ int main(int argc, char** argv) {
         break;
     }
 
+    timings.print_slowest();
+
 #ifdef LCC_TEST_NON_ZERO_EXIT_ON_FAILURE
     if (any_failed)
         return 1;
@@ -5,6 +5,7 @@
 #include <lcc/core.hh>
 #include <lcc/format.hh>
 #include <lcc/ir/core.hh>
+#include <lcc/ir/domtree.hh>
 #include <lcc/ir/module.hh>
 #include <lcc/opt.hh>
 #include <lcc/target.hh>
@@ -15,10 +16,16 @@
 #include <lccbase/context.hh>
 #include <lccbase/file.hh>
 
+#include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <chrono>
 #include <filesystem>
 #include <iterator>
+#include <set>
+#include <string>
 #include <string_view>
+#include <thread>
 #include <vector>
 
 const lcc::Target* default_target =
@@ -35,15 +42,39 @@ const lcc::Format* default_format = lcc::Format::gnu_as_att_assembly;
 
 static lcc::Colours C{true};
 
+/// Options for the contexts tests are compiled in.
+const lcc::Context::Options default_options{
+    lcc::Context::DoNotUseColour,
+    lcc::Context::DoNotPrintStats,
+    lcc::Context::DoNotDiagBacktrace,
+    lcc::Context::DoNotPrintAST,
+    lcc::Context::DoNotStopatLex,
+    lcc::Context::DoNotStopatSyntax,
+    lcc::Context::DoNotStopatSema,
+    lcc::Context::DoNotPrintMachineIR,
+    lcc::Context::DoNotStopatMIR
+};
+
 struct TestNameAndResult {
     std::string_view name{};
     bool passed{true};
+    std::chrono::steady_clock::duration time{};
+};
+
+struct IRTest {
+    std::string_view name;
+    std::string_view input;
+    std::string_view expected;
+    int optimise{};
 };
 
 struct TestContext {
     lcc::Context& context;
     std::vector<TestNameAndResult> results{};
 
+    /// Every test that was run, for running them all again at once.
+    std::vector<IRTest> tests{};
+
     bool option_per_directory_count{true};
 };
 
@@ -128,13 +159,6 @@ auto to_sarif(
     return sarif.emit();
 }
 
-struct IRTest {
-    std::string_view name;
-    std::string_view input;
-    std::string_view expected;
-    int optimise{};
-};
-
 auto collect_tests_from_file(
     TestContext& out,
     std::filesystem::path test_file
@@ -381,57 +405,92 @@ auto print_passedfailed(const std::vector<TestNameAndResult>& results) -> std::s
     return out;
 }
 
-void visit_directory(
-    TestContext& out,
+/// Run a test in a context of its own.
+bool run_test(const IRTest& t) {
+    lcc::Context context{default_target, default_format, default_options};
+
+    auto& got_f = context.create_file(
+        fmt::format("got.{}", t.name),
+        lcc::utils::to_vec(t.input)
+    );
+    auto got = lcc::Module::Parse(&context, got_f);
+    if (not got) return false;
+
+    if (t.optimise)
+        lcc::opt::Optimise(got.get(), t.optimise);
+
+    auto& expected_f = context.create_file(
+        fmt::format("expected.{}", t.name),
+        lcc::utils::to_vec(t.expected)
+    );
+    auto expected = lcc::Module::Parse(&context, expected_f);
+    if (not expected) {
+        lcc::Diag::Error("Test `{}` has malformed expected IR", t.name);
+        return false;
+    }
+
+    bool passed = langtest::perform_ir_match(*got, *expected);
+
+    // Writing a module as binary IR and reading it back must
+    // give the same module.
+    auto binary = got->as_binary_ir();
+    auto round_tripped = lcc::Module::ParseBinary(&context, binary);
+    if (
+        not round_tripped
+        or not langtest::perform_ir_match(*round_tripped, *got)
+    ) {
+        lcc::Diag::Error("Test `{}` did not survive a binary IR round trip", t.name);
+        passed = false;
+    }
+
+    return passed;
+}
+
+void collect_test_files(
+    std::vector<std::filesystem::path>& out,
     std::filesystem::path directory_path
 ) {
     for (const auto& entry : std::filesystem::directory_iterator(directory_path)) {
         if (entry.is_directory())
-            visit_directory(out, entry.path());
-        if (not entry.is_regular_file())
-            continue;
+            collect_test_files(out, entry.path());
+        if (entry.is_regular_file())
+            out.push_back(entry.path());
+    }
+}
 
-        if (out.option_per_directory_count)
-            fmt::print("{}:\n", entry.path().lexically_normal().string());
+void visit_directory(
+    TestContext& out,
+    std::filesystem::path directory_path
+) {
+    std::vector<std::filesystem::path> paths{};
+    collect_test_files(paths, directory_path);
+    // Report files in the same order every time.
+    std::ranges::sort(paths);
+
+    // Which tests belong to which file.
+    std::vector<lcc::usz> file_begin{};
+    for (const auto& path : paths) {
+        file_begin.push_back(out.tests.size());
+        auto tests = collect_tests_from_file(out, path);
+        out.tests.insert(out.tests.end(), tests.begin(), tests.end());
+    }
+    file_begin.push_back(out.tests.size());
 
-        auto tests = collect_tests_from_file(out, entry.path());
+    auto run_results = langtest::run_tests(out.tests.size(), [&](lcc::usz i) {
+        return run_test(out.tests[i]);
+    });
 
-        std::vector<TestNameAndResult> results{};
-        for (auto t : tests) {
-            const auto testpassfail = [&](std::string_view name, bool passed) {
-                results.emplace_back(name, passed);
+    for (lcc::usz file = 0; file < paths.size(); ++file) {
+        if (out.option_per_directory_count)
+            fmt::print("{}:\n", paths[file].lexically_normal().string());
 
-                if (not out.option_per_directory_count)
-                    return;
+        std::vector<TestNameAndResult> results{};
+        for (lcc::usz i = file_begin[file]; i < file_begin[file + 1]; ++i) {
+            fmt::print("{}", run_results[i].output);
+            results.emplace_back(out.tests[i].name, run_results[i].passed, run_results[i].time);
 
+            if (out.option_per_directory_count)
                 fmt::print("{}", print_test_passedfailed(results.back()));
-            };
-
-            auto& got_f = out.context.create_file(
-                fmt::format("got.{}", t.name),
-                lcc::utils::to_vec(t.input)
-            );
-            auto got = lcc::Module::Parse(&out.context, got_f);
-            if (not got) {
-                testpassfail(t.name, false);
-                continue;
-            }
-
-            if (t.optimise)
-                lcc::opt::Optimise(got.get(), t.optimise);
-
-            auto& expected_f = out.context.create_file(
-                fmt::format("expected.{}", t.name),
-                lcc::utils::to_vec(t.expected)
-            );
-            auto expected = lcc::Module::Parse(&out.context, expected_f);
-            if (not expected) {
-                lcc::Diag::Error("Test `{}` has malformed expected IR", t.name);
-                continue;
-            }
-
-            bool passed = langtest::perform_ir_match(*got, *expected);
-            testpassfail(t.name, passed);
         }
 
         if (out.option_per_directory_count)
@@ -441,24 +500,134 @@ void visit_directory(
     }
 }
 
+/// Compile every test on many threads at once, all sharing one
+/// context, and check that each thread gets the same IR as compiling
+/// the test on its own.
+void compile_concurrently(TestContext& out) {
+    auto Compile = [&](const IRTest& t) -> std::string {
+        auto& f = out.context.create_file(
+            fmt::format("concurrent.{}", t.name),
+            lcc::utils::to_vec(t.input)
+        );
+        auto mod = lcc::Module::Parse(&out.context, f);
+        if (not mod) return {};
+        if (t.optimise) lcc::opt::Optimise(mod.get(), t.optimise);
+        return mod->as_lcc_ir(false);
+    };
+
+    std::vector<std::string> reference{};
+    for (const auto& t : out.tests) reference.push_back(Compile(t));
+
+    static constexpr lcc::usz thread_count = 8;
+    std::atomic<bool> passed{true};
+    std::vector<std::thread> threads{};
+    for (lcc::usz i = 0; i < thread_count; ++i) {
+        threads.emplace_back([&, i] {
+            // Start each thread at a different test so they don't all
+            // create the same types at the same time.
+            for (lcc::usz n = 0; n < out.tests.size(); ++n) {
+                auto index = (i + n) % out.tests.size();
+                if (Compile(out.tests[index]) != reference[index])
+                    passed = false;
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    out.results.emplace_back("concurrent compilation", passed.load());
+    if (out.option_per_directory_count)
+        fmt::print("concurrent:\n{}", print_test_passedfailed(out.results.back()));
+}
+
+/// Check that keeping the dominator tree of a function up to date while
+/// changing its CFG gives the same tree and dominance frontiers as
+/// building it from scratch.
+///
+/// In every test, one terminator at a time, turn a conditional branch
+/// into a branch to its then block (removing an edge), and a branch into
+/// a conditional branch that may also loop back to its own block (adding
+/// one), and compare the cached tree after each change.
+void check_incremental_dominator_trees(TestContext& out) {
+    auto SameTree = [](lcc::Function* f) {
+        auto& cached = f->dominator_tree();
+        lcc::DomTree rebuilt{f};
+        if (cached.debug() != rebuilt.debug()) return false;
+
+        // The order within a frontier doesn't matter.
+        auto Frontier = [](lcc::DomTree& tree, lcc::Block* b) {
+            auto frontier = tree.dom_frontier(b);
+            return std::set<lcc::Block*>{frontier.begin(), frontier.end()};
+        };
+        return std::ranges::all_of(f->blocks(), [&](auto& b) {
+            return Frontier(cached, b.get()) == Frontier(rebuilt, b.get());
+        });
+    };
+
+    bool passed{true};
+    for (const auto& t : out.tests) {
+        lcc::Context context{default_target, default_format, default_options};
+        auto& file = context.create_file(
+            fmt::format("domtree.{}", t.name),
+            lcc::utils::to_vec(t.input)
+        );
+        auto mod = lcc::Module::Parse(&context, file);
+        if (not mod) continue;
+
+        for (auto& f : mod->code()) {
+            for (lcc::usz i = 0; i < f->blocks().size(); ++i) {
+                auto* block = f->blocks()[i].get();
+                auto* terminator = block->terminator();
+                // Some tests are of blocks that are still being built.
+                if (not terminator) continue;
+
+                // Make sure there is a tree to keep up to date.
+                (void) f->dominator_tree();
+
+                if (auto* cond_branch = lcc::cast<lcc::CondBranchInst>(terminator)) {
+                    terminator->replace_with(new (*mod) lcc::BranchInst(cond_branch->then_block()));
+                } else if (auto* branch = lcc::cast<lcc::BranchInst>(terminator)) {
+                    auto* cond = new (*mod) lcc::IntegerConstant(lcc::Type::I1Ty, lcc::aint(true));
+                    terminator->replace_with(new (*mod) lcc::CondBranchInst(cond, branch->target(), block));
+                } else continue;
+
+                if (not SameTree(f.get())) {
+                    lcc::Diag::Error(
+                        "Test `{}`: dominator tree of `{}` kept up to date differs from a rebuilt one after changing the terminator of block {}",
+                        t.name,
+                        f->names().at(0).name,
+                        i
+                    );
+                    passed = false;
+                }
+            }
+        }
+    }
+
+    out.results.emplace_back("incremental dominator trees", passed);
+    if (out.option_per_directory_count)
+        fmt::print("domtree:\n{}", print_test_passedfailed(out.results.back()));
+}
+
 int main(int argc, char** argv) {
-    lcc::Context context{
-        default_target,
-        default_format,
-        lcc::Context::Options{
-            lcc::Context::DoNotUseColour,
-            lcc::Context::DoNotPrintStats,
-            lcc::Context::DoNotDiagBacktrace,
-            lcc::Context::DoNotPrintAST,
-            lcc::Context::DoNotStopatLex,
-            lcc::Context::DoNotStopatSyntax,
-            lcc::Context::DoNotStopatSema,
-            lcc::Context::DoNotPrintMachineIR,
-            lcc::Context::DoNotStopatMIR
+    for (auto i = 1; i < argc; ++i) {
+        std::string_view arg{argv[i]};
+        if (arg.starts_with("-j")) {
+            auto jobs = arg.substr(2);
+            if (jobs.empty() and i + 1 < argc) jobs = argv[++i];
+            if (not langtest::parse_job_count(jobs)) {
+                fmt::print("ERROR: invalid number of jobs `{}`\n", jobs);
+                return 1;
+            }
+            continue;
         }
-    };
+        fmt::print(stderr, "WARNING: Ignoring unhandled command line option `{}'\n", arg);
+    }
+
+    lcc::Context context{default_target, default_format, default_options};
     TestContext test_context{context};
     visit_directory(test_context, "corpus");
+    compile_concurrently(test_context);
+    check_incremental_dominator_trees(test_context);
 
     std::string command_line{};
     for (auto i = 0; i < argc; ++i) {
@@ -485,6 +654,11 @@ int main(int argc, char** argv) {
         fmt::print("{}", print_test_passedfailed(result));
     }
 
+    langtest::TestContext timings{};
+    for (auto result : test_context.results)
+        timings.record_test(result.name, result.passed, result.time);
+    timings.print_slowest();
+
 #ifdef LCC_TEST_NON_ZERO_EXIT_ON_FAILURE
     if (any_failed)
         return 1;
@@ -70,7 +70,7 @@ struct GlintTest : langtest::Test {
         // Save diagnostics reported during parsing, and clear the context's
         // diagnostics so that we can separate parse/sema diagnostics.
         auto parse_diagnostics = context.diagnostics();
-        context.diagnostics().clear();
+        context.clear_diagnostics();
 
         return {std::move(mod), parse_diagnostics};
     };
@@ -161,7 +161,7 @@ struct GlintTest : langtest::Test {
         // of forced to print something just to delineate what that output came
         // from.
         if (not passed) {
-            fmt::print("  {}: {}FAIL{}\n\n", name, C(Colour::Red), C(Colour::Reset));
+            langtest::print("  {}: {}FAIL{}\n\n", name, C(Colour::Red), C(Colour::Reset));
             if (not ast_matches) {
                 std::string expected = matcher.print();
                 std::string got = langtest::print_node<lcc::glint::Expr>(
@@ -219,13 +219,13 @@ struct GlintTest : langtest::Test {
                     got_color.end()
                 );
 
-                fmt::print("EXPECTED: {}\n", expected);
-                fmt::print("GOT:      {}\n", got);
+                langtest::print("EXPECTED: {}\n", expected);
+                langtest::print("GOT:      {}\n", got);
             }
         }
 
         if (option_print and passed) {
-            fmt::print("  {}: {}PASS{}\n", name, C(Colour::Green), C(Colour::Reset));
+            langtest::print("  {}: {}PASS{}\n", name, C(Colour::Green), C(Colour::Reset));
         }
 
         return passed;
@@ -301,42 +301,100 @@ void help() {
         "  -r, --read <filepath> ::  Output the AST parsed from the given\n"
         "          source file, such that it could be used as the matcher\n"
         "          input for a test\n"
+        "  -j <jobs> ::  Run this many tests at the same time (default:\n"
+        "          one per hardware thread)\n"
     );
 }
 
-void visit_directory(langtest::TestContext& out, std::filesystem::path directory_path, bool option_count) {
+void collect_test_files(
+    std::vector<std::filesystem::path>& out,
+    std::filesystem::path directory_path
+) {
     for (const auto& entry : std::filesystem::directory_iterator(directory_path)) {
-        if (entry.is_regular_file()) {
-            if (option_print or option_count)
-                fmt::print("{}:\n", entry.path().lexically_normal().string());
+        if (entry.is_regular_file())
+            out.push_back(entry.path());
+        else if (entry.is_directory())
+            collect_test_files(out, entry.path());
+    }
+}
+
+void visit_directory(
+    langtest::TestContext& out,
+    std::filesystem::path directory_path,
+    bool option_count
+) {
+    std::vector<std::filesystem::path> paths{};
+    collect_test_files(paths, directory_path);
+    // Report files in the same order every time.
+    std::ranges::sort(paths);
+
+    auto files = langtest::process_ast_test_files<GlintTest>(paths);
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (option_print or option_count)
+            fmt::print("{}:\n", paths[i].lexically_normal().string());
 
-            auto count = langtest::process_ast_test_file<GlintTest>(entry.path());
+        fmt::print("{}", files[i].output);
+        auto& count = files[i].results;
 
-            if (option_count) {
+        if (option_count) {
+            fmt::print(
+                "  {}PASSED:  {}/{}{}\n",
+                C(lcc::Colour::Green),
+                count.count_passed(),
+                count.count(),
+                C(lcc::Colour::Reset)
+            );
+            if (count.count_failed()) {
                 fmt::print(
-                    "  {}PASSED:  {}/{}{}\n",
-                    C(lcc::Colour::Green),
-                    count.count_passed(),
-                    count.count(),
+                    "  {}FAILED:  {}{}\n",
+                    C(lcc::Colour::Red),
+                    count.count_failed(),
                     C(lcc::Colour::Reset)
                 );
-                if (count.count_failed()) {
-                    fmt::print(
-                        "  {}FAILED:  {}{}\n",
-                        C(lcc::Colour::Red),
-                        count.count_failed(),
-                        C(lcc::Colour::Reset)
-                    );
-                }
             }
-
-            out.merge(count);
-        } else if (entry.is_directory()) {
-            visit_directory(out, entry.path(), option_count);
         }
+
+        out.merge(count);
     }
 }
 
+/// Compile the tests in the corpus on several threads sharing one
+/// context, and check they compile the same as they do on their own.
+void check_concurrent_compilation(
+    langtest::TestContext& out,
+    std::filesystem::path directory_path
+) {
+    std::vector<std::filesystem::path> paths{};
+    collect_test_files(paths, directory_path);
+    std::ranges::sort(paths);
+
+    bool passed = langtest::compile_concurrently<GlintTest>(
+        paths,
+        default_target,
+        default_format,
+        [](lcc::Context& context, lcc::File& file, GlintTest test) -> std::string {
+            auto mod = lcc::glint::Parser::Parse(&context, file);
+            if (not mod or not test.should_check())
+                return {};
+
+            lcc::glint::Sema::Analyse(&context, *mod, true);
+            if (context.has_error())
+                return {};
+
+            auto printed = langtest::print_node<lcc::glint::Expr>(mod->top_level_function()->body());
+            if (not test.ir.empty() and test.stop_point == langtest::Test::StopPoint::None) {
+                std::unique_ptr<lcc::Module> ir{lcc::glint::IRGen::Generate(&context, *mod)};
+                printed += ir->as_lcc_ir(false);
+            }
+            return printed;
+        }
+    );
+
+    out.record_test("concurrent compilation", passed);
+    if (not passed)
+        fmt::print("  concurrent compilation: {}FAIL{}\n\n", C(Colour::Red), C(Colour::Reset));
+}
+
 void emit_sarif_file(
     const langtest::TestContext& results,
     std::filesystem::path outpath,
@@ -444,6 +502,21 @@ int main(int argc, const char** argv) {
             option_suppress = false;
             continue;
         }
+        if (arg.starts_with("-j")) {
+            auto jobs = arg.substr(2);
+            if (jobs.empty()) {
+                if (i + 1 >= argc) {
+                    fmt::print("ERROR: jobs option expects a number of jobs, but no argument was given\n");
+                    return 1;
+                }
+                jobs = argv[++i];
+            }
+            if (not langtest::parse_job_count(jobs)) {
+                fmt::print("ERROR: invalid number of jobs `{}`\n", jobs);
+                return 1;
+            }
+            continue;
+        }
         if (arg.starts_with("-r") or arg.starts_with("--read")) {
             if (i + 1 >= argc) {
                 fmt::print("ERROR: read option expects a source file input, but no argument was given\n");
@@ -503,9 +576,9 @@ int main(int argc, const char** argv) {
             }
             continue;
         }
-        lcc::Diag::Fatal(
-            "Unhandled command line option `{}'.\n"
-            "Use -h for more info.",
+        fmt::print(
+            stderr,
+            "WARNING: Ignoring unhandled command line option `{}' (use -h for more info)\n",
             arg
         );
     }
@@ -524,6 +597,7 @@ int main(int argc, const char** argv) {
     langtest::TestContext out{};
 
     visit_directory(out, "corpus", option_count);
+    check_concurrent_compilation(out, "corpus");
 
     // Emit Results in a SARIF file
     std::string command_line{argv[0]};
@@ -560,6 +634,8 @@ int main(int argc, const char** argv) {
         );
     }
 
+    out.print_slowest();
+
 #ifdef LCC_TEST_NON_ZERO_EXIT_ON_FAILURE
     if (out.count_failed())
        return 1;
@@ -282,6 +282,7 @@ strings were stored to."
          :command
          `(,lcc-path
            ,@source-files
+           ,@(plist-get test :flags)
            "-x" "ir"
            "-o" ,output-file
            "--run")
@@ -361,6 +362,7 @@ strings were stored to."
          :command
          `(,lcc-path
            ,@source-files
+           ,@(plist-get test :flags)
            "-x" "glint"
            "-o" ,output-file
            "--run")
@@ -489,6 +491,7 @@ strings were stored to."
          :command
          `(,lcc-path
            ,@source-files
+           ,@(plist-get test :flags)
            "-x" "c"
            "-o" ,output-file
            "--run")